@@ -0,0 +1,361 @@
+// Capture pipeline microbenchmark.
+//
+// Runs N independent streams, each a virtual source feeding its own
+// CapturePipeline on its own thread as fast as it can, and reports how much
+// faster than real time one core processes a stream (streams per core), the
+// per-packet and per-stage latency percentiles and the heap allocations made
+// while streaming (which should be zero).
+//
+// Built with -DNATIVE_AUDIO_BENCH=ON:
+//   capture_bench [--scenario NAME|all] [--streams N] [--seconds S]
+//                 [--packet FRAMES] [--chunk MS] [--json]
+
+#include "capture_pipeline.h"
+#include "capture_stats.h"
+#include "virtual_source.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+// ============================================================================
+// Allocation counting
+// ============================================================================
+
+static std::atomic<uint64_t> g_allocations{0};
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size ? size : 1);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+// ============================================================================
+// Scenarios
+// ============================================================================
+
+namespace {
+
+struct Scenario {
+    const char* name;
+    double inputRate;
+    uint32_t inputChannels;
+    double outputRate;   // 0 = same as input
+    bool mono;
+    int32_t sampleFormat;
+    int32_t encoding;
+};
+
+// The common shapes: untouched device format, speech-recognition format,
+// CD-rate devices converted up, and the encoders
+const Scenario kScenarios[] = {
+    {"passthrough-f32",   48000, 2, 0,     false, DSP_FORMAT_F32, AUDIO_ENCODER_PCM},
+    {"48k-stereo-16k-s16", 48000, 2, 16000, true,  DSP_FORMAT_S16, AUDIO_ENCODER_PCM},
+    {"44k1-48k-f32",      44100, 2, 48000, false, DSP_FORMAT_F32, AUDIO_ENCODER_PCM},
+    {"48k-16k-flac",      48000, 2, 16000, true,  DSP_FORMAT_S16, AUDIO_ENCODER_FLAC},
+    {"48k-opus",          48000, 2, 48000, true,  DSP_FORMAT_S16, AUDIO_ENCODER_OPUS},
+};
+
+struct Options {
+    std::string scenario = "all";
+    unsigned streams = 0;        // 0 = one per hardware thread
+    double seconds = 60;         // Audio per stream
+    uint32_t packetFrames = 480;
+    double chunkMs = 100;
+    bool json = false;
+};
+
+struct Stream {
+    VirtualSource* source = nullptr;
+    CapturePipeline pipeline;
+    CaptureStats* stats = nullptr;
+    std::vector<float> packet;
+    std::vector<uint64_t> packetNs;  // Process() time of every packet, reserved up front
+    uint64_t packets = 0;
+    uint64_t bytes = 0;
+    double wallSeconds = 0;
+};
+
+struct Result {
+    const Scenario* scenario;
+    unsigned streams;
+    double audioSeconds;         // Per stream
+    double realtimeFactor;       // Audio seconds per processing second, averaged over streams
+    double streamsPerCore;
+    uint64_t packetP50Ns, packetP99Ns, packetMaxNs;
+    uint64_t stageP50Ns[CAPTURE_STAGE_COUNT], stageP99Ns[CAPTURE_STAGE_COUNT];
+    uint64_t chunks;
+    uint64_t bytesOut;
+    uint64_t allocations;        // While streaming, all streams together
+    uint64_t bytesAllocated;     // Pipeline buffers, per stream
+};
+
+void CountBytes(const uint8_t*, size_t byteCount, const AudioChunkInfo&, void* context) {
+    static_cast<Stream*>(context)->bytes += byteCount;
+}
+
+uint64_t Percentile(std::vector<uint64_t>& values, double fraction) {
+    if (values.empty()) return 0;
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+// Returns false if the scenario can't be configured (e.g. Opus not built in)
+bool RunScenario(const Scenario& scenario, const Options& options, Result* result) {
+    const unsigned count = options.streams;
+    const uint64_t totalFrames = static_cast<uint64_t>(options.seconds * scenario.inputRate);
+    const size_t packetsPerStream = static_cast<size_t>(totalFrames / options.packetFrames + 1);
+
+    // Everything is set up before the clock and the allocation counter start
+    std::vector<std::unique_ptr<Stream>> streams;
+    for (unsigned i = 0; i < count; i++) {
+        auto stream = std::make_unique<Stream>();
+
+        VirtualSourceConfig source = {};
+        source.sampleRate = scenario.inputRate;
+        source.channels = scenario.inputChannels;
+        source.framesPerPacket = options.packetFrames;
+        source.signal = VIRTUAL_SIGNAL_NOISE;
+        source.amplitude = 0.5;
+        source.seed = i + 1;
+        stream->source = virtual_source_create(&source);
+
+        CapturePipeline::Config config;
+        config.inputSampleRate = scenario.inputRate;
+        config.inputChannels = scenario.inputChannels;
+        config.outputSampleRate = scenario.outputRate;
+        config.mono = scenario.mono;
+        config.chunkDurationMs = options.chunkMs;
+        config.maxFramesPerPacket = options.packetFrames;
+        config.sampleFormat = scenario.sampleFormat;
+        config.encoding = scenario.encoding;
+        if (!stream->source || !stream->pipeline.Configure(config, CountBytes, stream.get())) {
+            virtual_source_destroy(stream->source);
+            for (auto& s : streams) {
+                virtual_source_destroy(s->source);
+                capture_stats_destroy(s->stats);
+            }
+            return false;
+        }
+
+        stream->stats = capture_stats_create();
+        stream->pipeline.SetStats(stream->stats);
+        stream->packet.resize(static_cast<size_t>(options.packetFrames) * scenario.inputChannels);
+        stream->packetNs.reserve(packetsPerStream);
+        streams.push_back(std::move(stream));
+    }
+
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+    for (auto& entry : streams) {
+        Stream* stream = entry.get();
+        threads.emplace_back([stream, &go, &scenario, totalFrames, &options]() {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+
+            const uint64_t startNs = capture_stats_now_ns();
+            uint64_t frames = 0;
+            while (frames < totalFrames) {
+                size_t n = static_cast<size_t>(std::min<uint64_t>(options.packetFrames, totalFrames - frames));
+                virtual_source_generate(stream->source, stream->packet.data(), n);
+                uint64_t hostTimeNs = startNs + static_cast<uint64_t>(
+                    static_cast<double>(frames) * 1e9 / scenario.inputRate);
+
+                uint64_t before = capture_stats_now_ns();
+                stream->pipeline.Process(stream->packet.data(), n, hostTimeNs, 0);
+                stream->packetNs.push_back(capture_stats_now_ns() - before);
+                frames += n;
+            }
+            stream->packets = stream->packetNs.size();
+            stream->wallSeconds = static_cast<double>(capture_stats_now_ns() - startNs) / 1e9;
+        });
+    }
+
+    const uint64_t allocationsBefore = g_allocations.load();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : threads) thread.join();
+    const uint64_t allocationsAfter = g_allocations.load();
+
+    // Generating the signal is part of each thread's time; it is cheap next
+    // to the pipeline but makes these figures a slight underestimate
+    *result = Result{};
+    result->scenario = &scenario;
+    result->streams = count;
+    result->audioSeconds = static_cast<double>(totalFrames) / scenario.inputRate;
+    result->allocations = allocationsAfter - allocationsBefore;
+    result->bytesAllocated = streams[0]->pipeline.AllocatedBytes();
+
+    double wallTotal = 0;
+    std::vector<uint64_t> packetNs;
+    packetNs.reserve(packetsPerStream * count);
+    std::vector<uint64_t> stageP50[CAPTURE_STAGE_COUNT], stageP99[CAPTURE_STAGE_COUNT];
+    for (auto& stream : streams) {
+        wallTotal += stream->wallSeconds;
+        packetNs.insert(packetNs.end(), stream->packetNs.begin(), stream->packetNs.end());
+        result->bytesOut += stream->bytes;
+
+        AudioCaptureStats snapshot;
+        capture_stats_snapshot(stream->stats, &snapshot);
+        result->chunks += snapshot.stages[CAPTURE_STAGE_CHUNK].count;
+        for (int s = 0; s < CAPTURE_STAGE_COUNT; s++) {
+            stageP50[s].push_back(capture_stats_percentile_ns(&snapshot.stages[s], 0.5));
+            stageP99[s].push_back(capture_stats_percentile_ns(&snapshot.stages[s], 0.99));
+        }
+
+        virtual_source_destroy(stream->source);
+        capture_stats_destroy(stream->stats);
+    }
+
+    // One thread per stream: if there are more streams than cores they share,
+    // and the wall time per stream grows accordingly
+    double meanWall = wallTotal / count;
+    result->realtimeFactor = meanWall > 0 ? result->audioSeconds / meanWall : 0;
+    unsigned cores = std::max(1u, std::thread::hardware_concurrency());
+    result->streamsPerCore = result->realtimeFactor * count / std::min(count, cores);
+
+    result->packetMaxNs = packetNs.empty() ? 0 : *std::max_element(packetNs.begin(), packetNs.end());
+    result->packetP50Ns = Percentile(packetNs, 0.5);
+    result->packetP99Ns = Percentile(packetNs, 0.99);
+    // Median across streams of each stream's percentile
+    for (int s = 0; s < CAPTURE_STAGE_COUNT; s++) {
+        result->stageP50Ns[s] = Percentile(stageP50[s], 0.5);
+        result->stageP99Ns[s] = Percentile(stageP99[s], 0.5);
+    }
+    return true;
+}
+
+const char* const kStageNames[CAPTURE_STAGE_COUNT] = {"convert", "resample", "chunk", "delivery"};
+
+void PrintText(const Result& r) {
+    std::printf("%-20s streams=%u realtime=%.0fx streams/core=%.0f chunks=%llu allocs=%llu buffers=%lluB\n",
+                r.scenario->name, r.streams, r.realtimeFactor, r.streamsPerCore,
+                static_cast<unsigned long long>(r.chunks),
+                static_cast<unsigned long long>(r.allocations),
+                static_cast<unsigned long long>(r.bytesAllocated));
+    std::printf("%-20s packet p50=%.1fus p99=%.1fus max=%.1fus", "",
+                r.packetP50Ns / 1e3, r.packetP99Ns / 1e3, r.packetMaxNs / 1e3);
+    for (int s = 0; s < CAPTURE_STAGE_DELIVERY; s++) {
+        std::printf(" | %s p50=%.1fus p99=%.1fus", kStageNames[s], r.stageP50Ns[s] / 1e3, r.stageP99Ns[s] / 1e3);
+    }
+    std::printf("\n");
+}
+
+void PrintJson(const Result& r, bool first) {
+    std::printf("%s\n  {\"scenario\": \"%s\", \"streams\": %u, \"audioSeconds\": %.3f, "
+                "\"realtimeFactor\": %.1f, \"streamsPerCore\": %.1f, \"chunks\": %llu, \"bytesOut\": %llu, "
+                "\"allocations\": %llu, \"bytesAllocated\": %llu, "
+                "\"packetNs\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu}, \"stagesNs\": {",
+                first ? "" : ",", r.scenario->name, r.streams, r.audioSeconds, r.realtimeFactor,
+                r.streamsPerCore, static_cast<unsigned long long>(r.chunks),
+                static_cast<unsigned long long>(r.bytesOut),
+                static_cast<unsigned long long>(r.allocations),
+                static_cast<unsigned long long>(r.bytesAllocated),
+                static_cast<unsigned long long>(r.packetP50Ns),
+                static_cast<unsigned long long>(r.packetP99Ns),
+                static_cast<unsigned long long>(r.packetMaxNs));
+    for (int s = 0; s < CAPTURE_STAGE_DELIVERY; s++) {
+        std::printf("%s\"%s\": {\"p50\": %llu, \"p99\": %llu}", s ? ", " : "", kStageNames[s],
+                    static_cast<unsigned long long>(r.stageP50Ns[s]),
+                    static_cast<unsigned long long>(r.stageP99Ns[s]));
+    }
+    std::printf("}}");
+}
+
+bool ParseArgs(int argc, char** argv, Options* options) {
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (std::strcmp(arg, "--json") == 0) {
+            options->json = true;
+        } else if (std::strcmp(arg, "--scenario") == 0 && value) {
+            options->scenario = value;
+            i++;
+        } else if (std::strcmp(arg, "--streams") == 0 && value) {
+            options->streams = static_cast<unsigned>(std::atoi(value));
+            i++;
+        } else if (std::strcmp(arg, "--seconds") == 0 && value) {
+            options->seconds = std::atof(value);
+            i++;
+        } else if (std::strcmp(arg, "--packet") == 0 && value) {
+            options->packetFrames = static_cast<uint32_t>(std::atoi(value));
+            i++;
+        } else if (std::strcmp(arg, "--chunk") == 0 && value) {
+            options->chunkMs = std::atof(value);
+            i++;
+        } else {
+            return false;
+        }
+    }
+    if (options->streams == 0) options->streams = std::max(1u, std::thread::hardware_concurrency());
+    return options->seconds > 0 && options->packetFrames > 0 && options->chunkMs > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!ParseArgs(argc, argv, &options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--scenario NAME|all] [--streams N] [--seconds S] [--packet FRAMES] "
+                     "[--chunk MS] [--json]\nscenarios:",
+                     argv[0]);
+        for (const Scenario& scenario : kScenarios) std::fprintf(stderr, " %s", scenario.name);
+        std::fprintf(stderr, "\n");
+        return 2;
+    }
+
+    bool matched = false;
+    bool first = true;
+    if (options.json) std::printf("[");
+    for (const Scenario& scenario : kScenarios) {
+        if (options.scenario != "all" && options.scenario != scenario.name) continue;
+        matched = true;
+
+        Result result;
+        if (!RunScenario(scenario, options, &result)) {
+            std::fprintf(stderr, "%s: skipped (encoding not available in this build)\n", scenario.name);
+            continue;
+        }
+        if (options.json) {
+            PrintJson(result, first);
+        } else {
+            PrintText(result);
+        }
+        first = false;
+    }
+    if (options.json) std::printf("\n]\n");
+
+    if (!matched) {
+        std::fprintf(stderr, "unknown scenario: %s\n", options.scenario.c_str());
+        return 2;
+    }
+    return 0;
+}
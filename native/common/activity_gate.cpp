@@ -0,0 +1,56 @@
+#include "activity_gate.h"
+
+#include <cmath>
+
+void activity_gate_init(ActivityGateState* gate, double sampleRate, double thresholdDb, double hangoverMs) {
+    gate->detector = nullptr;
+    gate->detectorContext = nullptr;
+    gate->threshold = std::pow(10.0, thresholdDb / 10.0);
+    gate->hangoverFrames = hangoverMs > 0 ? static_cast<uint64_t>(hangoverMs * sampleRate / 1000.0) : 0;
+    activity_gate_reset(gate);
+}
+
+void activity_gate_set_detector(ActivityGateState* gate, ActivityDetector detector, void* context) {
+    gate->detector = detector;
+    gate->detectorContext = context;
+}
+
+void activity_gate_reset(ActivityGateState* gate) {
+    gate->quietFrames = 0;
+    gate->open = false;
+}
+
+static bool AboveThreshold(const float* samples, size_t count, double threshold) {
+    if (count == 0) return false;
+    double sum = 0.0;
+    for (size_t i = 0; i < count; i++) {
+        sum += static_cast<double>(samples[i]) * samples[i];
+    }
+    return sum / static_cast<double>(count) >= threshold;
+}
+
+int32_t activity_gate_process(ActivityGateState* gate, const float* samples, size_t frames, uint32_t channels) {
+    bool active = false;
+    if (samples && frames > 0) {
+        active = gate->detector
+            ? gate->detector(samples, frames, channels, gate->detectorContext)
+            : AboveThreshold(samples, frames * channels, gate->threshold);
+    }
+
+    if (active) {
+        gate->quietFrames = 0;
+        if (!gate->open) {
+            gate->open = true;
+            return ACTIVITY_GATE_PASS | ACTIVITY_GATE_OPENED;
+        }
+        return ACTIVITY_GATE_PASS;
+    }
+
+    if (!gate->open) return 0;
+
+    gate->quietFrames += frames;
+    if (gate->quietFrames <= gate->hangoverFrames) return ACTIVITY_GATE_PASS;
+
+    gate->open = false;
+    return ACTIVITY_GATE_CLOSED;
+}
@@ -0,0 +1,755 @@
+#include "audio_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "dsp_kernels.h"
+
+#ifdef NATIVE_AUDIO_HAS_OPUS
+#include <opus.h>
+#endif
+
+// Encoders share one interface behind the opaque C handle
+struct AudioEncoder {
+    virtual ~AudioEncoder() = default;
+    virtual size_t Encode(const float* samples, size_t frames, const uint8_t** out) = 0;
+    virtual void Reset() = 0;
+    virtual size_t Granularity() const { return 1; }
+    virtual const char* Name() const = 0;
+    virtual uint32_t Bits() const = 0;
+    virtual bool IsFloat() const { return false; }
+};
+
+namespace {
+
+void PutLe16(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value);
+    out[1] = static_cast<uint8_t>(value >> 8);
+}
+
+void PutLe32(uint8_t* out, uint32_t value) {
+    PutLe16(out, value);
+    PutLe16(out + 2, value >> 16);
+}
+
+// ============================================================================
+// WAV
+// ============================================================================
+
+class WavEncoder : public AudioEncoder {
+public:
+    static constexpr size_t kHeaderBytes = AUDIO_WAV_HEADER_BYTES;
+
+    WavEncoder(const AudioEncoderConfig& config, size_t sampleBytes)
+        : channels_(config.channels),
+          sampleFormat_(config.sampleFormat),
+          sampleBytes_(sampleBytes),
+          maxFrames_(config.maxFrames),
+          buffer_(kHeaderBytes + config.maxFrames * config.channels * sampleBytes) {
+        audio_wav_header(header_, config.sampleRate, channels_, static_cast<uint32_t>(sampleBytes_ * 8),
+                         sampleFormat_ == DSP_FORMAT_F32);
+        Reset();
+    }
+
+    size_t Encode(const float* samples, size_t frames, const uint8_t** out) override {
+        frames = std::min(frames, maxFrames_);
+        size_t offset = 0;
+        if (!headerSent_) {
+            std::memcpy(buffer_.data(), header_, kHeaderBytes);
+            offset = kHeaderBytes;
+            headerSent_ = true;
+        }
+        offset += dsp_encode_f32(samples, frames, channels_, sampleFormat_, false,
+                                 sampleFormat_ == DSP_FORMAT_S16 ? &dither_ : nullptr,
+                                 buffer_.data() + offset);
+        *out = buffer_.data();
+        return offset;
+    }
+
+    void Reset() override {
+        headerSent_ = false;
+        dsp_dither_init(&dither_, 0);
+    }
+
+    const char* Name() const override { return "wav"; }
+    uint32_t Bits() const override { return static_cast<uint32_t>(sampleBytes_ * 8); }
+    bool IsFloat() const override { return sampleFormat_ == DSP_FORMAT_F32; }
+
+private:
+    uint32_t channels_;
+    int32_t sampleFormat_;
+    size_t sampleBytes_;
+    size_t maxFrames_;
+    uint8_t header_[kHeaderBytes];
+    std::vector<uint8_t> buffer_;
+    bool headerSent_ = false;
+    DspDitherState dither_;
+};
+
+// ============================================================================
+// FLAC
+// Fixed predictors (orders 0-4) with partitioned Rice residuals, and stereo
+// decorrelation picked per frame. That gets most of libFLAC's default ratio
+// with no LPC analysis, so it's cheap enough for the capture thread.
+// ============================================================================
+
+// MSB-first bit packer over a caller-sized buffer
+class BitWriter {
+public:
+    void Begin(uint8_t* out) {
+        out_ = out;
+        bytes_ = 0;
+        accumulator_ = 0;
+        bits_ = 0;
+    }
+
+    void Write(uint32_t value, uint32_t count) {
+        if (count == 0) return;
+        uint64_t mask = (uint64_t(1) << count) - 1;
+        accumulator_ = (accumulator_ << count) | (value & mask);
+        bits_ += count;
+        while (bits_ >= 8) {
+            bits_ -= 8;
+            out_[bytes_++] = static_cast<uint8_t>(accumulator_ >> bits_);
+        }
+    }
+
+    void WriteSigned(int32_t value, uint32_t count) { Write(static_cast<uint32_t>(value), count); }
+
+    // `zeros` 0 bits followed by a 1
+    void WriteUnary(uint32_t zeros) {
+        while (zeros >= 32) {
+            Write(0, 32);
+            zeros -= 32;
+        }
+        Write(1, zeros + 1);
+    }
+
+    void AlignToByte() {
+        if (bits_ > 0) Write(0, 8 - bits_);
+    }
+
+    size_t Bytes() const { return bytes_; }
+
+private:
+    uint8_t* out_ = nullptr;
+    size_t bytes_ = 0;
+    uint64_t accumulator_ = 0;
+    uint32_t bits_ = 0;
+};
+
+struct CrcTables {
+    uint8_t crc8[256];
+    uint16_t crc16[256];
+
+    CrcTables() {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c8 = i;
+            uint32_t c16 = i << 8;
+            for (int bit = 0; bit < 8; bit++) {
+                c8 = (c8 & 0x80) ? (c8 << 1) ^ 0x07 : c8 << 1;
+                c16 = (c16 & 0x8000) ? (c16 << 1) ^ 0x8005 : c16 << 1;
+            }
+            crc8[i] = static_cast<uint8_t>(c8);
+            crc16[i] = static_cast<uint16_t>(c16);
+        }
+    }
+};
+
+const CrcTables& Crc() {
+    static const CrcTables tables;
+    return tables;
+}
+
+uint8_t Crc8(const uint8_t* data, size_t count) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < count; i++) crc = Crc().crc8[crc ^ data[i]];
+    return crc;
+}
+
+uint16_t Crc16(const uint8_t* data, size_t count) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < count; i++) {
+        crc = static_cast<uint16_t>((crc << 8) ^ Crc().crc16[(crc >> 8) ^ data[i]]);
+    }
+    return crc;
+}
+
+inline uint32_t ZigZag(int32_t value) {
+    return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+}
+
+// Residual of fixed predictor `order` at sample i (i >= order)
+inline int64_t FixedResidual(const int32_t* x, size_t i, uint32_t order) {
+    switch (order) {
+        case 0: return x[i];
+        case 1: return int64_t(x[i]) - x[i - 1];
+        case 2: return int64_t(x[i]) - 2 * int64_t(x[i - 1]) + x[i - 2];
+        case 3: return int64_t(x[i]) - 3 * int64_t(x[i - 1]) + 3 * int64_t(x[i - 2]) - x[i - 3];
+        default:
+            return int64_t(x[i]) - 4 * int64_t(x[i - 1]) + 6 * int64_t(x[i - 2])
+                 - 4 * int64_t(x[i - 3]) + x[i - 4];
+    }
+}
+
+class FlacEncoder : public AudioEncoder {
+public:
+    static constexpr size_t kMaxBlock = 4096;
+    static constexpr size_t kMinBlock = 16;        // Only the last frame of a stream may be shorter
+    static constexpr uint32_t kMaxOrder = 4;
+    static constexpr uint32_t kMaxPartitionOrder = 6;
+    static constexpr uint32_t kMaxRiceParameter = 14; // 15 is the escape code
+
+    FlacEncoder(const AudioEncoderConfig& config)
+        : channels_(config.channels),
+          bits_(config.sampleFormat == DSP_FORMAT_S24 ? 24 : 16),
+          sampleRate_(static_cast<uint32_t>(std::lround(config.sampleRate))),
+          maxFrames_(config.maxFrames),
+          pcm16_(kMaxBlock * config.channels),
+          mid_(kMaxBlock),
+          side_(kMaxBlock),
+          residual_(kMaxBlock),
+          pending_((config.maxFrames + kMinBlock) * config.channels) {
+        for (auto& channel : planes_) channel.assign(kMaxBlock, 0);
+
+        // Worst case is every subframe verbatim, side channels one bit wider
+        size_t maxBlockFrames = maxFrames_ + kMinBlock;
+        size_t blocks = (maxBlockFrames + kMaxBlock - 1) / kMaxBlock + 1;
+        size_t perFrameOverhead = 20 + 2 * static_cast<size_t>(channels_);
+        size_t payload = channels_ * (((bits_ + 1) * maxBlockFrames + 7) / 8 + blocks);
+        buffer_.assign(64 + blocks * perFrameOverhead + payload, 0);
+        Reset();
+    }
+
+    size_t Encode(const float* samples, size_t frames, const uint8_t** out) override {
+        frames = std::min(frames, maxFrames_);
+        size_t offset = 0;
+        if (!headerSent_) {
+            offset = WriteStreamHeader(buffer_.data());
+            headerSent_ = true;
+        }
+
+        // A call shorter than kMinBlock is carried over and leads the next one
+        if (pendingFrames_ > 0 || frames < kMinBlock) {
+            std::memcpy(pending_.data() + pendingFrames_ * channels_, samples, frames * channels_ * sizeof(float));
+            pendingFrames_ += frames;
+            *out = buffer_.data();
+            if (pendingFrames_ < kMinBlock) return offset;
+            samples = pending_.data();
+            frames = pendingFrames_;
+            pendingFrames_ = 0;
+        }
+
+        // Split evenly so a chunk never ends in a runt frame
+        size_t blocks = (frames + kMaxBlock - 1) / kMaxBlock;
+        for (size_t b = 0; b < blocks; b++) {
+            size_t begin = frames * b / blocks;
+            size_t end = frames * (b + 1) / blocks;
+            offset += EncodeFrame(samples + begin * channels_, end - begin, buffer_.data() + offset);
+        }
+
+        *out = buffer_.data();
+        return offset;
+    }
+
+    void Reset() override {
+        headerSent_ = false;
+        sampleNumber_ = 0;
+        pendingFrames_ = 0;
+        dsp_dither_init(&dither_, 0);
+    }
+
+    size_t Granularity() const override { return kMinBlock; }
+    const char* Name() const override { return "flac"; }
+    uint32_t Bits() const override { return bits_; }
+
+private:
+    // Subframe plan: how one channel of a frame is coded, and its exact size
+    struct Subframe {
+        enum Type { Constant, Verbatim, Fixed } type = Verbatim;
+        uint32_t order = 0;
+        uint32_t partitionOrder = 0;
+        uint32_t parameters[1 << kMaxPartitionOrder] = {};
+        uint64_t bits = 0;
+    };
+
+    size_t WriteStreamHeader(uint8_t* out) {
+        std::memcpy(out, "fLaC", 4);
+        writer_.Begin(out + 4);
+        writer_.Write(1, 1);             // Last metadata block
+        writer_.Write(0, 7);             // STREAMINFO
+        writer_.Write(34, 24);
+        writer_.Write(kMinBlock, 16);    // Min block size
+        writer_.Write(kMaxBlock, 16);    // Max block size
+        writer_.Write(0, 24);            // Min/max frame size unknown
+        writer_.Write(0, 24);
+        writer_.Write(sampleRate_, 20);
+        writer_.Write(channels_ - 1, 3);
+        writer_.Write(bits_ - 1, 5);
+        writer_.Write(0, 4);             // Total samples unknown (36 bits)
+        writer_.Write(0, 32);
+        for (int i = 0; i < 4; i++) writer_.Write(0, 32); // No MD5
+        return 4 + writer_.Bytes();
+    }
+
+    // Quantize and deinterleave one block into planes_
+    void LoadBlock(const float* samples, size_t frames) {
+        const size_t count = frames * channels_;
+        if (bits_ == 16) {
+            // Same dither as s16 PCM output
+            dsp_f32_to_s16(samples, pcm16_.data(), count, &dither_);
+            for (size_t i = 0; i < count; i++) planes_[i % channels_][i / channels_] = pcm16_[i];
+        } else {
+            for (size_t i = 0; i < count; i++) {
+                float scaled = std::max(-1.0f, std::min(1.0f, samples[i])) * 8388607.0f;
+                long value = std::max(-8388608L, std::min(8388607L, std::lrint(scaled)));
+                planes_[i % channels_][i / channels_] = static_cast<int32_t>(value);
+            }
+        }
+    }
+
+    // Sum of |residual| for every fixed order, to pick one without coding them all
+    static uint32_t BestFixedOrder(const int32_t* x, size_t n, uint64_t* cost) {
+        uint64_t sums[kMaxOrder + 1] = {};
+        for (size_t i = kMaxOrder; i < n; i++) {
+            for (uint32_t order = 0; order <= kMaxOrder; order++) {
+                sums[order] += static_cast<uint64_t>(std::llabs(FixedResidual(x, i, order)));
+            }
+        }
+        uint32_t best = 0;
+        for (uint32_t order = 1; order <= kMaxOrder; order++) {
+            if (sums[order] < sums[best]) best = order;
+        }
+        if (cost) *cost = sums[best];
+        return best;
+    }
+
+    static uint32_t RiceParameter(uint64_t sum, size_t count) {
+        uint32_t k = 0;
+        while (k < kMaxRiceParameter && (static_cast<uint64_t>(count) << (k + 1)) < sum) k++;
+        return k;
+    }
+
+    // Choose the coding of one channel; leaves its residual in residual_ for fixed plans
+    void PlanSubframe(const int32_t* x, size_t n, uint32_t bits, Subframe* plan) {
+        // Sizes include the 8-bit subframe header
+        plan->type = Subframe::Verbatim;
+        plan->bits = 8 + static_cast<uint64_t>(bits) * n;
+
+        bool constant = true;
+        for (size_t i = 1; i < n && constant; i++) constant = x[i] == x[0];
+        if (constant) {
+            plan->type = Subframe::Constant;
+            plan->bits = 8 + bits;
+            return;
+        }
+        if (n <= kMaxOrder) return;
+
+        uint32_t order = BestFixedOrder(x, n, nullptr);
+        for (size_t i = order; i < n; i++) {
+            residual_[i] = ZigZag(static_cast<int32_t>(FixedResidual(x, i, order)));
+        }
+
+        // Partition sums at the finest order, merged pairwise for coarser ones
+        uint32_t maxPartitionOrder = 0;
+        while (maxPartitionOrder < kMaxPartitionOrder &&
+               n % (size_t(1) << (maxPartitionOrder + 1)) == 0 &&
+               (n >> (maxPartitionOrder + 1)) > order) {
+            maxPartitionOrder++;
+        }
+        uint64_t sums[1 << kMaxPartitionOrder] = {};
+        size_t partitionSize = n >> maxPartitionOrder;
+        for (size_t p = 0; p < (size_t(1) << maxPartitionOrder); p++) {
+            size_t begin = p == 0 ? order : p * partitionSize;
+            for (size_t i = begin; i < (p + 1) * partitionSize; i++) sums[p] += residual_[i];
+        }
+
+        uint64_t bestEstimate = UINT64_MAX;
+        for (uint32_t po = maxPartitionOrder + 1; po-- > 0;) {
+            size_t partitions = size_t(1) << po;
+            if (po < maxPartitionOrder) {
+                for (size_t p = 0; p < partitions; p++) sums[p] = sums[2 * p] + sums[2 * p + 1];
+            }
+            uint64_t estimate = 0;
+            uint32_t parameters[1 << kMaxPartitionOrder];
+            for (size_t p = 0; p < partitions; p++) {
+                size_t count = (n >> po) - (p == 0 ? order : 0);
+                parameters[p] = RiceParameter(sums[p], count);
+                estimate += 4 + count * (parameters[p] + 1) + (sums[p] >> parameters[p]);
+            }
+            if (estimate < bestEstimate) {
+                bestEstimate = estimate;
+                plan->partitionOrder = po;
+                std::memcpy(plan->parameters, parameters, partitions * sizeof(uint32_t));
+            }
+        }
+
+        // Exact size, so the verbatim fallback really is the bound
+        uint64_t exact = 8 + static_cast<uint64_t>(order) * bits + 6;
+        size_t partitions = size_t(1) << plan->partitionOrder;
+        partitionSize = n >> plan->partitionOrder;
+        for (size_t p = 0; p < partitions; p++) {
+            uint32_t k = plan->parameters[p];
+            size_t begin = p == 0 ? order : p * partitionSize;
+            exact += 4;
+            for (size_t i = begin; i < (p + 1) * partitionSize; i++) exact += (residual_[i] >> k) + 1 + k;
+        }
+        if (exact < plan->bits) {
+            plan->type = Subframe::Fixed;
+            plan->order = order;
+            plan->bits = exact;
+        }
+    }
+
+    void WriteSubframe(const int32_t* x, size_t n, uint32_t bits) {
+        Subframe plan;
+        PlanSubframe(x, n, bits, &plan);
+
+        writer_.Write(0, 1);
+        switch (plan.type) {
+            case Subframe::Constant:
+                writer_.Write(0, 6);
+                writer_.Write(0, 1);
+                writer_.WriteSigned(x[0], bits);
+                return;
+            case Subframe::Verbatim:
+                writer_.Write(1, 6);
+                writer_.Write(0, 1);
+                for (size_t i = 0; i < n; i++) writer_.WriteSigned(x[i], bits);
+                return;
+            case Subframe::Fixed:
+                break;
+        }
+
+        writer_.Write(0x08 | plan.order, 6);
+        writer_.Write(0, 1);
+        for (uint32_t i = 0; i < plan.order; i++) writer_.WriteSigned(x[i], bits);
+        writer_.Write(0, 2);             // Rice coding, 4-bit parameters
+        writer_.Write(plan.partitionOrder, 4);
+        size_t partitionSize = n >> plan.partitionOrder;
+        for (size_t p = 0; p < (size_t(1) << plan.partitionOrder); p++) {
+            uint32_t k = plan.parameters[p];
+            writer_.Write(k, 4);
+            for (size_t i = p == 0 ? plan.order : p * partitionSize; i < (p + 1) * partitionSize; i++) {
+                writer_.WriteUnary(residual_[i] >> k);
+                writer_.Write(residual_[i], k);
+            }
+        }
+    }
+
+    size_t EncodeFrame(const float* samples, size_t n, uint8_t* out) {
+        LoadBlock(samples, n);
+
+        // Stereo: code whichever pair of left, right, mid and side is cheapest
+        uint32_t assignment = channels_ - 1;
+        if (channels_ == 2) {
+            int32_t* left = planes_[0].data();
+            int32_t* right = planes_[1].data();
+            for (size_t i = 0; i < n; i++) {
+                mid_[i] = (left[i] + right[i]) >> 1;
+                side_[i] = left[i] - right[i];
+            }
+            uint64_t l = 0, r = 0, m = 0, s = 0;
+            BestFixedOrder(left, n, &l);
+            BestFixedOrder(right, n, &r);
+            BestFixedOrder(mid_.data(), n, &m);
+            BestFixedOrder(side_.data(), n, &s);
+            uint64_t costs[4] = {l + r, l + s, s + r, m + s};
+            uint32_t best = static_cast<uint32_t>(std::min_element(costs, costs + 4) - costs);
+            assignment = best == 0 ? 1 : 7 + best; // 0001 independent, 1000 L/S, 1001 S/R, 1010 M/S
+        }
+
+        writer_.Begin(out);
+        writer_.Write(0x3FFE, 14);       // Sync
+        writer_.Write(0, 1);
+        writer_.Write(1, 1);             // Variable blocksize: header carries the sample number
+        writer_.Write(0x7, 4);           // Block size - 1 follows as 16 bits
+        writer_.Write(0, 4);             // Sample rate from STREAMINFO
+        writer_.Write(assignment, 4);
+        writer_.Write(bits_ == 24 ? 0x6 : 0x4, 3);
+        writer_.Write(0, 1);
+        WriteCodedNumber(sampleNumber_);
+        writer_.Write(static_cast<uint32_t>(n - 1), 16);
+        writer_.Write(Crc8(out, writer_.Bytes()), 8);
+
+        switch (assignment) {
+            case 8:
+                WriteSubframe(planes_[0].data(), n, bits_);
+                WriteSubframe(side_.data(), n, bits_ + 1);
+                break;
+            case 9:
+                WriteSubframe(side_.data(), n, bits_ + 1);
+                WriteSubframe(planes_[1].data(), n, bits_);
+                break;
+            case 10:
+                WriteSubframe(mid_.data(), n, bits_);
+                WriteSubframe(side_.data(), n, bits_ + 1);
+                break;
+            default:
+                for (uint32_t c = 0; c < channels_; c++) WriteSubframe(planes_[c].data(), n, bits_);
+                break;
+        }
+
+        writer_.AlignToByte();
+        writer_.Write(Crc16(out, writer_.Bytes()), 16);
+        sampleNumber_ += n;
+        return writer_.Bytes();
+    }
+
+    // UTF-8 style variable-length integer (up to 36 bits, 7 bytes)
+    void WriteCodedNumber(uint64_t value) {
+        if (value < 0x80) {
+            writer_.Write(static_cast<uint32_t>(value), 8);
+            return;
+        }
+        uint32_t bytes = 2;
+        while (bytes < 7 && value >= (uint64_t(1) << (5 * bytes + 1))) bytes++;
+        uint32_t lead = (0xFF00u >> bytes) & 0xFF;
+        writer_.Write(lead | static_cast<uint32_t>(value >> (6 * (bytes - 1))), 8);
+        for (uint32_t i = bytes - 1; i-- > 0;) {
+            writer_.Write(0x80 | static_cast<uint32_t>((value >> (6 * i)) & 0x3F), 8);
+        }
+    }
+
+    uint32_t channels_;
+    uint32_t bits_;
+    uint32_t sampleRate_;
+    size_t maxFrames_;
+
+    std::vector<int16_t> pcm16_;
+    std::vector<int32_t> planes_[8];
+    std::vector<int32_t> mid_;
+    std::vector<int32_t> side_;
+    std::vector<uint32_t> residual_;
+    std::vector<float> pending_;     // Carried-over frames, then the call they lead
+    size_t pendingFrames_ = 0;
+    std::vector<uint8_t> buffer_;
+    BitWriter writer_;
+
+    bool headerSent_ = false;
+    uint64_t sampleNumber_ = 0;
+    DspDitherState dither_;
+};
+
+// ============================================================================
+// Opus
+// ============================================================================
+
+#ifdef NATIVE_AUDIO_HAS_OPUS
+class OpusStreamEncoder : public AudioEncoder {
+public:
+    static constexpr size_t kMaxPacketBytes = 1275; // Largest single 20 ms frame
+
+    static OpusStreamEncoder* Create(const AudioEncoderConfig& config) {
+        const int rate = static_cast<int>(std::lround(config.sampleRate));
+        if (rate != 8000 && rate != 12000 && rate != 16000 && rate != 24000 && rate != 48000) return nullptr;
+        if (config.channels < 1 || config.channels > 2) return nullptr;
+
+        int error = OPUS_OK;
+        OpusEncoder* encoder = opus_encoder_create(rate, static_cast<int>(config.channels),
+                                                   OPUS_APPLICATION_AUDIO, &error);
+        if (!encoder || error != OPUS_OK) return nullptr;
+        opus_encoder_ctl(encoder, OPUS_SET_BITRATE(config.bitrate > 0 ? config.bitrate : 32000));
+        return new OpusStreamEncoder(config, encoder, static_cast<size_t>(rate / 50));
+    }
+
+    ~OpusStreamEncoder() override { opus_encoder_destroy(encoder_); }
+
+    size_t Encode(const float* samples, size_t frames, const uint8_t** out) override {
+        frames = std::min(frames, maxFrames_);
+        size_t offset = 0;
+        while (frames > 0) {
+            const float* packet = samples;
+            size_t used = frameSize_;
+            if (pendingFrames_ > 0 || frames < frameSize_) {
+                // Top up the carried-over partial packet
+                used = std::min(frames, frameSize_ - pendingFrames_);
+                std::memcpy(pending_.data() + pendingFrames_ * channels_, samples, used * channels_ * sizeof(float));
+                pendingFrames_ += used;
+                if (pendingFrames_ < frameSize_) break;
+                packet = pending_.data();
+                pendingFrames_ = 0;
+            }
+            samples += used * channels_;
+            frames -= used;
+
+            opus_int32 bytes = opus_encode_float(encoder_, packet, static_cast<int>(frameSize_),
+                                                 buffer_.data() + offset + 2, kMaxPacketBytes);
+            if (bytes <= 0) continue;    // Encoder error: drop this packet, keep the stream going
+            PutLe16(buffer_.data() + offset, static_cast<uint32_t>(bytes));
+            offset += 2 + static_cast<size_t>(bytes);
+        }
+        *out = buffer_.data();
+        return offset;
+    }
+
+    void Reset() override {
+        opus_encoder_ctl(encoder_, OPUS_RESET_STATE);
+        pendingFrames_ = 0;
+    }
+
+    size_t Granularity() const override { return frameSize_; }
+    const char* Name() const override { return "opus"; }
+    uint32_t Bits() const override { return 16; }
+
+private:
+    OpusStreamEncoder(const AudioEncoderConfig& config, OpusEncoder* encoder, size_t frameSize)
+        : encoder_(encoder),
+          channels_(config.channels),
+          frameSize_(frameSize),
+          maxFrames_(config.maxFrames),
+          pending_(frameSize * config.channels),
+          buffer_(((config.maxFrames + frameSize) / frameSize + 1) * (2 + kMaxPacketBytes)) {}
+
+    OpusEncoder* encoder_;
+    uint32_t channels_;
+    size_t frameSize_;
+    size_t maxFrames_;
+    std::vector<float> pending_;
+    size_t pendingFrames_ = 0;
+    std::vector<uint8_t> buffer_;
+};
+#endif
+
+} // namespace
+
+bool audio_encoder_available(int32_t encoding) {
+    switch (encoding) {
+        case AUDIO_ENCODER_WAV:
+        case AUDIO_ENCODER_FLAC:
+            return true;
+#ifdef NATIVE_AUDIO_HAS_OPUS
+        case AUDIO_ENCODER_OPUS:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+AudioEncoder* audio_encoder_create(const AudioEncoderConfig* config) {
+    if (!config || config->channels == 0 || config->sampleRate <= 0 || config->maxFrames == 0) return nullptr;
+
+    switch (config->encoding) {
+        case AUDIO_ENCODER_WAV: {
+            size_t sampleBytes = dsp_format_bytes(config->sampleFormat);
+            if (sampleBytes == 0) return nullptr;
+            return new WavEncoder(*config, sampleBytes);
+        }
+        case AUDIO_ENCODER_FLAC:
+            // STREAMINFO holds 3 bits of channels and 20 bits of sample rate
+            if (config->channels > 8 || std::lround(config->sampleRate) >= (1 << 20)) return nullptr;
+            return new FlacEncoder(*config);
+#ifdef NATIVE_AUDIO_HAS_OPUS
+        case AUDIO_ENCODER_OPUS:
+            return OpusStreamEncoder::Create(*config);
+#endif
+        default:
+            return nullptr;
+    }
+}
+
+void audio_encoder_destroy(AudioEncoder* encoder) {
+    delete encoder;
+}
+
+size_t audio_encoder_encode(AudioEncoder* encoder, const float* samples, size_t frames, const uint8_t** out) {
+    *out = nullptr;
+    if (!encoder || !samples || frames == 0) return 0;
+    return encoder->Encode(samples, frames, out);
+}
+
+void audio_encoder_reset(AudioEncoder* encoder) {
+    if (encoder) encoder->Reset();
+}
+
+size_t audio_encoder_frame_granularity(const AudioEncoder* encoder) {
+    return encoder ? encoder->Granularity() : 1;
+}
+
+const char* audio_encoder_name(const AudioEncoder* encoder) {
+    return encoder ? encoder->Name() : "pcm";
+}
+
+uint32_t audio_encoder_bits(const AudioEncoder* encoder) {
+    return encoder ? encoder->Bits() : 0;
+}
+
+bool audio_encoder_is_float(const AudioEncoder* encoder) {
+    return encoder && encoder->IsFloat();
+}
+
+namespace {
+
+void PutLe64(uint8_t* out, uint64_t value) {
+    PutLe32(out, static_cast<uint32_t>(value));
+    PutLe32(out + 4, static_cast<uint32_t>(value >> 32));
+}
+
+constexpr size_t kWavJunkOffset = 12;   // JUNK / ds64 chunk
+constexpr size_t kWavFmtOffset = 48;
+constexpr size_t kWavDataOffset = 72;
+
+} // namespace
+
+void audio_wav_header(uint8_t* h, double sampleRate, uint32_t channels, uint32_t bitsPerSample, bool isFloat) {
+    const uint32_t rate = static_cast<uint32_t>(std::lround(sampleRate));
+    const uint32_t blockAlign = channels * (bitsPerSample / 8);
+
+    std::memset(h, 0, AUDIO_WAV_HEADER_BYTES);
+    std::memcpy(h, "RIFF", 4);
+    PutLe32(h + 4, 0xFFFFFFFFu);
+    std::memcpy(h + 8, "WAVE", 4);
+
+    std::memcpy(h + kWavJunkOffset, "JUNK", 4);
+    PutLe32(h + kWavJunkOffset + 4, 28);
+
+    uint8_t* fmt = h + kWavFmtOffset;
+    std::memcpy(fmt, "fmt ", 4);
+    PutLe32(fmt + 4, 16);
+    PutLe16(fmt + 8, isFloat ? 3 : 1); // IEEE float or PCM
+    PutLe16(fmt + 10, channels);
+    PutLe32(fmt + 12, rate);
+    PutLe32(fmt + 16, rate * blockAlign);
+    PutLe16(fmt + 20, blockAlign);
+    PutLe16(fmt + 22, bitsPerSample);
+
+    std::memcpy(h + kWavDataOffset, "data", 4);
+    PutLe32(h + kWavDataOffset + 4, 0xFFFFFFFFu);
+}
+
+void audio_wav_set_length(uint8_t* h, uint64_t dataBytes) {
+    const uint64_t riffBytes = dataBytes + (AUDIO_WAV_HEADER_BYTES - 8);
+    if (riffBytes <= 0xFFFFFFFFull) {
+        std::memcpy(h, "RIFF", 4);
+        PutLe32(h + 4, static_cast<uint32_t>(riffBytes));
+        PutLe32(h + kWavDataOffset + 4, static_cast<uint32_t>(dataBytes));
+        return;
+    }
+
+    // RF64: the 32-bit sizes say "see ds64", which takes the JUNK chunk's place
+    const uint32_t blockAlign = h[kWavFmtOffset + 20] | (h[kWavFmtOffset + 21] << 8);
+    uint8_t* ds64 = h + kWavJunkOffset;
+    std::memcpy(h, "RF64", 4);
+    PutLe32(h + 4, 0xFFFFFFFFu);
+    std::memcpy(ds64, "ds64", 4);
+    PutLe32(ds64 + 4, 28);
+    PutLe64(ds64 + 8, riffBytes);
+    PutLe64(ds64 + 16, dataBytes);
+    PutLe64(ds64 + 24, blockAlign > 0 ? dataBytes / blockAlign : 0);
+    PutLe32(ds64 + 32, 0);             // No table entries
+    PutLe32(h + kWavDataOffset + 4, 0xFFFFFFFFu);
+}
+
+void audio_flac_set_total_samples(uint8_t* h, uint64_t frames) {
+    // 36 bits after the sample rate, channels and bits per sample (STREAMINFO byte 13)
+    if (frames >= (uint64_t(1) << 36)) frames = 0; // Unknown
+    h[21] = static_cast<uint8_t>((h[21] & 0xF0) | ((frames >> 32) & 0x0F));
+    h[22] = static_cast<uint8_t>(frames >> 24);
+    h[23] = static_cast<uint8_t>(frames >> 16);
+    h[24] = static_cast<uint8_t>(frames >> 8);
+    h[25] = static_cast<uint8_t>(frames);
+}
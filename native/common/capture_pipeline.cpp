@@ -0,0 +1,424 @@
+#include "capture_pipeline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+bool CapturePipeline::Configure(const Config& config, ChunkSink sink, void* context) {
+    sink_ = sink;
+    context_ = context;
+
+    inputChannels_ = config.inputChannels > 0 ? config.inputChannels : 1;
+    outputChannels_ = config.mono ? 1 : inputChannels_;
+    inputRate_ = config.inputSampleRate;
+    outputRate_ = config.outputSampleRate > 0 ? config.outputSampleRate : inputRate_;
+    gain_ = config.gain;
+
+    matrix_.clear();
+    const size_t matrixOutputs = config.channelMatrix.size() / inputChannels_;
+    if (matrixOutputs > 0 && config.channelMatrix.size() == matrixOutputs * inputChannels_) {
+        outputChannels_ = static_cast<uint32_t>(matrixOutputs);
+        matrix_ = config.channelMatrix;
+        for (float& weight : matrix_) weight *= gain_;
+    }
+    resampling_ = outputRate_ != inputRate_;
+    step_ = inputRate_ / outputRate_;
+
+    framesPerChunk_ = static_cast<size_t>((config.chunkDurationMs / 1000.0) * outputRate_);
+    if (framesPerChunk_ == 0) framesPerChunk_ = 1;
+    maxFramesPerChunk_ = std::max(framesPerChunk_,
+                                  static_cast<size_t>((config.maxChunkDurationMs / 1000.0) * outputRate_));
+
+    encoder_.reset();
+    if (config.encoding != AUDIO_ENCODER_PCM) {
+        // Leave room for rounding the chunk up to the encoder's packet size (20 ms at most)
+        AudioEncoderConfig encoderConfig;
+        encoderConfig.encoding = config.encoding;
+        encoderConfig.sampleRate = outputRate_;
+        encoderConfig.channels = outputChannels_;
+        encoderConfig.sampleFormat = config.sampleFormat;
+        encoderConfig.bitrate = config.bitrate;
+        encoderConfig.maxFrames = maxFramesPerChunk_ + static_cast<size_t>(outputRate_ / 50) + 1;
+        encoder_.reset(audio_encoder_create(&encoderConfig));
+        if (!encoder_) return false;
+
+        size_t granularity = audio_encoder_frame_granularity(encoder_.get());
+        framesPerChunk_ = (framesPerChunk_ + granularity - 1) / granularity * granularity;
+        maxFramesPerChunk_ = (maxFramesPerChunk_ + granularity - 1) / granularity * granularity;
+    }
+
+    scratchFrames_ = config.maxFramesPerPacket > 0 ? config.maxFramesPerPacket : 1;
+    scratch_.assign(resampling_ ? scratchFrames_ * outputChannels_ : 0, 0.0f);
+
+    polyphase_ = resampling_ &&
+        resampler_.Configure(inputRate_, outputRate_, outputChannels_, config.resampleQuality, scratchFrames_);
+    resampled_.assign(polyphase_ ? resampler_.MaxOutputFrames(scratchFrames_) * outputChannels_ : 0, 0.0f);
+
+    sampleBytes_ = dsp_format_bytes(config.sampleFormat);
+    sampleFormat_ = sampleBytes_ > 0 ? config.sampleFormat : DSP_FORMAT_F32;
+    if (sampleBytes_ == 0) sampleBytes_ = sizeof(float);
+    planar_ = config.planar && outputChannels_ > 1 && !encoder_;
+    passthrough_ = sampleFormat_ == DSP_FORMAT_F32 && !planar_ && !encoder_;
+    dsp_dither_init(&dither_, 0);
+
+    const size_t maxSamples = maxFramesPerChunk_ * outputChannels_;
+    accumulator_.assign(maxSamples, 0.0f);
+    encoded_.assign(passthrough_ || encoder_ ? 0 : maxSamples * sampleBytes_, 0);
+    silence_.assign(encoder_ ? 0 : maxSamples * sampleBytes_, 0);
+    silentSamples_.assign(encoder_ ? maxSamples : 0, 0.0f);
+    requestedFramesPerChunk_ = 0;
+    previousFrame_.assign(outputChannels_, 0.0f);
+    interpolated_.assign(outputChannels_, 0.0f);
+
+    // Keep a plugged-in detector across reconfiguration
+    ActivityDetector detector = gate_.detector;
+    void* detectorContext = gate_.detectorContext;
+    gateEnabled_ = config.gate;
+    activity_gate_init(&gate_, outputRate_, config.gateThresholdDb, config.gateHangoverMs);
+    activity_gate_set_detector(&gate_, detector, detectorContext);
+
+    levelsEnabled_ = config.levels;
+    levelsOnly_ = config.levels && config.levelsOnly;
+    levels_ = AudioLevels();
+    levels_.channels = std::min<uint32_t>(outputChannels_, AUDIO_LEVELS_MAX_CHANNELS);
+
+    Reset();
+    return true;
+}
+
+bool CapturePipeline::ChangeInput(const Config& config) {
+    if (accumulator_.empty()) return false;
+    const uint32_t inputChannels = config.inputChannels > 0 ? config.inputChannels : 1;
+
+    std::vector<float> matrix;
+    const size_t matrixOutputs = config.channelMatrix.size() / inputChannels;
+    if (matrixOutputs > 0 && config.channelMatrix.size() == matrixOutputs * inputChannels) {
+        if (matrixOutputs != outputChannels_) return false;
+        matrix = config.channelMatrix;
+    } else if (outputChannels_ > 1 && inputChannels != outputChannels_) {
+        matrix.assign(static_cast<size_t>(outputChannels_) * inputChannels, 0.0f);
+        for (uint32_t o = 0; o < outputChannels_; o++) {
+            matrix[static_cast<size_t>(o) * inputChannels + std::min(o, inputChannels - 1)] = 1.0f;
+        }
+    }
+    // A mono output downmixes whatever arrives, as configured
+
+    inputChannels_ = inputChannels;
+    inputRate_ = config.inputSampleRate;
+    gain_ = config.gain;
+    matrix_ = std::move(matrix);
+    for (float& weight : matrix_) weight *= gain_;
+    resampling_ = outputRate_ != inputRate_;
+    step_ = inputRate_ / outputRate_;
+
+    // The old source's resampler history doesn't belong in front of the new one
+    scratchFrames_ = config.maxFramesPerPacket > 0 ? config.maxFramesPerPacket : 1;
+    scratch_.assign(resampling_ ? scratchFrames_ * outputChannels_ : 0, 0.0f);
+    polyphase_ = resampling_ &&
+        resampler_.Configure(inputRate_, outputRate_, outputChannels_, config.resampleQuality, scratchFrames_);
+    resampled_.assign(polyphase_ ? resampler_.MaxOutputFrames(scratchFrames_) * outputChannels_ : 0, 0.0f);
+    position_ = 0;  // Linear interpolation starts from the old source's last frame
+
+    // The new source's first frame lands at the output produced so far; its
+    // packets bring their own host times
+    inputFrames_ = static_cast<double>(framePosition_ + filledFrames_) * step_;
+    anchorInputFrame_ = inputFrames_;
+    anchorHostTimeNs_ = 0;
+    pendingFlags_ |= AUDIO_CHUNK_FLAG_DISCONTINUITY;
+    return true;
+}
+
+uint32_t CapturePipeline::BitsPerSample() const {
+    if (encoder_) return audio_encoder_bits(encoder_.get());
+    return static_cast<uint32_t>(sampleBytes_ * 8);
+}
+
+bool CapturePipeline::IsFloat() const {
+    if (encoder_) return audio_encoder_is_float(encoder_.get());
+    return sampleFormat_ == DSP_FORMAT_F32;
+}
+
+std::string CapturePipeline::EncodingName() const {
+    if (encoder_) return audio_encoder_name(encoder_.get());
+
+    std::string name;
+    switch (sampleFormat_) {
+        case DSP_FORMAT_S16: name = "pcm_s16le"; break;
+        case DSP_FORMAT_S24: name = "pcm_s24le"; break;
+        default:             name = "pcm_f32le"; break;
+    }
+    return planar_ ? name + "_planar" : name;
+}
+
+void CapturePipeline::Reset() {
+    filledFrames_ = 0;
+    position_ = 0;
+    std::fill(previousFrame_.begin(), previousFrame_.end(), 0.0f);
+    if (polyphase_) resampler_.Reset();
+
+    sequence_ = 0;
+    framePosition_ = 0;
+    pendingFlags_ = 0;
+    inputFrames_ = 0;
+    anchorInputFrame_ = 0;
+    anchorHostTimeNs_ = 0;
+    activity_gate_reset(&gate_);
+    audio_encoder_reset(encoder_.get());
+}
+
+size_t CapturePipeline::AllocatedBytes() const {
+    size_t floats = matrix_.capacity() + scratch_.capacity() + resampled_.capacity() + accumulator_.capacity() +
+                    silentSamples_.capacity() + previousFrame_.capacity() + interpolated_.capacity();
+    return floats * sizeof(float) + encoded_.capacity() + silence_.capacity();
+}
+
+size_t CapturePipeline::FramesForDuration(double chunkDurationMs) const {
+    size_t frames = static_cast<size_t>((chunkDurationMs / 1000.0) * outputRate_);
+    if (frames == 0) frames = 1;
+    if (encoder_) {
+        size_t granularity = audio_encoder_frame_granularity(encoder_.get());
+        frames = (frames + granularity - 1) / granularity * granularity;
+    }
+    return frames;
+}
+
+bool CapturePipeline::RequestChunkDuration(double chunkDurationMs) {
+    if (!(chunkDurationMs > 0)) return false;
+    size_t frames = FramesForDuration(chunkDurationMs);
+    if (frames > maxFramesPerChunk_) return false;
+    requestedFramesPerChunk_.store(frames, std::memory_order_release);
+    return true;
+}
+
+void CapturePipeline::ApplyRequestedChunkSize() {
+    if (filledFrames_ != 0 || requestedFramesPerChunk_.load(std::memory_order_relaxed) == 0) return;
+    size_t frames = requestedFramesPerChunk_.exchange(0, std::memory_order_acquire);
+    if (frames != 0) framesPerChunk_ = frames;
+}
+
+void CapturePipeline::SetActivityDetector(ActivityDetector detector, void* context) {
+    activity_gate_set_detector(&gate_, detector, context);
+}
+
+void CapturePipeline::Process(const float* input, size_t frames, uint64_t hostTimeNs, uint32_t flags) {
+    if (!input || frames == 0 || accumulator_.empty()) return;
+
+    ApplyRequestedChunkSize();
+    pendingFlags_ |= flags;
+    if (hostTimeNs != 0) {
+        anchorHostTimeNs_ = hostTimeNs;
+        anchorInputFrame_ = inputFrames_;
+    }
+    inputFrames_ += static_cast<double>(frames);
+
+    if (!resampling_) {
+        // Transform straight into the accumulator, one chunk-sized span at a time
+        while (frames > 0) {
+            size_t span = std::min(frames, framesPerChunk_ - filledFrames_);
+            uint64_t start = stats_ ? capture_stats_now_ns() : 0;
+            TransformFrames(input, span, accumulator_.data() + filledFrames_ * outputChannels_);
+            if (stats_) AddStageTime(CAPTURE_STAGE_CONVERT, start, chunkNs_);
+            filledFrames_ += span;
+            input += span * inputChannels_;
+            frames -= span;
+            FlushIfFull();
+        }
+        return;
+    }
+
+    while (frames > 0) {
+        size_t block = std::min(frames, scratchFrames_);
+        uint64_t start = stats_ ? capture_stats_now_ns() : 0;
+        TransformFrames(input, block, scratch_.data());
+        if (stats_) {
+            AddStageTime(CAPTURE_STAGE_CONVERT, start, chunkNs_);
+            start = capture_stats_now_ns();
+        }
+
+        // Linear interpolation delivers chunks as it goes; AddStageTime() leaves them out
+        uint64_t chunkNs = chunkNs_;
+        if (polyphase_) {
+            size_t produced = resampler_.Process(scratch_.data(), block, resampled_.data());
+            if (stats_) AddStageTime(CAPTURE_STAGE_RESAMPLE, start, chunkNs);
+            AppendFrames(resampled_.data(), produced);
+        } else {
+            ResampleLinear(scratch_.data(), block);
+            if (stats_) AddStageTime(CAPTURE_STAGE_RESAMPLE, start, chunkNs);
+        }
+        input += block * inputChannels_;
+        frames -= block;
+    }
+}
+
+void CapturePipeline::TransformFrames(const float* input, size_t frames, float* output) const {
+    if (!matrix_.empty()) {
+        // Selection or mix with the gain folded into the weights
+        dsp_channel_matrix_f32(input, output, frames, inputChannels_, outputChannels_, matrix_.data());
+        return;
+    }
+
+    if (outputChannels_ == 1 && inputChannels_ > 1) {
+        // Downmix and gain in one pass
+        dsp_gain_downmix_f32(input, output, frames, inputChannels_, gain_);
+        return;
+    }
+
+    const size_t samples = frames * inputChannels_;
+    if (gain_ == 1.0f) {
+        std::memcpy(output, input, samples * sizeof(float));
+    } else {
+        dsp_gain_f32(input, output, samples, gain_);
+    }
+}
+
+void CapturePipeline::ResampleLinear(const float* frames, size_t count) {
+    const size_t channels = outputChannels_;
+    const double last = static_cast<double>(count) - 1.0;
+    float* out = interpolated_.data();
+
+    // position_ indexes the virtual sequence [previousFrame_, frames[0..count-1]]
+    // starting at -1, so interpolation is continuous across packet boundaries.
+    while (position_ < last) {
+        double floorPos = std::floor(position_);
+        ptrdiff_t index = static_cast<ptrdiff_t>(floorPos);
+        float frac = static_cast<float>(position_ - floorPos);
+
+        const float* a = index < 0 ? previousFrame_.data() : frames + index * channels;
+        const float* b = frames + (index + 1) * channels;
+        for (size_t c = 0; c < channels; c++) {
+            out[c] = a[c] + (b[c] - a[c]) * frac;
+        }
+        AppendFrames(out, 1);
+
+        position_ += step_;
+    }
+
+    position_ -= static_cast<double>(count);
+    std::memcpy(previousFrame_.data(), frames + (count - 1) * channels, channels * sizeof(float));
+}
+
+void CapturePipeline::AppendFrames(const float* frames, size_t count) {
+    while (count > 0) {
+        size_t span = std::min(count, framesPerChunk_ - filledFrames_);
+        std::memcpy(accumulator_.data() + filledFrames_ * outputChannels_, frames,
+                    span * outputChannels_ * sizeof(float));
+        filledFrames_ += span;
+        frames += span * outputChannels_;
+        count -= span;
+        FlushIfFull();
+    }
+}
+
+AudioChunkInfo CapturePipeline::NextChunkInfo(uint32_t flags, bool delivered) {
+    AudioChunkInfo info;
+    info.sequence = delivered ? sequence_++ : sequence_;
+    info.framePosition = framePosition_;
+    info.frameCount = static_cast<uint32_t>(framesPerChunk_);
+    info.flags = flags;
+    info.hostTimeNs = 0;
+
+    if (anchorHostTimeNs_ != 0) {
+        // Input frame the chunk's first output frame was filtered around
+        double latency = polyphase_ ? resampler_.LatencyFrames() : 0.0;
+        double inputFrame = static_cast<double>(framePosition_) * step_ - latency;
+        double offsetNs = (inputFrame - anchorInputFrame_) / inputRate_ * 1e9;
+        double hostTime = static_cast<double>(anchorHostTimeNs_) + offsetNs;
+        info.hostTimeNs = hostTime > 0 ? static_cast<uint64_t>(hostTime) : 0;
+    }
+
+    framePosition_ += framesPerChunk_;
+    return info;
+}
+
+void CapturePipeline::EmitSilence(uint64_t hostTimeNs) {
+    if (accumulator_.empty()) return;
+    ApplyRequestedChunkSize();
+
+    // Account for the silence as if it had been captured, so later packets line up
+    inputFrames_ += static_cast<double>(framesPerChunk_) * step_;
+    DeliverChunk(nullptr, AUDIO_CHUNK_FLAG_SILENT, hostTimeNs);
+}
+
+void CapturePipeline::FlushIfFull() {
+    if (filledFrames_ < framesPerChunk_) return;
+
+    DeliverChunk(accumulator_.data(), 0, 0);
+    filledFrames_ = 0;
+    ApplyRequestedChunkSize();
+}
+
+void CapturePipeline::AddStageTime(int32_t stage, uint64_t startNs, uint64_t chunkNsAtStart) {
+    uint64_t elapsed = capture_stats_now_ns() - startNs;
+    uint64_t nested = chunkNs_ - chunkNsAtStart;
+    capture_stats_add_time(stats_, stage, elapsed > nested ? elapsed - nested : 0);
+}
+
+void CapturePipeline::DeliverChunk(const float* samples, uint32_t flags, uint64_t hostTimeNs) {
+    if (!stats_) {
+        ProcessChunk(samples, flags, hostTimeNs);
+        return;
+    }
+
+    uint64_t start = capture_stats_now_ns();
+    ProcessChunk(samples, flags, hostTimeNs);
+    uint64_t elapsed = capture_stats_now_ns() - start;
+    chunkNs_ += elapsed;
+    capture_stats_add_time(stats_, CAPTURE_STAGE_CHUNK, elapsed);
+}
+
+void CapturePipeline::ProcessChunk(const float* samples, uint32_t flags, uint64_t hostTimeNs) {
+    // Silence never opens the gate, but it can run out the hangover
+    int32_t gate = gateEnabled_
+        ? activity_gate_process(&gate_, samples, framesPerChunk_, outputChannels_)
+        : ACTIVITY_GATE_PASS;
+    bool pass = (gate & ACTIVITY_GATE_PASS) != 0;
+
+    // A held-back chunk's flags wait for the next delivered chunk
+    AudioChunkInfo info = NextChunkInfo(pendingFlags_ | flags, pass);
+    if (hostTimeNs != 0) info.hostTimeNs = hostTimeNs;
+    if (pass) pendingFlags_ = 0;
+
+    if (levelsEnabled_ && levelSink_) {
+        if (samples) {
+            dsp_levels_f32(samples, framesPerChunk_, outputChannels_, levels_.channels,
+                           levels_.peak, levels_.rms, levels_.clipped);
+        } else {
+            AudioLevels silent = {};
+            silent.channels = levels_.channels;
+            levels_ = silent;
+        }
+        levelSink_(levels_, info, context_);
+    }
+
+    if (!pass) {
+        if ((gate & ACTIVITY_GATE_CLOSED) && activitySink_) {
+            activitySink_(false, info, context_);
+        }
+        return;
+    }
+
+    if ((gate & ACTIVITY_GATE_OPENED) && activitySink_) {
+        activitySink_(true, info, context_);
+    }
+
+    if (levelsOnly_ || !sink_) return;
+
+    if (encoder_) {
+        // Opus returns nothing until a packet fills; chunks are sized so that never happens
+        const uint8_t* encoded = nullptr;
+        size_t bytes = audio_encoder_encode(encoder_.get(), samples ? samples : silentSamples_.data(),
+                                            framesPerChunk_, &encoded);
+        if (bytes > 0) sink_(encoded, bytes, info, context_);
+    } else if (!samples) {
+        sink_(silence_.data(), BytesPerChunk(), info, context_);
+    } else if (passthrough_) {
+        sink_(reinterpret_cast<const uint8_t*>(samples), SamplesPerChunk() * sizeof(float), info, context_);
+    } else {
+        // s16 gets TPDF dither so quiet passages don't truncate to distortion
+        size_t bytes = dsp_encode_f32(samples, framesPerChunk_, outputChannels_,
+                                      sampleFormat_, planar_,
+                                      sampleFormat_ == DSP_FORMAT_S16 ? &dither_ : nullptr,
+                                      encoded_.data());
+        sink_(encoded_.data(), bytes, info, context_);
+    }
+}
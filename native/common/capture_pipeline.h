@@ -0,0 +1,250 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "activity_gate.h"
+#include "audio_chunk.h"
+#include "audio_encoder.h"
+#include "capture_stats.h"
+#include "dsp_kernels.h"
+#include "resampler.h"
+
+/**
+ * Capture Pipeline - Converts device frames into fixed-size output chunks.
+ *
+ * Runs on the real-time capture thread, so Process() never allocates or moves
+ * buffered audio: every buffer is sized once in Configure(). Gain and mono
+ * downmix are fused into a single pass, rate conversion uses the streaming
+ * polyphase resampler (linear interpolation only for ratios it can't express),
+ * and the accumulator is exactly one chunk long so a full
+ * chunk is always a contiguous view that is emitted in place and then reused.
+ *
+ * Input is interleaved 32-bit float. A channel matrix (Config::channelMatrix)
+ * can replace the downmix with any weighted selection or mix of the input
+ * channels, fused with the gain into the same pass. Output is encoded once per chunk into
+ * the configured sample format and layout (f32/s16/s24, interleaved/planar),
+ * or passed through a streaming encoder (WAV/FLAC/Opus, see audio_encoder.h).
+ * With Opus, chunks are rounded up to whole 20 ms packets.
+ *
+ * Every chunk carries an AudioChunkInfo: a sequence number, its frame position
+ * and the host time of its first frame, extrapolated from the timestamp of the
+ * most recent packet (and corrected for the resampler's group delay).
+ *
+ * With the activity gate enabled, chunks the gate holds back are never encoded
+ * or emitted: they use no sequence number but still advance framePosition, so
+ * the gap is visible to consumers. Gate transitions go to the ActivitySink.
+ *
+ * Levels (per-channel peak, RMS and clip count) are measured on each chunk's
+ * float samples while they are still in cache, before the gate and encoder.
+ * In levels-only mode nothing is encoded or passed to the ChunkSink.
+ *
+ * ChangeInput() moves a running stream onto a source with another rate or
+ * channel count (e.g. a new default device) without ending it: the partly
+ * filled chunk, counters, gate and encoder carry on, only the input side is
+ * rebuilt, and the next chunk is flagged as a discontinuity.
+ *
+ * The chunk size can change while capturing: RequestChunkDuration() may be
+ * called from any thread, and the thread calling Process() switches at the
+ * next chunk boundary. Buffers are sized in Configure() for the largest size
+ * allowed (Config::maxChunkDurationMs), so switching never allocates.
+ *
+ * With SetStats(), each conversion, resampling and chunk delivery pass is
+ * timed into the stats' stage histograms. Time spent delivering a chunk is
+ * counted once, under CAPTURE_STAGE_CHUNK, even when it happens inside a
+ * resampling pass.
+ */
+
+// Receives one complete encoded chunk; the view is only valid during the call
+typedef void (*ChunkSink)(const uint8_t* data, size_t byteCount, const AudioChunkInfo& info, void* context);
+
+// Receives activity gate transitions; info describes the chunk that opened or closed it
+typedef void (*ActivitySink)(bool active, const AudioChunkInfo& info, void* context);
+
+// Receives the levels of every chunk (held back or not) before the chunk is emitted
+typedef void (*LevelSink)(const AudioLevels& levels, const AudioChunkInfo& info, void* context);
+
+class CapturePipeline {
+public:
+    struct Config {
+        double inputSampleRate = 48000;
+        uint32_t inputChannels = 2;
+        double outputSampleRate = 0;      // 0 = same as input
+        bool mono = true;                 // Downmix all channels to one
+        // Row-major outputs x inputChannels weights (see dsp_channel_matrix_f32);
+        // when set it decides the output channels and `mono` is ignored
+        std::vector<float> channelMatrix;
+        float gain = 1.0f;
+        double chunkDurationMs = 200;
+        double maxChunkDurationMs = 0;    // Largest size RequestChunkDuration() accepts (at least chunkDurationMs)
+        size_t maxFramesPerPacket = 4800; // Scratch size; larger packets are split
+        PolyphaseResampler::Quality resampleQuality = PolyphaseResampler::Quality::Medium;
+        int32_t sampleFormat = DSP_FORMAT_F32; // DSP_FORMAT_*
+        bool planar = false;              // One contiguous block per channel
+        bool gate = false;                // Hold back chunks without activity
+        double gateThresholdDb = -50;     // RMS level that counts as activity
+        double gateHangoverMs = 500;      // Keep delivering this long after activity stops
+        bool levels = false;              // Meter chunks into the LevelSink
+        bool levelsOnly = false;          // With levels: skip encoding and the ChunkSink
+        int32_t encoding = AUDIO_ENCODER_PCM; // AUDIO_ENCODER_*; sampleFormat sets its bit depth
+        int32_t bitrate = 0;              // Opus bits per second, 0 = encoder default
+    };
+
+    // Allocate all buffers. Call before capture starts, never on the capture thread.
+    // Returns false if the encoding isn't available for this output format.
+    bool Configure(const Config& config, ChunkSink sink, void* context);
+
+    // Process interleaved input frames, emitting every chunk that fills up.
+    // hostTimeNs is the capture time of the first frame (0 if unknown); flags
+    // (AUDIO_CHUNK_FLAG_*) are attached to the chunk receiving these frames.
+    void Process(const float* input, size_t frames, uint64_t hostTimeNs = 0, uint32_t flags = 0);
+
+    // Emit one chunk of generated silence, keeping sequence and position continuous
+    void EmitSilence(uint64_t hostTimeNs);
+
+    // Drop buffered samples, resampler state and chunk counters (e.g. between sessions)
+    void Reset();
+
+    // Take input as described by config's input side (inputSampleRate,
+    // inputChannels, channelMatrix, gain, maxFramesPerPacket, resampleQuality)
+    // from the next Process() call; output rate, channels, format and chunks are
+    // kept. Without a matrix, a multichannel output takes each input channel of
+    // the same index (the last one past the end). Allocates, so keep it off
+    // the real-time thread: call from another thread while the one calling
+    // Process() is held between packets. Returns false if the matrix doesn't
+    // have one row per output channel.
+    bool ChangeInput(const Config& config);
+
+    // Switch to chunks of chunkDurationMs at the next chunk boundary. Any thread.
+    // Returns false if the size is beyond what Configure() allocated for.
+    bool RequestChunkDuration(double chunkDurationMs);
+
+    // Gate transitions, reported with the context passed to Configure()
+    void SetActivitySink(ActivitySink sink) { activitySink_ = sink; }
+
+    // Level reports while Config::levels is on, with the context passed to Configure()
+    void SetLevelSink(LevelSink sink) { levelSink_ = sink; }
+
+    // Replace the gate's RMS detector (e.g. with a VAD); NULL restores it
+    void SetActivityDetector(ActivityDetector detector, void* context);
+
+    // Time the processing stages into stats (NULL turns timing off)
+    void SetStats(CaptureStats* stats) { stats_ = stats; }
+
+    // Bytes held by the buffers Configure() sized
+    size_t AllocatedBytes() const;
+
+    double OutputSampleRate() const { return outputRate_; }
+    uint32_t OutputChannels() const { return outputChannels_; }
+    size_t FramesPerChunk() const { return framesPerChunk_; }
+    size_t SamplesPerChunk() const { return framesPerChunk_ * outputChannels_; }
+    size_t BytesPerChunk() const { return SamplesPerChunk() * sampleBytes_; }
+    int32_t SampleFormat() const { return sampleFormat_; }
+    bool Planar() const { return planar_; }
+
+    // Metadata fields describing the decoded samples
+    uint32_t BitsPerSample() const;
+    bool IsFloat() const;
+
+    // Metadata encoding string, e.g. "pcm_s16le", "pcm_f32le_planar" or "flac"
+    std::string EncodingName() const;
+
+private:
+    struct EncoderDeleter {
+        void operator()(AudioEncoder* encoder) const { audio_encoder_destroy(encoder); }
+    };
+
+    // Gain + downmix `frames` input frames into `output` (outputChannels_ wide)
+    void TransformFrames(const float* input, size_t frames, float* output) const;
+
+    // Linear interpolation across packet boundaries into the accumulator
+    // (fallback when the polyphase resampler can't handle the ratio)
+    void ResampleLinear(const float* frames, size_t count);
+
+    void AppendFrames(const float* frames, size_t count);
+    void FlushIfFull();
+
+    // Output frames per chunk for a duration, rounded up to the encoder's packet size
+    size_t FramesForDuration(double chunkDurationMs) const;
+    // Take a pending RequestChunkDuration() while no chunk is partly filled
+    void ApplyRequestedChunkSize();
+
+    // Meter, gate, encode and emit one full chunk (samples NULL = silence_),
+    // timed as CAPTURE_STAGE_CHUNK
+    void DeliverChunk(const float* samples, uint32_t flags, uint64_t hostTimeNs);
+    void ProcessChunk(const float* samples, uint32_t flags, uint64_t hostTimeNs);
+
+    // Record the time since startNs as `stage`, less the chunk delivery time
+    // accumulated since chunkNsAtStart
+    void AddStageTime(int32_t stage, uint64_t startNs, uint64_t chunkNsAtStart);
+
+    // Fill the sequence, position and clock fields for the next chunk;
+    // held-back chunks (delivered = false) don't consume a sequence number
+    AudioChunkInfo NextChunkInfo(uint32_t flags, bool delivered = true);
+
+    ChunkSink sink_ = nullptr;
+    ActivitySink activitySink_ = nullptr;
+    LevelSink levelSink_ = nullptr;
+    void* context_ = nullptr;
+
+    CaptureStats* stats_ = nullptr;
+    uint64_t chunkNs_ = 0;            // Total DeliverChunk() time, for stages it runs inside
+
+    uint32_t inputChannels_ = 0;
+    uint32_t outputChannels_ = 0;
+    double inputRate_ = 0;
+    double outputRate_ = 0;
+    float gain_ = 1.0f;
+    bool resampling_ = false;
+    bool polyphase_ = false;
+    double step_ = 1.0;               // Input frames per output frame
+
+    std::vector<float> matrix_;       // Config::channelMatrix times gain_, empty = downmix or passthrough
+    std::vector<float> scratch_;      // Transformed input awaiting resampling
+    size_t scratchFrames_ = 0;
+
+    PolyphaseResampler resampler_;
+    std::vector<float> resampled_;    // Resampler output for one scratch block
+
+    std::vector<float> accumulator_;  // One chunk of the largest allowed size
+    size_t framesPerChunk_ = 0;
+    size_t maxFramesPerChunk_ = 0;    // What every chunk-sized buffer holds
+    size_t filledFrames_ = 0;
+    std::atomic<size_t> requestedFramesPerChunk_{0};  // 0 = no change pending
+
+    int32_t sampleFormat_ = DSP_FORMAT_F32;
+    size_t sampleBytes_ = sizeof(float);
+    bool planar_ = false;
+    bool passthrough_ = true;         // Interleaved f32: emit the accumulator as-is
+    std::vector<uint8_t> encoded_;    // One encoded chunk
+    DspDitherState dither_;
+
+    std::vector<uint8_t> silence_;
+
+    std::unique_ptr<AudioEncoder, EncoderDeleter> encoder_;
+    std::vector<float> silentSamples_; // Encoder input for generated silence
+
+    bool gateEnabled_ = false;
+    ActivityGateState gate_ = {};
+
+    bool levelsEnabled_ = false;
+    bool levelsOnly_ = false;
+    AudioLevels levels_ = {};
+
+    // Chunk timing
+    uint64_t sequence_ = 0;
+    uint64_t framePosition_ = 0;      // Output frames in chunks emitted so far
+    uint32_t pendingFlags_ = 0;       // Flags for the chunk currently filling
+    double inputFrames_ = 0;          // Input frames consumed (silence counts at the input rate)
+    double anchorInputFrame_ = 0;     // inputFrames_ when the latest timed packet arrived
+    uint64_t anchorHostTimeNs_ = 0;   // That packet's host time, 0 if none yet
+
+    // Linear resampler state carried between packets
+    std::vector<float> previousFrame_;
+    std::vector<float> interpolated_;
+    double position_ = 0;             // Next output position; -1 addresses previousFrame_
+};
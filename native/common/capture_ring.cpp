@@ -0,0 +1,143 @@
+#include "capture_ring.h"
+#include "audio_chunk.h"
+
+#include <atomic>
+#include <cstring>
+#include <new>
+
+namespace {
+
+// Records start on 16-byte boundaries of the (new[]-aligned) storage, so
+// payloads stay aligned for float samples
+constexpr size_t kAlign = 16;
+// Header size marking the unused end of the storage; the reader skips to 0
+constexpr uint32_t kWrapMarker = UINT32_MAX;
+
+struct RecordHeader {
+    uint32_t bytes;
+    uint32_t flags;
+    uint64_t hostTimeNs;
+};
+static_assert(sizeof(RecordHeader) == kAlign, "header must keep records aligned");
+
+size_t RecordSize(size_t bytes) {
+    return sizeof(RecordHeader) + ((bytes + kAlign - 1) & ~(kAlign - 1));
+}
+
+}  // namespace
+
+// Positions are monotonic byte counters; the storage index is position % capacity.
+// Only the producer stores writePos and only the consumer stores readPos.
+struct CaptureRing {
+    uint8_t* storage;
+    size_t capacity;
+    alignas(64) std::atomic<uint64_t> writePos{0};
+    alignas(64) std::atomic<uint64_t> readPos{0};
+    // Producer only
+    alignas(64) bool overrun = false;
+    std::atomic<uint64_t> droppedBytes{0};
+};
+
+CaptureRing* capture_ring_create(size_t capacityBytes) {
+    size_t capacity = (capacityBytes + kAlign - 1) & ~(kAlign - 1);
+    if (capacity < 2 * kAlign) capacity = 2 * kAlign;
+
+    uint8_t* storage = new (std::nothrow) uint8_t[capacity];
+    if (!storage) return nullptr;
+
+    CaptureRing* ring = new (std::nothrow) CaptureRing();
+    if (!ring) {
+        delete[] storage;
+        return nullptr;
+    }
+    ring->storage = storage;
+    ring->capacity = capacity;
+    return ring;
+}
+
+void capture_ring_destroy(CaptureRing* ring) {
+    if (!ring) return;
+    delete[] ring->storage;
+    delete ring;
+}
+
+bool capture_ring_write(CaptureRing* ring, const void* data, size_t bytes, uint64_t hostTimeNs, uint32_t flags) {
+    if (bytes == 0) return true;
+
+    size_t need = RecordSize(bytes);
+    uint64_t write = ring->writePos.load(std::memory_order_relaxed);
+    uint64_t used = write - ring->readPos.load(std::memory_order_acquire);
+    size_t index = static_cast<size_t>(write % ring->capacity);
+    size_t contiguous = ring->capacity - index;
+    // A record never straddles the end; the tail is given up to a wrap marker
+    size_t skip = need > contiguous ? contiguous : 0;
+
+    if (bytes > UINT32_MAX - kAlign || used + skip + need > ring->capacity) {
+        ring->overrun = true;
+        ring->droppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (skip) {
+        RecordHeader marker = {kWrapMarker, 0, 0};
+        std::memcpy(ring->storage + index, &marker, sizeof(marker));
+        index = 0;
+    }
+
+    if (ring->overrun) {
+        flags |= AUDIO_CHUNK_FLAG_DISCONTINUITY;
+        ring->overrun = false;
+    }
+    RecordHeader header = {static_cast<uint32_t>(bytes), flags, hostTimeNs};
+    std::memcpy(ring->storage + index, &header, sizeof(header));
+    std::memcpy(ring->storage + index + sizeof(header), data, bytes);
+
+    ring->writePos.store(write + skip + need, std::memory_order_release);
+    return true;
+}
+
+size_t capture_ring_peek(CaptureRing* ring, const void** data, uint64_t* hostTimeNs, uint32_t* flags) {
+    uint64_t read = ring->readPos.load(std::memory_order_relaxed);
+    uint64_t write = ring->writePos.load(std::memory_order_acquire);
+    if (read == write) return 0;
+
+    size_t index = static_cast<size_t>(read % ring->capacity);
+    RecordHeader header;
+    std::memcpy(&header, ring->storage + index, sizeof(header));
+    if (header.bytes == kWrapMarker) {
+        // The marker is always followed by a record, written in the same store
+        read += ring->capacity - index;
+        ring->readPos.store(read, std::memory_order_release);
+        index = 0;
+        std::memcpy(&header, ring->storage, sizeof(header));
+    }
+
+    if (data) *data = ring->storage + index + sizeof(header);
+    if (hostTimeNs) *hostTimeNs = header.hostTimeNs;
+    if (flags) *flags = header.flags;
+    return header.bytes;
+}
+
+void capture_ring_consume(CaptureRing* ring) {
+    uint64_t read = ring->readPos.load(std::memory_order_relaxed);
+    if (read == ring->writePos.load(std::memory_order_acquire)) return;
+
+    size_t index = static_cast<size_t>(read % ring->capacity);
+    RecordHeader header;
+    std::memcpy(&header, ring->storage + index, sizeof(header));
+    if (header.bytes == kWrapMarker) {
+        read += ring->capacity - index;
+        std::memcpy(&header, ring->storage, sizeof(header));
+    }
+    ring->readPos.store(read + RecordSize(header.bytes), std::memory_order_release);
+}
+
+void capture_ring_reset(CaptureRing* ring) {
+    ring->readPos.store(ring->writePos.load(std::memory_order_acquire), std::memory_order_release);
+    ring->overrun = false;
+    ring->droppedBytes.store(0, std::memory_order_relaxed);
+}
+
+uint64_t capture_ring_dropped_bytes(const CaptureRing* ring) {
+    return ring->droppedBytes.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,183 @@
+#include "capture_stats.h"
+#include "audio_chunk.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <new>
+
+namespace {
+
+struct StageCounters {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> totalNs{0};
+    std::atomic<uint64_t> maxNs{0};
+    std::atomic<uint32_t> buckets[CAPTURE_STATS_BUCKETS];
+
+    StageCounters() {
+        for (auto& bucket : buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+};
+
+int FloorLog2(uint64_t value) {
+    int log = 0;
+    while (value >>= 1) log++;
+    return log;
+}
+
+// Values below 4 get a bucket each; above, each power of two is split in four
+// by the two bits after the leading one
+size_t BucketFor(uint64_t ns) {
+    if (ns < 4) return static_cast<size_t>(ns);
+    int octave = FloorLog2(ns);
+    size_t sub = static_cast<size_t>(ns >> (octave - 2)) & 3;
+    size_t bucket = static_cast<size_t>(octave - 1) * 4 + sub;
+    return bucket < CAPTURE_STATS_BUCKETS ? bucket : CAPTURE_STATS_BUCKETS - 1;
+}
+
+uint64_t BucketUpperBound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    size_t octave = bucket / 4 + 1;
+    uint64_t sub = bucket % 4;
+    return ((4 + sub + 1) << (octave - 2)) - 1;
+}
+
+void StoreMax(std::atomic<uint64_t>& target, uint64_t value) {
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value > current &&
+           !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+}  // namespace
+
+struct CaptureStats {
+    std::atomic<uint64_t> packets{0};
+    std::atomic<uint64_t> framesCaptured{0};
+    std::atomic<uint64_t> chunksEmitted{0};
+    std::atomic<uint64_t> framesEmitted{0};
+    std::atomic<uint64_t> discontinuities{0};
+    std::atomic<uint64_t> timestampErrors{0};
+    std::atomic<uint64_t> droppedBytes{0};
+    std::atomic<uint64_t> bytesAllocated{0};
+    StageCounters stages[CAPTURE_STAGE_COUNT];
+};
+
+CaptureStats* capture_stats_create(void) {
+    return new (std::nothrow) CaptureStats();
+}
+
+void capture_stats_destroy(CaptureStats* stats) {
+    delete stats;
+}
+
+void capture_stats_reset(CaptureStats* stats) {
+    if (!stats) return;
+    stats->packets.store(0, std::memory_order_relaxed);
+    stats->framesCaptured.store(0, std::memory_order_relaxed);
+    stats->chunksEmitted.store(0, std::memory_order_relaxed);
+    stats->framesEmitted.store(0, std::memory_order_relaxed);
+    stats->discontinuities.store(0, std::memory_order_relaxed);
+    stats->timestampErrors.store(0, std::memory_order_relaxed);
+    stats->droppedBytes.store(0, std::memory_order_relaxed);
+    for (StageCounters& stage : stats->stages) {
+        stage.count.store(0, std::memory_order_relaxed);
+        stage.totalNs.store(0, std::memory_order_relaxed);
+        stage.maxNs.store(0, std::memory_order_relaxed);
+        for (auto& bucket : stage.buckets) bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+void capture_stats_add_packet(CaptureStats* stats, uint64_t frames, uint32_t flags) {
+    if (!stats) return;
+    stats->packets.fetch_add(1, std::memory_order_relaxed);
+    stats->framesCaptured.fetch_add(frames, std::memory_order_relaxed);
+    if (flags & AUDIO_CHUNK_FLAG_DISCONTINUITY) {
+        stats->discontinuities.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void capture_stats_add_timestamp_error(CaptureStats* stats) {
+    if (!stats) return;
+    stats->timestampErrors.fetch_add(1, std::memory_order_relaxed);
+}
+
+void capture_stats_add_chunk(CaptureStats* stats, uint64_t frames) {
+    if (!stats) return;
+    stats->chunksEmitted.fetch_add(1, std::memory_order_relaxed);
+    stats->framesEmitted.fetch_add(frames, std::memory_order_relaxed);
+}
+
+void capture_stats_add_dropped_bytes(CaptureStats* stats, uint64_t bytes) {
+    if (!stats) return;
+    stats->droppedBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void capture_stats_set_allocated(CaptureStats* stats, uint64_t bytes) {
+    if (!stats) return;
+    stats->bytesAllocated.store(bytes, std::memory_order_relaxed);
+}
+
+void capture_stats_add_time(CaptureStats* stats, int32_t stage, uint64_t ns) {
+    if (!stats || stage < 0 || stage >= CAPTURE_STAGE_COUNT) return;
+    StageCounters& counters = stats->stages[stage];
+    counters.count.fetch_add(1, std::memory_order_relaxed);
+    counters.totalNs.fetch_add(ns, std::memory_order_relaxed);
+    StoreMax(counters.maxNs, ns);
+    counters.buckets[BucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t capture_stats_now_ns(void) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void capture_stats_snapshot(const CaptureStats* stats, AudioCaptureStats* out) {
+    if (!out) return;
+    *out = AudioCaptureStats{};
+    if (!stats) return;
+
+    out->packets = stats->packets.load(std::memory_order_relaxed);
+    out->framesCaptured = stats->framesCaptured.load(std::memory_order_relaxed);
+    out->chunksEmitted = stats->chunksEmitted.load(std::memory_order_relaxed);
+    out->framesEmitted = stats->framesEmitted.load(std::memory_order_relaxed);
+    out->discontinuities = stats->discontinuities.load(std::memory_order_relaxed);
+    out->timestampErrors = stats->timestampErrors.load(std::memory_order_relaxed);
+    out->droppedBytes = stats->droppedBytes.load(std::memory_order_relaxed);
+    out->bytesAllocated = stats->bytesAllocated.load(std::memory_order_relaxed);
+    for (int i = 0; i < CAPTURE_STAGE_COUNT; i++) {
+        const StageCounters& counters = stats->stages[i];
+        CaptureStageStats& stage = out->stages[i];
+        stage.count = counters.count.load(std::memory_order_relaxed);
+        stage.totalNs = counters.totalNs.load(std::memory_order_relaxed);
+        stage.maxNs = counters.maxNs.load(std::memory_order_relaxed);
+        for (size_t b = 0; b < CAPTURE_STATS_BUCKETS; b++) {
+            stage.buckets[b] = counters.buckets[b].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+uint64_t capture_stats_percentile_ns(const CaptureStageStats* stage, double fraction) {
+    if (!stage) return 0;
+
+    // The buckets are read one by one while updates go on, so count them
+    // rather than trusting stage->count
+    uint64_t total = 0;
+    for (size_t b = 0; b < CAPTURE_STATS_BUCKETS; b++) total += stage->buckets[b];
+    if (total == 0) return 0;
+
+    if (fraction < 0) fraction = 0;
+    if (fraction > 1) fraction = 1;
+    uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(total)));
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (size_t b = 0; b < CAPTURE_STATS_BUCKETS; b++) {
+        seen += stage->buckets[b];
+        if (seen >= rank) {
+            uint64_t bound = BucketUpperBound(b);
+            return bound < stage->maxNs ? bound : stage->maxNs;
+        }
+    }
+    return stage->maxNs;
+}
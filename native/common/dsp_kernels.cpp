@@ -0,0 +1,832 @@
+#include "dsp_kernels.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define DSP_X64 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define DSP_ARM64 1
+#include <arm_neon.h>
+#endif
+
+// GCC/Clang need a per-function target to emit AVX2 without -mavx2 for the
+// whole file; MSVC accepts the intrinsics anywhere.
+#if defined(DSP_X64) && !defined(_MSC_VER)
+#define DSP_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define DSP_TARGET_AVX2
+#endif
+
+namespace {
+
+constexpr float kS16Scale = 32767.0f;
+constexpr float kS16Inverse = 1.0f / 32768.0f;
+constexpr float kS24Scale = 8388607.0f;
+
+// Samples gathered per channel before a planar block is converted
+constexpr size_t kPlanarBlock = 256;
+// Frames a channel matrix pass accumulates per output channel; small enough
+// that the block's input stays in L1 (16 KB at 64 channels)
+constexpr size_t kMatrixBlock = 64;
+constexpr float kRandomScale = 1.0f / 16777216.0f;  // 2^-24
+
+struct DspKernels {
+    void (*gain)(const float*, float*, size_t, float);
+    void (*gainClamp)(float*, size_t, float);
+    void (*gainDownmix)(const float*, float*, size_t, uint32_t, float);
+    void (*mix)(const float*, float*, size_t, float);
+    void (*matrixTap)(const float*, float*, size_t, uint32_t, float);
+    void (*f32ToS16)(const float*, int16_t*, size_t, DspDitherState*);
+    void (*s16ToF32)(const int16_t*, float*, size_t);
+    void (*levels)(const float*, size_t, uint32_t, uint32_t, float*, float*, uint32_t*);
+    const char* isa;
+};
+
+// ============================================================================
+// Scalar (reference implementation and loop tails)
+// ============================================================================
+
+void GainScalar(const float* in, float* out, size_t count, float gain) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = in[i] * gain;
+    }
+}
+
+void GainClampScalar(float* samples, size_t count, float gain) {
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = std::max(-1.0f, std::min(1.0f, samples[i] * gain));
+    }
+}
+
+void GainDownmixScalar(const float* in, float* out, size_t frames, uint32_t channels, float gain) {
+    const float scale = gain / static_cast<float>(channels);
+    for (size_t i = 0; i < frames; i++) {
+        const float* frame = in + i * channels;
+        float sum = 0.0f;
+        for (uint32_t c = 0; c < channels; c++) {
+            sum += frame[c];
+        }
+        out[i] = sum * scale;
+    }
+}
+
+void MixScalar(const float* in, float* out, size_t count, float gain) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] += in[i] * gain;
+    }
+}
+
+// One channel matrix weight: acc[f] += in[f * stride] * weight. in points at
+// the tap's channel in the first frame.
+void MatrixTapScalar(const float* in, float* acc, size_t frames, uint32_t stride, float weight) {
+    for (size_t f = 0; f < frames; f++) {
+        acc[f] += in[f * stride] * weight;
+    }
+}
+
+// Accumulates into peak/sumSquares/clipped for the first `metered` channels
+void LevelsScalar(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                  float* peak, float* sumSquares, uint32_t* clipped) {
+    for (size_t i = 0; i < frames; i++) {
+        const float* frame = in + i * channels;
+        for (uint32_t c = 0; c < metered; c++) {
+            float v = std::fabs(frame[c]);
+            peak[c] = std::max(peak[c], v);
+            sumSquares[c] += v * v;
+            clipped[c] += v >= 1.0f ? 1 : 0;
+        }
+    }
+}
+
+// Fold vector lanes into channels: with `lanes` a multiple of the channel
+// count, lane i of interleaved data always holds channel i % channels
+void FoldLevelLanes(const float* lanePeak, const float* laneSum, const uint32_t* laneClips, size_t lanes,
+                    uint32_t channels, uint32_t metered, float* peak, float* sumSquares, uint32_t* clipped) {
+    for (size_t lane = 0; lane < lanes; lane++) {
+        uint32_t c = static_cast<uint32_t>(lane % channels);
+        if (c >= metered) continue;
+        peak[c] = std::max(peak[c], lanePeak[lane]);
+        sumSquares[c] += laneSum[lane];
+        clipped[c] += laneClips[lane];
+    }
+}
+
+inline uint32_t XorShift(uint32_t& x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+// Triangular dither in (-1, 1) LSB: difference of two uniform variables
+inline float TpdfScalar(uint32_t& state) {
+    float a = static_cast<float>(XorShift(state) >> 8) * kRandomScale;
+    float b = static_cast<float>(XorShift(state) >> 8) * kRandomScale;
+    return a - b;
+}
+
+inline int16_t ToS16(float sample, float dither) {
+    float scaled = std::max(-1.0f, std::min(1.0f, sample)) * kS16Scale + dither;
+    long rounded = std::lrint(scaled);
+    return static_cast<int16_t>(std::max(-32768L, std::min(32767L, rounded)));
+}
+
+void F32ToS16Scalar(const float* in, int16_t* out, size_t count, DspDitherState* dither) {
+    if (dither) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ToS16(in[i], TpdfScalar(dither->lanes[0]));
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = ToS16(in[i], 0.0f);
+        }
+    }
+}
+
+void S16ToF32Scalar(const int16_t* in, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = static_cast<float>(in[i]) * kS16Inverse;
+    }
+}
+
+void F32ToS24Scalar(const float* in, uint8_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float scaled = std::max(-1.0f, std::min(1.0f, in[i])) * kS24Scale;
+        long value = std::max(-8388608L, std::min(8388607L, std::lrint(scaled)));
+        uint32_t bits = static_cast<uint32_t>(value);
+        out[i * 3] = static_cast<uint8_t>(bits);
+        out[i * 3 + 1] = static_cast<uint8_t>(bits >> 8);
+        out[i * 3 + 2] = static_cast<uint8_t>(bits >> 16);
+    }
+}
+
+#if defined(DSP_X64)
+
+// ============================================================================
+// SSE2 (x64 baseline)
+// ============================================================================
+
+void GainSse2(const float* in, float* out, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_loadu_ps(in + i), g));
+    }
+    GainScalar(in + i, out + i, count - i, gain);
+}
+
+void MixSse2(const float* in, float* out, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(in + i), g);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), v));
+    }
+    MixScalar(in + i, out + i, count - i, gain);
+}
+
+void GainClampSse2(float* samples, size_t count, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_mul_ps(_mm_loadu_ps(samples + i), g);
+        _mm_storeu_ps(samples + i, _mm_max_ps(lo, _mm_min_ps(hi, v)));
+    }
+    GainClampScalar(samples + i, count - i, gain);
+}
+
+void GainDownmixSse2(const float* in, float* out, size_t frames, uint32_t channels, float gain) {
+    if (channels != 2) {
+        GainDownmixScalar(in, out, frames, channels, gain);
+        return;
+    }
+
+    // Stereo: split 4 frames into L and R vectors, add, scale
+    const __m128 scale = _mm_set1_ps(gain * 0.5f);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        __m128 a = _mm_loadu_ps(in + i * 2);
+        __m128 b = _mm_loadu_ps(in + i * 2 + 4);
+        __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_add_ps(left, right), scale));
+    }
+    GainDownmixScalar(in + i * 2, out + i, frames - i, channels, gain);
+}
+
+// Also the AVX2 tier's: an 8-lane gather measured slower than building lanes by hand
+void MatrixTapSse2(const float* in, float* acc, size_t frames, uint32_t stride, float weight) {
+    const __m128 w = _mm_set1_ps(weight);
+    size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        const float* src = in + f * stride;
+        __m128 v = _mm_setr_ps(src[0], src[stride], src[2 * stride], src[3 * stride]);
+        _mm_storeu_ps(acc + f, _mm_add_ps(_mm_loadu_ps(acc + f), _mm_mul_ps(v, w)));
+    }
+    MatrixTapScalar(in + f * stride, acc + f, frames - f, stride, weight);
+}
+
+inline __m128i XorShiftSse2(__m128i& x) {
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+    x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+    x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+    return x;
+}
+
+inline __m128 TpdfSse2(__m128i& state) {
+    const __m128 scale = _mm_set1_ps(kRandomScale);
+    __m128 a = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(XorShiftSse2(state), 8)), scale);
+    __m128 b = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(XorShiftSse2(state), 8)), scale);
+    return _mm_sub_ps(a, b);
+}
+
+void F32ToS16Sse2(const float* in, int16_t* out, size_t count, DspDitherState* dither) {
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(kS16Scale);
+    __m128i state = dither ? _mm_loadu_si128(reinterpret_cast<const __m128i*>(dither->lanes)) : _mm_setzero_si128();
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128 a = _mm_mul_ps(_mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(in + i))), scale);
+        __m128 b = _mm_mul_ps(_mm_max_ps(lo, _mm_min_ps(hi, _mm_loadu_ps(in + i + 4))), scale);
+        if (dither) {
+            a = _mm_add_ps(a, TpdfSse2(state));
+            b = _mm_add_ps(b, TpdfSse2(state));
+        }
+        // cvtps rounds to nearest; packs saturates the dithered extremes
+        __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), packed);
+    }
+
+    if (dither) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dither->lanes), state);
+    }
+    F32ToS16Scalar(in + i, out + i, count - i, dither);
+}
+
+void S16ToF32Sse2(const int16_t* in, float* out, size_t count) {
+    const __m128 scale = _mm_set1_ps(kS16Inverse);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        // Sign-extend by unpacking into the high half and shifting back down
+        __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+    }
+    S16ToF32Scalar(in + i, out + i, count - i);
+}
+
+void LevelsSse2(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                float* peak, float* sumSquares, uint32_t* clipped) {
+    if (4 % channels != 0) {
+        LevelsScalar(in, frames, channels, metered, peak, sumSquares, clipped);
+        return;
+    }
+
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 vPeak = _mm_setzero_ps();
+    __m128 vSum = _mm_setzero_ps();
+    __m128i vClips = _mm_setzero_si128();
+
+    const size_t count = frames * channels;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_andnot_ps(signMask, _mm_loadu_ps(in + i));
+        vPeak = _mm_max_ps(vPeak, v);
+        vSum = _mm_add_ps(vSum, _mm_mul_ps(v, v));
+        // Compare masks are -1 per clipped lane
+        vClips = _mm_sub_epi32(vClips, _mm_castps_si128(_mm_cmpge_ps(v, one)));
+    }
+
+    float lanePeak[4], laneSum[4];
+    uint32_t laneClips[4];
+    _mm_storeu_ps(lanePeak, vPeak);
+    _mm_storeu_ps(laneSum, vSum);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(laneClips), vClips);
+    FoldLevelLanes(lanePeak, laneSum, laneClips, 4, channels, metered, peak, sumSquares, clipped);
+    LevelsScalar(in + i, (count - i) / channels, channels, metered, peak, sumSquares, clipped);
+}
+
+// ============================================================================
+// AVX2
+// ============================================================================
+
+DSP_TARGET_AVX2 void GainAvx2(const float* in, float* out, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_loadu_ps(in + i), g));
+    }
+    GainSse2(in + i, out + i, count - i, gain);
+}
+
+DSP_TARGET_AVX2 void MixAvx2(const float* in, float* out, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(in + i), g);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_loadu_ps(out + i), v));
+    }
+    MixSse2(in + i, out + i, count - i, gain);
+}
+
+DSP_TARGET_AVX2 void GainClampAvx2(float* samples, size_t count, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_loadu_ps(samples + i), g);
+        _mm256_storeu_ps(samples + i, _mm256_max_ps(lo, _mm256_min_ps(hi, v)));
+    }
+    GainClampSse2(samples + i, count - i, gain);
+}
+
+DSP_TARGET_AVX2 void GainDownmixAvx2(const float* in, float* out, size_t frames, uint32_t channels, float gain) {
+    if (channels != 2) {
+        GainDownmixScalar(in, out, frames, channels, gain);
+        return;
+    }
+
+    // hadd pairs L+R per 128-bit lane, then restore frame order across lanes
+    const __m256 scale = _mm256_set1_ps(gain * 0.5f);
+    size_t i = 0;
+    for (; i + 8 <= frames; i += 8) {
+        __m256 a = _mm256_loadu_ps(in + i * 2);
+        __m256 b = _mm256_loadu_ps(in + i * 2 + 8);
+        __m256 sums = _mm256_hadd_ps(a, b);
+        sums = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(sums), _MM_SHUFFLE(3, 1, 2, 0)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(sums, scale));
+    }
+    GainDownmixSse2(in + i * 2, out + i, frames - i, channels, gain);
+}
+
+DSP_TARGET_AVX2 inline __m256i XorShiftAvx2(__m256i& x) {
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 13));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 17));
+    x = _mm256_xor_si256(x, _mm256_slli_epi32(x, 5));
+    return x;
+}
+
+DSP_TARGET_AVX2 inline __m256 TpdfAvx2(__m256i& state) {
+    const __m256 scale = _mm256_set1_ps(kRandomScale);
+    __m256 a = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(XorShiftAvx2(state), 8)), scale);
+    __m256 b = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(XorShiftAvx2(state), 8)), scale);
+    return _mm256_sub_ps(a, b);
+}
+
+DSP_TARGET_AVX2 void F32ToS16Avx2(const float* in, int16_t* out, size_t count, DspDitherState* dither) {
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 scale = _mm256_set1_ps(kS16Scale);
+    __m256i state = dither ? _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dither->lanes)) : _mm256_setzero_si256();
+
+    size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m256 a = _mm256_mul_ps(_mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(in + i))), scale);
+        __m256 b = _mm256_mul_ps(_mm256_max_ps(lo, _mm256_min_ps(hi, _mm256_loadu_ps(in + i + 8))), scale);
+        if (dither) {
+            a = _mm256_add_ps(a, TpdfAvx2(state));
+            b = _mm256_add_ps(b, TpdfAvx2(state));
+        }
+        // packs works per 128-bit lane; permute restores sample order
+        __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+        packed = _mm256_permute4x64_epi64(packed, _MM_SHUFFLE(3, 1, 2, 0));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), packed);
+    }
+
+    if (dither) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dither->lanes), state);
+    }
+    F32ToS16Sse2(in + i, out + i, count - i, dither);
+}
+
+DSP_TARGET_AVX2 void S16ToF32Avx2(const int16_t* in, float* out, size_t count) {
+    const __m256 scale = _mm256_set1_ps(kS16Inverse);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i v = _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(v), scale));
+    }
+    S16ToF32Scalar(in + i, out + i, count - i);
+}
+
+DSP_TARGET_AVX2 void LevelsAvx2(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                                float* peak, float* sumSquares, uint32_t* clipped) {
+    if (8 % channels != 0) {
+        LevelsSse2(in, frames, channels, metered, peak, sumSquares, clipped);
+        return;
+    }
+
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 vPeak = _mm256_setzero_ps();
+    __m256 vSum = _mm256_setzero_ps();
+    __m256i vClips = _mm256_setzero_si256();
+
+    const size_t count = frames * channels;
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_andnot_ps(signMask, _mm256_loadu_ps(in + i));
+        vPeak = _mm256_max_ps(vPeak, v);
+        vSum = _mm256_add_ps(vSum, _mm256_mul_ps(v, v));
+        vClips = _mm256_sub_epi32(vClips, _mm256_castps_si256(_mm256_cmp_ps(v, one, _CMP_GE_OQ)));
+    }
+
+    float lanePeak[8], laneSum[8];
+    uint32_t laneClips[8];
+    _mm256_storeu_ps(lanePeak, vPeak);
+    _mm256_storeu_ps(laneSum, vSum);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(laneClips), vClips);
+    FoldLevelLanes(lanePeak, laneSum, laneClips, 8, channels, metered, peak, sumSquares, clipped);
+    LevelsScalar(in + i, (count - i) / channels, channels, metered, peak, sumSquares, clipped);
+}
+
+bool CpuHasAvx2() {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+
+    // AVX2 also needs the OS to save YMM state (OSXSAVE + XCR0 bits 1-2)
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // DSP_X64
+
+#if defined(DSP_ARM64)
+
+// ============================================================================
+// NEON (arm64 baseline)
+// ============================================================================
+
+void GainNeon(const float* in, float* out, size_t count, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vmulq_f32(vld1q_f32(in + i), g));
+    }
+    GainScalar(in + i, out + i, count - i, gain);
+}
+
+void MixNeon(const float* in, float* out, size_t count, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(out + i, vmlaq_f32(vld1q_f32(out + i), vld1q_f32(in + i), g));
+    }
+    MixScalar(in + i, out + i, count - i, gain);
+}
+
+void GainClampNeon(float* samples, size_t count, float gain) {
+    const float32x4_t g = vdupq_n_f32(gain);
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vmulq_f32(vld1q_f32(samples + i), g);
+        vst1q_f32(samples + i, vmaxq_f32(lo, vminq_f32(hi, v)));
+    }
+    GainClampScalar(samples + i, count - i, gain);
+}
+
+void GainDownmixNeon(const float* in, float* out, size_t frames, uint32_t channels, float gain) {
+    if (channels != 2) {
+        GainDownmixScalar(in, out, frames, channels, gain);
+        return;
+    }
+
+    // vld2 deinterleaves L and R directly
+    const float32x4_t scale = vdupq_n_f32(gain * 0.5f);
+    size_t i = 0;
+    for (; i + 4 <= frames; i += 4) {
+        float32x4x2_t lr = vld2q_f32(in + i * 2);
+        vst1q_f32(out + i, vmulq_f32(vaddq_f32(lr.val[0], lr.val[1]), scale));
+    }
+    GainDownmixScalar(in + i * 2, out + i, frames - i, channels, gain);
+}
+
+void MatrixTapNeon(const float* in, float* acc, size_t frames, uint32_t stride, float weight) {
+    size_t f = 0;
+    for (; f + 4 <= frames; f += 4) {
+        const float* src = in + f * stride;
+        float32x4_t v = vdupq_n_f32(src[0]);
+        v = vld1q_lane_f32(src + stride, v, 1);
+        v = vld1q_lane_f32(src + 2 * stride, v, 2);
+        v = vld1q_lane_f32(src + 3 * stride, v, 3);
+        vst1q_f32(acc + f, vmlaq_n_f32(vld1q_f32(acc + f), v, weight));
+    }
+    MatrixTapScalar(in + f * stride, acc + f, frames - f, stride, weight);
+}
+
+inline uint32x4_t XorShiftNeon(uint32x4_t& x) {
+    x = veorq_u32(x, vshlq_n_u32(x, 13));
+    x = veorq_u32(x, vshrq_n_u32(x, 17));
+    x = veorq_u32(x, vshlq_n_u32(x, 5));
+    return x;
+}
+
+inline float32x4_t TpdfNeon(uint32x4_t& state) {
+    const float32x4_t scale = vdupq_n_f32(kRandomScale);
+    float32x4_t a = vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(XorShiftNeon(state), 8)), scale);
+    float32x4_t b = vmulq_f32(vcvtq_f32_u32(vshrq_n_u32(XorShiftNeon(state), 8)), scale);
+    return vsubq_f32(a, b);
+}
+
+void F32ToS16Neon(const float* in, int16_t* out, size_t count, DspDitherState* dither) {
+    const float32x4_t lo = vdupq_n_f32(-1.0f);
+    const float32x4_t hi = vdupq_n_f32(1.0f);
+    const float32x4_t scale = vdupq_n_f32(kS16Scale);
+    uint32x4_t state = dither ? vld1q_u32(dither->lanes) : vdupq_n_u32(0);
+
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        float32x4_t a = vmulq_f32(vmaxq_f32(lo, vminq_f32(hi, vld1q_f32(in + i))), scale);
+        float32x4_t b = vmulq_f32(vmaxq_f32(lo, vminq_f32(hi, vld1q_f32(in + i + 4))), scale);
+        if (dither) {
+            a = vaddq_f32(a, TpdfNeon(state));
+            b = vaddq_f32(b, TpdfNeon(state));
+        }
+        // Round to nearest, then saturating narrow
+        int16x8_t packed = vcombine_s16(vqmovn_s32(vcvtnq_s32_f32(a)), vqmovn_s32(vcvtnq_s32_f32(b)));
+        vst1q_s16(out + i, packed);
+    }
+
+    if (dither) {
+        vst1q_u32(dither->lanes, state);
+    }
+    F32ToS16Scalar(in + i, out + i, count - i, dither);
+}
+
+void S16ToF32Neon(const int16_t* in, float* out, size_t count) {
+    const float32x4_t scale = vdupq_n_f32(kS16Inverse);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        int16x8_t v = vld1q_s16(in + i);
+        vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), scale));
+        vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), scale));
+    }
+    S16ToF32Scalar(in + i, out + i, count - i);
+}
+
+void LevelsNeon(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                float* peak, float* sumSquares, uint32_t* clipped) {
+    if (4 % channels != 0) {
+        LevelsScalar(in, frames, channels, metered, peak, sumSquares, clipped);
+        return;
+    }
+
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    float32x4_t vPeak = vdupq_n_f32(0.0f);
+    float32x4_t vSum = vdupq_n_f32(0.0f);
+    uint32x4_t vClips = vdupq_n_u32(0);
+
+    const size_t count = frames * channels;
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        float32x4_t v = vabsq_f32(vld1q_f32(in + i));
+        vPeak = vmaxq_f32(vPeak, v);
+        vSum = vmlaq_f32(vSum, v, v);
+        // Compare masks are all ones (= -1) per clipped lane
+        vClips = vsubq_u32(vClips, vcgeq_f32(v, one));
+    }
+
+    float lanePeak[4], laneSum[4];
+    uint32_t laneClips[4];
+    vst1q_f32(lanePeak, vPeak);
+    vst1q_f32(laneSum, vSum);
+    vst1q_u32(laneClips, vClips);
+    FoldLevelLanes(lanePeak, laneSum, laneClips, 4, channels, metered, peak, sumSquares, clipped);
+    LevelsScalar(in + i, (count - i) / channels, channels, metered, peak, sumSquares, clipped);
+}
+
+#endif // DSP_ARM64
+
+DspKernels SelectKernels() {
+    const DspKernels scalar = {
+        GainScalar, GainClampScalar, GainDownmixScalar, MixScalar, MatrixTapScalar, F32ToS16Scalar, S16ToF32Scalar,
+        LevelsScalar, "scalar"
+    };
+
+    // NATIVE_AUDIO_DSP_ISA forces a lower tier, e.g. to compare kernels in benchmarks
+    const char* forced = std::getenv("NATIVE_AUDIO_DSP_ISA");
+    if (forced && std::strcmp(forced, "scalar") == 0) {
+        return scalar;
+    }
+
+#if defined(DSP_X64)
+    const DspKernels sse2 = {
+        GainSse2, GainClampSse2, GainDownmixSse2, MixSse2, MatrixTapSse2, F32ToS16Sse2, S16ToF32Sse2, LevelsSse2, "sse2"
+    };
+    if (forced && std::strcmp(forced, "sse2") == 0) {
+        return sse2;
+    }
+    if (CpuHasAvx2()) {
+        return {
+            GainAvx2, GainClampAvx2, GainDownmixAvx2, MixAvx2, MatrixTapSse2, F32ToS16Avx2, S16ToF32Avx2, LevelsAvx2, "avx2"
+        };
+    }
+    return sse2;
+#elif defined(DSP_ARM64)
+    return {
+        GainNeon, GainClampNeon, GainDownmixNeon, MixNeon, MatrixTapNeon, F32ToS16Neon, S16ToF32Neon, LevelsNeon, "neon"
+    };
+#else
+    return scalar;
+#endif
+}
+
+const DspKernels& Kernels() {
+    // Resolved once; C++11 guarantees thread-safe initialization
+    static const DspKernels kernels = SelectKernels();
+    return kernels;
+}
+
+// Convert `count` contiguous floats into `format` at `out`
+void ConvertSamples(const float* in, size_t count, int32_t format, DspDitherState* dither, uint8_t* out) {
+    switch (format) {
+        case DSP_FORMAT_S16:
+            Kernels().f32ToS16(in, reinterpret_cast<int16_t*>(out), count, dither);
+            break;
+        case DSP_FORMAT_S24:
+            F32ToS24Scalar(in, out, count);
+            break;
+        default:
+            std::memcpy(out, in, count * sizeof(float));
+            break;
+    }
+}
+
+} // namespace
+
+extern "C" {
+
+void dsp_gain_f32(const float* in, float* out, size_t count, float gain) {
+    Kernels().gain(in, out, count, gain);
+}
+
+void dsp_gain_clamp_f32(float* samples, size_t count, float gain) {
+    Kernels().gainClamp(samples, count, gain);
+}
+
+void dsp_gain_downmix_f32(const float* in, float* out, size_t frames, uint32_t channels, float gain) {
+    if (channels == 0) return;
+    Kernels().gainDownmix(in, out, frames, channels, gain);
+}
+
+void dsp_mix_f32(const float* in, float* out, size_t count, float gain) {
+    Kernels().mix(in, out, count, gain);
+}
+
+void dsp_channel_matrix_f32(const float* in, float* out, size_t frames,
+                            uint32_t inChannels, uint32_t outChannels, const float* matrix) {
+    if (inChannels == 0 || outChannels == 0) return;
+    const DspKernels& kernels = Kernels();
+
+    // Per block, accumulate each output channel over its nonzero taps, then
+    // interleave it into place
+    float acc[kMatrixBlock];
+    for (size_t start = 0; start < frames; start += kMatrixBlock) {
+        const size_t count = std::min(kMatrixBlock, frames - start);
+        const float* src = in + start * inChannels;
+        float* dest = out + start * outChannels;
+
+        for (uint32_t o = 0; o < outChannels; o++) {
+            const float* row = matrix + static_cast<size_t>(o) * inChannels;
+            std::fill(acc, acc + count, 0.0f);
+            for (uint32_t i = 0; i < inChannels; i++) {
+                if (row[i] != 0.0f) {
+                    kernels.matrixTap(src + i, acc, count, inChannels, row[i]);
+                }
+            }
+
+            if (outChannels == 1) {
+                std::memcpy(dest, acc, count * sizeof(float));
+            } else {
+                for (size_t f = 0; f < count; f++) {
+                    dest[f * outChannels + o] = acc[f];
+                }
+            }
+        }
+    }
+}
+
+bool dsp_channel_matrix_fit(const float* matrix, uint32_t outputs, uint32_t inputs,
+                            uint32_t channels, float* out) {
+    for (uint32_t o = 0; o < outputs; o++) {
+        for (uint32_t i = channels; i < inputs; i++) {
+            if (matrix[static_cast<size_t>(o) * inputs + i] != 0.0f) return false;
+        }
+    }
+    for (uint32_t o = 0; o < outputs; o++) {
+        for (uint32_t c = 0; c < channels; c++) {
+            out[static_cast<size_t>(o) * channels + c] = c < inputs ? matrix[static_cast<size_t>(o) * inputs + c] : 0.0f;
+        }
+    }
+    return true;
+}
+
+void dsp_dither_init(DspDitherState* state, uint32_t seed) {
+    // xorshift must never be seeded with zero; give each lane its own stream
+    uint32_t x = seed ? seed : 0x9E3779B9u;
+    for (uint32_t& lane : state->lanes) {
+        x = x * 1664525u + 1013904223u;
+        lane = x ? x : 1u;
+    }
+}
+
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t count, DspDitherState* dither) {
+    Kernels().f32ToS16(in, out, count, dither);
+}
+
+void dsp_s16_to_f32(const int16_t* in, float* out, size_t count) {
+    Kernels().s16ToF32(in, out, count);
+}
+
+void dsp_f32_to_s24(const float* in, uint8_t* out, size_t count) {
+    F32ToS24Scalar(in, out, count);
+}
+
+size_t dsp_format_bytes(int32_t format) {
+    switch (format) {
+        case DSP_FORMAT_F32: return 4;
+        case DSP_FORMAT_S16: return 2;
+        case DSP_FORMAT_S24: return 3;
+        default: return 0;
+    }
+}
+
+size_t dsp_encode_f32(const float* in, size_t frames, uint32_t channels,
+                      int32_t format, bool planar, DspDitherState* dither, void* out) {
+    const size_t sampleBytes = dsp_format_bytes(format);
+    if (sampleBytes == 0 || channels == 0) return 0;
+
+    uint8_t* dest = static_cast<uint8_t*>(out);
+    if (!planar || channels == 1) {
+        ConvertSamples(in, frames * channels, format, dither, dest);
+        return frames * channels * sampleBytes;
+    }
+
+    // Gather each channel into a small block so conversion stays vectorized
+    float block[kPlanarBlock];
+    for (uint32_t c = 0; c < channels; c++) {
+        uint8_t* channelOut = dest + c * frames * sampleBytes;
+        for (size_t start = 0; start < frames; start += kPlanarBlock) {
+            size_t count = std::min(kPlanarBlock, frames - start);
+            const float* src = in + start * channels + c;
+            for (size_t i = 0; i < count; i++) {
+                block[i] = src[i * channels];
+            }
+            ConvertSamples(block, count, format, dither, channelOut + start * sampleBytes);
+        }
+    }
+    return frames * channels * sampleBytes;
+}
+
+void dsp_levels_f32(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                    float* peak, float* rms, uint32_t* clipped) {
+    if (channels == 0) return;
+    metered = std::min(metered, channels);
+    for (uint32_t c = 0; c < metered; c++) {
+        peak[c] = 0.0f;
+        rms[c] = 0.0f;
+        clipped[c] = 0;
+    }
+    if (frames == 0) return;
+
+    // rms holds the sum of squares until the kernel is done
+    Kernels().levels(in, frames, channels, metered, peak, rms, clipped);
+    for (uint32_t c = 0; c < metered; c++) {
+        rms[c] = std::sqrt(rms[c] / static_cast<float>(frames));
+    }
+}
+
+const char* dsp_active_isa(void) {
+    return Kernels().isa;
+}
+
+} // extern "C"
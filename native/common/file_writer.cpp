@@ -0,0 +1,407 @@
+#include "file_writer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+
+#include "audio_encoder.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+constexpr size_t kBlockAlignment = 4096;
+constexpr auto kPollInterval = std::chrono::milliseconds(20);
+constexpr size_t kFrameMarks = 4096;
+
+} // namespace
+
+// ============================================================================
+// Platform file handle: sequential appends, positional patches, preallocation
+// ============================================================================
+
+class FileWriter::File {
+public:
+    ~File() { CloseHandle(); }
+
+#ifdef _WIN32
+    bool Open(const std::string& path) {
+        int length = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, nullptr, 0);
+        if (length <= 0) return false;
+        std::wstring widePath(static_cast<size_t>(length), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, path.c_str(), -1, &widePath[0], length);
+        handle_ = CreateFileW(widePath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        return handle_ != INVALID_HANDLE_VALUE;
+    }
+
+    bool WriteAt(uint64_t offset, const uint8_t* data, size_t bytes) {
+        while (bytes > 0) {
+            OVERLAPPED overlapped{};
+            overlapped.Offset = static_cast<DWORD>(offset);
+            overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD chunk = static_cast<DWORD>(std::min<size_t>(bytes, 1u << 30));
+            DWORD written = 0;
+            if (!WriteFile(handle_, data, chunk, &written, &overlapped) || written == 0) return false;
+            data += written;
+            bytes -= written;
+            offset += written;
+        }
+        return true;
+    }
+
+    void Preallocate(uint64_t bytes) {
+        // Reserves clusters without moving end-of-file
+        FILE_ALLOCATION_INFO info{};
+        info.AllocationSize.QuadPart = static_cast<LONGLONG>(bytes);
+        SetFileInformationByHandle(handle_, FileAllocationInfo, &info, sizeof(info));
+    }
+
+    void Truncate(uint64_t size) {
+        FILE_END_OF_FILE_INFO info{};
+        info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+        SetFileInformationByHandle(handle_, FileEndOfFileInfo, &info, sizeof(info));
+    }
+
+    void CloseHandle() {
+        if (handle_ != INVALID_HANDLE_VALUE) {
+            ::CloseHandle(handle_);
+            handle_ = INVALID_HANDLE_VALUE;
+        }
+    }
+
+private:
+    HANDLE handle_ = INVALID_HANDLE_VALUE;
+#else
+    bool Open(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        return fd_ >= 0;
+    }
+
+    bool WriteAt(uint64_t offset, const uint8_t* data, size_t bytes) {
+        while (bytes > 0) {
+            ssize_t written = ::pwrite(fd_, data, bytes, static_cast<off_t>(offset));
+            if (written < 0 && errno == EINTR) continue;
+            if (written <= 0) return false;
+            data += written;
+            bytes -= static_cast<size_t>(written);
+            offset += static_cast<uint64_t>(written);
+        }
+        return true;
+    }
+
+    void Preallocate(uint64_t bytes) {
+#if defined(__APPLE__)
+        // Contiguous if possible, else anywhere; doesn't move end-of-file
+        fstore_t store{F_ALLOCATECONTIG, F_PEOFPOSMODE, 0, static_cast<off_t>(bytes), 0};
+        if (fcntl(fd_, F_PREALLOCATE, &store) == -1) {
+            store.fst_flags = F_ALLOCATEALL;
+            fcntl(fd_, F_PREALLOCATE, &store);
+        }
+#elif defined(__linux__)
+        // Extends the file; Close() trims it back to what was written
+        posix_fallocate(fd_, 0, static_cast<off_t>(bytes));
+#else
+        (void)bytes;
+#endif
+    }
+
+    void Truncate(uint64_t size) {
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            // Leaves the preallocated tail; the container sizes still describe the data
+        }
+    }
+
+    void CloseHandle() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+
+private:
+    int fd_ = -1;
+#endif
+};
+
+void FileWriter::AlignedFree::operator()(uint8_t* p) const {
+    ::operator delete(p, std::align_val_t(kBlockAlignment));
+}
+
+// ============================================================================
+// Producer side
+// ============================================================================
+
+FileWriter::FileWriter() = default;
+
+FileWriter::~FileWriter() {
+    Close();
+}
+
+bool FileWriter::Open(const std::string& path, const Config& config, ProgressSink progress, ErrorSink error,
+                      void* context, std::string* errorMessage) {
+    Close();
+
+    config_ = config;
+    // Whole filesystem blocks, and a ring that holds at least two of them
+    config_.blockBytes = std::max(kBlockAlignment,
+                                  (config_.blockBytes + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment);
+    config_.bufferBytes = std::max(config_.bufferBytes, config_.blockBytes * 2);
+    config_.progressIntervalMs = std::max(config_.progressIntervalMs, 50.0);
+
+    auto file = std::make_unique<File>();
+    if (!file->Open(path)) {
+        if (errorMessage) *errorMessage = "Cannot open " + path + " for writing";
+        return false;
+    }
+    if (config_.preallocateBytes > 0) {
+        file->Preallocate(config_.preallocateBytes);
+    }
+
+    file_ = std::move(file);
+    progress_ = progress;
+    error_ = error;
+    context_ = context;
+
+    ring_.assign(config_.bufferBytes, 0);
+    block_.reset(static_cast<uint8_t*>(::operator new(config_.blockBytes, std::align_val_t(kBlockAlignment))));
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    framesQueued_.store(0, std::memory_order_relaxed);
+    droppedChunks_.store(0, std::memory_order_relaxed);
+    marks_.assign(kFrameMarks, FrameMark{0, 0});
+    markHead_.store(0, std::memory_order_relaxed);
+    markTail_.store(0, std::memory_order_relaxed);
+    pendingContainer_.store(-1, std::memory_order_relaxed);
+    container_ = Container::Raw;
+    header_.clear();
+    headerBytes_ = 0;
+    bytesWritten_ = 0;
+    framesWritten_ = 0;
+    failed_ = false;
+    stopping_.store(false, std::memory_order_relaxed);
+    streamBegun_ = false;
+
+    open_ = true;
+    thread_ = std::thread(&FileWriter::Run, this);
+    return true;
+}
+
+void FileWriter::BeginStream(const StreamFormat& format) {
+    if (!open_ || streamBegun_) return;
+    streamBegun_ = true;
+
+    Container container = Container::Raw;
+    if (format.encoding == "wav") {
+        container = Container::WavStream;
+    } else if (format.encoding == "flac") {
+        container = Container::Flac;
+    } else if (!config_.raw && format.encoding.compare(0, 4, "pcm_") == 0 &&
+               format.encoding.find("planar") == std::string::npos && format.channels > 0) {
+        container = Container::WavPcm;
+    }
+
+    // Published before any bytes, so the writer knows what the stream starts with
+    pendingContainer_.store(static_cast<int>(container), std::memory_order_release);
+
+    if (container == Container::WavPcm) {
+        uint8_t header[AUDIO_WAV_HEADER_BYTES];
+        audio_wav_header(header, format.sampleRate, format.channels, format.bitsPerSample, format.isFloat);
+        Write(header, sizeof(header), 0);
+    }
+}
+
+bool FileWriter::Write(const uint8_t* data, size_t bytes, uint32_t frames) {
+    if (!open_) return false;
+
+    const uint64_t head = head_.load(std::memory_order_relaxed);
+    const uint64_t tail = tail_.load(std::memory_order_acquire);
+    if (bytes > ring_.size() - (head - tail)) {
+        droppedChunks_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const size_t offset = static_cast<size_t>(head % ring_.size());
+    const size_t first = std::min(bytes, ring_.size() - offset);
+    std::memcpy(ring_.data() + offset, data, first);
+    std::memcpy(ring_.data(), data + first, bytes - first);
+
+    const uint64_t framesQueued = framesQueued_.fetch_add(frames, std::memory_order_relaxed) + frames;
+    head_.store(head + bytes, std::memory_order_release);
+
+    if (frames > 0) {
+        const uint64_t markHead = markHead_.load(std::memory_order_relaxed);
+        if (markHead - markTail_.load(std::memory_order_acquire) < marks_.size()) {
+            marks_[markHead & (marks_.size() - 1)] = FrameMark{head + bytes, framesQueued};
+            markHead_.store(markHead + 1, std::memory_order_release);
+        }
+    }
+
+    // No lock here: a missed wake-up only delays the writer to its next poll
+    if (Available() >= config_.blockBytes) {
+        wake_.notify_one();
+    }
+    return true;
+}
+
+void FileWriter::Close() {
+    if (!open_) return;
+
+    stopping_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex_);
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+
+    file_.reset();
+    ring_.clear();
+    ring_.shrink_to_fit();
+    marks_.clear();
+    marks_.shrink_to_fit();
+    block_.reset();
+    open_ = false;
+}
+
+size_t FileWriter::Available() const {
+    return static_cast<size_t>(head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_relaxed));
+}
+
+// ============================================================================
+// Writer thread
+// ============================================================================
+
+void FileWriter::Run() {
+    const auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double, std::milli>(config_.progressIntervalMs));
+    auto nextProgress = std::chrono::steady_clock::now() + interval;
+
+    for (;;) {
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+
+        // head_ first: a container published before those bytes is then visible
+        size_t available = Available();
+        const int pending = pendingContainer_.exchange(-1, std::memory_order_acquire);
+        if (pending >= 0) {
+            container_ = static_cast<Container>(pending);
+            headerBytes_ = container_ == Container::Flac ? AUDIO_FLAC_HEADER_BYTES
+                         : container_ == Container::Raw  ? 0
+                                                         : AUDIO_WAV_HEADER_BYTES;
+            header_.clear();
+        }
+
+        while (available >= config_.blockBytes) {
+            WriteOut(config_.blockBytes);
+            available -= config_.blockBytes;
+        }
+
+        if (stopping) {
+            // The last, partial block
+            if (available > 0) WriteOut(available);
+            // Everything is on disk, including chunks whose mark didn't fit
+            if (!failed_) framesWritten_ = framesQueued_.load(std::memory_order_relaxed);
+            FixUpHeader(true);
+            file_->Truncate(bytesWritten_);
+            if (progress_) {
+                progress_(bytesWritten_, framesWritten_,
+                          droppedChunks_.load(std::memory_order_relaxed), true, context_);
+            }
+            return;
+        }
+
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= nextProgress) {
+            FixUpHeader(false);
+            if (progress_ && !failed_) {
+                progress_(bytesWritten_, framesWritten_,
+                          droppedChunks_.load(std::memory_order_relaxed), false, context_);
+            }
+            nextProgress = now + interval;
+        }
+
+        std::unique_lock<std::mutex> lock(wakeMutex_);
+        wake_.wait_for(lock, kPollInterval, [this] {
+            return stopping_.load(std::memory_order_acquire) || Available() >= config_.blockBytes;
+        });
+    }
+}
+
+void FileWriter::WriteOut(size_t bytes) {
+    const uint64_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t offset = static_cast<size_t>(tail % ring_.size());
+    const size_t first = std::min(bytes, ring_.size() - offset);
+    uint8_t* block = block_.get();
+    std::memcpy(block, ring_.data() + offset, first);
+    std::memcpy(block + first, ring_.data(), bytes - first);
+    tail_.store(tail + bytes, std::memory_order_release);
+
+    // Keep the container header for fix-ups
+    if (header_.size() < headerBytes_) {
+        const size_t take = std::min(headerBytes_ - header_.size(), bytes);
+        header_.insert(header_.end(), block, block + take);
+    }
+
+    if (failed_) return;  // Keep draining so the producer never sees a full ring
+    if (!file_->WriteAt(bytesWritten_, block, bytes)) {
+        Fail("File sink write failed (disk full?); recording to file stopped");
+        return;
+    }
+    bytesWritten_ += bytes;
+    CommitFrames();
+}
+
+// File offsets match ring positions, so a chunk is on disk once
+// bytesWritten_ has passed its end
+void FileWriter::CommitFrames() {
+    const uint64_t markHead = markHead_.load(std::memory_order_acquire);
+    uint64_t markTail = markTail_.load(std::memory_order_relaxed);
+    while (markTail != markHead) {
+        const FrameMark& mark = marks_[markTail & (marks_.size() - 1)];
+        if (mark.endByte > bytesWritten_) break;
+        framesWritten_ = mark.frames;
+        markTail++;
+    }
+    markTail_.store(markTail, std::memory_order_release);
+}
+
+void FileWriter::FixUpHeader(bool final) {
+    if (failed_ || headerBytes_ == 0 || header_.size() < headerBytes_) return;
+
+    switch (container_) {
+        case Container::WavPcm:
+        case Container::WavStream:
+            audio_wav_set_length(header_.data(), bytesWritten_ - headerBytes_);
+            break;
+        case Container::Flac:
+            // Only exact once everything queued is on disk
+            if (!final) return;
+            audio_flac_set_total_samples(header_.data(), framesWritten_);
+            break;
+        case Container::Raw:
+            return;
+    }
+
+    if (!file_->WriteAt(0, header_.data(), headerBytes_)) {
+        Fail("File sink header update failed");
+    }
+}
+
+void FileWriter::Fail(const char* message) {
+    if (failed_) return;
+    failed_ = true;
+    if (error_) error_(message, context_);
+}
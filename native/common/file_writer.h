@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * File Writer - Records chunks straight to disk without a round trip through
+ * JavaScript.
+ *
+ * The capture side copies each finished chunk into a byte ring (lock-free,
+ * never blocks, never allocates); a dedicated writer thread drains the ring in
+ * large block-sized writes, so file offsets stay block aligned and the disk
+ * sees a few big sequential writes instead of one small write per chunk. Space
+ * can be reserved up front, and whatever is left unused is trimmed on Close().
+ *
+ * Containers are finished in place once the length is known:
+ *   - PCM is wrapped in a WAV header (unless raw is set) whose sizes are
+ *     patched on every progress tick, so a crash still leaves a readable file,
+ *     and become RF64 past 4 GiB
+ *   - the "wav" encoder's own header is patched the same way
+ *   - "flac" gets its STREAMINFO sample count on Close()
+ *   - "opus" (length-prefixed packets) and raw PCM are written as is
+ *
+ * If the writer falls behind by more than the ring, whole chunks are dropped
+ * and counted rather than stalling the capture thread. Write errors are
+ * reported once through the error sink; the rest of the stream is discarded.
+ */
+class FileWriter {
+public:
+    // Periodic and final progress, on the writer thread (final = Close()).
+    // framesWritten counts the frames of chunks that are completely on disk.
+    typedef void (*ProgressSink)(uint64_t bytesWritten, uint64_t framesWritten, uint64_t droppedChunks,
+                                 bool final, void* context);
+    // Write failure, on the writer thread
+    typedef void (*ErrorSink)(const char* message, void* context);
+
+    struct Config {
+        bool raw = false;                   // Don't wrap PCM in a WAV header
+        size_t bufferBytes = 8 << 20;       // Ring between the capture and writer threads
+        size_t blockBytes = 256 << 10;      // Size of each write
+        uint64_t preallocateBytes = 0;      // Space reserved when the file is opened
+        double progressIntervalMs = 1000;   // Progress events and header fix-ups
+    };
+
+    // Format of the stream about to be written (from the session metadata)
+    struct StreamFormat {
+        std::string encoding;               // Metadata encoding string
+        double sampleRate = 0;
+        uint32_t channels = 0;
+        uint32_t bitsPerSample = 0;
+        bool isFloat = false;
+    };
+
+    FileWriter();
+    ~FileWriter();
+
+    FileWriter(const FileWriter&) = delete;
+    FileWriter& operator=(const FileWriter&) = delete;
+
+    // Create (or truncate) the file and start the writer thread.
+    // Returns false with *errorMessage set if the file can't be opened.
+    bool Open(const std::string& path, const Config& config, ProgressSink progress, ErrorSink error,
+              void* context, std::string* errorMessage);
+
+    // Called once before the first Write() of a session, on the producer side.
+    // The file has one header, so calls after the first per Open() are ignored.
+    void BeginStream(const StreamFormat& format);
+
+    // Queue one chunk (capture thread). Returns false if it was dropped.
+    bool Write(const uint8_t* data, size_t bytes, uint32_t frames);
+
+    // Flush everything queued, finish the container, trim the file, stop the
+    // thread. Call after the producer has stopped.
+    void Close();
+
+    bool IsOpen() const { return open_; }
+
+private:
+    enum class Container { Raw, WavPcm, WavStream, Flac };
+
+    class File;
+
+    void Run();
+    size_t Available() const;
+    void WriteOut(size_t bytes);
+    void CommitFrames();
+    void FixUpHeader(bool final);
+    void Fail(const char* message);
+
+    Config config_;
+    ProgressSink progress_ = nullptr;
+    ErrorSink error_ = nullptr;
+    void* context_ = nullptr;
+    std::unique_ptr<File> file_;
+    bool open_ = false;
+    bool streamBegun_ = false;  // Producer side: BeginStream() ran since Open()
+
+    // Byte ring: head_ advanced by the producer, tail_ by the writer thread
+    std::vector<uint8_t> ring_;
+    std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> tail_{0};
+    std::atomic<uint64_t> framesQueued_{0};
+    std::atomic<uint64_t> droppedChunks_{0};
+
+    // Where chunks end in the ring, so the writer can count the frames it has
+    // put on disk. A full mark ring only delays that count: marks are cumulative.
+    struct FrameMark {
+        uint64_t endByte;   // Ring position just past the chunk
+        uint64_t frames;    // framesQueued_ including the chunk
+    };
+    std::vector<FrameMark> marks_;            // Power-of-two sized
+    std::atomic<uint64_t> markHead_{0};       // Advanced by the producer
+    std::atomic<uint64_t> markTail_{0};       // Advanced by the writer thread
+
+    // Block staging buffer, aligned for the filesystem
+    struct AlignedFree {
+        void operator()(uint8_t* p) const;
+    };
+    std::unique_ptr<uint8_t, AlignedFree> block_;
+
+    // Writer thread state
+    Container container_ = Container::Raw;
+    std::atomic<int> pendingContainer_{-1};   // Set by BeginStream, picked up by the writer
+    std::vector<uint8_t> header_;             // First bytes of the file, for fix-ups
+    size_t headerBytes_ = 0;
+    uint64_t bytesWritten_ = 0;
+    uint64_t framesWritten_ = 0;              // Frames of chunks wholly on disk
+    bool failed_ = false;
+
+    std::thread thread_;
+    std::mutex wakeMutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> stopping_{false};
+};
@@ -0,0 +1,208 @@
+#include "resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+struct PolyphaseResampler::FilterBank {
+    size_t taps = 0;
+    // coeffs[phase * taps + m] multiplies history[i - taps + 1 + m]
+    std::vector<float> coeffs;
+};
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+struct QualityParams {
+    size_t zeroCrossings;  // Sinc lobes on each side of the center
+    double rolloff;        // Cutoff as a fraction of the lower Nyquist
+    double beta;           // Kaiser window shape
+};
+
+QualityParams ParamsFor(PolyphaseResampler::Quality quality) {
+    switch (quality) {
+        case PolyphaseResampler::Quality::Low:  return { 8, 0.85, 6.0 };
+        case PolyphaseResampler::Quality::High: return { 32, 0.95, 10.0 };
+        default:                                return { 16, 0.91, 8.0 };
+    }
+}
+
+// Zeroth-order modified Bessel function (series expansion)
+double BesselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12) break;
+    }
+    return sum;
+}
+
+std::shared_ptr<const PolyphaseResampler::FilterBank> BuildFilterBank(
+    uint32_t up, uint32_t down, PolyphaseResampler::Quality quality) {
+    QualityParams params = ParamsFor(quality);
+
+    // Downsampling widens the impulse response by M/L input frames per lobe;
+    // round up to a multiple of 4 for the dot product
+    const double stretch = std::max(1.0, static_cast<double>(down) / up);
+    size_t taps = static_cast<size_t>(std::ceil(2.0 * params.zeroCrossings * stretch));
+    taps = (taps + 3) & ~static_cast<size_t>(3);
+    const size_t length = static_cast<size_t>(up) * taps;
+
+    // Low-pass at the lower of the two Nyquist rates, normalized to the
+    // virtual upsampled rate (input rate * L)
+    const double cutoff = 0.5 * params.rolloff / std::max(up, down);
+    const double center = (static_cast<double>(length) - 1.0) / 2.0;
+    const double windowNorm = BesselI0(params.beta);
+
+    std::vector<double> prototype(length);
+    double sum = 0.0;
+    for (size_t j = 0; j < length; j++) {
+        double t = static_cast<double>(j) - center;
+        double sinc = t == 0.0 ? 1.0 : std::sin(2.0 * kPi * cutoff * t) / (2.0 * kPi * cutoff * t);
+        double ratio = center > 0 ? t / center : 0.0;
+        double window = BesselI0(params.beta * std::sqrt(std::max(0.0, 1.0 - ratio * ratio))) / windowNorm;
+        prototype[j] = 2.0 * cutoff * sinc * window;
+        sum += prototype[j];
+    }
+
+    // Each phase sees every L-th coefficient, so unity DC gain needs sum == L
+    const double scale = sum != 0.0 ? static_cast<double>(up) / sum : 0.0;
+
+    auto bank = std::make_shared<PolyphaseResampler::FilterBank>();
+    bank->taps = taps;
+    bank->coeffs.resize(length);
+    for (uint32_t phase = 0; phase < up; phase++) {
+        for (size_t m = 0; m < taps; m++) {
+            // Reversed so the dot product walks history forwards
+            size_t k = taps - 1 - m;
+            bank->coeffs[phase * taps + m] = static_cast<float>(prototype[phase + k * up] * scale);
+        }
+    }
+    return bank;
+}
+
+std::shared_ptr<const PolyphaseResampler::FilterBank> GetFilterBank(
+    uint32_t up, uint32_t down, PolyphaseResampler::Quality quality) {
+    static std::mutex mutex;
+    static std::map<std::tuple<uint32_t, uint32_t, int>, std::shared_ptr<const PolyphaseResampler::FilterBank>> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = std::make_tuple(up, down, static_cast<int>(quality));
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+    auto bank = BuildFilterBank(up, down, quality);
+    cache.emplace(key, bank);
+    return bank;
+}
+
+uint32_t Gcd(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+inline float Dot(const float* coeffs, const float* samples, size_t taps) {
+    // Four partial sums so the compiler can keep it in vector registers
+    float a = 0.0f, b = 0.0f, c = 0.0f, d = 0.0f;
+    size_t m = 0;
+    for (; m + 4 <= taps; m += 4) {
+        a += coeffs[m] * samples[m];
+        b += coeffs[m + 1] * samples[m + 1];
+        c += coeffs[m + 2] * samples[m + 2];
+        d += coeffs[m + 3] * samples[m + 3];
+    }
+    for (; m < taps; m++) {
+        a += coeffs[m] * samples[m];
+    }
+    return (a + b) + (c + d);
+}
+
+} // namespace
+
+bool PolyphaseResampler::Configure(double inputRate, double outputRate, uint32_t channels,
+                                   Quality quality, size_t maxInputFrames) {
+    bank_.reset();
+
+    uint32_t in = static_cast<uint32_t>(std::lround(inputRate));
+    uint32_t out = static_cast<uint32_t>(std::lround(outputRate));
+    if (in == 0 || out == 0 || channels == 0) return false;
+
+    uint32_t divisor = Gcd(in, out);
+    upFactor_ = out / divisor;
+    downFactor_ = in / divisor;
+    if (upFactor_ > kMaxPhases) return false;
+
+    bank_ = GetFilterBank(upFactor_, downFactor_, quality);
+    channels_ = channels;
+    taps_ = bank_->taps;
+
+    historyStride_ = taps_ - 1 + std::max<size_t>(maxInputFrames, 1);
+    history_.assign(historyStride_ * channels_, 0.0f);
+
+    Reset();
+    return true;
+}
+
+void PolyphaseResampler::Reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    inputIndex_ = taps_ > 0 ? taps_ - 1 : 0;
+    phase_ = 0;
+}
+
+size_t PolyphaseResampler::MaxOutputFrames(size_t inputFrames) const {
+    return (inputFrames * upFactor_) / downFactor_ + 2;
+}
+
+size_t PolyphaseResampler::Process(const float* input, size_t frames, float* output) {
+    if (!bank_ || frames == 0) return 0;
+
+    const size_t context = taps_ - 1;
+    frames = std::min(frames, historyStride_ - context);
+
+    // Deinterleave new input behind the retained context
+    for (uint32_t c = 0; c < channels_; c++) {
+        float* channel = history_.data() + c * historyStride_ + context;
+        for (size_t i = 0; i < frames; i++) {
+            channel[i] = input[i * channels_ + c];
+        }
+    }
+
+    const size_t available = context + frames;
+    const float* coeffs = bank_->coeffs.data();
+    size_t produced = 0;
+
+    while (inputIndex_ < available) {
+        const float* phaseCoeffs = coeffs + static_cast<size_t>(phase_) * taps_;
+        const size_t start = inputIndex_ - context;
+        for (uint32_t c = 0; c < channels_; c++) {
+            const float* window = history_.data() + c * historyStride_ + start;
+            output[produced * channels_ + c] = Dot(phaseCoeffs, window, taps_);
+        }
+        produced++;
+
+        // Advance by M/L input frames: exact integer phase accumulation
+        phase_ += downFactor_;
+        inputIndex_ += phase_ / upFactor_;
+        phase_ %= upFactor_;
+    }
+
+    // Keep the last taps_ - 1 frames as context for the next call
+    for (uint32_t c = 0; c < channels_; c++) {
+        float* channel = history_.data() + c * historyStride_;
+        std::memmove(channel, channel + frames, context * sizeof(float));
+    }
+    inputIndex_ -= frames;
+
+    return produced;
+}
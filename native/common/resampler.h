@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Polyphase Resampler - Streaming windowed-sinc sample rate conversion.
+ *
+ * The rate change is reduced to an exact ratio L/M (48k->16k is 1/3,
+ * 44.1k->16k is 160/441), so output positions are tracked with integers and
+ * never drift. Filter history is kept between calls, so packet boundaries are
+ * seamless, and channels are filtered independently.
+ *
+ * Coefficient tables are built in Configure() and cached per (L, M, quality)
+ * for the whole process: every stream at a common ratio shares one table, and
+ * Process() itself never allocates.
+ */
+class PolyphaseResampler {
+public:
+    // Quality trades CPU and latency for stopband rejection. A phase spans
+    // 2 * zero crossings taps, times M/L when downsampling; the group delay is
+    // half of that in input frames.
+    enum class Quality {
+        Low = 0,     // 8 zero crossings
+        Medium = 1,  // 16 zero crossings (default)
+        High = 2,    // 32 zero crossings
+    };
+
+    struct FilterBank;
+
+    // Prepare for conversion. maxInputFrames bounds a single Process() call.
+    // Returns false if the ratio can't be expressed with a reasonable number of
+    // phases (the caller should fall back to another method).
+    bool Configure(double inputRate, double outputRate, uint32_t channels,
+                   Quality quality, size_t maxInputFrames);
+
+    // Convert interleaved input; returns the number of frames written to `output`
+    size_t Process(const float* input, size_t frames, float* output);
+
+    // Upper bound on frames produced by one Process() call of `inputFrames`
+    size_t MaxOutputFrames(size_t inputFrames) const;
+
+    // Clear filter history (the next call starts from silence)
+    void Reset();
+
+    // Group delay in input frames: the centre of the L * taps prototype,
+    // in the virtual upsampled rate, divided by L
+    double LatencyFrames() const {
+        return taps_ > 0 ? (static_cast<double>(taps_) * upFactor_ - 1.0) / 2.0 / upFactor_ : 0.0;
+    }
+
+    static const size_t kMaxPhases = 4096;
+
+private:
+    std::shared_ptr<const FilterBank> bank_;
+    uint32_t channels_ = 0;
+    uint32_t upFactor_ = 1;    // L
+    uint32_t downFactor_ = 1;  // M
+    size_t taps_ = 0;
+
+    // Planar history per channel: taps_ - 1 frames of context, then new input
+    std::vector<float> history_;
+    size_t historyStride_ = 0;
+
+    size_t inputIndex_ = 0;    // Newest history frame the next output needs
+    uint32_t phase_ = 0;
+};
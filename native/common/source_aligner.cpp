@@ -0,0 +1,205 @@
+#include "source_aligner.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio_chunk.h"
+#include "dsp_kernels.h"
+
+void SourceAligner::Configure(const Config& config, FrameSink sink, void* context) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sink_ = sink;
+    context_ = context;
+
+    sampleRate_ = config.sampleRate > 0 ? config.sampleRate : 48000;
+    const double framesPerMs = sampleRate_ / 1000.0;
+    maxLatencyFrames_ = static_cast<uint64_t>(std::max(1.0, config.maxLatencyMs * framesPerMs));
+    toleranceFrames_ = static_cast<int64_t>(std::max(1.0, config.driftToleranceMs * framesPerMs));
+    gapFrames_ = std::max(toleranceFrames_ + 1, static_cast<int64_t>(config.gapThresholdMs * framesPerMs));
+
+    // The leading source may be maxLatency ahead plus one push before padding kicks in
+    const size_t push = std::max<size_t>(config.maxFramesPerPush, 1);
+    capacity_ = static_cast<size_t>(maxLatencyFrames_) + push * 2;
+    channels_ = std::max<uint32_t>(config.channelsPerSource, 1);
+    mix_ = config.mix;
+
+    sources_.assign(std::max<uint32_t>(config.sources, 1), Source());
+    for (Source& source : sources_) {
+        source.ring.assign(capacity_ * channels_, 0.0f);
+    }
+
+    outputFrames_ = push;
+    output_.assign(outputFrames_ * channels_ * (mix_ ? 1 : sources_.size()), 0.0f);
+
+    emitted_ = 0;
+    originNs_ = 0;
+    hasOrigin_ = false;
+    pendingFlags_ = 0;
+}
+
+void SourceAligner::Reset() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (Source& source : sources_) {
+        source.written = 0;
+        source.corrections = 0;
+    }
+    emitted_ = 0;
+    originNs_ = 0;
+    hasOrigin_ = false;
+    pendingFlags_ = 0;
+}
+
+uint64_t SourceAligner::Corrections(uint32_t source) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return source < sources_.size() ? sources_[source].corrections : 0;
+}
+
+size_t SourceAligner::Free(const Source& source) const {
+    return capacity_ - static_cast<size_t>(source.written - emitted_);
+}
+
+void SourceAligner::Write(Source& source, const float* frames, size_t count) {
+    const size_t free = Free(source);
+    if (count > free) {
+        // Only reachable if one source outruns maxLatency within a single push
+        pendingFlags_ |= AUDIO_CHUNK_FLAG_DISCONTINUITY;
+        count = free;
+    }
+    for (size_t i = 0; i < count; i++) {
+        float* slot = &source.ring[((source.written + i) % capacity_) * channels_];
+        std::copy(frames + i * channels_, frames + (i + 1) * channels_, slot);
+    }
+    source.written += count;
+}
+
+void SourceAligner::WriteSilence(Source& source, size_t count) {
+    count = std::min(count, Free(source));
+    for (size_t i = 0; i < count; i++) {
+        float* slot = &source.ring[((source.written + i) % capacity_) * channels_];
+        std::fill(slot, slot + channels_, 0.0f);
+    }
+    source.written += count;
+}
+
+void SourceAligner::Push(uint32_t index, const float* frames, size_t count, uint64_t hostTimeNs, uint32_t flags) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (index >= sources_.size() || !frames || count == 0) return;
+
+    Source& source = sources_[index];
+    pendingFlags_ |= flags;
+
+    // Timeline position of frames[0]: where the source left off, unless its
+    // timestamp says otherwise
+    int64_t start = static_cast<int64_t>(source.written);
+    int slip = 0;
+    if (hostTimeNs != 0) {
+        if (!hasOrigin_) {
+            originNs_ = hostTimeNs;
+            hasOrigin_ = true;
+        }
+        double offsetNs = static_cast<double>(hostTimeNs) - static_cast<double>(originNs_);
+        int64_t expected = static_cast<int64_t>(std::llround(offsetNs * sampleRate_ / 1e9));
+        int64_t error = expected - start;
+
+        if (error > gapFrames_ || error < -gapFrames_) {
+            start = expected;
+            source.corrections += static_cast<uint64_t>(error > 0 ? error : -error);
+        } else if (error > toleranceFrames_) {
+            slip = 1;
+            source.corrections++;
+        } else if (error < -toleranceFrames_ && count > 1) {
+            slip = -1;
+            source.corrections++;
+        }
+    }
+
+    // Gap: fill with silence. When the ring is full, emit (padding the other
+    // sources if they are idle) to make room.
+    while (start > static_cast<int64_t>(source.written)) {
+        size_t missing = static_cast<size_t>(start - static_cast<int64_t>(source.written));
+        size_t before = static_cast<size_t>(source.written - emitted_);
+        WriteSilence(source, missing);
+        if (source.written - emitted_ == before) {
+            Drain(false);
+            if (Free(source) == 0) break;
+        }
+    }
+
+    // Overlap: drop frames for positions already queued or emitted
+    if (start < static_cast<int64_t>(source.written)) {
+        size_t overlap = static_cast<size_t>(static_cast<int64_t>(source.written) - start);
+        size_t skip = std::min(overlap, count);
+        frames += skip * channels_;
+        count -= skip;
+    }
+
+    if (slip > 0 && count > 0) {
+        Write(source, frames, 1);  // Duplicate the first frame
+    } else if (slip < 0 && count > 1) {
+        frames += channels_;
+        count--;
+    }
+
+    Write(source, frames, count);
+    Drain(false);
+}
+
+void SourceAligner::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Drain(true);
+}
+
+void SourceAligner::Drain(bool flush) {
+    if (sources_.empty()) return;
+
+    uint64_t leading = 0;
+    for (const Source& source : sources_) {
+        leading = std::max(leading, source.written);
+    }
+
+    // Sources that fell too far behind (idle, or never started) get silence
+    uint64_t padTo = flush ? leading : (leading > maxLatencyFrames_ ? leading - maxLatencyFrames_ : 0);
+    uint64_t ready = leading;
+    for (Source& source : sources_) {
+        if (source.written < padTo) {
+            WriteSilence(source, static_cast<size_t>(padTo - source.written));
+        }
+        ready = std::min(ready, source.written);
+    }
+
+    const size_t stride = channels_ * (mix_ ? 1 : sources_.size());
+    while (emitted_ < ready) {
+        size_t frames = static_cast<size_t>(std::min<uint64_t>(ready - emitted_, outputFrames_));
+        if (mix_) {
+            std::fill(output_.begin(), output_.begin() + frames * channels_, 0.0f);
+        }
+        for (size_t s = 0; s < sources_.size(); s++) {
+            const std::vector<float>& ring = sources_[s].ring;
+            if (mix_) {
+                // The span is contiguous in the ring except where it wraps
+                size_t start = static_cast<size_t>(emitted_ % capacity_);
+                size_t first = std::min(frames, capacity_ - start);
+                dsp_mix_f32(&ring[start * channels_], output_.data(), first * channels_, 1.0f);
+                dsp_mix_f32(ring.data(), output_.data() + first * channels_, (frames - first) * channels_, 1.0f);
+                continue;
+            }
+            for (size_t i = 0; i < frames; i++) {
+                const float* slot = &ring[((emitted_ + i) % capacity_) * channels_];
+                std::copy(slot, slot + channels_, &output_[i * stride + s * channels_]);
+            }
+        }
+
+        uint64_t hostTimeNs = 0;
+        if (hasOrigin_) {
+            hostTimeNs = originNs_ + static_cast<uint64_t>(static_cast<double>(emitted_) * 1e9 / sampleRate_);
+        }
+
+        uint32_t flags = pendingFlags_;
+        pendingFlags_ = 0;
+        emitted_ += frames;
+
+        if (sink_) {
+            sink_(output_.data(), frames, hostTimeNs, flags, context_);
+        }
+    }
+}
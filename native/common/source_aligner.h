@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+/**
+ * Source Aligner - Merges independently clocked streams into one
+ * multi-channel stream on a shared host-clock timeline.
+ *
+ * Every source pushes interleaved Float32 frames (channelsPerSource samples
+ * each) at the common output rate together with the host time of the first
+ * frame. The first timestamp seen anchors the timeline; each later push is
+ * compared against where that timeline says it belongs and the source is
+ * corrected:
+ *   - small drift (device clocks running at slightly different rates) slips
+ *     one frame per push - a duplicated or dropped sample, inaudible at the
+ *     few-ppm rates real devices drift by
+ *   - a large gap (a source started late or went idle) is filled with silence,
+ *     and late data for a span already emitted is discarded
+ * A source that stops delivering entirely is padded with silence once the
+ * others get more than maxLatencyMs ahead, so output never stalls on it.
+ *
+ * Output frames are interleaved with source i on channels [i * channelsPerSource,
+ * (i + 1) * channelsPerSource), or with mix set, the sources are summed into
+ * one channelsPerSource-channel stream (dsp_mix_f32). Push() may be
+ * called from a different thread per source; the sink runs under the
+ * aligner's lock. All buffers are sized in Configure(), so Push() never
+ * allocates.
+ */
+class SourceAligner {
+public:
+    // Receives interleaved frames; hostTimeNs is 0 if no source had timestamps
+    typedef void (*FrameSink)(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                              uint32_t flags, void* context);
+
+    struct Config {
+        uint32_t sources = 2;
+        uint32_t channelsPerSource = 1;
+        bool mix = false;                  // Sum the sources instead of stacking their channels
+        double sampleRate = 48000;
+        size_t maxFramesPerPush = 480;     // Largest single Push()
+        double maxLatencyMs = 200;         // How far one source may run ahead of another
+        double driftToleranceMs = 1;       // Error left alone before slipping frames
+        double gapThresholdMs = 20;        // Error corrected in one step instead of slipping
+    };
+
+    void Configure(const Config& config, FrameSink sink, void* context);
+
+    // Queue `count` frames from one source; emits every frame all sources have reached
+    void Push(uint32_t source, const float* frames, size_t count, uint64_t hostTimeNs, uint32_t flags = 0);
+
+    // Emit what is queued, padding sources that are behind with silence
+    void Flush();
+
+    // Drop queued audio and the timeline anchor
+    void Reset();
+
+    // Frames inserted or dropped to keep a source on the timeline
+    uint64_t Corrections(uint32_t source) const;
+
+private:
+    struct Source {
+        std::vector<float> ring;
+        uint64_t written = 0;      // Timeline position after the last queued frame
+        uint64_t corrections = 0;
+    };
+
+    void Write(Source& source, const float* frames, size_t count);
+    void WriteSilence(Source& source, size_t count);
+    void Drain(bool flush);
+    size_t Free(const Source& source) const;
+
+    FrameSink sink_ = nullptr;
+    void* context_ = nullptr;
+
+    std::vector<Source> sources_;
+    size_t capacity_ = 0;          // Ring frames per source
+    uint32_t channels_ = 1;        // Samples per source frame
+    bool mix_ = false;
+    double sampleRate_ = 48000;
+    uint64_t maxLatencyFrames_ = 0;
+    int64_t toleranceFrames_ = 0;
+    int64_t gapFrames_ = 0;
+
+    uint64_t emitted_ = 0;         // Timeline position of the next output frame
+    uint64_t originNs_ = 0;        // Host time of timeline position 0
+    bool hasOrigin_ = false;
+    uint32_t pendingFlags_ = 0;
+
+    std::vector<float> output_;    // Interleaved block handed to the sink
+    size_t outputFrames_ = 0;
+
+    mutable std::mutex mutex_;
+};
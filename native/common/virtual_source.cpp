@@ -0,0 +1,155 @@
+#include "virtual_source.h"
+#include "capture_stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <new>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr double kTwoPi = 6.283185307179586;
+constexpr uint32_t kDefaultSeed = 0x9E3779B9u;
+
+}  // namespace
+
+struct VirtualSource {
+    VirtualSourceConfig config;
+    std::vector<float> packet;  // One packet, filled by the thread
+
+    // Signal state
+    double phase = 0;
+    double phaseStep = 0;
+    uint32_t noise = kDefaultSeed;
+    std::atomic<uint64_t> frames{0};
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+    VirtualPacketCallback callback = nullptr;
+    void* context = nullptr;
+};
+
+// xorshift32: cheap, and the same sequence on every platform
+static inline float NextNoise(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<float>(static_cast<int32_t>(state)) * (1.0f / 2147483648.0f);
+}
+
+VirtualSource* virtual_source_create(const VirtualSourceConfig* config) {
+    if (!config || !(config->sampleRate > 0) || config->channels == 0 || config->channels > 64 ||
+        config->framesPerPacket == 0 || config->signal < VIRTUAL_SIGNAL_SILENCE ||
+        config->signal > VIRTUAL_SIGNAL_NOISE) {
+        return nullptr;
+    }
+
+    VirtualSource* source = new (std::nothrow) VirtualSource();
+    if (!source) return nullptr;
+    try {
+        source->packet.resize(static_cast<size_t>(config->framesPerPacket) * config->channels);
+    } catch (const std::bad_alloc&) {
+        delete source;
+        return nullptr;
+    }
+
+    source->config = *config;
+    source->config.amplitude = std::min(std::max(config->amplitude, 0.0), 1.0);
+    source->phaseStep = kTwoPi * config->frequency / config->sampleRate;
+    source->noise = config->seed != 0 ? config->seed : kDefaultSeed;
+    return source;
+}
+
+void virtual_source_destroy(VirtualSource* source) {
+    if (!source) return;
+    virtual_source_stop(source);
+    delete source;
+}
+
+void virtual_source_generate(VirtualSource* source, float* out, size_t frames) {
+    if (!source || !out) return;
+    const VirtualSourceConfig& config = source->config;
+    const size_t channels = config.channels;
+    const float amplitude = static_cast<float>(config.amplitude);
+
+    switch (config.signal) {
+        case VIRTUAL_SIGNAL_SINE:
+            for (size_t f = 0; f < frames; f++) {
+                float sample = amplitude * static_cast<float>(std::sin(source->phase));
+                for (size_t c = 0; c < channels; c++) out[f * channels + c] = sample;
+                source->phase += source->phaseStep;
+                if (source->phase >= kTwoPi) source->phase -= kTwoPi;
+            }
+            break;
+
+        case VIRTUAL_SIGNAL_NOISE:
+            for (size_t i = 0; i < frames * channels; i++) {
+                out[i] = amplitude * NextNoise(source->noise);
+            }
+            break;
+
+        default:
+            std::fill(out, out + frames * channels, 0.0f);
+            break;
+    }
+    source->frames.fetch_add(frames, std::memory_order_relaxed);
+}
+
+static void RunSource(VirtualSource* source) {
+    const VirtualSourceConfig& config = source->config;
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t startNs = capture_stats_now_ns();
+    uint64_t sent = 0;
+
+    while (source->running.load(std::memory_order_relaxed)) {
+        uint64_t count = config.framesPerPacket;
+        if (config.totalFrames != 0) {
+            if (sent >= config.totalFrames) break;
+            count = std::min<uint64_t>(count, config.totalFrames - sent);
+        }
+
+        uint64_t hostTimeNs = startNs + static_cast<uint64_t>(static_cast<double>(sent) * 1e9 / config.sampleRate);
+        virtual_source_generate(source, source->packet.data(), static_cast<size_t>(count));
+        sent += count;
+
+        // A device hands a packet over once its last frame has been captured
+        if (config.realtime) {
+            auto due = start + std::chrono::nanoseconds(
+                static_cast<int64_t>(static_cast<double>(sent) * 1e9 / config.sampleRate));
+            std::this_thread::sleep_until(due);
+        }
+        source->callback(source->packet.data(), static_cast<size_t>(count), hostTimeNs, 0, source->context);
+    }
+}
+
+int32_t virtual_source_start(VirtualSource* source, VirtualPacketCallback callback, void* context) {
+    if (!source || !callback) return -2;
+    if (source->thread.joinable()) return -1;
+
+    source->callback = callback;
+    source->context = context;
+    source->running = true;
+    try {
+        source->thread = std::thread(RunSource, source);
+    } catch (const std::system_error&) {
+        source->running = false;
+        return -2;
+    }
+    return 0;
+}
+
+void virtual_source_stop(VirtualSource* source) {
+    if (!source) return;
+    source->running = false;
+    if (source->thread.joinable()) {
+        source->thread.join();
+    }
+}
+
+uint64_t virtual_source_frames(const VirtualSource* source) {
+    return source ? source->frames.load(std::memory_order_relaxed) : 0;
+}
@@ -0,0 +1,59 @@
+#ifndef ACTIVITY_GATE_H
+#define ACTIVITY_GATE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Activity Gate
+// Decides per chunk whether audio is worth delivering, so silence never
+// leaves native code. A detector classifies each block as active or not; the
+// gate opens on the first active block and stays open for a hangover period
+// after the last one, so pauses between words don't chop the stream.
+// Shared by the Windows pipeline and the macOS recorders (like dsp_kernels.h).
+// ============================================================================
+
+// Detector hook: return true if the interleaved block contains activity.
+// The built-in detector (used while none is set) compares the block's RMS
+// level against the gate threshold; a VAD can be plugged in instead.
+typedef bool (*ActivityDetector)(const float* samples, size_t frames, uint32_t channels, void* context);
+
+// Bits returned by activity_gate_process
+#define ACTIVITY_GATE_PASS   0x1  // Deliver this block
+#define ACTIVITY_GATE_OPENED 0x2  // Activity starts with this block
+#define ACTIVITY_GATE_CLOSED 0x4  // Activity ended before this block (hangover elapsed)
+
+typedef struct {
+    ActivityDetector detector;  // NULL = RMS threshold
+    void* detectorContext;
+    double threshold;           // Mean-square level of thresholdDb
+    uint64_t hangoverFrames;
+    uint64_t quietFrames;       // Inactive frames since the last active block
+    bool open;
+} ActivityGateState;
+
+// thresholdDb is an RMS level in dBFS (e.g. -50); hangoverMs keeps the gate
+// open after activity stops. Starts closed.
+void activity_gate_init(ActivityGateState* gate, double sampleRate, double thresholdDb, double hangoverMs);
+
+// Replace the RMS detector; NULL restores it
+void activity_gate_set_detector(ActivityGateState* gate, ActivityDetector detector, void* context);
+
+// Close the gate without changing its settings
+void activity_gate_reset(ActivityGateState* gate);
+
+// Classify one block of interleaved frames and return ACTIVITY_GATE_* bits.
+// samples may be NULL for generated silence, which counts as inactive
+// without consulting the detector.
+int32_t activity_gate_process(ActivityGateState* gate, const float* samples, size_t frames, uint32_t channels);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ACTIVITY_GATE_H
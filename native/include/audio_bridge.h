@@ -4,6 +4,10 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "audio_chunk.h"
+#include "capture_stats.h"
+#include "virtual_source.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -13,11 +17,40 @@ typedef void* AudioRecorderHandle;
 
 // Callback types
 typedef void (*AudioDataCallback)(const uint8_t* data, int32_t length, void* context);
+// eventType: 0 = start, 1 = stop, 2 = error (message set),
+// 3 = activity start, 4 = activity stop (silence gate, see "silenceGate")
 typedef void (*AudioEventCallback)(int32_t eventType, const char* message, void* context);
+// Data callback with timing; replaces AudioDataCallback once registered
+typedef void (*AudioChunkCallback)(const uint8_t* data, int32_t length,
+                                   const AudioChunkInfo* info, void* context);
+// Levels of every chunk, called before the chunk itself is delivered (see "levels")
+typedef void (*AudioLevelCallback)(const AudioLevels* levels, const AudioChunkInfo* info, void* context);
 typedef void (*AudioMetadataCallback)(double sampleRate, uint32_t channelsPerFrame,
                                        uint32_t bitsPerChannel, bool isFloat,
                                        const char* encoding, void* context);
 
+// Output formats for audio_start_* (a sample format, optionally | AUDIO_FORMAT_PLANAR).
+// AUDIO_FORMAT_DEFAULT keeps each platform's historical output: 32-bit float on
+// Windows; on macOS signed 16-bit when sampleRate is set, else the device format.
+#define AUDIO_FORMAT_DEFAULT 0
+#define AUDIO_FORMAT_F32     1
+#define AUDIO_FORMAT_S16     2
+#define AUDIO_FORMAT_S24     3     // Packed little-endian, 3 bytes per sample
+#define AUDIO_FORMAT_PLANAR  0x100 // One contiguous block per channel instead of interleaved frames
+#define AUDIO_FORMAT_SAMPLE_MASK 0xFF
+
+// Encodings, combined into outputFormat (see audio_encoder.h for the stream layouts).
+// Encoded output is always interleaved; the sample format picks the bit depth
+// of WAV and FLAC (16-bit when left at AUDIO_FORMAT_DEFAULT, FLAC has no float).
+// Starting fails if the encoding isn't available (Opus needs a libopus build),
+// or the format doesn't suit it (Opus: 8/12/16/24/48 kHz, at most two channels).
+#define AUDIO_ENCODING_PCM   0
+#define AUDIO_ENCODING_WAV   0x10000
+#define AUDIO_ENCODING_FLAC  0x20000
+#define AUDIO_ENCODING_OPUS  0x30000
+#define AUDIO_ENCODING_MASK  0xFF0000
+#define AUDIO_ENCODING_SHIFT 16
+
 // Create a new audio recorder session
 AudioRecorderHandle audio_create(
     AudioDataCallback dataCallback,
@@ -28,7 +61,8 @@ AudioRecorderHandle audio_create(
 
 // Start system audio capture
 // Note: mute parameter only works on macOS (silently ignored on Windows)
-// Note: Windows only supports single process filtering (first PID is used)
+// Note: Windows captures several include PIDs with one process-loopback client
+// each, mixed natively ("mixProcesses"); exclude mode uses only the first PID
 // Note: emitSilence generates silent buffers when no audio is playing (Windows only, macOS always emits)
 int32_t audio_start_system_audio(
     AudioRecorderHandle handle,
@@ -40,7 +74,8 @@ int32_t audio_start_system_audio(
     const int32_t* includeProcesses,
     int32_t includeProcessCount,
     const int32_t* excludeProcesses,
-    int32_t excludeProcessCount
+    int32_t excludeProcessCount,
+    int32_t outputFormat    // AUDIO_FORMAT_*
 );
 
 // Start microphone capture
@@ -52,7 +87,132 @@ int32_t audio_start_microphone(
     bool isMono,
     bool emitSilence,
     const char* deviceUID,  // NULL for default device
-    double gain             // 0.0 to any positive value (1.0 = unity gain)
+    double gain,            // 0.0 to any positive value (1.0 = unity gain)
+    int32_t outputFormat    // AUDIO_FORMAT_*
+);
+
+// Start system audio and microphone capture on one session and one clock.
+// Output has two channels: system audio (downmixed) on channel 0, the
+// microphone on channel 1, aligned by capture time with drift compensation.
+// Note: mute parameter only works on macOS (silently ignored on Windows)
+int32_t audio_start_combined(
+    AudioRecorderHandle handle,
+    double sampleRate,
+    double chunkDurationMs,
+    bool mute,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount,
+    const char* micDeviceUID,   // NULL for default device
+    double micGain,             // 0.0 to any positive value (1.0 = unity gain)
+    int32_t outputFormat        // AUDIO_FORMAT_*
+);
+
+// Start capture from a synthetic source (virtual_source.h) instead of a device:
+// its packets go through the same conversion, chunking, gating, encoding and
+// callbacks as device audio, for benchmarks and tests without hardware. Once
+// source->totalFrames have been generated the session goes quiet until stopped.
+// Returns 0, -1 invalid handle, -2 running, -3 invalid source, -4 unsupported
+// output encoding, -5 the source thread couldn't start.
+int32_t audio_start_virtual(
+    AudioRecorderHandle handle,
+    double sampleRate,          // 0 = the source rate
+    double chunkDurationMs,
+    bool isMono,
+    const VirtualSourceConfig* source,
+    int32_t outputFormat        // AUDIO_FORMAT_*
+);
+
+// Prepare a start ahead of time: device discovery, audio client activation
+// (Windows) or tap and aggregate device creation (macOS) happen now, and a
+// later start for the same source (same processes, mute and mono setting or
+// device) reuses them and only has to start streaming. Prepared objects also
+// survive stop(), so stop/start cycles stay fast, until audio_release_prepared()
+// or a start for a different source. Arguments mean the same as for the
+// matching start function.
+// Returns 0 on success, -1 for an invalid handle, -2 while running, and the
+// matching start function's error codes when preparation fails.
+int32_t audio_prepare_system_audio(
+    AudioRecorderHandle handle,
+    bool mute,
+    bool isMono,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount
+);
+
+int32_t audio_prepare_microphone(AudioRecorderHandle handle, const char* deviceUID);
+
+int32_t audio_prepare_combined(
+    AudioRecorderHandle handle,
+    bool mute,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount,
+    const char* micDeviceUID
+);
+
+// Drop prepared objects; while stopped they are freed now, while running on stop.
+// Returns 0 on success, -1 for an invalid handle.
+int32_t audio_release_prepared(AudioRecorderHandle handle);
+
+// Deliver chunks with timing (AudioChunkInfo) instead of through the session's
+// AudioDataCallback. Call before starting; NULL restores the data callback.
+// Returns 0 on success, -1 for an invalid handle, -2 while running.
+int32_t audio_set_chunk_callback(AudioRecorderHandle handle, AudioChunkCallback callback);
+
+// Receive per-chunk levels while the "levels" option is on. Chunks the silence
+// gate holds back are metered too; their info carries the next sequence number.
+// Call before starting. Returns 0 on success, -1 for an invalid handle, -2 while running.
+int32_t audio_set_level_callback(AudioRecorderHandle handle, AudioLevelCallback callback);
+
+// Set a capture tuning option, applied on the next start. Platform-specific
+// keys that a platform doesn't use are accepted and ignored.
+//   "bufferDurationMs" - WASAPI shared-mode buffer duration; below 10ms this
+//                        requests a low-latency IAudioClient3 period (Windows only)
+//   "eventDriven"      - 1 = event-driven WASAPI capture (default), 0 = timer polling (Windows only)
+//   "sharedCaptureThread" - 1 = service the stream from a shared pool of capture
+//                        threads (capture_scheduler.h), 0 = own thread (default, Windows only)
+//   "resampleQuality"  - 0 = low, 1 = medium (default), 2 = high; trades CPU and
+//                        latency for anti-aliasing when sampleRate is converted
+//   "silenceGate"      - 1 = hold back chunks without activity (activity_gate.h) and
+//                        report activity start/stop events instead; 0 = off (default)
+//   "gateThresholdDb"  - RMS level in dBFS that counts as activity (default -50, <= 0)
+//   "gateHangoverMs"   - how long chunks keep flowing after activity stops (default 500)
+//   "levels"           - 0 = off (default), 1 = meter every chunk, 2 = levels only:
+//                        chunks are metered but no PCM is encoded or delivered
+//   "bitrate"          - Opus target in bits per second (default 0 = 32000, >= 0)
+//   "mixProcesses"     - several include PIDs: 1 = mix into one stream (default),
+//                        0 = one mono channel per PID, in order (Windows only)
+//   "followDefaultDevice" - 1 = when the default device changes or goes away,
+//                        move the default microphone or system-wide capture onto
+//                        the new one without stopping; the next chunk is flagged
+//                        AUDIO_CHUNK_FLAG_DISCONTINUITY. 0 = off (default)
+//   "chunkDurationMs"  - the one key also accepted while running: chunks switch to
+//                        the new size at the next chunk boundary (> 0; while running
+//                        at most 5000ms on macOS, and on Windows 1000ms or the start size)
+// Returns 0 if applied, 1 if ignored on this platform, negative on error
+// (-1 invalid handle/key, -2 running, -3 invalid value)
+int32_t audio_set_option(AudioRecorderHandle handle, const char* key, double value);
+
+// Map the captured channels through a row-major outputs x inputs weight
+// matrix on the next start (dsp_channel_matrix_f32): out[o] = sum of
+// weights[o * inputs + i] * in[i]. Picking channels is a single 1 per row.
+// The inputs are the channels a start without downmix would deliver (device
+// channels; for combined capture system audio then microphone). Missing
+// columns count as 0; a start fails with an error event if a nonzero weight
+// addresses a channel the source doesn't have. Replaces the isMono downmix.
+// weights = NULL or outputs = 0 clears the matrix.
+// Returns 0, -1 invalid handle, -2 running, -3 invalid size.
+#define AUDIO_CHANNEL_MATRIX_MAX 64  // Largest outputs and inputs
+int32_t audio_set_channel_matrix(
+    AudioRecorderHandle handle,
+    const float* weights,
+    uint32_t outputs,
+    uint32_t inputs
 );
 
 // Stop audio capture
@@ -64,6 +224,10 @@ void audio_destroy(AudioRecorderHandle handle);
 // Check if session is running
 bool audio_is_running(AudioRecorderHandle handle);
 
+// Snapshot the capture counters and stage timings since the last start.
+// Safe to call from any thread while running. Returns 0, or -1 for a bad handle.
+int32_t audio_get_stats(AudioRecorderHandle handle, AudioCaptureStats* stats);
+
 // ============================================================================
 // Device Enumeration
 // ============================================================================
@@ -83,11 +247,23 @@ typedef struct {
 // List all audio devices
 // Returns 0 on success, populates devices array and count
 // Caller must free with audio_free_device_list
+// Note: the list is cached natively and only enumerated again after a device
+// notification, so calls after the first are cheap; safe to call from any thread
 int32_t audio_list_devices(AudioDeviceInfo** devices, int32_t* count);
 
 // Free device list allocated by audio_list_devices
 void audio_free_device_list(AudioDeviceInfo* devices, int32_t count);
 
+// Called on a system thread when a device is added or removed, changes state,
+// name or format, or becomes the default; audio_list_devices() then returns
+// the new list. Bursts of notifications may be delivered as several calls.
+typedef void (*AudioDeviceChangeCallback)(void* context);
+
+// Set the process-wide device change callback (NULL clears it). Returns 0 on
+// success, -1 if notifications are unavailable. Once it returns, the previous
+// callback is no longer running or called.
+int32_t audio_set_device_change_callback(AudioDeviceChangeCallback callback, void* context);
+
 // Get default input device UID (caller must free)
 char* audio_get_default_input_device(void);
 
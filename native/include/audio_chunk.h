@@ -0,0 +1,48 @@
+#ifndef AUDIO_CHUNK_H
+#define AUDIO_CHUNK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Chunk Timing
+// Per-chunk position and clock information passed to AudioChunkCallback,
+// and the per-chunk levels passed to AudioLevelCallback.
+// Kept apart from audio_bridge.h so the Swift side can import the struct.
+// ============================================================================
+
+// The chunk follows lost device data (e.g. AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY
+// or a gap in the device's sample clock)
+#define AUDIO_CHUNK_FLAG_DISCONTINUITY 0x1
+// The chunk is generated silence rather than device data (Windows emitSilence)
+#define AUDIO_CHUNK_FLAG_SILENT        0x2
+
+typedef struct {
+    uint64_t sequence;       // Chunk index since start, from 0
+    uint64_t framePosition;  // Frames emitted before this chunk, at the output rate
+    uint64_t hostTimeNs;     // Host-clock capture time of the first frame, 0 if unknown.
+                             // QueryPerformanceCounter on Windows, mach_absolute_time on
+                             // macOS, both in nanoseconds (the clock of uv_hrtime)
+    uint32_t frameCount;     // Frames in this chunk
+    uint32_t flags;          // AUDIO_CHUNK_FLAG_*
+} AudioChunkInfo;
+
+// Channels metered per chunk; further channels are not measured
+#define AUDIO_LEVELS_MAX_CHANNELS 8
+
+// Per-channel levels of one chunk, measured on the float samples before encoding
+typedef struct {
+    uint32_t channels;                           // Entries filled (<= AUDIO_LEVELS_MAX_CHANNELS)
+    float peak[AUDIO_LEVELS_MAX_CHANNELS];       // Largest |sample|, 1.0 = full scale
+    float rms[AUDIO_LEVELS_MAX_CHANNELS];        // Root mean square
+    uint32_t clipped[AUDIO_LEVELS_MAX_CHANNELS]; // Samples at or beyond full scale
+} AudioLevels;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_CHUNK_H
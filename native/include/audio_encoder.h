@@ -0,0 +1,97 @@
+#ifndef AUDIO_ENCODER_H
+#define AUDIO_ENCODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Audio Encoder
+// Streaming encoder stage run on each finished chunk, so compressed bytes are
+// all that cross into JavaScript. Every call returns a self-contained piece of
+// the stream; concatenating the outputs of one session gives a valid file.
+//   WAV:  the first output starts with an AUDIO_WAV_HEADER_BYTES RIFF header
+//         whose sizes are 0xFFFFFFFF (unknown length, as streaming readers
+//         expect); see audio_wav_set_length for fixing them up afterwards
+//   FLAC: the first output starts with "fLaC" + STREAMINFO; each call then
+//         emits whole variable-blocksize frames (16 to 4096 frames each); a
+//         call of fewer than 16 frames carries over to the next one
+//   Opus: 20 ms packets, each prefixed with its length as a little-endian
+//         uint16; frames that don't fill a packet carry over to the next call.
+//         Only available when built against libopus (NATIVE_AUDIO_HAS_OPUS).
+// Shared by the Windows pipeline and the macOS recorders (like dsp_kernels.h).
+// ============================================================================
+
+// Encodings (same values as AUDIO_ENCODING_* >> 16 in audio_bridge.h)
+#define AUDIO_ENCODER_PCM  0
+#define AUDIO_ENCODER_WAV  1
+#define AUDIO_ENCODER_FLAC 2
+#define AUDIO_ENCODER_OPUS 3
+
+typedef struct AudioEncoder AudioEncoder;
+
+typedef struct {
+    int32_t encoding;       // AUDIO_ENCODER_*
+    double sampleRate;
+    uint32_t channels;
+    int32_t sampleFormat;   // DSP_FORMAT_*: WAV sample format; FLAC is 24-bit for S24, else 16-bit
+    int32_t bitrate;        // Opus bits per second, 0 = 32000
+    size_t maxFrames;       // Largest block passed to audio_encoder_encode
+} AudioEncoderConfig;
+
+// Whether this build can create `encoding`
+bool audio_encoder_available(int32_t encoding);
+
+// NULL if the encoding isn't available or doesn't support the format
+// (Opus needs 8/12/16/24/48 kHz and one or two channels)
+AudioEncoder* audio_encoder_create(const AudioEncoderConfig* config);
+void audio_encoder_destroy(AudioEncoder* encoder);
+
+// Encode `frames` interleaved float frames. *out points into the encoder's own
+// buffer and stays valid until the next call. Returns the bytes written, which
+// is 0 while Opus is still short of a full packet. Never allocates.
+size_t audio_encoder_encode(AudioEncoder* encoder, const float* samples, size_t frames, const uint8_t** out);
+
+// Start a new stream: the next output repeats the header and carried-over frames are dropped
+void audio_encoder_reset(AudioEncoder* encoder);
+
+// Frames per packet ("opus" = 20 ms, "flac" = 16); chunks sized in multiples of it never carry over
+size_t audio_encoder_frame_granularity(const AudioEncoder* encoder);
+
+// Metadata encoding string: "wav", "flac" or "opus"
+const char* audio_encoder_name(const AudioEncoder* encoder);
+
+// Bits per sample of the decoded stream, and whether it is float (WAV f32 only)
+uint32_t audio_encoder_bits(const AudioEncoder* encoder);
+bool audio_encoder_is_float(const AudioEncoder* encoder);
+
+// ----------------------------------------------------------------------------
+// Container fix-ups, for writers that can seek back once the length is known
+// ----------------------------------------------------------------------------
+
+// RIFF header + fmt chunk, a 36-byte JUNK chunk reserving room for an RF64
+// ds64 chunk, and the data chunk header. Float samples get format tag 3.
+#define AUDIO_WAV_HEADER_BYTES 80
+
+// Write a header for a stream of unknown length (sizes 0xFFFFFFFF)
+void audio_wav_header(uint8_t* out, double sampleRate, uint32_t channels, uint32_t bitsPerSample, bool isFloat);
+
+// Set the sizes in a header from audio_wav_header for dataBytes of samples.
+// Beyond 4 GiB the header becomes RF64, with the JUNK chunk turned into ds64.
+void audio_wav_set_length(uint8_t* header, uint64_t dataBytes);
+
+// Bytes of "fLaC" + STREAMINFO at the start of every FLAC stream
+#define AUDIO_FLAC_HEADER_BYTES 42
+
+// Set STREAMINFO's total sample count (frames per channel)
+void audio_flac_set_total_samples(uint8_t* header, uint64_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_ENCODER_H
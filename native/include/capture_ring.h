@@ -0,0 +1,54 @@
+#ifndef CAPTURE_RING_H
+#define CAPTURE_RING_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Capture Ring
+// Bounded single-producer/single-consumer byte ring between a real-time
+// audio callback and the thread that processes its data. Each write is kept
+// as one record with its host time and AUDIO_CHUNK_FLAG_* bits, so the reader
+// sees the device buffers exactly as they arrived.
+//
+// Writing is a memcpy plus two atomic operations: no locks, no allocation,
+// nothing that could block the CoreAudio I/O thread. A write that doesn't fit
+// is dropped whole and the next record that does is marked
+// AUDIO_CHUNK_FLAG_DISCONTINUITY, since the reader can't otherwise tell
+// where the gap was.
+// ============================================================================
+
+typedef struct CaptureRing CaptureRing;
+
+// capacityBytes bounds the queued payload plus 16 bytes of header per record.
+// Returns NULL if the storage can't be allocated.
+CaptureRing* capture_ring_create(size_t capacityBytes);
+void capture_ring_destroy(CaptureRing* ring);
+
+// Producer only. Copies one record; returns false (and drops it) if the ring
+// is full. Empty writes are ignored.
+bool capture_ring_write(CaptureRing* ring, const void* data, size_t bytes, uint64_t hostTimeNs, uint32_t flags);
+
+// Consumer only. Returns the size of the oldest record and points *data at its
+// payload, which stays valid until capture_ring_consume(); 0 when empty.
+size_t capture_ring_peek(CaptureRing* ring, const void** data, uint64_t* hostTimeNs, uint32_t* flags);
+
+// Consumer only. Releases the record returned by the last peek.
+void capture_ring_consume(CaptureRing* ring);
+
+// Discard everything queued. Only while no write can be in progress.
+void capture_ring_reset(CaptureRing* ring);
+
+// Payload bytes dropped because the ring was full, since create/reset
+uint64_t capture_ring_dropped_bytes(const CaptureRing* ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_RING_H
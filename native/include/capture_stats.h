@@ -0,0 +1,82 @@
+#ifndef CAPTURE_STATS_H
+#define CAPTURE_STATS_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Capture Statistics
+// Counters and per-stage timing histograms updated on the capture path and
+// read at any time as an AudioCaptureStats snapshot. Every update is a few
+// relaxed atomic adds with no locks or allocation, so they stay on in
+// production, including on real-time threads.
+// Kept apart from audio_bridge.h so the Swift side can import the structs.
+// ============================================================================
+
+// Processing stages timed per call
+#define CAPTURE_STAGE_CONVERT  0  // Gain, downmix and sample format conversion
+#define CAPTURE_STAGE_RESAMPLE 1  // Sample rate conversion
+#define CAPTURE_STAGE_CHUNK    2  // Metering, gating, encoding and delivering a finished chunk
+#define CAPTURE_STAGE_DELIVERY 3  // From a chunk being queued to JS until its event is built
+#define CAPTURE_STAGE_COUNT    4
+
+// Histogram buckets: 4 per power of two of nanoseconds (at most 25% wide), up to ~8.6s;
+// longer times land in the last bucket
+#define CAPTURE_STATS_BUCKETS 128
+
+typedef struct {
+    uint64_t count;
+    uint64_t totalNs;
+    uint64_t maxNs;
+    uint32_t buckets[CAPTURE_STATS_BUCKETS];
+} CaptureStageStats;
+
+typedef struct {
+    uint64_t packets;          // Device buffers processed
+    uint64_t framesCaptured;   // Device frames in them
+    uint64_t chunksEmitted;    // Chunks handed to the chunk callback (gated ones excluded)
+    uint64_t framesEmitted;    // Output frames in those chunks
+    uint64_t discontinuities;  // Device buffers that followed lost data
+    uint64_t timestampErrors;  // Device buffers with an unreliable timestamp (WASAPI)
+    uint64_t droppedBytes;     // Device data lost before processing (capture ring overrun)
+    uint64_t bytesAllocated;   // Buffers the capture path holds while running
+    CaptureStageStats stages[CAPTURE_STAGE_COUNT];
+} AudioCaptureStats;
+
+typedef struct CaptureStats CaptureStats;
+
+// Returns NULL if the counters can't be allocated
+CaptureStats* capture_stats_create(void);
+void capture_stats_destroy(CaptureStats* stats);
+
+// Zero everything, e.g. at the start of a session. Not atomic as a whole:
+// updates racing with it may survive.
+void capture_stats_reset(CaptureStats* stats);
+
+// One device buffer; flags are AUDIO_CHUNK_FLAG_* (discontinuities are counted)
+void capture_stats_add_packet(CaptureStats* stats, uint64_t frames, uint32_t flags);
+void capture_stats_add_timestamp_error(CaptureStats* stats);
+void capture_stats_add_chunk(CaptureStats* stats, uint64_t frames);
+void capture_stats_add_dropped_bytes(CaptureStats* stats, uint64_t bytes);
+void capture_stats_set_allocated(CaptureStats* stats, uint64_t bytes);
+
+// Record one timed call of a CAPTURE_STAGE_*
+void capture_stats_add_time(CaptureStats* stats, int32_t stage, uint64_t ns);
+
+// Monotonic clock for stage timing, in nanoseconds
+uint64_t capture_stats_now_ns(void);
+
+void capture_stats_snapshot(const CaptureStats* stats, AudioCaptureStats* out);
+
+// Upper bound of the bucket holding the given fraction (0..1) of a stage's
+// calls, clamped to maxNs; 0 when the stage has no calls
+uint64_t capture_stats_percentile_ns(const CaptureStageStats* stage, double fraction);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CAPTURE_STATS_H
@@ -0,0 +1,89 @@
+#ifndef DSP_KERNELS_H
+#define DSP_KERNELS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// DSP Kernels
+// Runtime-dispatched sample processing shared by the Windows pipeline and the
+// macOS Swift code (imported via -import-objc-header). x64 picks AVX2 when the
+// CPU and OS support it and SSE2 otherwise; arm64 always uses NEON.
+// All buffers are interleaved; input and output must not overlap unless noted.
+// ============================================================================
+
+// out[i] = in[i] * gain. In-place (out == in) is allowed.
+void dsp_gain_f32(const float* in, float* out, size_t count, float gain);
+
+// In-place gain followed by a clamp to [-1, 1]
+void dsp_gain_clamp_f32(float* samples, size_t count, float gain);
+
+// Fused gain + downmix: out[frame] = gain * mean(in[frame][0..channels-1])
+void dsp_gain_downmix_f32(const float* in, float* out, size_t frames, uint32_t channels, float gain);
+
+// Accumulate: out[i] += in[i] * gain (mixing several streams into one)
+void dsp_mix_f32(const float* in, float* out, size_t count, float gain);
+
+// Channel matrix: out[frame][o] = sum over i of matrix[o * inChannels + i] * in[frame][i],
+// with outChannels output channels. Zero weights are skipped, so picking
+// channels (a single 1 per row) costs one multiply per output sample.
+void dsp_channel_matrix_f32(const float* in, float* out, size_t frames,
+                            uint32_t inChannels, uint32_t outChannels, const float* matrix);
+
+// Fit a row-major outputs x inputs matrix to a stream of `channels` channels:
+// columns past `inputs` are zero and columns past `channels` are dropped.
+// out holds outputs * channels floats. Returns false (out untouched) if a
+// nonzero weight addresses a channel the stream doesn't have.
+bool dsp_channel_matrix_fit(const float* matrix, uint32_t outputs, uint32_t inputs,
+                            uint32_t channels, float* out);
+
+// TPDF dither generator state (one xorshift32 stream per SIMD lane)
+typedef struct {
+    uint32_t lanes[8];
+} DspDitherState;
+
+void dsp_dither_init(DspDitherState* state, uint32_t seed);
+
+// Float to 16-bit PCM: clamp to [-1, 1], scale, round to nearest.
+// With a dither state, adds +/-1 LSB triangular dither before rounding.
+void dsp_f32_to_s16(const float* in, int16_t* out, size_t count, DspDitherState* dither);
+
+// 16-bit PCM to float in [-1, 1)
+void dsp_s16_to_f32(const int16_t* in, float* out, size_t count);
+
+// Float to packed little-endian signed 24-bit (3 bytes per sample), rounded
+void dsp_f32_to_s24(const float* in, uint8_t* out, size_t count);
+
+// Sample formats for dsp_encode_f32 (same values as AUDIO_FORMAT_* in audio_bridge.h)
+#define DSP_FORMAT_F32 1
+#define DSP_FORMAT_S16 2
+#define DSP_FORMAT_S24 3
+
+// Bytes per sample of a DSP_FORMAT_* value, 0 if unknown
+size_t dsp_format_bytes(int32_t format);
+
+// Encode interleaved float frames as `format`. Planar output stores each
+// channel's frames contiguously, channel 0 first. `out` must hold
+// frames * channels * dsp_format_bytes(format) bytes; returns the bytes written.
+size_t dsp_encode_f32(const float* in, size_t frames, uint32_t channels,
+                      int32_t format, bool planar, DspDitherState* dither, void* out);
+
+// Per-channel meter over interleaved frames: peak |sample|, RMS, and the number
+// of samples at or beyond full scale (|sample| >= 1). Only the first `metered`
+// channels are measured; each output array holds that many entries.
+void dsp_levels_f32(const float* in, size_t frames, uint32_t channels, uint32_t metered,
+                    float* peak, float* rms, uint32_t* clipped);
+
+// Name of the selected instruction set: "avx2", "sse2", "neon" or "scalar"
+const char* dsp_active_isa(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DSP_KERNELS_H
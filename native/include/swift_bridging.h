@@ -0,0 +1,13 @@
+#ifndef SWIFT_BRIDGING_H
+#define SWIFT_BRIDGING_H
+
+// C declarations imported by the Swift sources (-import-objc-header)
+#include "activity_gate.h"
+#include "audio_chunk.h"
+#include "audio_encoder.h"
+#include "capture_ring.h"
+#include "capture_stats.h"
+#include "dsp_kernels.h"
+#include "virtual_source.h"
+
+#endif // SWIFT_BRIDGING_H
@@ -0,0 +1,70 @@
+#ifndef VIRTUAL_SOURCE_H
+#define VIRTUAL_SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ============================================================================
+// Virtual Source
+// A synthetic capture device: deterministic interleaved 32-bit float packets
+// at a chosen rate, channel count and packet size, delivered from a thread of
+// its own like a device callback. Lets the capture pipeline, the recorders
+// (audio_start_virtual) and the JS delivery path be benchmarked and tested
+// without audio hardware. The same config and seed always produce the same
+// samples.
+// ============================================================================
+
+#define VIRTUAL_SIGNAL_SILENCE 0
+#define VIRTUAL_SIGNAL_SINE    1  // Same tone on every channel
+#define VIRTUAL_SIGNAL_NOISE   2  // Uniform white noise, independent per channel
+
+typedef struct {
+    double sampleRate;         // Source rate in Hz (> 0)
+    uint32_t channels;         // Interleaved channels (1..64)
+    uint32_t framesPerPacket;  // Frames per delivered packet (> 0)
+    int32_t signal;            // VIRTUAL_SIGNAL_*
+    double frequency;          // Sine frequency in Hz
+    double amplitude;          // Peak level, 0..1
+    uint32_t seed;             // Noise seed (0 picks a fixed default)
+    bool realtime;             // Pace packets at the source rate; false = back to back
+    uint64_t totalFrames;      // Stop generating after this many frames, 0 = until stopped
+} VirtualSourceConfig;
+
+// Receives one packet; the samples are only valid during the call. hostTimeNs
+// is the first frame's time on the monotonic clock, as if it had been captured
+// one packet before delivery.
+typedef void (*VirtualPacketCallback)(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                                      uint32_t flags, void* context);
+
+typedef struct VirtualSource VirtualSource;
+
+// Returns NULL if the config is out of range or the packet buffer can't be allocated
+VirtualSource* virtual_source_create(const VirtualSourceConfig* config);
+
+// Stops the thread first if it is running
+void virtual_source_destroy(VirtualSource* source);
+
+// Fill `frames` frames of the signal into out (frames * channels floats) and
+// advance it, without the thread. Not while the thread is running.
+void virtual_source_generate(VirtualSource* source, float* out, size_t frames);
+
+// Deliver packets to callback from a new thread until stopped or totalFrames
+// have gone out. Returns 0, -1 if already running, -2 if the thread can't start.
+int32_t virtual_source_start(VirtualSource* source, VirtualPacketCallback callback, void* context);
+
+// Stop and join the thread; no callback runs once this returns
+void virtual_source_stop(VirtualSource* source);
+
+// Frames generated since create
+uint64_t virtual_source_frames(const VirtualSource* source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIRTUAL_SOURCE_H
@@ -0,0 +1,40 @@
+import CoreAudio
+import Foundation
+
+/// Gate settings from audio_set_option ("silenceGate", "gateThresholdDb", "gateHangoverMs")
+public struct ActivityGateOptions {
+    public var enabled = false
+    public var thresholdDb: Double = -50
+    public var hangoverMs: Double = 500
+}
+
+/// Holds back chunks without activity using the shared C gate (activity_gate.h),
+/// so both platforms open and close on the same levels.
+/// Runs on the recorder's source packets, before conversion: the device delivers
+/// Float32 on both capture paths, and the mean-square level doesn't depend on layout.
+final class ActivityGate {
+    private var state = ActivityGateState()
+    private let channels: UInt32
+
+    /// nil when the gate is disabled or the source isn't Float32
+    init?(options: ActivityGateOptions, sourceFormat: AudioStreamBasicDescription) {
+        let isFloat32 = sourceFormat.mFormatFlags & kAudioFormatFlagIsFloat != 0 && sourceFormat.mBitsPerChannel == 32
+        guard options.enabled && isFloat32 else { return nil }
+
+        // Non-interleaved buffers are classified as one long mono block
+        let isInterleaved = sourceFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved == 0
+        self.channels = isInterleaved ? max(sourceFormat.mChannelsPerFrame, 1) : 1
+        activity_gate_init(&state, sourceFormat.mSampleRate, options.thresholdDb, options.hangoverMs)
+    }
+
+    /// ACTIVITY_GATE_* bits for one source packet
+    func evaluate(_ packet: AudioPacket) -> Int32 {
+        let frames = packet.data.count / MemoryLayout<Float32>.size / Int(channels)
+        return packet.data.withUnsafeBytes { raw in
+            guard let samples = raw.baseAddress?.assumingMemoryBound(to: Float.self) else {
+                return activity_gate_process(&state, nil, frames, channels)
+            }
+            return activity_gate_process(&state, samples, frames, channels)
+        }
+    }
+}
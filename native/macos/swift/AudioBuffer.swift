@@ -8,12 +8,23 @@ public class AudioBuffer {
     private var availableBytes: Int = 0
     private let maxBufferSize: Int
 
-    private let bytesPerChunk: Int
-    private let chunkDuration: Double
+    private var bytesPerChunk: Int
+    private var chunkDuration: Double
+    private let bytesPerFrame: Int
+    private let sampleRate: Double
+
+    // Timing: absolute byte counters and the host time of the latest timed append
+    private var totalWritten: UInt64 = 0
+    private var totalRead: UInt64 = 0
+    private var anchorHostTime: UInt64 = 0
+    private var anchorByte: UInt64 = 0
+    private var pendingFlags: UInt32 = 0
 
     public init(format: AudioStreamBasicDescription, chunkDuration: Double = 0.2) {
         // Pre-calculate chunk parameters
         let bytesPerFrame = Int(format.mBytesPerFrame)
+        self.bytesPerFrame = max(bytesPerFrame, 1)
+        self.sampleRate = format.mSampleRate
         let samplesPerChunk = Int(format.mSampleRate * chunkDuration)
         self.bytesPerChunk = samplesPerChunk * bytesPerFrame
         self.chunkDuration = Double(samplesPerChunk) / format.mSampleRate
@@ -26,30 +37,57 @@ public class AudioBuffer {
         self.buffer = Array(repeating: 0, count: maxBufferSize)
     }
 
+    /// Change the chunk size; the next `nextChunk()` call uses it. Capped at half the
+    /// ring so a chunk can always fill. Call from the thread that reads chunks.
+    public func setChunkDuration(_ seconds: Double) {
+        let samplesPerChunk = max(Int(sampleRate * seconds), 1)
+        let frames = min(samplesPerChunk, maxBufferSize / 2 / bytesPerFrame)
+        bytesPerChunk = frames * bytesPerFrame
+        chunkDuration = Double(frames) / sampleRate
+    }
+
     public func append(_ data: Data) {
-        guard availableBytes + data.count <= maxBufferSize else {
+        data.withUnsafeBytes { bytes in
+            if let baseAddress = bytes.baseAddress {
+                append(baseAddress, count: bytes.count)
+            }
+        }
+    }
+
+    /// Append raw bytes straight from a Core Audio buffer without wrapping them in `Data` first.
+    /// `hostTime` (ns, 0 if unknown) is the capture time of the first frame; `flags`
+    /// (AUDIO_CHUNK_FLAG_*) are attached to the chunk these bytes land in.
+    public func append(_ bytes: UnsafeRawPointer, count dataSize: Int, hostTime: UInt64 = 0, flags: UInt32 = 0) {
+        guard dataSize > 0 else { return }
+        guard availableBytes + dataSize <= maxBufferSize else {
+            // Overrun: the bytes are lost, so the next chunk starts after a gap
+            pendingFlags |= UInt32(AUDIO_CHUNK_FLAG_DISCONTINUITY)
             return
         }
 
-        data.withUnsafeBytes { bytes in
-            let sourceBytes = bytes.bindMemory(to: UInt8.self)
-            let dataSize = sourceBytes.count
+        pendingFlags |= flags
+        if hostTime != 0 {
+            anchorHostTime = hostTime
+            anchorByte = totalWritten
+        }
+        totalWritten += UInt64(dataSize)
 
+        buffer.withUnsafeMutableBytes { destination in
             if writeIndex + dataSize <= maxBufferSize {
-                buffer.replaceSubrange(writeIndex..<writeIndex + dataSize, with: sourceBytes)
+                destination.baseAddress!.advanced(by: writeIndex).copyMemory(from: bytes, byteCount: dataSize)
                 writeIndex = (writeIndex + dataSize) % maxBufferSize
             } else {
                 let firstChunkSize = maxBufferSize - writeIndex
                 let secondChunkSize = dataSize - firstChunkSize
 
-                buffer.replaceSubrange(writeIndex..<maxBufferSize, with: sourceBytes.prefix(firstChunkSize))
-                buffer.replaceSubrange(0..<secondChunkSize, with: sourceBytes.suffix(secondChunkSize))
+                destination.baseAddress!.advanced(by: writeIndex).copyMemory(from: bytes, byteCount: firstChunkSize)
+                destination.baseAddress!.copyMemory(from: bytes.advanced(by: firstChunkSize), byteCount: secondChunkSize)
 
                 writeIndex = secondChunkSize
             }
         }
 
-        availableBytes += data.count
+        availableBytes += dataSize
     }
 
     public func processChunks() -> [AudioPacket] {
@@ -65,27 +103,42 @@ public class AudioBuffer {
     private func nextChunk() -> AudioPacket? {
         guard availableBytes >= bytesPerChunk else { return nil }
 
-        var chunkData = Data(capacity: bytesPerChunk)
-
-        if readIndex + bytesPerChunk <= maxBufferSize {
-            chunkData.append(contentsOf: buffer[readIndex..<readIndex + bytesPerChunk])
-            readIndex = (readIndex + bytesPerChunk) % maxBufferSize
-        } else {
-            let firstChunkSize = maxBufferSize - readIndex
-            let secondChunkSize = bytesPerChunk - firstChunkSize
+        // One allocation per chunk, filled with at most two memcpys out of the ring
+        var chunkData = Data(count: bytesPerChunk)
+        chunkData.withUnsafeMutableBytes { destination in
+            buffer.withUnsafeBytes { source in
+                let firstChunkSize = min(bytesPerChunk, maxBufferSize - readIndex)
+                destination.baseAddress!.copyMemory(
+                    from: source.baseAddress!.advanced(by: readIndex), byteCount: firstChunkSize
+                )
+                if firstChunkSize < bytesPerChunk {
+                    destination.baseAddress!.advanced(by: firstChunkSize).copyMemory(
+                        from: source.baseAddress!, byteCount: bytesPerChunk - firstChunkSize
+                    )
+                }
+            }
+        }
+        readIndex = (readIndex + bytesPerChunk) % maxBufferSize
 
-            chunkData.append(contentsOf: buffer[readIndex..<maxBufferSize])
-            chunkData.append(contentsOf: buffer[0..<secondChunkSize])
+        availableBytes -= bytesPerChunk
 
-            readIndex = secondChunkSize
+        // Extrapolate the first frame's time from the latest timed append
+        var hostTime: UInt64 = 0
+        if anchorHostTime != 0 {
+            let frameOffset = (Double(totalRead) - Double(anchorByte)) / Double(bytesPerFrame)
+            let time = Double(anchorHostTime) + frameOffset / sampleRate * 1_000_000_000
+            hostTime = time > 0 ? UInt64(time) : 0
         }
+        totalRead += UInt64(bytesPerChunk)
 
-        availableBytes -= bytesPerChunk
+        let flags = pendingFlags
+        pendingFlags = 0
 
         return AudioPacket(
-            timestamp: Date(),
             duration: chunkDuration,
-            data: chunkData
+            data: chunkData,
+            hostTime: hostTime,
+            flags: flags
         )
     }
 }
@@ -76,39 +76,7 @@ class AudioDeviceManager {
 
     /// List output devices using Core Audio (AVCaptureDevice doesn't expose outputs)
     private static func listOutputDevicesUsingCoreAudio() -> [DeviceInfo] {
-        var propertyAddress = AudioObjectPropertyAddress(
-            mSelector: kAudioHardwarePropertyDevices,
-            mScope: kAudioObjectPropertyScopeGlobal,
-            mElement: kAudioObjectPropertyElementMain
-        )
-
-        var dataSize: UInt32 = 0
-        var status = AudioObjectGetPropertyDataSize(
-            AudioObjectID(kAudioObjectSystemObject),
-            &propertyAddress,
-            0, nil,
-            &dataSize
-        )
-
-        guard status == noErr else {
-            return []
-        }
-
-        let deviceCount = Int(dataSize) / MemoryLayout<AudioDeviceID>.size
-        var deviceIDs = [AudioDeviceID](repeating: 0, count: deviceCount)
-
-        status = AudioObjectGetPropertyData(
-            AudioObjectID(kAudioObjectSystemObject),
-            &propertyAddress,
-            0, nil,
-            &dataSize,
-            &deviceIDs
-        )
-
-        guard status == noErr else {
-            return []
-        }
-
+        let deviceIDs = getAllDeviceIDs()
         let defaultOutputID = getDefaultOutputDeviceID()
 
         return deviceIDs.compactMap { deviceID -> DeviceInfo? in
@@ -179,7 +147,8 @@ class AudioDeviceManager {
         return status == noErr ? deviceID : nil
     }
 
-    private static func getDeviceIDFromUID(_ uid: String) -> AudioDeviceID? {
+    /// IDs of every Core Audio device object, inputs and outputs
+    static func getAllDeviceIDs() -> [AudioDeviceID] {
         var propertyAddress = AudioObjectPropertyAddress(
             mSelector: kAudioHardwarePropertyDevices,
             mScope: kAudioObjectPropertyScopeGlobal,
@@ -194,7 +163,7 @@ class AudioDeviceManager {
             &dataSize
         )
 
-        guard status == noErr else { return nil }
+        guard status == noErr else { return [] }
 
         let deviceCount = Int(dataSize) / MemoryLayout<AudioDeviceID>.size
         var deviceIDs = [AudioDeviceID](repeating: 0, count: deviceCount)
@@ -207,9 +176,12 @@ class AudioDeviceManager {
             &deviceIDs
         )
 
-        guard status == noErr else { return nil }
+        guard status == noErr else { return [] }
+        return deviceIDs
+    }
 
-        for deviceID in deviceIDs {
+    private static func getDeviceIDFromUID(_ uid: String) -> AudioDeviceID? {
+        for deviceID in getAllDeviceIDs() {
             if let deviceUID = getDeviceUID(deviceID: deviceID), deviceUID == uid {
                 return deviceID
             }
@@ -370,6 +342,157 @@ class AudioDeviceManager {
     }
 }
 
+// MARK: - Device Cache
+
+public typealias AudioDeviceChangeCallback = @convention(c) (UnsafeMutableRawPointer?) -> Void
+
+/// Process-wide device list, enumerated again only after Core Audio reports a change.
+///
+/// Listing walks every device with several property reads each, plus an
+/// AVCaptureDevice discovery session. The cache registers property listeners
+/// on first use (the device list and both defaults on the system object, the
+/// nominal sample rate and stream layout on each device) and every callback
+/// bumps a generation counter; a snapshot only enumerates when that counter
+/// moved since the last one.
+final class AudioDeviceCache {
+    static let shared = AudioDeviceCache()
+
+    private let queue = DispatchQueue(label: "com.native-audio-node.device-cache", qos: .utility)
+
+    private let listLock = NSLock()           // Guards devices, cachedGeneration and listeners
+    private var devices: [DeviceInfo] = []
+    private var cachedGeneration: UInt64 = 0
+    private var listening = false
+    private var deviceListeners: [AudioDeviceID: AudioObjectPropertyListenerBlock] = [:]
+
+    private let generationLock = NSLock()
+    private var generation: UInt64 = 1
+
+    private let callbackLock = NSLock()       // Held while the callback runs
+    private var callback: AudioDeviceChangeCallback?
+    private var callbackContext: UnsafeMutableRawPointer?
+
+    private static let systemSelectors: [AudioObjectPropertySelector] = [
+        kAudioHardwarePropertyDevices,
+        kAudioHardwarePropertyDefaultInputDevice,
+        kAudioHardwarePropertyDefaultOutputDevice,
+    ]
+
+    private static let deviceSelectors: [AudioObjectPropertySelector] = [
+        kAudioDevicePropertyNominalSampleRate,
+        kAudioDevicePropertyStreamConfiguration,
+    ]
+
+    func snapshot() -> [DeviceInfo] {
+        listLock.lock()
+        defer { listLock.unlock() }
+
+        startListening()
+        let current = currentGeneration()
+        if current != cachedGeneration {
+            // A change during enumeration bumps the generation again, so the
+            // next snapshot enumerates once more
+            devices = AudioDeviceManager.listAllDevices()
+            cachedGeneration = current
+            watchDevices(AudioDeviceManager.getAllDeviceIDs())
+        }
+        return devices
+    }
+
+    /// Replace the change callback; returns once the previous one is no longer running
+    func setChangeCallback(_ newCallback: AudioDeviceChangeCallback?, context: UnsafeMutableRawPointer?) {
+        listLock.lock()
+        startListening()
+        listLock.unlock()
+
+        callbackLock.lock()
+        callback = newCallback
+        callbackContext = context
+        callbackLock.unlock()
+    }
+
+    private func currentGeneration() -> UInt64 {
+        generationLock.lock()
+        defer { generationLock.unlock() }
+        return generation
+    }
+
+    private func invalidate() {
+        generationLock.lock()
+        generation &+= 1
+        generationLock.unlock()
+
+        callbackLock.lock()
+        callback?(callbackContext)
+        callbackLock.unlock()
+    }
+
+    private func startListening() {
+        guard !listening else { return }
+        listening = true
+
+        let block: AudioObjectPropertyListenerBlock = { [weak self] _, _ in
+            self?.invalidate()
+        }
+        for selector in Self.systemSelectors {
+            var address = AudioObjectPropertyAddress(
+                mSelector: selector,
+                mScope: kAudioObjectPropertyScopeGlobal,
+                mElement: kAudioObjectPropertyElementMain
+            )
+            AudioObjectAddPropertyListenerBlock(AudioObjectID(kAudioObjectSystemObject), &address, queue, block)
+        }
+    }
+
+    /// Listen on devices that appeared since the last enumeration. Listeners of
+    /// removed devices go away with the device object, only the block is dropped.
+    private func watchDevices(_ deviceIDs: [AudioDeviceID]) {
+        let present = Set(deviceIDs)
+        deviceListeners = deviceListeners.filter { present.contains($0.key) }
+
+        for deviceID in deviceIDs where deviceListeners[deviceID] == nil {
+            let block: AudioObjectPropertyListenerBlock = { [weak self] _, _ in
+                self?.invalidate()
+            }
+            for selector in Self.deviceSelectors {
+                var address = AudioObjectPropertyAddress(
+                    mSelector: selector,
+                    mScope: kAudioObjectPropertyScopeWildcard,
+                    mElement: kAudioObjectPropertyElementWildcard
+                )
+                AudioObjectAddPropertyListenerBlock(deviceID, &address, queue, block)
+            }
+            deviceListeners[deviceID] = block
+        }
+    }
+}
+
+// MARK: - Default Device Listener
+
+/// Calls onChange on queue whenever the system default input device changes,
+/// for sessions following the default device ("followDefaultDevice"). The
+/// listener is removed when this is released; a change already dispatched to
+/// queue may still run after that.
+final class DefaultDeviceListener {
+    private let queue: DispatchQueue
+    private let block: AudioObjectPropertyListenerBlock
+    private var address = AudioObjectPropertyAddress(
+        mSelector: kAudioHardwarePropertyDefaultInputDevice,
+        mScope: kAudioObjectPropertyScopeGlobal,
+        mElement: kAudioObjectPropertyElementMain
+    )
+
+    init(queue: DispatchQueue, onChange: @escaping () -> Void) {
+        self.queue = queue
+        self.block = { _, _ in onChange() }
+        AudioObjectAddPropertyListenerBlock(AudioObjectID(kAudioObjectSystemObject), &address, queue, block)
+    }
+
+    deinit {
+        AudioObjectRemovePropertyListenerBlock(AudioObjectID(kAudioObjectSystemObject), &address, queue, block)
+    }
+}
+
 // MARK: - C-Compatible API
 
 // C struct layout matching audio_bridge.h AudioDeviceInfo
@@ -386,7 +509,7 @@ public func audio_list_devices(
     devices: UnsafeMutableRawPointer,  // AudioDeviceInfo** 
     count: UnsafeMutablePointer<Int32>
 ) -> Int32 {
-    let deviceList = AudioDeviceManager.listAllDevices()
+    let deviceList = AudioDeviceCache.shared.snapshot()
     
     // Cast to the correct pointer type for the out parameter
     let devicesOut = devices.assumingMemoryBound(to: UnsafeMutableRawPointer?.self)
@@ -475,3 +598,12 @@ public func audio_get_default_output_device() -> UnsafeMutablePointer<CChar>? {
     }
     return strdup(uid)
 }
+
+@_cdecl("audio_set_device_change_callback")
+public func audio_set_device_change_callback(
+    callback: AudioDeviceChangeCallback?,
+    context: UnsafeMutableRawPointer?
+) -> Int32 {
+    AudioDeviceCache.shared.setChangeCallback(callback, context: context)
+    return 0
+}
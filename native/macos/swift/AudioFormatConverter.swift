@@ -7,7 +7,21 @@ public class AudioFormatConverter {
     private let sourceFormat: AVAudioFormat
     private let targetFormat: AVAudioFormat
 
-    public init(sourceFormat: AudioStreamBasicDescription, targetFormat: AudioStreamBasicDescription) throws {
+    private let sourceBytesPerFrame: Int
+    private let targetBytesPerFrame: Int
+
+    // AVAudioConverter pulls input in blocks of about 10 ms and fills output
+    // blocks of the same duration, so its delay line, not the chunk size,
+    // bounds how far output trails input. Both buffers are allocated once.
+    private static let blockDuration = 0.01
+    private let inputBuffer: AVAudioPCMBuffer
+    private let outputBuffer: AVAudioPCMBuffer
+
+    public init(
+        sourceFormat: AudioStreamBasicDescription,
+        targetFormat: AudioStreamBasicDescription,
+        quality: AVAudioQuality = .high
+    ) throws {
         var mutableSourceFormat = sourceFormat
         var mutableTargetFormat = targetFormat
 
@@ -20,65 +34,107 @@ public class AudioFormatConverter {
         guard let converter = AVAudioConverter(from: sourceAVFormat, to: targetAVFormat) else {
             throw AudioConverterError.creationFailed
         }
+        converter.sampleRateConverterQuality = quality.rawValue
+        // Another channel count (a followed device) is mixed, not truncated
+        converter.downmix = sourceFormat.mChannelsPerFrame != targetFormat.mChannelsPerFrame
+        if quality == .max {
+            converter.sampleRateConverterAlgorithm = AVSampleRateConverterAlgorithm_Mastering
+        }
+
+        let inputFrames = AVAudioFrameCount(max(sourceFormat.mSampleRate * AudioFormatConverter.blockDuration, 1))
+        let outputFrames = AVAudioFrameCount(max(targetFormat.mSampleRate * AudioFormatConverter.blockDuration, 1))
+        guard let inputBuffer = AVAudioPCMBuffer(pcmFormat: sourceAVFormat, frameCapacity: inputFrames),
+              let outputBuffer = AVAudioPCMBuffer(pcmFormat: targetAVFormat, frameCapacity: outputFrames)
+        else {
+            throw AudioConverterError.creationFailed
+        }
 
         self.sourceFormat = sourceAVFormat
         self.targetFormat = targetAVFormat
         self.avConverter = converter
+        self.sourceBytesPerFrame = max(Int(sourceFormat.mBytesPerFrame), 1)
+        self.targetBytesPerFrame = max(Int(targetFormat.mBytesPerFrame), 1)
+        self.inputBuffer = inputBuffer
+        self.outputBuffer = outputBuffer
     }
 
     public var targetFormatDescription: AudioStreamBasicDescription {
         return targetFormat.streamDescription.pointee
     }
 
+    /// Convert the next packet of one continuous stream. The converter keeps
+    /// its filter state and any frames it hasn't emitted yet between calls, so
+    /// a packet's output is whatever the converter produced while consuming
+    /// it: close to, but not exactly, its frames times the rate ratio. The
+    /// frames still held at the end come out of flush().
     public func transform(_ packet: AudioPacket) -> AudioPacket {
-        let inputData = packet.data
-
-        let inputFrameCount = inputData.count / Int(sourceFormat.streamDescription.pointee.mBytesPerFrame)
-        let outputFrameCount = Int(Double(inputFrameCount) * (targetFormat.sampleRate / sourceFormat.sampleRate))
-
-        guard let inputBuffer = AVAudioPCMBuffer(
-            pcmFormat: sourceFormat,
-            frameCapacity: AVAudioFrameCount(inputFrameCount)
-        ) else {
-            return packet
+        let totalFrames = packet.data.count / sourceBytesPerFrame
+        let ratio = targetFormat.sampleRate / sourceFormat.sampleRate
+        var output = Data(capacity: (Int(Double(totalFrames) * ratio) + Int(outputBuffer.frameCapacity)) * targetBytesPerFrame)
+
+        packet.data.withUnsafeBytes { bytes in
+            guard let source = bytes.baseAddress else { return }
+            let inputBuffer = self.inputBuffer
+            let bytesPerFrame = sourceBytesPerFrame
+            var consumed = 0
+
+            // Hand out the packet one block at a time; running dry ends this call
+            // without ending the stream
+            drain(into: &output) { _, outStatus in
+                guard consumed < totalFrames else {
+                    outStatus.pointee = .noDataNow
+                    return nil
+                }
+                let frames = min(Int(inputBuffer.frameCapacity), totalFrames - consumed)
+                inputBuffer.audioBufferList.pointee.mBuffers.mData!.copyMemory(
+                    from: source + consumed * bytesPerFrame, byteCount: frames * bytesPerFrame
+                )
+                inputBuffer.frameLength = AVAudioFrameCount(frames)
+                consumed += frames
+                outStatus.pointee = .haveData
+                return inputBuffer
+            }
         }
 
-        inputData.withUnsafeBytes { bytes in
-            let dest = inputBuffer.audioBufferList.pointee.mBuffers.mData!
-            dest.copyMemory(from: bytes.baseAddress!, byteCount: inputData.count)
-        }
-        inputBuffer.frameLength = AVAudioFrameCount(inputFrameCount)
-
-        guard let outputBuffer = AVAudioPCMBuffer(
-            pcmFormat: targetFormat,
-            frameCapacity: AVAudioFrameCount(outputFrameCount)
-        ) else {
-            return packet
-        }
+        return packet.replacingData(output)
+    }
 
-        var error: NSError?
-        _ = avConverter.convert(to: outputBuffer, error: &error) { _, outStatus in
-            outStatus.pointee = .haveData
-            return inputBuffer
+    /// End the stream: the frames still inside the converter (its filter delay),
+    /// after which the converter starts over for the next stream
+    public func flush() -> Data {
+        var output = Data()
+        drain(into: &output) { _, outStatus in
+            outStatus.pointee = .endOfStream
+            return nil
         }
+        avConverter.reset()
+        return output
+    }
 
-        guard outputBuffer.frameLength > 0 else {
-            return packet
+    /// Run the converter until it needs input the block doesn't have, appending every output block
+    private func drain(into output: inout Data, input: @escaping AVAudioConverterInputBlock) {
+        while true {
+            outputBuffer.frameLength = 0
+            var error: NSError?
+            let status = avConverter.convert(to: outputBuffer, error: &error, withInputFrom: input)
+
+            let frames = Int(outputBuffer.frameLength)
+            if frames > 0 {
+                output.append(
+                    outputBuffer.audioBufferList.pointee.mBuffers.mData!.assumingMemoryBound(to: UInt8.self),
+                    count: frames * targetBytesPerFrame
+                )
+            }
+            // haveData means the output block filled up and more may follow
+            guard status == .haveData, frames > 0 else { return }
         }
-
-        let outputData = Data(
-            bytes: outputBuffer.audioBufferList.pointee.mBuffers.mData!,
-            count: Int(outputBuffer.frameLength * targetFormat.streamDescription.pointee.mBytesPerFrame)
-        )
-
-        return AudioPacket(
-            timestamp: packet.timestamp,
-            duration: packet.duration,
-            data: outputData
-        )
     }
 
-    public static func toSampleRate(_ sampleRate: Double, from sourceFormat: AudioStreamBasicDescription) throws -> AudioFormatConverter {
+    public static func toSampleRate(
+        _ sampleRate: Double,
+        from sourceFormat: AudioStreamBasicDescription,
+        quality: AVAudioQuality = .high
+    ) throws -> AudioFormatConverter {
         var targetFormat = AudioStreamBasicDescription()
         targetFormat.mSampleRate = sampleRate
         targetFormat.mFormatID = kAudioFormatLinearPCM
@@ -89,7 +145,35 @@ public class AudioFormatConverter {
         targetFormat.mBytesPerFrame = (targetFormat.mBitsPerChannel / 8) * sourceFormat.mChannelsPerFrame
         targetFormat.mBytesPerPacket = targetFormat.mFramesPerPacket * targetFormat.mBytesPerFrame
 
-        return try AudioFormatConverter(sourceFormat: sourceFormat, targetFormat: targetFormat)
+        return try AudioFormatConverter(sourceFormat: sourceFormat, targetFormat: targetFormat, quality: quality)
+    }
+
+    /// Interleaved Float32 at `sampleRate`, the input format of OutputEncoder
+    public static func toFloat32(
+        _ sampleRate: Double,
+        from sourceFormat: AudioStreamBasicDescription,
+        quality: AVAudioQuality = .high
+    ) throws -> AudioFormatConverter {
+        var targetFormat = AudioStreamBasicDescription()
+        targetFormat.mSampleRate = sampleRate
+        targetFormat.mFormatID = kAudioFormatLinearPCM
+        targetFormat.mFormatFlags = kAudioFormatFlagIsPacked | kAudioFormatFlagIsFloat
+        targetFormat.mFramesPerPacket = 1
+        targetFormat.mBitsPerChannel = 32
+        targetFormat.mChannelsPerFrame = sourceFormat.mChannelsPerFrame
+        targetFormat.mBytesPerFrame = (targetFormat.mBitsPerChannel / 8) * sourceFormat.mChannelsPerFrame
+        targetFormat.mBytesPerPacket = targetFormat.mFramesPerPacket * targetFormat.mBytesPerFrame
+
+        return try AudioFormatConverter(sourceFormat: sourceFormat, targetFormat: targetFormat, quality: quality)
+    }
+
+    /// Maps the bridge's resampleQuality option (0=low, 1=medium, 2=high)
+    public static func quality(forOption value: Double) -> AVAudioQuality {
+        switch Int(value) {
+        case 0: return .medium
+        case 2: return .max
+        default: return .high
+        }
     }
 
     public static func isValidSampleRate(_ sampleRate: Double) -> Bool {
@@ -5,6 +5,9 @@ import Foundation
 public enum AudioFormatError: Error {
     case deviceNotReady(AudioObjectID)
     case formatUnavailable(AudioObjectID, OSStatus)
+    case encodingUnavailable(Int32)
+    case channelMapMismatch(UInt32)  // The source's channel count
+    case channelMapUnsupported
 
     var localizedDescription: String {
         switch self {
@@ -12,6 +15,13 @@ public enum AudioFormatError: Error {
             return "Audio device \(deviceID) is not ready"
         case .formatUnavailable(let deviceID, let status):
             return "Failed to get stream format from device \(deviceID): OSStatus \(status)"
+        case .encodingUnavailable(let encoding):
+            let name = [AUDIO_ENCODER_WAV: "wav", AUDIO_ENCODER_FLAC: "flac", AUDIO_ENCODER_OPUS: "opus"][encoding]
+            return "Output encoding '\(name ?? String(encoding))' is not available for this build or format"
+        case .channelMapMismatch(let channels):
+            return "Channel map uses a channel the source doesn't have (it has \(channels))"
+        case .channelMapUnsupported:
+            return "Channel maps need 32-bit float interleaved input"
         }
     }
 }
@@ -62,4 +72,31 @@ public class AudioFormatManager {
 
         throw AudioFormatError.formatUnavailable(deviceID, lastStatus)
     }
+
+    /// Channel count of each input stream, in IOProc buffer order
+    public static func getInputStreamChannels(deviceID: AudioObjectID) throws -> [UInt32] {
+        var propertyAddress = getPropertyAddress(
+            selector: kAudioDevicePropertyStreamConfiguration,
+            scope: kAudioDevicePropertyScopeInput
+        )
+        var propertySize: UInt32 = 0
+        var status = AudioObjectGetPropertyDataSize(deviceID, &propertyAddress, 0, nil, &propertySize)
+        guard status == noErr, propertySize > 0 else {
+            throw AudioFormatError.formatUnavailable(deviceID, status)
+        }
+
+        let storage = UnsafeMutableRawPointer.allocate(
+            byteCount: Int(propertySize),
+            alignment: MemoryLayout<AudioBufferList>.alignment
+        )
+        defer { storage.deallocate() }
+
+        status = AudioObjectGetPropertyData(deviceID, &propertyAddress, 0, nil, &propertySize, storage)
+        guard status == noErr else {
+            throw AudioFormatError.formatUnavailable(deviceID, status)
+        }
+
+        let bufferList = UnsafeMutableAudioBufferListPointer(storage.assumingMemoryBound(to: AudioBufferList.self))
+        return bufferList.map { $0.mNumberChannels }
+    }
 }
@@ -1,13 +1,22 @@
 import Foundation
 
 public struct AudioPacket {
-    public let timestamp: Date
     public let duration: Double
     public let data: Data
+    /// Host time of the first frame in nanoseconds, 0 if unknown
+    public let hostTime: UInt64
+    /// AUDIO_CHUNK_FLAG_* bits
+    public let flags: UInt32
 
-    public init(timestamp: Date, duration: Double, data: Data) {
-        self.timestamp = timestamp
+    public init(duration: Double, data: Data, hostTime: UInt64 = 0, flags: UInt32 = 0) {
         self.duration = duration
         self.data = data
+        self.hostTime = hostTime
+        self.flags = flags
+    }
+
+    /// The same packet with converted contents
+    public func replacingData(_ data: Data) -> AudioPacket {
+        return AudioPacket(duration: duration, data: data, hostTime: hostTime, flags: flags)
     }
 }
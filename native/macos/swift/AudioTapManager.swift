@@ -31,6 +31,42 @@ class AudioTapManager {
         try addTapToAggregateDevice(tapID: tapID, deviceID: deviceID)
     }
 
+    /// Sets up the audio tap in an aggregate device that also contains an input
+    /// device. The input device is the clock master and the tap is drift
+    /// compensated against it, so one IOProc delivers both on a single clock.
+    func setupAudioTap(with config: TapConfiguration, inputDeviceUID: String) throws {
+        let tapID = try createSystemAudioTap(with: config)
+        self.tapID = tapID
+
+        let uid = UUID().uuidString
+        let description = [
+            kAudioAggregateDeviceNameKey: "audiotee-combined-device",
+            kAudioAggregateDeviceUIDKey: uid,
+            kAudioAggregateDeviceMainSubDeviceKey: inputDeviceUID,
+            kAudioAggregateDeviceSubDeviceListKey: [
+                [kAudioSubDeviceUIDKey: inputDeviceUID]
+            ] as CFArray,
+            kAudioAggregateDeviceTapListKey: [
+                [
+                    kAudioSubTapUIDKey: getTapUID(tapID: tapID),
+                    kAudioSubTapDriftCompensationKey: true,
+                ]
+            ] as CFArray,
+            kAudioAggregateDeviceTapAutoStartKey: true,
+            kAudioAggregateDeviceIsPrivateKey: true,
+            kAudioAggregateDeviceIsStackedKey: false,
+        ] as [String: Any]
+
+        var deviceID: AudioObjectID = 0
+        let status = AudioHardwareCreateAggregateDevice(description as CFDictionary, &deviceID)
+
+        guard status == kAudioHardwareNoError else {
+            throw AudioTeeError.aggregateDeviceCreationFailed(status)
+        }
+
+        self.deviceID = deviceID
+    }
+
     /// Returns the aggregate device ID for recording
     func getDeviceID() -> AudioObjectID? {
         return deviceID
@@ -80,19 +116,23 @@ class AudioTapManager {
         return deviceID
     }
 
-    private func addTapToAggregateDevice(tapID: AudioObjectID, deviceID: AudioObjectID) throws {
-        // Get the tap's UID
+    private func getTapUID(tapID: AudioObjectID) -> CFString {
         var propertyAddress = getPropertyAddress(selector: kAudioTapPropertyUID)
         var propertySize = UInt32(MemoryLayout<CFString>.stride)
         var tapUID: CFString = "" as CFString
         _ = withUnsafeMutablePointer(to: &tapUID) { tapUID in
             AudioObjectGetPropertyData(tapID, &propertyAddress, 0, nil, &propertySize, tapUID)
         }
+        return tapUID
+    }
+
+    private func addTapToAggregateDevice(tapID: AudioObjectID, deviceID: AudioObjectID) throws {
+        let tapUID = getTapUID(tapID: tapID)
 
         // Add the tap to the aggregate device
-        propertyAddress = getPropertyAddress(selector: kAudioAggregateDevicePropertyTapList)
+        var propertyAddress = getPropertyAddress(selector: kAudioAggregateDevicePropertyTapList)
         let tapArray = [tapUID] as CFArray
-        propertySize = UInt32(MemoryLayout<CFArray>.stride)
+        var propertySize = UInt32(MemoryLayout<CFArray>.stride)
 
         let status = withUnsafePointer(to: tapArray) { ptr in
             AudioObjectSetPropertyData(deviceID, &propertyAddress, 0, nil, propertySize, ptr)
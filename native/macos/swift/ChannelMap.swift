@@ -0,0 +1,91 @@
+import CoreAudio
+import Foundation
+
+// MARK: - Channel Map
+
+/// A channel matrix as set through audio_set_channel_matrix: row-major
+/// outputs x inputs weights
+struct ChannelMatrixSpec {
+    let weights: [Float]
+    let outputs: UInt32
+    let inputs: UInt32
+}
+
+/// Applies the session's channel matrix to interleaved Float32 packets before
+/// they reach the chunker, so only the selected or mixed channels are chunked,
+/// converted and delivered (dsp_channel_matrix_f32). Runs on the thread that
+/// feeds the chunker, never the IOProc: the scratch grows on demand.
+final class ChannelMap {
+    let outputChannels: UInt32
+    private let inputChannels: UInt32
+    private var matrix: [Float]  // Fitted to inputChannels
+    private var scratch: UnsafeMutablePointer<Float>?
+    private var scratchFrames = 0
+
+    /// Throws AudioFormatError.channelMapMismatch if the matrix uses a channel
+    /// the source doesn't have, .channelMapUnsupported if the source isn't
+    /// interleaved Float32
+    init(spec: ChannelMatrixSpec, sourceFormat: AudioStreamBasicDescription) throws {
+        let channels = sourceFormat.mChannelsPerFrame
+        let isFloat = sourceFormat.mFormatFlags & kAudioFormatFlagIsFloat != 0
+        let interleaved = sourceFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved == 0
+        guard isFloat, interleaved, sourceFormat.mBitsPerChannel == 32, channels > 0 else {
+            throw AudioFormatError.channelMapUnsupported
+        }
+
+        var fitted = [Float](repeating: 0, count: Int(spec.outputs * channels))
+        let fits = spec.weights.withUnsafeBufferPointer { weights in
+            dsp_channel_matrix_fit(weights.baseAddress, spec.outputs, spec.inputs, channels, &fitted)
+        }
+        guard fits else {
+            throw AudioFormatError.channelMapMismatch(channels)
+        }
+
+        self.matrix = fitted
+        self.outputChannels = spec.outputs
+        self.inputChannels = channels
+        reserve(frames: 4096)
+    }
+
+    deinit {
+        scratch?.deallocate()
+    }
+
+    /// sourceFormat with the mapped channel count
+    func mappedFormat(_ sourceFormat: AudioStreamBasicDescription) -> AudioStreamBasicDescription {
+        let bytesPerFrame = outputChannels * UInt32(MemoryLayout<Float>.size)
+        return AudioStreamBasicDescription(
+            mSampleRate: sourceFormat.mSampleRate,
+            mFormatID: kAudioFormatLinearPCM,
+            mFormatFlags: kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked,
+            mBytesPerPacket: bytesPerFrame,
+            mFramesPerPacket: 1,
+            mBytesPerFrame: bytesPerFrame,
+            mChannelsPerFrame: outputChannels,
+            mBitsPerChannel: 32,
+            mReserved: 0
+        )
+    }
+
+    /// Map byteCount bytes of source frames; the result stays valid until the next call
+    func apply(_ data: UnsafeRawPointer, byteCount: Int) -> (UnsafeRawPointer, Int) {
+        let frames = byteCount / (Int(inputChannels) * MemoryLayout<Float>.size)
+        reserve(frames: frames)
+        guard let scratch = scratch else { return (data, 0) }
+
+        matrix.withUnsafeBufferPointer { weights in
+            dsp_channel_matrix_f32(
+                data.assumingMemoryBound(to: Float.self), scratch, frames,
+                inputChannels, outputChannels, weights.baseAddress
+            )
+        }
+        return (UnsafeRawPointer(scratch), frames * Int(outputChannels) * MemoryLayout<Float>.size)
+    }
+
+    private func reserve(frames: Int) {
+        guard frames > scratchFrames else { return }
+        scratch?.deallocate()
+        scratch = UnsafeMutablePointer<Float>.allocate(capacity: frames * Int(outputChannels))
+        scratchFrames = frames
+    }
+}
@@ -15,9 +15,24 @@ public typealias AudioDataCallback = @convention(c) (
     UnsafeMutableRawPointer? // user context
 ) -> Void
 
+/// Callback type for receiving audio data with per-chunk timing (AudioChunkInfo in audio_chunk.h)
+public typealias AudioChunkCallback = @convention(c) (
+    UnsafePointer<UInt8>,            // data pointer
+    Int32,                           // data length
+    UnsafePointer<AudioChunkInfo>?,  // sequence, frame position, host time, flags
+    UnsafeMutableRawPointer?         // user context
+) -> Void
+
+/// Callback type for receiving per-chunk levels (AudioLevels in audio_chunk.h)
+public typealias AudioLevelCallback = @convention(c) (
+    UnsafePointer<AudioLevels>?,     // peak, rms and clip count per channel
+    UnsafePointer<AudioChunkInfo>?,  // the chunk the levels belong to
+    UnsafeMutableRawPointer?         // user context
+) -> Void
+
 /// Callback type for receiving events (start, stop, error)
 public typealias AudioEventCallback = @convention(c) (
-    Int32,                   // event type: 0=start, 1=stop, 2=error
+    Int32,                   // event type: 0=start, 1=stop, 2=error, 3=activity start, 4=activity stop
     UnsafePointer<CChar>?,   // message (for errors)
     UnsafeMutableRawPointer? // user context
 ) -> Void
@@ -38,6 +53,19 @@ public typealias AudioMetadataCallback = @convention(c) (
 enum AudioSource {
     case systemAudio
     case microphone(deviceUID: String?)
+    case combined(deviceUID: String?)
+    case virtual
+}
+
+/// What audio_start_combined built its recorder from, so a new default input
+/// can be given the same tap and output ("followDefaultDevice")
+struct CombinedStartParameters {
+    let tapConfig: TapConfiguration
+    let sampleRate: Double
+    var chunkDurationMs: Double       // Follows live chunkDurationMs changes
+    let outputFormat: Int32
+    let inputGain: Float
+    var inputUID: String              // The input device the aggregate was built on
 }
 
 /// Unified session for both system audio and microphone recording
@@ -47,7 +75,38 @@ class AudioRecorderSession {
     var recorder: NativeAudioRecorder?
     var micCaptureManager: MicrophoneCaptureManager?
     var micRecorder: MicrophoneRecorder?
+    var virtualRecorder: VirtualRecorder?
     var isRunning: Bool = false
+    var resampleQuality: AVAudioQuality = .high
+    var gateOptions = ActivityGateOptions()
+    var levelsMode: Int32 = 0  // "levels": 0 = off, 1 = meter chunks, 2 = levels only
+    var bitrate: Int32 = 0     // "bitrate" for Opus, 0 = encoder default
+    var channelMatrix: ChannelMatrixSpec?  // audio_set_channel_matrix, nil = device channels
+    var followDefaultDevice = false  // "followDefaultDevice": move onto a new default input while running
+    var chunkCallback: AudioChunkCallback?
+    var levelCallback: AudioLevelCallback?
+
+    // Prepared devices (audio_prepare_*): kept across stops while keepPrepared
+    // is set, and reused by a start whose key matches
+    var keepPrepared = false
+    var tapKey: String?                    // What tapManager was built for
+    var micSession: AVCaptureSession?      // Capture session with its input attached
+    var micSessionKey: String?             // Device UID it was built for, "" = default
+
+    // Default-device follow: the listener calls into followQueue, which also
+    // swaps a combined session's recorder and tap (see followDefaultInput)
+    var deviceListener: DefaultDeviceListener?
+    var combinedStart: CombinedStartParameters?
+    let followQueue = DispatchQueue(label: "com.native-audio-node.follow-default", qos: .userInitiated)
+
+    // Chunk counters, reset on every start
+    private var sequence: UInt64 = 0
+    private var framePosition: UInt64 = 0
+    private var outputBytesPerFrame: Int = 0
+    private var pendingFlags: UInt32 = 0
+
+    // Packet, chunk and stage timing counters for audio_get_stats, reset on every start
+    let stats = capture_stats_create()
 
     let dataCallback: AudioDataCallback?
     let eventCallback: AudioEventCallback?
@@ -66,6 +125,31 @@ class AudioRecorderSession {
         self.userContext = userContext
     }
 
+    deinit {
+        capture_stats_destroy(stats)
+    }
+
+    /// Tear down the tap and microphone session kept for the next start
+    func releasePrepared() {
+        tapManager = nil
+        tapKey = nil
+        micSession = nil
+        micSessionKey = nil
+    }
+
+    func resetChunkCounters() {
+        sequence = 0
+        framePosition = 0
+        pendingFlags = 0
+        capture_stats_reset(stats)
+    }
+
+    /// Flag the next delivered chunk as a discontinuity (the source was switched).
+    /// Call where chunks are emitted, or while no chunk can be.
+    func markDiscontinuity() {
+        pendingFlags |= UInt32(AUDIO_CHUNK_FLAG_DISCONTINUITY)
+    }
+
     func emitData(_ data: Data) {
         data.withUnsafeBytes { buffer in
             if let baseAddress = buffer.baseAddress?.assumingMemoryBound(to: UInt8.self) {
@@ -74,6 +158,61 @@ class AudioRecorderSession {
         }
     }
 
+    /// Emit a packet through the chunk callback when one is set, else as plain data
+    func emitPacket(_ packet: AudioPacket) {
+        emitChunk(packet, frameCount: frameCount(of: packet), hostTime: packet.hostTime,
+                  flags: packet.flags, levels: nil, pass: true)
+    }
+
+    /// Account for one chunk of `frameCount` output frames: report its levels,
+    /// then deliver `packet` (nil = levels only). A chunk the silence gate held
+    /// back (`pass` false) advances framePosition but takes no sequence number,
+    /// and its flags carry over to the next delivered chunk.
+    func emitChunk(
+        _ packet: AudioPacket?,
+        frameCount: Int,
+        hostTime: UInt64,
+        flags: UInt32,
+        levels: AudioLevels?,
+        pass: Bool
+    ) {
+        var info = AudioChunkInfo(
+            sequence: sequence,
+            framePosition: framePosition,
+            hostTimeNs: hostTime,
+            frameCount: UInt32(frameCount),
+            flags: flags | pendingFlags
+        )
+        framePosition += UInt64(frameCount)
+        if pass {
+            sequence += 1
+            pendingFlags = 0
+        } else {
+            pendingFlags = info.flags
+        }
+
+        if var levels = levels, let levelCallback = levelCallback {
+            levelCallback(&levels, &info, userContext)
+        }
+
+        guard pass, let packet = packet else { return }
+        capture_stats_add_chunk(stats, UInt64(frameCount))
+        guard let chunkCallback = chunkCallback else {
+            emitData(packet.data)
+            return
+        }
+        packet.data.withUnsafeBytes { buffer in
+            if let baseAddress = buffer.baseAddress?.assumingMemoryBound(to: UInt8.self) {
+                chunkCallback(baseAddress, Int32(buffer.count), &info, userContext)
+            }
+        }
+    }
+
+    /// Frames in a packet of the output format reported through emitMetadata
+    func frameCount(of packet: AudioPacket) -> Int {
+        return outputBytesPerFrame > 0 ? packet.data.count / outputBytesPerFrame : 0
+    }
+
     func emitEvent(_ eventType: Int32, message: String? = nil) {
         if let msg = message {
             msg.withCString { cstr in
@@ -85,6 +224,7 @@ class AudioRecorderSession {
     }
 
     func emitMetadata(_ metadata: NativeAudioMetadata) {
+        outputBytesPerFrame = Int(metadata.bitsPerChannel / 8 * metadata.channelsPerFrame)
         metadata.encoding.withCString { encodingCStr in
             metadataCallback?(
                 metadata.sampleRate,
@@ -131,7 +271,8 @@ public func audio_start_system_audio(
     includeProcesses: UnsafePointer<Int32>?,
     includeProcessCount: Int32,
     excludeProcesses: UnsafePointer<Int32>?,
-    excludeProcessCount: Int32
+    excludeProcessCount: Int32,
+    outputFormat: Int32                 // AUDIO_FORMAT_* (0 = s16 when resampling, else device format)
 ) -> Int32 {
     guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
         return -1
@@ -141,6 +282,210 @@ public func audio_start_system_audio(
         return -2 // Already running
     }
 
+    // Create tap configuration
+    let tapConfig = makeTapConfiguration(
+        includeProcesses: includeProcesses,
+        includeProcessCount: includeProcessCount,
+        excludeProcesses: excludeProcesses,
+        excludeProcessCount: excludeProcessCount,
+        mute: mute,
+        isMono: isMono
+    )
+
+    // Set up audio tap
+    let tapManager: AudioTapManager
+    do {
+        tapManager = try acquireTapManager(session: session, config: tapConfig, inputDeviceUID: nil)
+    } catch {
+        session.emitEvent(2, message: "Failed to setup audio tap: \(error)")
+        return -3
+    }
+
+    session.source = .systemAudio
+    return startTapRecorder(
+        session: session,
+        tapManager: tapManager,
+        sampleRate: sampleRate,
+        chunkDurationMs: chunkDurationMs,
+        outputFormat: outputFormat,
+        combinedInputGain: nil
+    )
+}
+
+/// Start system audio and microphone capture on one aggregate device
+/// Output is two channels: system audio on channel 0, the microphone on channel 1
+@_cdecl("audio_start_combined")
+public func audio_start_combined(
+    handle: AudioRecorderHandle,
+    sampleRate: Double,           // 0 for native rate
+    chunkDurationMs: Double,      // chunk duration in milliseconds
+    mute: Bool,
+    includeProcesses: UnsafePointer<Int32>?,
+    includeProcessCount: Int32,
+    excludeProcesses: UnsafePointer<Int32>?,
+    excludeProcessCount: Int32,
+    micDeviceUID: UnsafePointer<CChar>?,    // NULL for default device
+    micGain: Double,
+    outputFormat: Int32                 // AUDIO_FORMAT_* (0 = s16 when resampling, else device format)
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2 // Already running
+    }
+
+    let requestedUID: String? = micDeviceUID != nil ? String(cString: micDeviceUID!) : nil
+    guard let inputUID = requestedUID ?? AudioDeviceManager.getDefaultInputDeviceUID() else {
+        session.emitEvent(2, message: "No default input device available")
+        return -3
+    }
+
+    // The tap is mixed down to one channel either way
+    let tapConfig = makeTapConfiguration(
+        includeProcesses: includeProcesses,
+        includeProcessCount: includeProcessCount,
+        excludeProcesses: excludeProcesses,
+        excludeProcessCount: excludeProcessCount,
+        mute: mute,
+        isMono: true
+    )
+
+    // One aggregate device: the microphone drives the clock, the tap is drift compensated
+    let tapManager: AudioTapManager
+    do {
+        tapManager = try acquireTapManager(session: session, config: tapConfig, inputDeviceUID: inputUID)
+    } catch {
+        session.emitEvent(2, message: "Failed to setup combined audio device: \(error)")
+        return -3
+    }
+
+    session.source = .combined(deviceUID: requestedUID)
+    let result = startTapRecorder(
+        session: session,
+        tapManager: tapManager,
+        sampleRate: sampleRate,
+        chunkDurationMs: chunkDurationMs,
+        outputFormat: outputFormat,
+        combinedInputGain: Float(max(micGain, 0))
+    )
+
+    // An explicitly chosen microphone is kept
+    if result == 0 && requestedUID == nil && session.followDefaultDevice {
+        session.combinedStart = CombinedStartParameters(
+            tapConfig: tapConfig,
+            sampleRate: sampleRate,
+            chunkDurationMs: chunkDurationMs,
+            outputFormat: outputFormat,
+            inputGain: Float(max(micGain, 0)),
+            inputUID: inputUID
+        )
+        listenForDefaultInput(session: session)
+    }
+    return result
+}
+
+/// Follow the default input device while the session runs (audio_stop removes the listener)
+private func listenForDefaultInput(session: AudioRecorderSession) {
+    session.deviceListener = DefaultDeviceListener(queue: session.followQueue) { [weak session] in
+        guard let session = session, session.isRunning else { return }
+        followDefaultInput(session: session)
+    }
+}
+
+/// Runs on followQueue. A microphone session swaps its capture input; a
+/// combined one builds an aggregate on the new input and hands the stream
+/// over to a recorder on it, keeping the tap configuration, the chunker and
+/// (for the same format) the conversion state. A failed switch is reported
+/// as an error and capture stays on the previous device.
+private func followDefaultInput(session: AudioRecorderSession) {
+    if let micRecorder = session.micRecorder {
+        micRecorder.followDefaultInput()
+        return
+    }
+
+    guard let parameters = session.combinedStart, let previous = session.recorder,
+          let inputUID = AudioDeviceManager.getDefaultInputDeviceUID(),
+          inputUID != parameters.inputUID else {
+        return
+    }
+
+    let tapManager = AudioTapManager()
+    let recorder: NativeAudioRecorder
+    do {
+        try tapManager.setupAudioTap(with: parameters.tapConfig, inputDeviceUID: inputUID)
+        guard let deviceID = tapManager.getDeviceID() else {
+            throw AudioTeeError.setupFailed
+        }
+        recorder = try NativeAudioRecorder(
+            deviceID: deviceID,
+            outputHandler: NativeAudioOutputHandler(session: session),
+            convertToSampleRate: parameters.sampleRate > 0 ? parameters.sampleRate : nil,
+            chunkDuration: parameters.chunkDurationMs / 1000.0,
+            resampleQuality: session.resampleQuality,
+            outputFormat: OutputFormat(rawValue: parameters.outputFormat, bitrate: session.bitrate),
+            combinedInputGain: parameters.inputGain,
+            channelMatrix: session.channelMatrix,
+            continuing: previous
+        )
+    } catch {
+        let message = (error as? AudioFormatError)?.localizedDescription ?? "\(error)"
+        session.emitEvent(2, message: "Failed to follow the default input device: \(message)")
+        return
+    }
+
+    // The old aggregate goes away with its tap manager, after its IOProc stopped
+    previous.stopRecording(handingOffTo: recorder)
+    session.markDiscontinuity()
+    session.recorder = recorder
+    session.tapManager = tapManager
+    session.tapKey = tapKey(config: parameters.tapConfig, inputDeviceUID: inputUID)
+    session.combinedStart?.inputUID = inputUID
+    recorder.startRecording()
+}
+
+/// The session's prepared tap if it was built for this configuration, else a new one.
+/// Creating a tap and its aggregate device is the slow part of a system audio start.
+private func acquireTapManager(
+    session: AudioRecorderSession,
+    config: TapConfiguration,
+    inputDeviceUID: String?
+) throws -> AudioTapManager {
+    let key = tapKey(config: config, inputDeviceUID: inputDeviceUID)
+    if let prepared = session.tapManager, session.tapKey == key {
+        return prepared
+    }
+
+    // Release the old tap before building its replacement
+    session.tapManager = nil
+    session.tapKey = nil
+
+    let tapManager = AudioTapManager()
+    if let inputDeviceUID = inputDeviceUID {
+        try tapManager.setupAudioTap(with: config, inputDeviceUID: inputDeviceUID)
+    } else {
+        try tapManager.setupAudioTap(with: config)
+    }
+    session.tapManager = tapManager
+    session.tapKey = key
+    return tapManager
+}
+
+/// Identifies what a tap and its aggregate device were built for
+private func tapKey(config: TapConfiguration, inputDeviceUID: String?) -> String {
+    return "\(config.processes)|\(config.isExclusive)|\(config.muteBehavior.rawValue)|\(config.isMono)|\(inputDeviceUID ?? "")"
+}
+
+/// Process selection for a tap: an include list, else an exclude list, else everything
+private func makeTapConfiguration(
+    includeProcesses: UnsafePointer<Int32>?,
+    includeProcessCount: Int32,
+    excludeProcesses: UnsafePointer<Int32>?,
+    excludeProcessCount: Int32,
+    mute: Bool,
+    isMono: Bool
+) -> TapConfiguration {
     // Convert process arrays
     var includeList: [Int32] = []
     var excludeList: [Int32] = []
@@ -166,31 +511,28 @@ public func audio_start_system_audio(
         isExclusive = true
     }
 
-    // Create tap configuration
-    let tapConfig = TapConfiguration(
+    return TapConfiguration(
         processes: processes,
         muteBehavior: mute ? .muted : .unmuted,
         isExclusive: isExclusive,
         isMono: isMono
     )
+}
 
-    // Set up audio tap
-    let tapManager = AudioTapManager()
-    do {
-        try tapManager.setupAudioTap(with: tapConfig)
-    } catch {
-        session.emitEvent(2, message: "Failed to setup audio tap: \(error)")
-        return -3
-    }
-
+/// Create the IOProc recorder on a tap's aggregate device and start it on a background run loop
+private func startTapRecorder(
+    session: AudioRecorderSession,
+    tapManager: AudioTapManager,
+    sampleRate: Double,
+    chunkDurationMs: Double,
+    outputFormat: Int32,
+    combinedInputGain: Float?
+) -> Int32 {
     guard let deviceID = tapManager.getDeviceID() else {
         session.emitEvent(2, message: "Failed to get device ID")
         return -4
     }
 
-    session.source = .systemAudio
-    session.tapManager = tapManager
-
     // Create native output handler that calls our callbacks
     let outputHandler = NativeAudioOutputHandler(session: session)
 
@@ -205,17 +547,25 @@ public func audio_start_system_audio(
             deviceID: deviceID,
             outputHandler: outputHandler,
             convertToSampleRate: targetSampleRate,
-            chunkDuration: chunkDurationSec
+            chunkDuration: chunkDurationSec,
+            resampleQuality: session.resampleQuality,
+            outputFormat: OutputFormat(rawValue: outputFormat, bitrate: session.bitrate),
+            combinedInputGain: combinedInputGain,
+            channelMatrix: session.channelMatrix
         )
     } catch AudioFormatError.formatUnavailable(let deviceID, let status) {
         session.emitEvent(2, message: "Failed to get audio format from device \(deviceID): OSStatus \(status)")
         return -5
+    } catch let error as AudioFormatError {
+        session.emitEvent(2, message: error.localizedDescription)
+        return -6
     } catch {
         session.emitEvent(2, message: "Failed to create recorder: \(error)")
         return -6
     }
 
     session.recorder = recorder
+    session.resetChunkCounters()
     session.isRunning = true
 
     // Start recording in a background thread
@@ -243,7 +593,8 @@ public func audio_start_microphone(
     isMono: Bool,
     emitSilence: Bool,                  // ignored on macOS - always emits continuous audio
     deviceUID: UnsafePointer<CChar>?,   // NULL for default device
-    gain: Double                        // 0.0 to 1.0
+    gain: Double,                       // 0.0 to 1.0
+    outputFormat: Int32                 // AUDIO_FORMAT_* (0 = s16 when resampling, else device format)
 ) -> Int32 {
     guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
         return -1
@@ -269,48 +620,390 @@ public func audio_start_microphone(
     // Convert chunk duration from ms to seconds
     let chunkDurationSec = chunkDurationMs / 1000.0
 
-    // Create microphone recorder using AVAudioEngine
+    // Create microphone recorder using AVCaptureSession, prepared if one was
     let targetSampleRate: Double? = sampleRate > 0 ? sampleRate : nil
+    let micKey = deviceUIDString ?? ""
     let micRecorder = MicrophoneRecorder(
         outputHandler: outputHandler,
         convertToSampleRate: targetSampleRate,
         chunkDuration: chunkDurationSec,
         gain: micCaptureManager.getGain(),
-        deviceUID: deviceUIDString
+        deviceUID: deviceUIDString,
+        resampleQuality: session.resampleQuality,
+        outputFormat: OutputFormat(rawValue: outputFormat, bitrate: session.bitrate),
+        captureSession: session.micSessionKey == micKey ? session.micSession : nil,
+        channelMatrix: session.channelMatrix
     )
 
     session.micRecorder = micRecorder
+    session.micSession = micRecorder.captureSession
+    session.micSessionKey = micKey
+    session.resetChunkCounters()
     session.isRunning = true
 
     // Start recording - AVCaptureSession handles the audio capture
     do {
         try micRecorder.startRecording()
-    } catch MicrophoneError.deviceNotFound(let uid) {
+    } catch {
         session.isRunning = false
+        return reportMicrophoneError(session: session, error: error)
+    }
+
+    // An explicitly chosen device is kept
+    if deviceUIDString == nil && session.followDefaultDevice {
+        listenForDefaultInput(session: session)
+    }
+
+    return 0
+}
+
+/// Start capture from a synthetic source (virtual_source.h) for benchmarks and tests
+@_cdecl("audio_start_virtual")
+public func audio_start_virtual(
+    handle: AudioRecorderHandle,
+    sampleRate: Double,                 // 0 = the source rate
+    chunkDurationMs: Double,
+    isMono: Bool,
+    source: UnsafePointer<VirtualSourceConfig>?,
+    outputFormat: Int32                 // AUDIO_FORMAT_*
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2 // Already running
+    }
+
+    guard let config = source?.pointee else {
+        session.emitEvent(2, message: "Invalid virtual source")
+        return -3
+    }
+
+    let outputHandler = NativeAudioOutputHandler(session: session)
+    let recorder: VirtualRecorder
+    do {
+        recorder = try VirtualRecorder(
+            config: config,
+            outputHandler: outputHandler,
+            convertToSampleRate: sampleRate > 0 ? sampleRate : nil,
+            chunkDuration: (chunkDurationMs > 0 ? chunkDurationMs : 200) / 1000.0,
+            isMono: isMono,
+            resampleQuality: session.resampleQuality,
+            outputFormat: OutputFormat(rawValue: outputFormat, bitrate: session.bitrate),
+            channelMatrix: session.channelMatrix
+        )
+    } catch let error as AudioFormatError {
+        session.emitEvent(2, message: error.localizedDescription)
+        return -4
+    } catch {
+        session.emitEvent(2, message: "Invalid virtual source")
+        return -3
+    }
+
+    session.source = .virtual
+    session.virtualRecorder = recorder
+    session.resetChunkCounters()
+    session.isRunning = true
+
+    if !recorder.startRecording() {
+        _ = audio_stop(handle: handle)
+        return -5
+    }
+
+    return 0
+}
+
+/// Emit a microphone start failure as an error event; returns its error code
+private func reportMicrophoneError(session: AudioRecorderSession, error: Error) -> Int32 {
+    switch error {
+    case MicrophoneError.deviceNotFound(let uid):
         session.emitEvent(2, message: "Microphone device not found: \(uid)")
         return -3
-    } catch MicrophoneError.permissionDenied {
-        session.isRunning = false
+    case MicrophoneError.permissionDenied:
         session.emitEvent(2, message: "Microphone permission denied")
         return -4
-    } catch MicrophoneError.noDefaultInputDevice {
-        session.isRunning = false
+    case MicrophoneError.noDefaultInputDevice:
         session.emitEvent(2, message: "No default input device available")
         return -5
-    } catch MicrophoneError.sessionConfigurationFailed(let error) {
-        session.isRunning = false
+    case MicrophoneError.sessionConfigurationFailed(let error):
         session.emitEvent(2, message: "Failed to configure capture session: \(error.localizedDescription)")
         return -6
-    } catch MicrophoneError.captureSessionError(let message) {
-        session.isRunning = false
+    case MicrophoneError.captureSessionError(let message):
         session.emitEvent(2, message: "Capture session error: \(message)")
         return -7
-    } catch {
-        session.isRunning = false
+    case MicrophoneError.formatError(let message):
+        session.emitEvent(2, message: message)
+        return -8
+    default:
         session.emitEvent(2, message: "Failed to start microphone: \(error)")
         return -8
     }
+}
+
+/// Build the tap and aggregate device a system audio start would use
+@_cdecl("audio_prepare_system_audio")
+public func audio_prepare_system_audio(
+    handle: AudioRecorderHandle,
+    mute: Bool,
+    isMono: Bool,
+    includeProcesses: UnsafePointer<Int32>?,
+    includeProcessCount: Int32,
+    excludeProcesses: UnsafePointer<Int32>?,
+    excludeProcessCount: Int32
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    let tapConfig = makeTapConfiguration(
+        includeProcesses: includeProcesses,
+        includeProcessCount: includeProcessCount,
+        excludeProcesses: excludeProcesses,
+        excludeProcessCount: excludeProcessCount,
+        mute: mute,
+        isMono: isMono
+    )
+
+    session.keepPrepared = true
+    do {
+        _ = try acquireTapManager(session: session, config: tapConfig, inputDeviceUID: nil)
+    } catch {
+        session.emitEvent(2, message: "Failed to setup audio tap: \(error)")
+        return -3
+    }
+    return 0
+}
+
+/// Look up the microphone and attach it to a capture session ready to start
+@_cdecl("audio_prepare_microphone")
+public func audio_prepare_microphone(
+    handle: AudioRecorderHandle,
+    deviceUID: UnsafePointer<CChar>?
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    let deviceUIDString: String? = deviceUID != nil ? String(cString: deviceUID!) : nil
+    session.keepPrepared = true
+
+    // startRunning() is left to start: a running session lights the microphone indicator
+    let captureSession = AVCaptureSession()
+    do {
+        try MicrophoneRecorder.attachInput(to: captureSession, deviceUID: deviceUIDString)
+    } catch {
+        return reportMicrophoneError(session: session, error: error)
+    }
+    session.micSession = captureSession
+    session.micSessionKey = deviceUIDString ?? ""
+    return 0
+}
+
+/// Build the tap plus input device aggregate a combined start would use
+@_cdecl("audio_prepare_combined")
+public func audio_prepare_combined(
+    handle: AudioRecorderHandle,
+    mute: Bool,
+    includeProcesses: UnsafePointer<Int32>?,
+    includeProcessCount: Int32,
+    excludeProcesses: UnsafePointer<Int32>?,
+    excludeProcessCount: Int32,
+    micDeviceUID: UnsafePointer<CChar>?
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    let requestedUID: String? = micDeviceUID != nil ? String(cString: micDeviceUID!) : nil
+    guard let inputUID = requestedUID ?? AudioDeviceManager.getDefaultInputDeviceUID() else {
+        session.emitEvent(2, message: "No default input device available")
+        return -3
+    }
+
+    let tapConfig = makeTapConfiguration(
+        includeProcesses: includeProcesses,
+        includeProcessCount: includeProcessCount,
+        excludeProcesses: excludeProcesses,
+        excludeProcessCount: excludeProcessCount,
+        mute: mute,
+        isMono: true
+    )
+
+    session.keepPrepared = true
+    do {
+        _ = try acquireTapManager(session: session, config: tapConfig, inputDeviceUID: inputUID)
+    } catch {
+        session.emitEvent(2, message: "Failed to setup combined audio device: \(error)")
+        return -3
+    }
+    return 0
+}
+
+/// Drops prepared devices; a running session keeps them until it stops
+@_cdecl("audio_release_prepared")
+public func audio_release_prepared(handle: AudioRecorderHandle) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    session.keepPrepared = false
+    if !session.isRunning {
+        session.releasePrepared()
+    }
+    return 0
+}
+
+/// Sets a capture tuning option for the next start
+/// Returns 0 if applied, 1 if the option only exists on other platforms
+@_cdecl("audio_set_option")
+public func audio_set_option(
+    handle: AudioRecorderHandle,
+    key: UnsafePointer<CChar>?,
+    value: Double
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession?,
+          let key = key else {
+        return -1
+    }
+
+    let name = String(cString: key)
+
+    // Applied live: the recorder switches at its next chunk. When idle the
+    // size comes from the next start call, so there is nothing to store.
+    if name == "chunkDurationMs" {
+        guard value > 0 && value <= 5000 else { return -3 }
+        if session.isRunning {
+            // In step with a default-device follow replacing the recorder
+            session.followQueue.sync {
+                session.recorder?.setChunkDuration(value / 1000.0)
+                session.combinedStart?.chunkDurationMs = value
+            }
+            session.micRecorder?.setChunkDuration(value / 1000.0)
+            session.virtualRecorder?.setChunkDuration(value / 1000.0)
+        }
+        return 0
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    switch name {
+    case "resampleQuality":
+        guard value >= 0 && value <= 2 else { return -3 }
+        session.resampleQuality = AudioFormatConverter.quality(forOption: value)
+        return 0
+    case "silenceGate":
+        session.gateOptions.enabled = value != 0
+        return 0
+    case "gateThresholdDb":
+        guard value <= 0 else { return -3 }
+        session.gateOptions.thresholdDb = value
+        return 0
+    case "gateHangoverMs":
+        guard value >= 0 else { return -3 }
+        session.gateOptions.hangoverMs = value
+        return 0
+    case "levels":
+        guard value >= 0 && value <= 2 else { return -3 }
+        session.levelsMode = Int32(value)
+        return 0
+    case "bitrate":
+        guard value >= 0 else { return -3 }
+        session.bitrate = Int32(value)
+        return 0
+    case "followDefaultDevice":
+        session.followDefaultDevice = value != 0
+        return 0
+    default:
+        // Windows-only keys (bufferDurationMs, eventDriven) have no Core Audio equivalent
+        return 1
+    }
+}
+
+/// Sets the channel matrix for the next start; NULL weights or 0 outputs clears it
+/// Returns 0, -1 invalid handle, -2 running, -3 invalid size
+@_cdecl("audio_set_channel_matrix")
+public func audio_set_channel_matrix(
+    handle: AudioRecorderHandle,
+    weights: UnsafePointer<Float>?,
+    outputs: UInt32,
+    inputs: UInt32
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    guard let weights = weights, outputs > 0 else {
+        session.channelMatrix = nil
+        return 0
+    }
+
+    // AUDIO_CHANNEL_MATRIX_MAX
+    guard inputs > 0, outputs <= 64, inputs <= 64 else {
+        return -3
+    }
 
+    session.channelMatrix = ChannelMatrixSpec(
+        weights: Array(UnsafeBufferPointer(start: weights, count: Int(outputs * inputs))),
+        outputs: outputs,
+        inputs: inputs
+    )
+    return 0
+}
+
+/// Routes data through a chunk callback that carries AudioChunkInfo
+/// Returns 0 on success, -1 for an invalid handle, -2 while running
+@_cdecl("audio_set_chunk_callback")
+public func audio_set_chunk_callback(
+    handle: AudioRecorderHandle,
+    chunkCallback: AudioChunkCallback?
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    session.chunkCallback = chunkCallback
+    return 0
+}
+
+/// Reports per-chunk levels while the "levels" option is on
+/// Returns 0 on success, -1 for an invalid handle, -2 while running
+@_cdecl("audio_set_level_callback")
+public func audio_set_level_callback(
+    handle: AudioRecorderHandle,
+    levelCallback: AudioLevelCallback?
+) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession? else {
+        return -1
+    }
+
+    if session.isRunning {
+        return -2
+    }
+
+    session.levelCallback = levelCallback
     return 0
 }
 
@@ -327,16 +1020,29 @@ public func audio_stop(handle: AudioRecorderHandle) -> Int32 {
 
     session.isRunning = false
 
+    // No switch may start once this returns, and one in progress finishes first
+    session.deviceListener = nil
+    session.followQueue.sync {}
+    session.combinedStart = nil
+
     // Stop system audio recorder if running
     session.recorder?.stopRecording()
     session.recorder = nil
-    session.tapManager = nil
 
     // Stop microphone recorder if running
     session.micRecorder?.stopRecording()
     session.micRecorder = nil
     session.micCaptureManager = nil
 
+    // Stop the virtual source if running
+    session.virtualRecorder?.stopRecording()
+    session.virtualRecorder = nil
+
+    // The tap and capture session stay for the next start if prepared
+    if !session.keepPrepared {
+        session.releasePrepared()
+    }
+
     session.source = nil
 
     return 0
@@ -360,3 +1066,14 @@ public func audio_is_running(handle: AudioRecorderHandle) -> Bool {
     }
     return session.isRunning
 }
+
+/// Snapshot the session's capture counters and stage timings since the last start
+@_cdecl("audio_get_stats")
+public func audio_get_stats(handle: AudioRecorderHandle, stats: UnsafeMutablePointer<AudioCaptureStats>?) -> Int32 {
+    guard let session = Unmanaged<AudioRecorderSession>.fromOpaque(handle).takeUnretainedValue() as AudioRecorderSession?,
+          let stats = stats else {
+        return -1
+    }
+    capture_stats_snapshot(session.stats, stats)
+    return 0
+}
@@ -0,0 +1,43 @@
+import CoreAudio
+import Foundation
+
+/// Per-channel peak, RMS and clip counts of source packets, measured with the
+/// shared dsp_levels_f32 kernel so both platforms report the same numbers.
+/// Like ActivityGate it reads the Float32 packets before conversion.
+final class LevelMeter {
+    private let channels: UInt32
+
+    /// nil when the source isn't Float32
+    init?(sourceFormat: AudioStreamBasicDescription) {
+        let isFloat32 = sourceFormat.mFormatFlags & kAudioFormatFlagIsFloat != 0 && sourceFormat.mBitsPerChannel == 32
+        guard isFloat32 else { return nil }
+
+        // Non-interleaved buffers are metered as one channel
+        let isInterleaved = sourceFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved == 0
+        self.channels = isInterleaved ? max(sourceFormat.mChannelsPerFrame, 1) : 1
+    }
+
+    func measure(_ packet: AudioPacket) -> AudioLevels {
+        var levels = AudioLevels()
+        let metered = min(channels, UInt32(AUDIO_LEVELS_MAX_CHANNELS))
+        let frames = packet.data.count / MemoryLayout<Float32>.size / Int(channels)
+        levels.channels = metered
+
+        packet.data.withUnsafeBytes { raw in
+            guard let samples = raw.baseAddress?.assumingMemoryBound(to: Float.self) else { return }
+            withUnsafeMutableBytes(of: &levels.peak) { peak in
+                withUnsafeMutableBytes(of: &levels.rms) { rms in
+                    withUnsafeMutableBytes(of: &levels.clipped) { clipped in
+                        dsp_levels_f32(
+                            samples, frames, channels, metered,
+                            peak.baseAddress!.assumingMemoryBound(to: Float.self),
+                            rms.baseAddress!.assumingMemoryBound(to: Float.self),
+                            clipped.baseAddress!.assumingMemoryBound(to: UInt32.self)
+                        )
+                    }
+                }
+            }
+        }
+        return levels
+    }
+}
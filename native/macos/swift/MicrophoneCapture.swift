@@ -82,83 +82,69 @@ enum MicrophoneError: Error {
 // MARK: - AVCaptureSession-based Microphone Recorder
 
 class MicrophoneRecorder: NSObject {
-    private let captureSession = AVCaptureSession()
+    let captureSession: AVCaptureSession
     private var audioOutput: AVCaptureAudioDataOutput?
     private let audioQueue = DispatchQueue(label: "com.coreaudio.microphone.capture", qos: .userInitiated)
 
     private var outputHandler: NativeAudioOutputHandler
     private var targetSampleRate: Double?
+    private var resampleQuality: AVAudioQuality
     private var chunkDuration: Double
     private var gain: Float
     private var deviceUID: String?
 
     private var audioBuffer: AudioBuffer?
-    private var converter: AudioFormatConverter?
-    private var finalFormat: AudioStreamBasicDescription?
+    private var outputFormat: OutputFormat
+    private var stages: OutputStages?
     private var sourceFormat: AudioStreamBasicDescription?
+    private let channelMatrix: ChannelMatrixSpec?
+    private var channelMap: ChannelMap?  // Built with the stages once the device format is known
     private var isRecording = false
     private var hasEmittedMetadata = false
+    private var expectedPresentationTime: CMTime = .invalid
 
     init(
         outputHandler: NativeAudioOutputHandler,
         convertToSampleRate: Double? = nil,
         chunkDuration: Double = 0.2,
         gain: Float = 1.0,
-        deviceUID: String? = nil
+        deviceUID: String? = nil,
+        resampleQuality: AVAudioQuality = .high,
+        outputFormat: OutputFormat = OutputFormat(rawValue: 0),
+        captureSession: AVCaptureSession? = nil,  // Prepared with the device input already attached
+        channelMatrix: ChannelMatrixSpec? = nil
     ) {
+        self.captureSession = captureSession ?? AVCaptureSession()
         self.outputHandler = outputHandler
         self.targetSampleRate = convertToSampleRate
+        self.resampleQuality = resampleQuality
+        self.outputFormat = outputFormat
         self.chunkDuration = chunkDuration
         self.gain = gain
         self.deviceUID = deviceUID
+        self.channelMatrix = channelMatrix
         super.init()
     }
 
     func startRecording() throws {
         guard !isRecording else { return }
 
-        // Get the audio device
-        let device: AVCaptureDevice
-        if let uid = deviceUID {
-            guard let foundDevice = AVCaptureDevice(uniqueID: uid) else {
-                throw MicrophoneError.deviceNotFound(uid)
-            }
-            device = foundDevice
-        } else {
-            guard let defaultDevice = AVCaptureDevice.default(for: .audio) else {
-                throw MicrophoneError.noDefaultInputDevice
-            }
-            device = defaultDevice
+        // The device format isn't known until the first buffer, but a missing encoder can fail now
+        if outputFormat.encoding != AUDIO_ENCODER_PCM && !audio_encoder_available(outputFormat.encoding) {
+            throw MicrophoneError.formatError(AudioFormatError.encodingUnavailable(outputFormat.encoding).localizedDescription)
         }
 
-        // Configure the capture session
-        captureSession.beginConfiguration()
-
-        // Remove any existing inputs/outputs
-        for input in captureSession.inputs {
-            captureSession.removeInput(input)
+        // A prepared session already has its input
+        if captureSession.inputs.isEmpty {
+            try MicrophoneRecorder.attachInput(to: captureSession, deviceUID: deviceUID)
         }
+
+        // Replace the previous session's output, whose delegate was another recorder
+        captureSession.beginConfiguration()
         for output in captureSession.outputs {
             captureSession.removeOutput(output)
         }
 
-        // Add audio input
-        do {
-            let audioInput = try AVCaptureDeviceInput(device: device)
-            if captureSession.canAddInput(audioInput) {
-                captureSession.addInput(audioInput)
-            } else {
-                captureSession.commitConfiguration()
-                throw MicrophoneError.captureSessionError("Cannot add audio input to session")
-            }
-        } catch let error as MicrophoneError {
-            captureSession.commitConfiguration()
-            throw error
-        } catch {
-            captureSession.commitConfiguration()
-            throw MicrophoneError.sessionConfigurationFailed(error)
-        }
-
         // Add audio output
         let audioOutput = AVCaptureAudioDataOutput()
         audioOutput.setSampleBufferDelegate(self, queue: audioQueue)
@@ -174,6 +160,7 @@ class MicrophoneRecorder: NSObject {
         captureSession.commitConfiguration()
 
         // Start the session
+        expectedPresentationTime = .invalid
         isRecording = true
         hasEmittedMetadata = false
 
@@ -187,26 +174,109 @@ class MicrophoneRecorder: NSObject {
         outputHandler.handleStreamStart()
     }
 
+    /// Look up the device and add its input to `session`: the slow part of a
+    /// start, done ahead of time by audio_prepare_microphone
+    static func attachInput(to session: AVCaptureSession, deviceUID: String?) throws {
+        let device: AVCaptureDevice
+        if let uid = deviceUID {
+            guard let foundDevice = AVCaptureDevice(uniqueID: uid) else {
+                throw MicrophoneError.deviceNotFound(uid)
+            }
+            device = foundDevice
+        } else {
+            guard let defaultDevice = AVCaptureDevice.default(for: .audio) else {
+                throw MicrophoneError.noDefaultInputDevice
+            }
+            device = defaultDevice
+        }
+
+        session.beginConfiguration()
+        defer { session.commitConfiguration() }
+
+        for input in session.inputs {
+            session.removeInput(input)
+        }
+
+        let audioInput: AVCaptureDeviceInput
+        do {
+            audioInput = try AVCaptureDeviceInput(device: device)
+        } catch {
+            throw MicrophoneError.sessionConfigurationFailed(error)
+        }
+        guard session.canAddInput(audioInput) else {
+            throw MicrophoneError.captureSessionError("Cannot add audio input to session")
+        }
+        session.addInput(audioInput)
+    }
+
     func stopRecording() {
         guard isRecording else { return }
 
-        isRecording = false
+        // Stop the session first and let any in-flight sample buffer finish on
+        // the capture queue, so the flush below is the only producer left
+        captureSession.stopRunning()
+        audioQueue.sync {
+            isRecording = false
+        }
 
-        // Process any remaining audio
-        if let buffer = audioBuffer, finalFormat != nil {
+        // Process any remaining audio, then what the converter still holds
+        if let buffer = audioBuffer, let stages = stages {
             buffer.processChunks().forEach { packet in
-                let processedPacket = converter?.transform(packet) ?? packet
-                outputHandler.handleAudioPacket(processedPacket)
+                outputHandler.handleSourcePacket(packet, stages: stages)
             }
+            outputHandler.handleEndOfStream(stages: stages)
         }
 
-        // Stop the session
-        captureSession.stopRunning()
-
         outputHandler.handleStreamStop()
     }
 
-    private func setupAudioProcessing(from formatDescription: CMAudioFormatDescription) {
+    /// Move a recorder on the default device onto the current default input.
+    /// The session keeps running; a device with another format gets a new
+    /// converter into the same output when its first buffer arrives (captureOutput).
+    func followDefaultInput() {
+        guard isRecording, deviceUID == nil else { return }
+        do {
+            try MicrophoneRecorder.attachInput(to: captureSession, deviceUID: nil)
+        } catch {
+            outputHandler.handleError("Failed to follow the default input device: \((error as? MicrophoneError)?.localizedDescription ?? "\(error)")")
+            return
+        }
+        audioQueue.async { [self] in
+            expectedPresentationTime = .invalid
+            outputHandler.session?.markDiscontinuity()
+        }
+    }
+
+    /// The device now delivers another format: finish what the current stages
+    /// hold, then convert the new format into the same output. As with
+    /// ChangeInput() on Windows, the output rate, channels and encoder stay and
+    /// no new metadata is reported, so the stream (and its header) carries on.
+    private func changeSourceFormat(_ formatDescription: CMAudioFormatDescription) {
+        guard let previous = stages else { return }
+        if let buffer = audioBuffer {
+            buffer.processChunks().forEach { packet in
+                outputHandler.handleSourcePacket(packet, stages: previous)
+            }
+            outputHandler.handleEndOfStream(stages: previous)
+        }
+        audioBuffer = nil
+        channelMap = nil
+        expectedPresentationTime = .invalid
+        outputHandler.session?.markDiscontinuity()
+        setupAudioProcessing(from: formatDescription, continuing: previous)
+    }
+
+    /// Switch chunk size while recording, on the queue that reads the chunks
+    func setChunkDuration(_ seconds: Double) {
+        audioQueue.async { [self] in
+            chunkDuration = seconds
+            audioBuffer?.setChunkDuration(seconds)
+        }
+    }
+
+    /// Build the stages for the device format, or with `previous` (a format
+    /// change mid-session) a converter from it into the previous output
+    private func setupAudioProcessing(from formatDescription: CMAudioFormatDescription, continuing previous: OutputStages? = nil) {
         let asbd = CMAudioFormatDescriptionGetStreamBasicDescription(formatDescription)?.pointee
 
         guard let format = asbd else {
@@ -229,36 +299,36 @@ class MicrophoneRecorder: NSObject {
 
         self.sourceFormat = sourceFormat
 
-        // Set up audio buffer
-        self.audioBuffer = AudioBuffer(format: sourceFormat, chunkDuration: chunkDuration)
-
-        // Set up converter if needed
-        if let targetRate = targetSampleRate, AudioFormatConverter.isValidSampleRate(targetRate) {
-            do {
-                let converter = try AudioFormatConverter.toSampleRate(targetRate, from: sourceFormat)
-                self.converter = converter
-                self.finalFormat = converter.targetFormatDescription
-            } catch {
-                self.converter = nil
-                self.finalFormat = sourceFormat
+        // Set up channel mapping, conversion and encoding if needed. Without
+        // stages no audio buffer is created, so every later sample buffer is dropped.
+        var chunkFormat = sourceFormat
+        let stages: OutputStages
+        do {
+            if let channelMatrix = channelMatrix {
+                let map = try ChannelMap(spec: channelMatrix, sourceFormat: sourceFormat)
+                chunkFormat = map.mappedFormat(sourceFormat)
+                channelMap = map
             }
-        } else {
-            self.converter = nil
-            self.finalFormat = sourceFormat
+            if let previous = previous {
+                stages = try OutputStages(continuing: previous, sourceFormat: chunkFormat, quality: resampleQuality)
+            } else {
+                stages = try OutputStages(
+                    sourceFormat: chunkFormat,
+                    targetSampleRate: targetSampleRate,
+                    outputFormat: outputFormat,
+                    quality: resampleQuality
+                )
+            }
+        } catch {
+            hasEmittedMetadata = true  // Don't retry on every buffer
+            outputHandler.handleError((error as? AudioFormatError)?.localizedDescription ?? "\(error)")
+            return
         }
-    }
+        self.stages = stages
+        outputHandler.configure(sourceFormat: chunkFormat, stages: stages)
 
-    private func createMetadata(for format: AudioStreamBasicDescription) -> NativeAudioMetadata {
-        let isFloat = format.mFormatFlags & kAudioFormatFlagIsFloat != 0
-        let encoding = isFloat ? "pcm_f32le" : "pcm_s16le"
-
-        return NativeAudioMetadata(
-            sampleRate: format.mSampleRate,
-            channelsPerFrame: format.mChannelsPerFrame,
-            bitsPerChannel: format.mBitsPerChannel,
-            isFloat: isFloat,
-            encoding: encoding
-        )
+        // Set up audio buffer
+        self.audioBuffer = AudioBuffer(format: chunkFormat, chunkDuration: chunkDuration)
     }
 }
 
@@ -268,14 +338,22 @@ extension MicrophoneRecorder: AVCaptureAudioDataOutputSampleBufferDelegate {
     func captureOutput(_ output: AVCaptureOutput, didOutput sampleBuffer: CMSampleBuffer, from connection: AVCaptureConnection) {
         guard isRecording else { return }
 
+        // A new default input may run at another rate or channel count
+        if hasEmittedMetadata, let current = sourceFormat,
+           let formatDescription = CMSampleBufferGetFormatDescription(sampleBuffer),
+           let format = CMAudioFormatDescriptionGetStreamBasicDescription(formatDescription)?.pointee,
+           format.mSampleRate != current.mSampleRate || format.mChannelsPerFrame != current.mChannelsPerFrame ||
+           format.mBytesPerFrame != current.mBytesPerFrame || format.mFormatFlags != current.mFormatFlags {
+            changeSourceFormat(formatDescription)
+        }
+
         // Get the format description on first buffer
         if !hasEmittedMetadata {
             if let formatDescription = CMSampleBufferGetFormatDescription(sampleBuffer) {
                 setupAudioProcessing(from: formatDescription)
 
-                if let format = finalFormat {
-                    let metadata = createMetadata(for: format)
-                    outputHandler.handleMetadata(metadata)
+                if let stages = stages {
+                    outputHandler.handleMetadata(stages.metadata)
                     hasEmittedMetadata = true
                 }
             }
@@ -309,31 +387,46 @@ extension MicrophoneRecorder: AVCaptureAudioDataOutputSampleBufferDelegate {
         let channelCount = Int(self.sourceFormat?.mChannelsPerFrame ?? 1)
         let bytesPerFrame = Int(self.sourceFormat?.mBytesPerFrame ?? 4)
 
-        // Apply gain if needed
+        // Apply gain if needed, clamping to prevent clipping (SIMD kernel)
         if gain != 1.0 {
             let floatPointer = dataPointer.assumingMemoryBound(to: Float32.self)
-            let sampleCount = frameCount * channelCount
+            dsp_gain_clamp_f32(floatPointer, frameCount * channelCount, gain)
+        }
 
-            for i in 0..<sampleCount {
-                var sample = floatPointer[i] * gain
-                // Clamp to prevent clipping
-                sample = max(-1.0, min(1.0, sample))
-                floatPointer[i] = sample
+        // Capture time of the first frame on the host clock; a gap of more than
+        // half a buffer against the previous one means frames were dropped
+        var hostTime: UInt64 = 0
+        var flags: UInt32 = 0
+        let presentationTime = CMSampleBufferGetPresentationTimeStamp(sampleBuffer)
+        if presentationTime.isValid {
+            hostTime = HostClock.nanoseconds(fromHostTime: CMClockConvertHostTimeToSystemUnits(presentationTime))
+            if expectedPresentationTime.isValid {
+                let gap = abs(CMTimeGetSeconds(CMTimeSubtract(presentationTime, expectedPresentationTime)))
+                let bufferSeconds = Double(frameCount) / (self.sourceFormat?.mSampleRate ?? 48000)
+                if gap > bufferSeconds / 2 {
+                    flags |= UInt32(AUDIO_CHUNK_FLAG_DISCONTINUITY)
+                }
             }
+            expectedPresentationTime = CMTimeAdd(presentationTime, CMSampleBufferGetDuration(sampleBuffer))
+        } else {
+            capture_stats_add_timestamp_error(outputHandler.session?.stats)
         }
+        capture_stats_add_packet(outputHandler.session?.stats, UInt64(frameCount), flags)
 
-        // Convert to Data and add to buffer
-        let dataLength = frameCount * bytesPerFrame
-        let audioData = Data(bytes: dataPointer, count: dataLength)
-
-        self.audioBuffer?.append(audioData)
+        // Add to buffer directly from the tap's memory, or from the map's scratch
+        var data = UnsafeRawPointer(dataPointer)
+        var dataLength = frameCount * bytesPerFrame
+        if let channelMap = channelMap {
+            (data, dataLength) = channelMap.apply(data, byteCount: dataLength)
+        }
+        self.audioBuffer?.append(data, count: dataLength, hostTime: hostTime, flags: flags)
         processChunks()
     }
 
     private func processChunks() {
+        guard let stages = stages else { return }
         audioBuffer?.processChunks().forEach { packet in
-            let processedPacket = converter?.transform(packet) ?? packet
-            outputHandler.handleAudioPacket(processedPacket)
+            outputHandler.handleSourcePacket(packet, stages: stages)
         }
     }
 }
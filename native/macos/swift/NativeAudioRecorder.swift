@@ -1,3 +1,4 @@
+import AVFoundation
 import AudioToolbox
 import CoreAudio
 import Foundation
@@ -16,13 +17,123 @@ struct NativeAudioMetadata {
 
 class NativeAudioOutputHandler {
     weak var session: AudioRecorderSession?
+    private var gate: ActivityGate?
+    private var meter: LevelMeter?
+    private var levelsOnly = false
+    private var outputRateRatio: Double = 1
+    private var sourceBytesPerFrame = 0
+    private var outputFrameRemainder: Double = 0
+    private var lastPass = true
+    private var conversionStage = CAPTURE_STAGE_CONVERT
+    private var conversionNs: UInt64 = 0  // Spent in convert() during the current packet
 
     init(session: AudioRecorderSession) {
         self.session = session
     }
 
-    func handleAudioPacket(_ packet: AudioPacket) {
-        session?.emitData(packet.data)
+    /// Set up the session's silence gate and level meter for packets in sourceFormat
+    func configure(sourceFormat: AudioStreamBasicDescription, stages: OutputStages) {
+        guard let session = session else { return }
+        gate = ActivityGate(options: session.gateOptions, sourceFormat: sourceFormat)
+        meter = session.levelsMode != 0 && session.levelCallback != nil ? LevelMeter(sourceFormat: sourceFormat) : nil
+        levelsOnly = session.levelsMode == 2 && meter != nil
+        outputRateRatio = sourceFormat.mSampleRate > 0 ? stages.finalFormat.mSampleRate / sourceFormat.mSampleRate : 1
+        sourceBytesPerFrame = Int(sourceFormat.mBytesPerFrame)
+        outputFrameRemainder = 0
+        // AVAudioConverter does format and rate in one pass; time it as whichever dominates
+        conversionStage = outputRateRatio != 1 ? CAPTURE_STAGE_RESAMPLE : CAPTURE_STAGE_CONVERT
+    }
+
+    /// Gate and meter one source chunk, then convert and emit it
+    func handleSourcePacket(_ source: AudioPacket, stages: OutputStages) {
+        guard let session = session else { return }
+        let start = capture_stats_now_ns()
+        conversionNs = 0
+
+        let result = gate?.evaluate(source) ?? ACTIVITY_GATE_PASS
+        let levels = meter?.measure(source)
+        let pass = result & ACTIVITY_GATE_PASS != 0
+        lastPass = pass
+
+        if result & ACTIVITY_GATE_OPENED != 0 {
+            session.emitEvent(3) // 3 = activity start
+        }
+
+        if levelsOnly {
+            // No PCM leaves native code, so skip the conversion and count the frames it would produce
+            session.emitChunk(
+                nil, frameCount: outputFrames(for: source),
+                hostTime: source.hostTime, flags: source.flags, levels: levels, pass: pass
+            )
+        } else if let streamEncoder = stages.streamEncoder {
+            // Held-back chunks still go through the converter to keep its state, but never
+            // reach the encoder, so the stream header lands in the first delivered chunk.
+            // An empty Opus result (short of a packet) is held back like a gated chunk.
+            let converted = convert(source, stages: stages)
+            let packet = pass ? streamEncoder.encode(converted) : converted
+            session.emitChunk(
+                packet, frameCount: streamEncoder.frameCount(of: converted),
+                hostTime: packet.hostTime, flags: packet.flags, levels: levels, pass: pass && !packet.data.isEmpty
+            )
+        } else {
+            let packet = stages.encode(convert(source, stages: stages))
+            session.emitChunk(
+                packet, frameCount: session.frameCount(of: packet),
+                hostTime: packet.hostTime, flags: packet.flags, levels: levels, pass: pass
+            )
+        }
+
+        if result & ACTIVITY_GATE_CLOSED != 0 {
+            session.emitEvent(4) // 4 = activity stop
+        }
+
+        // Everything but the conversion counts as chunk handling
+        let elapsed = capture_stats_now_ns() - start
+        capture_stats_add_time(session.stats, CAPTURE_STAGE_CHUNK, elapsed > conversionNs ? elapsed - conversionNs : 0)
+    }
+
+    /// stages.convert(), timed into the conversion stage
+    private func convert(_ source: AudioPacket, stages: OutputStages) -> AudioPacket {
+        let start = capture_stats_now_ns()
+        let converted = stages.convert(source)
+        conversionNs = capture_stats_now_ns() - start
+        capture_stats_add_time(session?.stats, conversionStage, conversionNs)
+        return converted
+    }
+
+    /// Emit the frames the converter still holds after the last packet. They
+    /// belong to that packet, so they follow its gate decision; the chunker's
+    /// partial chunk is dropped as before. Call once, after the last packet.
+    func handleEndOfStream(stages: OutputStages) {
+        guard let session = session, !levelsOnly, let tail = stages.flushConverter() else { return }
+
+        // The tail has no capture time of its own
+        if let streamEncoder = stages.streamEncoder {
+            let packet = lastPass ? streamEncoder.encode(tail) : tail
+            session.emitChunk(
+                packet, frameCount: streamEncoder.frameCount(of: tail),
+                hostTime: 0, flags: 0, levels: nil, pass: lastPass && !packet.data.isEmpty
+            )
+        } else {
+            let packet = stages.encode(tail)
+            session.emitChunk(
+                packet, frameCount: session.frameCount(of: packet),
+                hostTime: 0, flags: 0, levels: nil, pass: lastPass
+            )
+        }
+    }
+
+    /// Output frames a source packet converts to, carrying the fraction between packets
+    private func outputFrames(for source: AudioPacket) -> Int {
+        guard sourceBytesPerFrame > 0 else { return 0 }
+        let exact = Double(source.data.count / sourceBytesPerFrame) * outputRateRatio + outputFrameRemainder
+        let frames = exact.rounded(.down)
+        outputFrameRemainder = exact - frames
+        return Int(frames)
+    }
+
+    func handleError(_ message: String) {
+        session?.emitEvent(2, message: message) // 2 = error
     }
 
     func handleMetadata(_ metadata: NativeAudioMetadata) {
@@ -38,81 +149,232 @@ class NativeAudioOutputHandler {
     }
 }
 
+// MARK: - Combined Input Layout
+
+/// Where the input device and the tap sit in a combined aggregate's IOProc
+/// buffer list. Sub-device streams come first and the tap's stream last.
+struct CombinedInputLayout {
+    let inputBuffer: Int
+    let inputChannels: UInt32
+    let tapBuffer: Int
+    let tapChannels: UInt32
+
+    init(deviceID: AudioObjectID) throws {
+        let channels = try AudioFormatManager.getInputStreamChannels(deviceID: deviceID)
+        guard channels.count >= 2, let tapChannels = channels.last else {
+            throw AudioFormatError.formatUnavailable(deviceID, kAudioHardwareBadStreamError)
+        }
+        self.inputBuffer = 0
+        self.inputChannels = max(channels[0], 1)
+        self.tapBuffer = channels.count - 1
+        self.tapChannels = max(tapChannels, 1)
+    }
+}
+
 // MARK: - Native Audio Recorder
 
 public class NativeAudioRecorder {
     private var deviceID: AudioObjectID
     private var ioProcID: AudioDeviceIOProcID?
-    private var finalFormat: AudioStreamBasicDescription!
     private var audioBuffer: AudioBuffer?
     private var outputHandler: NativeAudioOutputHandler
-    private var converter: AudioFormatConverter?
+    private var stages: OutputStages
+    private var expectedSampleTime: Float64 = -1
+    private let sourceBytesPerFrame: UInt32
+    private let chunkFormat: AudioStreamBasicDescription  // What audioBuffer and stages take
+    private let channelMap: ChannelMap?  // Applied by the worker, after the ring
+
+    // Set when this recorder continues another's session on a new device
+    // (stopRecording(handingOffTo:)): no start or metadata event, and the
+    // output stays as it was. With the same chunk format it keeps the previous
+    // chunker and conversion state, else it converts into the same encoders.
+    private let continuesSession: Bool
+    private let continuesStages: Bool
+
+    // Combined capture: the tap (downmixed) and the input device (downmixed,
+    // with gain) interleaved as two channels in scratch preallocated for the IOProc
+    private static let maxCombinedFrames = 16384
+    private let combinedLayout: CombinedInputLayout?
+    private let combinedInputGain: Float
+    private var combinedScratch: UnsafeMutablePointer<Float>?
+
+    // The IOProc only copies device buffers into captureRing and signals the
+    // worker thread, which does the chunking, gating, conversion and emitting.
+    // Nothing on the I/O thread locks, allocates or touches reference counts.
+    private static let ringDuration = 2.0
+    private var captureRing: OpaquePointer?
+    private let ringBytes: Int
+    private var reportedDroppedBytes: UInt64 = 0  // capture_ring_dropped_bytes() already in the stats
+    private let workerSignal = DispatchSemaphore(value: 0)
+    private let workerExited = DispatchSemaphore(value: 0)
+    private let workerLock = NSLock()
+    private var workerRunning = false
+    private var workerThread: Thread?
+    private var pendingChunkDuration: Double?  // Under workerLock; applied by the worker
 
     init(
         deviceID: AudioObjectID,
         outputHandler: NativeAudioOutputHandler,
         convertToSampleRate: Double? = nil,
-        chunkDuration: Double = 0.2
+        chunkDuration: Double = 0.2,
+        resampleQuality: AVAudioQuality = .high,
+        outputFormat: OutputFormat = OutputFormat(rawValue: 0),
+        combinedInputGain: Float? = nil,  // Set for a combined tap + input device aggregate
+        channelMatrix: ChannelMatrixSpec? = nil,
+        continuing previous: NativeAudioRecorder? = nil
     ) throws {
         self.deviceID = deviceID
-        self.outputHandler = outputHandler
 
         // Get source format and set up conversion if requested
-        let sourceFormat = try AudioFormatManager.getDeviceFormat(deviceID: deviceID)
-
-        // Set up the audio buffer using source format and configurable chunk duration
-        self.audioBuffer = AudioBuffer(format: sourceFormat, chunkDuration: chunkDuration)
-
-        if let targetSampleRate = convertToSampleRate {
-            // Validate sample rate
-            guard AudioFormatConverter.isValidSampleRate(targetSampleRate) else {
-                self.converter = nil
-                self.finalFormat = sourceFormat
-                return
-            }
-
-            do {
-                let converter = try AudioFormatConverter.toSampleRate(targetSampleRate, from: sourceFormat)
-                self.converter = converter
-                self.finalFormat = converter.targetFormatDescription
-            } catch {
-                self.converter = nil
-                self.finalFormat = sourceFormat
-            }
+        var sourceFormat = try AudioFormatManager.getDeviceFormat(deviceID: deviceID)
+
+        if let gain = combinedInputGain {
+            self.combinedLayout = try CombinedInputLayout(deviceID: deviceID)
+            self.combinedInputGain = gain
+
+            // Two interleaved Float32 channels at the aggregate's rate
+            sourceFormat = AudioStreamBasicDescription(
+                mSampleRate: sourceFormat.mSampleRate,
+                mFormatID: kAudioFormatLinearPCM,
+                mFormatFlags: kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked,
+                mBytesPerPacket: 8,
+                mFramesPerPacket: 1,
+                mBytesPerFrame: 8,
+                mChannelsPerFrame: 2,
+                mBitsPerChannel: 32,
+                mReserved: 0
+            )
         } else {
-            self.converter = nil
-            self.finalFormat = sourceFormat
+            self.combinedLayout = nil
+            self.combinedInputGain = 1.0
+        }
+        self.sourceBytesPerFrame = sourceFormat.mBytesPerFrame
+
+        // The ring holds device frames; everything after it sees the mapped channels
+        var chunkFormat = sourceFormat
+        if let channelMatrix = channelMatrix {
+            let map = try ChannelMap(spec: channelMatrix, sourceFormat: sourceFormat)
+            chunkFormat = map.mappedFormat(sourceFormat)
+            self.channelMap = map
+        } else {
+            self.channelMap = nil
+        }
+        self.chunkFormat = chunkFormat
+        self.continuesSession = previous != nil
+
+        if let previous = previous, NativeAudioRecorder.sameLayout(previous.chunkFormat, chunkFormat) {
+            // Same frames after the ring: pick up the partial chunk, converter and gate as they are
+            self.audioBuffer = previous.audioBuffer
+            self.stages = previous.stages
+            self.outputHandler = previous.outputHandler
+            self.continuesStages = true
+        } else if let previous = previous {
+            // Another format: a new chunker and converter in front of the same
+            // encoders, so the stream's format and header carry on
+            self.audioBuffer = AudioBuffer(format: chunkFormat, chunkDuration: chunkDuration)
+            self.stages = try OutputStages(continuing: previous.stages, sourceFormat: chunkFormat, quality: resampleQuality)
+            self.outputHandler = previous.outputHandler
+            self.continuesStages = false
+        } else {
+            // Set up the audio buffer using source format and configurable chunk duration
+            self.audioBuffer = AudioBuffer(format: chunkFormat, chunkDuration: chunkDuration)
+
+            self.stages = try OutputStages(
+                sourceFormat: chunkFormat,
+                targetSampleRate: convertToSampleRate,
+                outputFormat: outputFormat,
+                quality: resampleQuality
+            )
+            self.outputHandler = outputHandler
+            self.continuesStages = false
+            outputHandler.configure(sourceFormat: chunkFormat, stages: stages)
+        }
+
+        // Allocated last so a throwing init has nothing to free
+        ringBytes = Int(sourceFormat.mSampleRate * NativeAudioRecorder.ringDuration) * Int(sourceBytesPerFrame)
+        guard let ring = capture_ring_create(ringBytes) else {
+            throw AudioTeeError.setupFailed
+        }
+        captureRing = ring
+        if combinedLayout != nil {
+            combinedScratch = UnsafeMutablePointer<Float>.allocate(capacity: NativeAudioRecorder.maxCombinedFrames * 4)
         }
     }
 
     func startRecording() {
-        // Send metadata for final format
-        let metadata = createMetadata(for: finalFormat)
-        outputHandler.handleMetadata(metadata)
-        outputHandler.handleStreamStart()
+        // Send metadata for final format, unless the stream carries on in the old one
+        if !continuesSession {
+            outputHandler.handleMetadata(stages.metadata)
+            outputHandler.handleStreamStart()
+        } else if !continuesStages {
+            // The previous recorder has flushed its converter by now: gate and
+            // meter the new device's frames
+            outputHandler.configure(sourceFormat: chunkFormat, stages: stages)
+        }
 
+        expectedSampleTime = -1
+        let scratchBytes = combinedScratch != nil ? NativeAudioRecorder.maxCombinedFrames * 4 * MemoryLayout<Float>.size : 0
+        capture_stats_set_allocated(outputHandler.session?.stats, UInt64(ringBytes + scratchBytes))
+        // Resolve the host timebase now rather than on the I/O thread's first call
+        _ = HostClock.nanoseconds(fromHostTime: 0)
+        startWorker()
         setupAndStartIOProc()
     }
 
-    private func createMetadata(for format: AudioStreamBasicDescription) -> NativeAudioMetadata {
-        let isFloat = format.mFormatFlags & kAudioFormatFlagIsFloat != 0
-        let encoding = isFloat ? "pcm_f32le" : "pcm_s16le"
+    private func startWorker() {
+        workerLock.lock()
+        workerRunning = true
+        workerLock.unlock()
 
-        return NativeAudioMetadata(
-            sampleRate: format.mSampleRate,
-            channelsPerFrame: format.mChannelsPerFrame,
-            bitsPerChannel: format.mBitsPerChannel,
-            isFloat: isFloat,
-            encoding: encoding
-        )
+        let thread = Thread { [self] in
+            runWorker()
+        }
+        thread.name = "native-audio-node.capture"
+        thread.qualityOfService = .userInteractive
+        workerThread = thread
+        thread.start()
+    }
+
+    private func runWorker() {
+        while isWorkerRunning() {
+            // The timeout only bounds how long a stop request can go unnoticed
+            _ = workerSignal.wait(timeout: .now() + .milliseconds(100))
+            drainCaptureRing()
+        }
+        workerExited.signal()
+    }
+
+    private func isWorkerRunning() -> Bool {
+        workerLock.lock()
+        defer { workerLock.unlock() }
+        return workerRunning
+    }
+
+    private func stopWorker() {
+        guard workerThread != nil else { return }
+        workerLock.lock()
+        workerRunning = false
+        workerLock.unlock()
+        workerSignal.signal()
+        workerExited.wait()
+        workerThread = nil
+    }
+
+    /// Switch chunk size while recording; the worker picks it up before its next chunk
+    func setChunkDuration(_ seconds: Double) {
+        workerLock.lock()
+        pendingChunkDuration = seconds
+        workerLock.unlock()
     }
 
     private func setupAndStartIOProc() {
         var status = AudioDeviceCreateIOProcID(
             deviceID,
             { (inDevice, inNow, inInputData, inInputTime, outOutputData, inOutputTime, inClientData) -> OSStatus in
-                let recorder = Unmanaged<NativeAudioRecorder>.fromOpaque(inClientData!).takeUnretainedValue()
-                return recorder.processAudio(inInputData)
+                // Borrowed without a retain/release pair; stopRecording outlives the IOProc
+                return Unmanaged<NativeAudioRecorder>.fromOpaque(inClientData!)._withUnsafeGuaranteedRef {
+                    $0.processAudio(inInputData, inputTime: inInputTime)
+                }
             },
             Unmanaged.passUnretained(self).toOpaque(),
             &ioProcID
@@ -131,34 +393,140 @@ public class NativeAudioRecorder {
         }
     }
 
-    private func processAudio(_ inputData: UnsafePointer<AudioBufferList>) -> OSStatus {
-        let bufferList = inputData.pointee
-        let firstBuffer = bufferList.mBuffers
+    deinit {
+        combinedScratch?.deallocate()
+        capture_ring_destroy(captureRing)
+    }
 
-        guard firstBuffer.mData != nil && firstBuffer.mDataByteSize > 0 else {
+    private func processAudio(_ inputData: UnsafePointer<AudioBufferList>, inputTime: UnsafePointer<AudioTimeStamp>) -> OSStatus {
+        // Combined aggregates are mixed into scratch; otherwise the first buffer is the audio
+        let samples: UnsafeMutableRawPointer?
+        let byteCount: Int
+        if let layout = combinedLayout, let scratch = combinedScratch {
+            let frames = mixCombined(inputData, layout: layout)
+            samples = UnsafeMutableRawPointer(scratch + 2 * NativeAudioRecorder.maxCombinedFrames)
+            byteCount = frames * Int(sourceBytesPerFrame)
+        } else {
+            let firstBuffer = inputData.pointee.mBuffers
+            samples = firstBuffer.mData
+            byteCount = Int(firstBuffer.mDataByteSize)
+        }
+
+        guard let data = samples, byteCount > 0 else {
             return noErr
         }
 
-        // Append raw audio data to buffer
-        let audioData = Data(bytes: firstBuffer.mData!, count: Int(firstBuffer.mDataByteSize))
-        audioBuffer?.append(audioData)
+        let timestamp = inputTime.pointee
+        var hostTime: UInt64 = 0
+        if timestamp.mFlags.contains(.hostTimeValid) {
+            hostTime = HostClock.nanoseconds(fromHostTime: timestamp.mHostTime)
+        }
+
+        // A jump in the device sample clock means the HAL dropped input
+        var flags: UInt32 = 0
+        if timestamp.mFlags.contains(.sampleTimeValid) {
+            if expectedSampleTime >= 0 && abs(timestamp.mSampleTime - expectedSampleTime) >= 1 {
+                flags |= UInt32(AUDIO_CHUNK_FLAG_DISCONTINUITY)
+            }
+            let bytesPerFrame = max(Int(sourceBytesPerFrame), 1)
+            expectedSampleTime = timestamp.mSampleTime + Float64(byteCount / bytesPerFrame)
+        }
 
-        processAudioBuffer()
+        // A full ring drops this buffer and flags the next one as a discontinuity
+        if capture_ring_write(captureRing, data, byteCount, hostTime, flags) {
+            workerSignal.signal()
+        }
 
         return noErr
     }
 
-    func stopRecording() {
-        processAudioBuffer()
-        outputHandler.handleStreamStop()
+    /// Downmix the tap and the input device into two interleaved channels; returns frames
+    private func mixCombined(_ inputData: UnsafePointer<AudioBufferList>, layout: CombinedInputLayout) -> Int {
+        let buffers = UnsafeMutableAudioBufferListPointer(UnsafeMutablePointer(mutating: inputData))
+        guard let scratch = combinedScratch, buffers.count > max(layout.inputBuffer, layout.tapBuffer),
+              let inputSamples = buffers[layout.inputBuffer].mData?.assumingMemoryBound(to: Float.self),
+              let tapSamples = buffers[layout.tapBuffer].mData?.assumingMemoryBound(to: Float.self) else {
+            return 0
+        }
+
+        let sampleSize = MemoryLayout<Float>.size
+        let inputFrames = Int(buffers[layout.inputBuffer].mDataByteSize) / (sampleSize * Int(layout.inputChannels))
+        let tapFrames = Int(buffers[layout.tapBuffer].mDataByteSize) / (sampleSize * Int(layout.tapChannels))
+        let frames = min(inputFrames, tapFrames, NativeAudioRecorder.maxCombinedFrames)
+
+        let system = scratch
+        let microphone = scratch + NativeAudioRecorder.maxCombinedFrames
+        let mixed = scratch + 2 * NativeAudioRecorder.maxCombinedFrames
+        dsp_gain_downmix_f32(tapSamples, system, frames, layout.tapChannels, 1.0)
+        dsp_gain_downmix_f32(inputSamples, microphone, frames, layout.inputChannels, combinedInputGain)
+        for i in 0..<frames {
+            mixed[2 * i] = system[i]
+            mixed[2 * i + 1] = microphone[i]
+        }
+        return frames
+    }
+
+    /// Stop capturing. With a successor (built `continuing` this recorder) the
+    /// session goes on there: no stop event, and if it took over the stages
+    /// the converter isn't flushed either.
+    func stopRecording(handingOffTo successor: NativeAudioRecorder? = nil) {
+        // Stop the IOProc, then the worker, so the final drain here is the only consumer
         cleanupIOProc()
+        stopWorker()
+        drainCaptureRing()
+        if successor?.continuesStages != true {
+            outputHandler.handleEndOfStream(stages: stages)
+        }
+        if successor == nil {
+            outputHandler.handleStreamStop()
+        }
+    }
+
+    private static func sameLayout(_ a: AudioStreamBasicDescription, _ b: AudioStreamBasicDescription) -> Bool {
+        return a.mSampleRate == b.mSampleRate && a.mFormatFlags == b.mFormatFlags &&
+            a.mBytesPerFrame == b.mBytesPerFrame && a.mChannelsPerFrame == b.mChannelsPerFrame &&
+            a.mBitsPerChannel == b.mBitsPerChannel
+    }
+
+    /// Move everything the IOProc queued into the chunker and emit complete chunks
+    private func drainCaptureRing() {
+        workerLock.lock()
+        let chunkDuration = pendingChunkDuration
+        pendingChunkDuration = nil
+        workerLock.unlock()
+        if let chunkDuration {
+            audioBuffer?.setChunkDuration(chunkDuration)
+        }
+
+        var data: UnsafeRawPointer?
+        var hostTime: UInt64 = 0
+        var flags: UInt32 = 0
+        let stats = outputHandler.session?.stats
+        while true {
+            let byteCount = capture_ring_peek(captureRing, &data, &hostTime, &flags)
+            guard byteCount > 0, let bytes = data else { break }
+            capture_stats_add_packet(stats, UInt64(byteCount / max(Int(sourceBytesPerFrame), 1)), flags)
+            if let channelMap = channelMap {
+                let (mapped, mappedCount) = channelMap.apply(bytes, byteCount: byteCount)
+                audioBuffer?.append(mapped, count: mappedCount, hostTime: hostTime, flags: flags)
+            } else {
+                audioBuffer?.append(bytes, count: byteCount, hostTime: hostTime, flags: flags)
+            }
+            capture_ring_consume(captureRing)
+            processAudioBuffer()
+        }
+
+        let dropped = capture_ring_dropped_bytes(captureRing)
+        if dropped > reportedDroppedBytes {
+            capture_stats_add_dropped_bytes(stats, dropped - reportedDroppedBytes)
+            reportedDroppedBytes = dropped
+        }
     }
 
     private func processAudioBuffer() {
-        // Process and send complete chunks, applying conversion if needed
+        // Process and send complete chunks, applying conversion and encoding if needed
         audioBuffer?.processChunks().forEach { packet in
-            let processedPacket = converter?.transform(packet) ?? packet
-            outputHandler.handleAudioPacket(processedPacket)
+            outputHandler.handleSourcePacket(packet, stages: stages)
         }
     }
 
@@ -0,0 +1,303 @@
+import AVFoundation
+import CoreAudio
+import Foundation
+
+/// Output sample format, layout and encoding requested through audio_start_*
+/// (AUDIO_FORMAT_* and AUDIO_ENCODING_* in audio_bridge.h)
+public struct OutputFormat {
+    static let sampleMask: Int32 = 0xFF
+    static let planarFlag: Int32 = 0x100
+    static let encodingMask: Int32 = 0xFF0000
+    static let encodingShift: Int32 = 16
+
+    public let sampleFormat: Int32  // DSP_FORMAT_*, 0 = platform default
+    public let planar: Bool
+    public let encoding: Int32      // AUDIO_ENCODER_*
+    public let bitrate: Int32       // Opus bits per second ("bitrate" option), 0 = default
+
+    public init(rawValue: Int32, bitrate: Int32 = 0) {
+        self.sampleFormat = rawValue & OutputFormat.sampleMask
+        self.planar = rawValue & OutputFormat.planarFlag != 0
+        self.encoding = (rawValue & OutputFormat.encodingMask) >> OutputFormat.encodingShift
+        self.bitrate = bitrate
+    }
+
+    /// Keep the historical macOS output (s16 when resampling, else the device format)
+    public var isDefault: Bool {
+        return dsp_format_bytes(sampleFormat) == 0 && encoding == AUDIO_ENCODER_PCM
+    }
+}
+
+/// Encodes interleaved Float32 packets into the requested sample format and
+/// layout with the shared DSP kernels, so both platforms emit identical bytes.
+public class OutputEncoder {
+    private let format: OutputFormat
+    private let channels: UInt32
+    private let sampleRate: Double
+    private var dither = DspDitherState()
+
+    public init(format: OutputFormat, sampleRate: Double, channels: UInt32) {
+        self.format = format
+        self.sampleRate = sampleRate
+        self.channels = max(channels, 1)
+        dsp_dither_init(&dither, 0)
+    }
+
+    public var targetFormatDescription: AudioStreamBasicDescription {
+        let bytesPerSample = UInt32(dsp_format_bytes(format.sampleFormat))
+        var flags: AudioFormatFlags = kAudioFormatFlagIsPacked
+        flags |= format.sampleFormat == DSP_FORMAT_F32 ? kAudioFormatFlagIsFloat : kAudioFormatFlagIsSignedInteger
+        if format.planar && channels > 1 {
+            flags |= kAudioFormatFlagIsNonInterleaved
+        }
+
+        var description = AudioStreamBasicDescription()
+        description.mSampleRate = sampleRate
+        description.mFormatID = kAudioFormatLinearPCM
+        description.mFormatFlags = flags
+        description.mFramesPerPacket = 1
+        description.mBitsPerChannel = bytesPerSample * 8
+        description.mChannelsPerFrame = channels
+        description.mBytesPerFrame = bytesPerSample * channels
+        description.mBytesPerPacket = description.mBytesPerFrame
+        return description
+    }
+
+    public func encode(_ packet: AudioPacket) -> AudioPacket {
+        let sampleCount = packet.data.count / MemoryLayout<Float32>.size
+        let frames = sampleCount / Int(channels)
+        var output = Data(count: frames * Int(channels) * dsp_format_bytes(format.sampleFormat))
+
+        packet.data.withUnsafeBytes { input in
+            output.withUnsafeMutableBytes { dest in
+                guard let source = input.baseAddress?.assumingMemoryBound(to: Float.self),
+                      let target = dest.baseAddress else { return }
+                // s16 gets TPDF dither, matching the Windows pipeline
+                withUnsafeMutablePointer(to: &dither) { ditherState in
+                    _ = dsp_encode_f32(
+                        source, frames, channels, format.sampleFormat, format.planar,
+                        format.sampleFormat == DSP_FORMAT_S16 ? ditherState : nil, target
+                    )
+                }
+            }
+        }
+
+        return packet.replacingData(output)
+    }
+}
+
+/// Streams interleaved Float32 packets through the shared encoder (audio_encoder.h),
+/// producing the same WAV, FLAC or Opus bytes as the Windows pipeline.
+final class StreamEncoder {
+    private let encoder: OpaquePointer
+    private let channels: UInt32
+    private let maxFrames: Int
+
+    /// nil if the encoding isn't built in or doesn't support this rate or channel count
+    init?(format: OutputFormat, sampleRate: Double, channels: UInt32) {
+        // Encoded streams default to 16-bit, as on Windows
+        let sampleFormat = dsp_format_bytes(format.sampleFormat) > 0 ? format.sampleFormat : DSP_FORMAT_S16
+        let maxFrames = max(Int(sampleRate), 1)
+        var config = AudioEncoderConfig(
+            encoding: format.encoding,
+            sampleRate: sampleRate,
+            channels: max(channels, 1),
+            sampleFormat: sampleFormat,
+            bitrate: format.bitrate,
+            maxFrames: maxFrames
+        )
+        guard let encoder = audio_encoder_create(&config) else { return nil }
+        self.encoder = encoder
+        self.channels = max(channels, 1)
+        self.maxFrames = maxFrames
+    }
+
+    deinit {
+        audio_encoder_destroy(encoder)
+    }
+
+    var name: String { String(cString: audio_encoder_name(encoder)) }
+    var bitsPerSample: UInt32 { audio_encoder_bits(encoder) }
+    var isFloat: Bool { audio_encoder_is_float(encoder) }
+
+    /// Frames in an input packet, for chunk info (encoded bytes say nothing about frames)
+    func frameCount(of packet: AudioPacket) -> Int {
+        return packet.data.count / MemoryLayout<Float32>.size / Int(channels)
+    }
+
+    /// Encoded bytes for one packet; empty while Opus is still short of a 20 ms packet
+    func encode(_ packet: AudioPacket) -> AudioPacket {
+        let frames = frameCount(of: packet)
+        var output = Data()
+
+        packet.data.withUnsafeBytes { input in
+            guard let source = input.baseAddress?.assumingMemoryBound(to: Float.self) else { return }
+            // Packets longer than the encoder's block (a second) go through in pieces
+            var offset = 0
+            while offset < frames {
+                let count = min(frames - offset, maxFrames)
+                var bytes: UnsafePointer<UInt8>?
+                let written = audio_encoder_encode(encoder, source + offset * Int(channels), count, &bytes)
+                if let bytes = bytes, written > 0 {
+                    output.append(bytes, count: written)
+                }
+                offset += count
+            }
+        }
+
+        return packet.replacingData(output)
+    }
+}
+
+/// The conversion chain of one recorder: an optional AVAudioConverter for the
+/// rate change, then an optional encoder for an explicitly requested format or
+/// a stream encoding (whose input is the interleaved Float32 in finalFormat).
+struct OutputStages {
+    let sourceFormat: AudioStreamBasicDescription
+    let converter: AudioFormatConverter?
+    let encoder: OutputEncoder?
+    let streamEncoder: StreamEncoder?
+    let finalFormat: AudioStreamBasicDescription
+
+    /// Throws AudioFormatError.encodingUnavailable if a stream encoding can't be created
+    init(
+        sourceFormat: AudioStreamBasicDescription,
+        targetSampleRate: Double?,
+        outputFormat: OutputFormat,
+        quality: AVAudioQuality
+    ) throws {
+        self.sourceFormat = sourceFormat
+        let validRate = targetSampleRate.flatMap { AudioFormatConverter.isValidSampleRate($0) ? $0 : nil }
+
+        if outputFormat.isDefault {
+            // Historical behavior: s16 at the target rate, or the device format untouched
+            let converter = validRate.flatMap {
+                try? AudioFormatConverter.toSampleRate($0, from: sourceFormat, quality: quality)
+            }
+            self.converter = converter
+            self.encoder = nil
+            self.streamEncoder = nil
+            self.finalFormat = converter?.targetFormatDescription ?? sourceFormat
+            return
+        }
+
+        // The encoder takes interleaved Float32; convert first unless the device already delivers it
+        let rate = validRate ?? sourceFormat.mSampleRate
+        let isFloat32 = sourceFormat.mFormatFlags & kAudioFormatFlagIsFloat != 0 && sourceFormat.mBitsPerChannel == 32
+        let isInterleaved = sourceFormat.mFormatFlags & kAudioFormatFlagIsNonInterleaved == 0 || sourceFormat.mChannelsPerFrame == 1
+
+        var converter: AudioFormatConverter?
+        if !(isFloat32 && isInterleaved && rate == sourceFormat.mSampleRate) {
+            converter = try? AudioFormatConverter.toFloat32(rate, from: sourceFormat, quality: quality)
+            guard converter != nil else {
+                if outputFormat.encoding != AUDIO_ENCODER_PCM {
+                    throw AudioFormatError.encodingUnavailable(outputFormat.encoding)
+                }
+                self.converter = nil
+                self.encoder = nil
+                self.streamEncoder = nil
+                self.finalFormat = sourceFormat
+                return
+            }
+        }
+
+        if outputFormat.encoding != AUDIO_ENCODER_PCM {
+            guard let streamEncoder = StreamEncoder(
+                format: outputFormat, sampleRate: rate, channels: sourceFormat.mChannelsPerFrame
+            ) else {
+                throw AudioFormatError.encodingUnavailable(outputFormat.encoding)
+            }
+            let float32 = OutputFormat(rawValue: DSP_FORMAT_F32)
+            self.converter = converter
+            self.encoder = nil
+            self.streamEncoder = streamEncoder
+            self.finalFormat = OutputEncoder(format: float32, sampleRate: rate, channels: sourceFormat.mChannelsPerFrame)
+                .targetFormatDescription
+            return
+        }
+
+        let encoder = OutputEncoder(format: outputFormat, sampleRate: rate, channels: sourceFormat.mChannelsPerFrame)
+        self.converter = converter
+        self.encoder = encoder
+        self.streamEncoder = nil
+        self.finalFormat = encoder.targetFormatDescription
+    }
+
+    /// The chain of `previous` for another source format (a followed default
+    /// device): the same encoders and finalFormat, so the stream's format and
+    /// header carry on, behind a converter from `sourceFormat` into what
+    /// `previous` converted to. Flush `previous` first; its encoders are shared.
+    init(continuing previous: OutputStages, sourceFormat: AudioStreamBasicDescription, quality: AVAudioQuality) throws {
+        let target = previous.convertedFormat
+        let sameFormat = sourceFormat.mSampleRate == target.mSampleRate &&
+            sourceFormat.mFormatFlags == target.mFormatFlags &&
+            sourceFormat.mBytesPerFrame == target.mBytesPerFrame &&
+            sourceFormat.mChannelsPerFrame == target.mChannelsPerFrame &&
+            sourceFormat.mBitsPerChannel == target.mBitsPerChannel
+        self.sourceFormat = sourceFormat
+        self.converter = sameFormat
+            ? nil
+            : try AudioFormatConverter(sourceFormat: sourceFormat, targetFormat: target, quality: quality)
+        self.encoder = previous.encoder
+        self.streamEncoder = previous.streamEncoder
+        self.finalFormat = previous.finalFormat
+    }
+
+    /// What convert() produces: the encoders' input format
+    var convertedFormat: AudioStreamBasicDescription {
+        return converter?.targetFormatDescription ?? sourceFormat
+    }
+
+    func convert(_ packet: AudioPacket) -> AudioPacket {
+        return converter?.transform(packet) ?? packet
+    }
+
+    func process(_ packet: AudioPacket) -> AudioPacket {
+        return encode(convert(packet))
+    }
+
+    /// The encoding step alone, for packets that are already converted
+    func encode(_ converted: AudioPacket) -> AudioPacket {
+        if let streamEncoder = streamEncoder {
+            return streamEncoder.encode(converted)
+        }
+        return encoder?.encode(converted) ?? converted
+    }
+
+    /// End of stream: the converter's remaining frames as a converted (not yet
+    /// encoded) packet, or nil if it holds none
+    func flushConverter() -> AudioPacket? {
+        guard let converter = converter else { return nil }
+        let data = converter.flush()
+        guard !data.isEmpty else { return nil }
+        let duration = Double(data.count / max(Int(finalFormat.mBytesPerFrame), 1)) / max(finalFormat.mSampleRate, 1)
+        return AudioPacket(duration: duration, data: data)
+    }
+
+    /// Metadata describing finalFormat, or the stream encoding
+    var metadata: NativeAudioMetadata {
+        let format = finalFormat
+        if let streamEncoder = streamEncoder {
+            return NativeAudioMetadata(
+                sampleRate: format.mSampleRate,
+                channelsPerFrame: format.mChannelsPerFrame,
+                bitsPerChannel: streamEncoder.bitsPerSample,
+                isFloat: streamEncoder.isFloat,
+                encoding: streamEncoder.name
+            )
+        }
+        let isFloat = format.mFormatFlags & kAudioFormatFlagIsFloat != 0
+        var encoding = isFloat ? "pcm_f32le" : "pcm_s\(format.mBitsPerChannel)le"
+        if format.mFormatFlags & kAudioFormatFlagIsNonInterleaved != 0 {
+            encoding += "_planar"
+        }
+
+        return NativeAudioMetadata(
+            sampleRate: format.mSampleRate,
+            channelsPerFrame: format.mChannelsPerFrame,
+            bitsPerChannel: format.mBitsPerChannel,
+            isFloat: isFloat,
+            encoding: encoding
+        )
+    }
+}
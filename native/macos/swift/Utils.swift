@@ -3,6 +3,25 @@ import AudioToolbox
 import CoreAudio
 import Foundation
 
+/// Host clock helpers: mach_absolute_time ticks to nanoseconds (the clock of uv_hrtime)
+enum HostClock {
+    private static let timebase: mach_timebase_info_data_t = {
+        var info = mach_timebase_info_data_t()
+        mach_timebase_info(&info)
+        return info
+    }()
+
+    static func nanoseconds(fromHostTime hostTime: UInt64) -> UInt64 {
+        let info = timebase
+        if info.numer == info.denom {
+            return hostTime
+        }
+        // Split to avoid overflowing hostTime * numer
+        return (hostTime / UInt64(info.denom)) * UInt64(info.numer)
+            + (hostTime % UInt64(info.denom)) * UInt64(info.numer) / UInt64(info.denom)
+    }
+}
+
 func isAudioDeviceValid(_ deviceID: AudioObjectID) -> Bool {
     var address = getPropertyAddress(selector: kAudioDevicePropertyDeviceIsAlive)
 
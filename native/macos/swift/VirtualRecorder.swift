@@ -0,0 +1,149 @@
+import AVFoundation
+import Foundation
+
+// MARK: - Virtual Recorder
+
+/// Records from a synthetic source (virtual_source.h) instead of a device. The
+/// packets go through the same chunker, gate, meter, conversion and emitting
+/// as NativeAudioRecorder's, so benchmarks and tests cover the real path
+/// without audio hardware. The source's thread does the processing, as the
+/// worker thread does for device capture.
+class VirtualRecorder {
+    private let outputHandler: NativeAudioOutputHandler
+    private let audioBuffer: AudioBuffer
+    private let stages: OutputStages
+    private let sourceChannels: UInt32
+    private let outputBytesPerFrame: Int
+    private var source: OpaquePointer?
+    private var mixScratch: UnsafeMutablePointer<Float>?  // Mono downmix of one packet
+    private let channelMap: ChannelMap?  // Replaces the downmix when set
+
+    private let chunkLock = NSLock()
+    private var pendingChunkDuration: Double?  // Under chunkLock; applied by the source thread
+
+    /// Throws AudioTeeError.setupFailed for an invalid source config and
+    /// AudioFormatError.encodingUnavailable for an encoding that can't be created
+    init(
+        config: VirtualSourceConfig,
+        outputHandler: NativeAudioOutputHandler,
+        convertToSampleRate: Double? = nil,
+        chunkDuration: Double = 0.2,
+        isMono: Bool = true,
+        resampleQuality: AVAudioQuality = .high,
+        outputFormat: OutputFormat = OutputFormat(rawValue: 0),
+        channelMatrix: ChannelMatrixSpec? = nil
+    ) throws {
+        guard config.sampleRate > 0, config.channels > 0, config.framesPerPacket > 0 else {
+            throw AudioTeeError.setupFailed
+        }
+        self.outputHandler = outputHandler
+        self.sourceChannels = config.channels
+
+        // Interleaved Float32, downmixed or mapped here so the chunker sees only the output channels
+        let packetFormat = VirtualRecorder.floatFormat(sampleRate: config.sampleRate, channels: config.channels)
+        let sourceFormat: AudioStreamBasicDescription
+        if let channelMatrix = channelMatrix {
+            let map = try ChannelMap(spec: channelMatrix, sourceFormat: packetFormat)
+            sourceFormat = map.mappedFormat(packetFormat)
+            self.channelMap = map
+        } else {
+            sourceFormat = VirtualRecorder.floatFormat(
+                sampleRate: config.sampleRate, channels: isMono ? 1 : config.channels)
+            self.channelMap = nil
+        }
+        self.outputBytesPerFrame = Int(sourceFormat.mBytesPerFrame)
+
+        self.audioBuffer = AudioBuffer(format: sourceFormat, chunkDuration: chunkDuration)
+        self.stages = try OutputStages(
+            sourceFormat: sourceFormat,
+            targetSampleRate: convertToSampleRate,
+            outputFormat: outputFormat,
+            quality: resampleQuality
+        )
+        outputHandler.configure(sourceFormat: sourceFormat, stages: stages)
+
+        // Allocated last so a throwing init has nothing to free
+        var sourceConfig = config
+        guard let source = virtual_source_create(&sourceConfig) else {
+            throw AudioTeeError.setupFailed
+        }
+        self.source = source
+        if channelMatrix == nil && isMono && config.channels > 1 {
+            mixScratch = UnsafeMutablePointer<Float>.allocate(capacity: Int(config.framesPerPacket))
+        }
+    }
+
+    deinit {
+        virtual_source_destroy(source)
+        mixScratch?.deallocate()
+    }
+
+    private static func floatFormat(sampleRate: Double, channels: UInt32) -> AudioStreamBasicDescription {
+        let bytesPerFrame = channels * UInt32(MemoryLayout<Float>.size)
+        return AudioStreamBasicDescription(
+            mSampleRate: sampleRate,
+            mFormatID: kAudioFormatLinearPCM,
+            mFormatFlags: kAudioFormatFlagIsFloat | kAudioFormatFlagIsPacked,
+            mBytesPerPacket: bytesPerFrame,
+            mFramesPerPacket: 1,
+            mBytesPerFrame: bytesPerFrame,
+            mChannelsPerFrame: channels,
+            mBitsPerChannel: 32,
+            mReserved: 0
+        )
+    }
+
+    /// Returns false if the source thread couldn't start
+    func startRecording() -> Bool {
+        outputHandler.handleMetadata(stages.metadata)
+        outputHandler.handleStreamStart()
+
+        // stopRecording() joins the thread before the session lets go of self
+        let recorder = Unmanaged.passUnretained(self).toOpaque()
+        return virtual_source_start(source, { frames, frameCount, hostTimeNs, flags, context in
+            guard let frames = frames, let context = context else { return }
+            let recorder = Unmanaged<VirtualRecorder>.fromOpaque(context).takeUnretainedValue()
+            recorder.handlePacket(frames, frameCount: frameCount, hostTime: hostTimeNs, flags: flags)
+        }, recorder) == 0
+    }
+
+    func stopRecording() {
+        // Joins the source thread, so the end-of-stream flush runs alone
+        virtual_source_stop(source)
+        outputHandler.handleEndOfStream(stages: stages)
+        outputHandler.handleStreamStop()
+    }
+
+    /// Switch chunk size while recording; the source thread applies it before its next packet
+    func setChunkDuration(_ seconds: Double) {
+        chunkLock.lock()
+        pendingChunkDuration = seconds
+        chunkLock.unlock()
+    }
+
+    private func handlePacket(_ frames: UnsafePointer<Float>, frameCount: Int, hostTime: UInt64, flags: UInt32) {
+        chunkLock.lock()
+        let chunkDuration = pendingChunkDuration
+        pendingChunkDuration = nil
+        chunkLock.unlock()
+        if let chunkDuration {
+            audioBuffer.setChunkDuration(chunkDuration)
+        }
+
+        capture_stats_add_packet(outputHandler.session?.stats, UInt64(frameCount), flags)
+
+        var samples = UnsafeRawPointer(frames)
+        var byteCount = frameCount * outputBytesPerFrame
+        if let channelMap = channelMap {
+            let packetBytes = frameCount * Int(sourceChannels) * MemoryLayout<Float>.size
+            (samples, byteCount) = channelMap.apply(samples, byteCount: packetBytes)
+        } else if let mixScratch = mixScratch {
+            dsp_gain_downmix_f32(frames, mixScratch, frameCount, sourceChannels, 1.0)
+            samples = UnsafeRawPointer(mixScratch)
+        }
+        audioBuffer.append(samples, count: byteCount, hostTime: hostTime, flags: flags)
+        audioBuffer.processChunks().forEach { packet in
+            outputHandler.handleSourcePacket(packet, stages: stages)
+        }
+    }
+}
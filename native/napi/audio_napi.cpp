@@ -1,10 +1,21 @@
 #include <napi.h>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
+#include <chrono>
 #include <queue>
 #include <atomic>
 #include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
 #include "audio_bridge.h"
+#include "chunk_pool.h"
+#include "file_writer.h"
+#include "lookback_ring.h"
+#include "shared_ring.h"
+#include "spsc_ring.h"
 
 // Platform-specific includes
 #ifdef _WIN32
@@ -94,19 +105,350 @@ static void DebugLogImpl(const char* format, ...) {
 
 // Forward declarations
 class AudioRecorderWrapper;
+class MicActivityMonitorWrapper;
+
+// Push-mode delivery: capture threads schedule a call into JS through a
+// thread-safe function instead of waiting for the next processEvents() poll.
+static void CallRecorderEventCallback(Napi::Env env, Napi::Function callback,
+                                      AudioRecorderWrapper* self, void* data);
+static void CallMicActivityEventCallback(Napi::Env env, Napi::Function callback,
+                                         MicActivityMonitorWrapper* self, void* data);
+
+using RecorderEventTsfn = Napi::TypedThreadSafeFunction<
+    AudioRecorderWrapper, void, CallRecorderEventCallback>;
+using MicActivityEventTsfn = Napi::TypedThreadSafeFunction<
+    MicActivityMonitorWrapper, void, CallMicActivityEventCallback>;
 
 // Thread-safe queue for events
 struct AudioEvent {
-    int32_t type;          // 0=data, 1=start, 2=stop, 3=error, 4=metadata
-    std::vector<uint8_t> data;
+    int32_t type;          // 0=data, 1=start, 2=stop, 3=error, 4=metadata, 5/6=speech start/stop, 7=level,
+                           // 8=file progress, 9=drop, 10=snapshot
+    ChunkSlabPtr data;     // Pooled chunk, handed to JS without another copy (levels for type 7)
+    std::vector<ChunkSlabPtr> batch;  // Sub-chunks following `data` in the same data event
     std::string message;
     double sampleRate;
     uint32_t channelsPerFrame;
     uint32_t bitsPerChannel;
     bool isFloat;
     std::string encoding;
+    uint64_t bytesWritten;  // File progress
+    uint64_t framesWritten;
+    uint64_t droppedChunks; // File progress, and drops since the last report
+    uint64_t droppedOldest;  // Drop reports
+    uint64_t droppedNewest;
+    uint64_t droppedFrames;
+    bool final;
+};
+
+// Control events (start/stop/error/metadata) take a mutex-protected slow path.
+// Each is tagged with the data ring's write position at the time it was queued
+// so draining can interleave the two queues in the original order.
+struct ControlEvent {
+    uint64_t position;
+    AudioEvent event;
+};
+
+// What the capture thread does when the data ring is full, or holds more than
+// maxQueuedBytes / maxQueuedMs
+enum class OverflowPolicy {
+    DropOldest,  // Discard the oldest queued chunk (default, keeps latency bounded)
+    DropNewest,  // Discard the incoming chunk
+    Block,       // Wait up to kBlockBudgetMs for JS to drain, else DropNewest
+    Pause,       // Discard incoming chunks until JS has drained half the queue,
+                 // so a stall costs one gap rather than a chunk here and there
+};
+
+static const size_t kDefaultQueueCapacity = 256;
+
+// chunkDurationMs / subChunkDurationMs as parsed by a start call, applied
+// once the session is known not to be running
+struct Chunking {
+    double nativeChunkMs = 0;       // Sub-chunk in sub-chunk mode, else the chunk
+    double subChunkDurationMs = 0;  // 0 = off
+    uint32_t batchSubChunks = 1;
 };
 
+// Longest OverflowPolicy::Block waits for JS, about one device period: the
+// capture thread may be a shared worker servicing other streams meanwhile
+static const int kBlockBudgetMs = 10;
+
+// Position, timing and flags of a data or snapshot event
+static void SetChunkFields(Napi::Env env, Napi::Object obj, const AudioChunkInfo& chunk, uint64_t frameCount) {
+    obj.Set("sequence", Napi::Number::New(env, static_cast<double>(chunk.sequence)));
+    obj.Set("framePosition", Napi::Number::New(env, static_cast<double>(chunk.framePosition)));
+    obj.Set("frameCount", Napi::Number::New(env, static_cast<double>(frameCount)));
+    obj.Set("hostTime", Napi::BigInt::New(env, chunk.hostTimeNs));
+    obj.Set("discontinuity", Napi::Boolean::New(env, (chunk.flags & AUDIO_CHUNK_FLAG_DISCONTINUITY) != 0));
+    obj.Set("silent", Napi::Boolean::New(env, (chunk.flags & AUDIO_CHUNK_FLAG_SILENT) != 0));
+}
+
+// { count, meanUs, maxUs, p50Us, p90Us, p99Us } for one stage histogram
+static Napi::Object BuildStageStats(Napi::Env env, const CaptureStageStats& stage) {
+    Napi::Object stats = Napi::Object::New(env);
+    double mean = stage.count > 0 ? static_cast<double>(stage.totalNs) / static_cast<double>(stage.count) : 0;
+    stats.Set("count", Napi::Number::New(env, static_cast<double>(stage.count)));
+    stats.Set("meanUs", Napi::Number::New(env, mean / 1000.0));
+    stats.Set("maxUs", Napi::Number::New(env, static_cast<double>(stage.maxNs) / 1000.0));
+    stats.Set("p50Us", Napi::Number::New(env, static_cast<double>(capture_stats_percentile_ns(&stage, 0.50)) / 1000.0));
+    stats.Set("p90Us", Napi::Number::New(env, static_cast<double>(capture_stats_percentile_ns(&stage, 0.90)) / 1000.0));
+    stats.Set("p99Us", Napi::Number::New(env, static_cast<double>(capture_stats_percentile_ns(&stage, 0.99)) / 1000.0));
+    return stats;
+}
+
+// Read an array of PIDs from options[key]; non-numbers are skipped
+static std::vector<int32_t> ParseProcessList(const Napi::Object& options, const char* key) {
+    std::vector<int32_t> pids;
+    if (options.Has(key) && options.Get(key).IsArray()) {
+        Napi::Array arr = options.Get(key).As<Napi::Array>();
+        for (uint32_t i = 0; i < arr.Length(); i++) {
+            if (arr.Get(i).IsNumber()) {
+                pids.push_back(arr.Get(i).As<Napi::Number>().Int32Value());
+            }
+        }
+    }
+    return pids;
+}
+
+// Read options.outputFormat ({ sampleFormat?: 'f32'|'s16'|'s24', layout?: 'interleaved'|'planar' })
+// into an AUDIO_FORMAT_* value. Throws and returns false on invalid input.
+static bool ParseOutputFormat(Napi::Env env, const Napi::Object& options, int32_t* format) {
+    *format = AUDIO_FORMAT_DEFAULT;
+    if (!options.Has("outputFormat") || options.Get("outputFormat").IsUndefined()) {
+        return true;
+    }
+    if (!options.Get("outputFormat").IsObject()) {
+        Napi::TypeError::New(env, "outputFormat must be an object").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    Napi::Object outputFormat = options.Get("outputFormat").As<Napi::Object>();
+    int32_t sampleFormat = AUDIO_FORMAT_DEFAULT;
+    if (outputFormat.Has("sampleFormat") && outputFormat.Get("sampleFormat").IsString()) {
+        std::string name = outputFormat.Get("sampleFormat").As<Napi::String>().Utf8Value();
+        if (name == "f32") {
+            sampleFormat = AUDIO_FORMAT_F32;
+        } else if (name == "s16") {
+            sampleFormat = AUDIO_FORMAT_S16;
+        } else if (name == "s24") {
+            sampleFormat = AUDIO_FORMAT_S24;
+        } else {
+            Napi::TypeError::New(env, "outputFormat.sampleFormat must be 'f32', 's16' or 's24'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    bool planar = false;
+    if (outputFormat.Has("layout") && outputFormat.Get("layout").IsString()) {
+        std::string layout = outputFormat.Get("layout").As<Napi::String>().Utf8Value();
+        if (layout == "planar") {
+            planar = true;
+        } else if (layout != "interleaved") {
+            Napi::TypeError::New(env, "outputFormat.layout must be 'interleaved' or 'planar'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    int32_t encoding = AUDIO_ENCODING_PCM;
+    if (outputFormat.Has("encoding") && outputFormat.Get("encoding").IsString()) {
+        std::string name = outputFormat.Get("encoding").As<Napi::String>().Utf8Value();
+        if (name == "wav") {
+            encoding = AUDIO_ENCODING_WAV;
+        } else if (name == "flac") {
+            encoding = AUDIO_ENCODING_FLAC;
+        } else if (name == "opus") {
+            encoding = AUDIO_ENCODING_OPUS;
+        } else if (name != "pcm") {
+            Napi::TypeError::New(env, "outputFormat.encoding must be 'pcm', 'wav', 'flac' or 'opus'")
+                .ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    if (encoding != AUDIO_ENCODING_PCM && planar) {
+        Napi::TypeError::New(env, "outputFormat.layout 'planar' can't be combined with an encoding")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    if (encoding == AUDIO_ENCODING_FLAC && sampleFormat == AUDIO_FORMAT_F32) {
+        Napi::TypeError::New(env, "FLAC has no float samples: use sampleFormat 's16' or 's24'")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+
+    // A layout without a sample format still needs a concrete format; f32 loses nothing
+    if (planar && sampleFormat == AUDIO_FORMAT_DEFAULT) {
+        sampleFormat = AUDIO_FORMAT_F32;
+    }
+    *format = sampleFormat | (planar ? AUDIO_FORMAT_PLANAR : 0) | encoding;
+    return true;
+}
+
+// Read options.source ({ sampleRate?, channels?, packetFrames?, signal?, frequency?,
+// amplitude?, seed?, realtime?, durationMs? }) into a VirtualSourceConfig.
+// Throws and returns false on invalid input.
+static bool ParseVirtualSource(Napi::Env env, const Napi::Object& options, VirtualSourceConfig* config) {
+    *config = VirtualSourceConfig{};
+    config->sampleRate = 48000;
+    config->channels = 2;
+    config->framesPerPacket = 480;
+    config->signal = VIRTUAL_SIGNAL_SINE;
+    config->frequency = 440;
+    config->amplitude = 0.5;
+    config->realtime = true;
+
+    if (!options.Has("source") || options.Get("source").IsUndefined()) {
+        return true;
+    }
+    if (!options.Get("source").IsObject()) {
+        Napi::TypeError::New(env, "source must be an object").ThrowAsJavaScriptException();
+        return false;
+    }
+    Napi::Object source = options.Get("source").As<Napi::Object>();
+
+    auto number = [&](const char* key, double* value) {
+        if (source.Has(key) && source.Get(key).IsNumber()) {
+            *value = source.Get(key).As<Napi::Number>().DoubleValue();
+        }
+    };
+    double channels = config->channels;
+    double packetFrames = config->framesPerPacket;
+    double seed = 0;
+    double durationMs = 0;
+    number("sampleRate", &config->sampleRate);
+    number("channels", &channels);
+    number("packetFrames", &packetFrames);
+    number("frequency", &config->frequency);
+    number("amplitude", &config->amplitude);
+    number("seed", &seed);
+    number("durationMs", &durationMs);
+
+    if (!(config->sampleRate >= 1000 && config->sampleRate <= 768000)) {
+        Napi::RangeError::New(env, "source.sampleRate must be between 1000 and 768000").ThrowAsJavaScriptException();
+        return false;
+    }
+    if (!(channels >= 1 && channels <= 64)) {
+        Napi::RangeError::New(env, "source.channels must be between 1 and 64").ThrowAsJavaScriptException();
+        return false;
+    }
+    if (!(packetFrames >= 1 && packetFrames <= config->sampleRate)) {
+        Napi::RangeError::New(env, "source.packetFrames must be between 1 and one second of frames")
+            .ThrowAsJavaScriptException();
+        return false;
+    }
+    if (!(durationMs >= 0)) {
+        Napi::RangeError::New(env, "source.durationMs must not be negative").ThrowAsJavaScriptException();
+        return false;
+    }
+    config->channels = static_cast<uint32_t>(channels);
+    config->framesPerPacket = static_cast<uint32_t>(packetFrames);
+    config->seed = static_cast<uint32_t>(seed);
+    config->totalFrames = static_cast<uint64_t>(durationMs / 1000.0 * config->sampleRate);
+
+    if (source.Has("signal") && source.Get("signal").IsString()) {
+        std::string signal = source.Get("signal").As<Napi::String>().Utf8Value();
+        if (signal == "sine") {
+            config->signal = VIRTUAL_SIGNAL_SINE;
+        } else if (signal == "noise") {
+            config->signal = VIRTUAL_SIGNAL_NOISE;
+        } else if (signal == "silence") {
+            config->signal = VIRTUAL_SIGNAL_SILENCE;
+        } else {
+            Napi::TypeError::New(env, "source.signal must be 'sine', 'noise' or 'silence'").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+    if (source.Has("realtime") && source.Get("realtime").IsBoolean()) {
+        config->realtime = source.Get("realtime").As<Napi::Boolean>().Value();
+    }
+    return true;
+}
+
+// Read options.channels (channel indexes to keep, in output order) or
+// options.channelMatrix (one row of input weights per output channel) into a
+// row-major matrix for audio_set_channel_matrix. Neither leaves *outputs at 0.
+// Throws and returns false on invalid input.
+static bool ParseChannelMap(Napi::Env env, const Napi::Object& options, std::vector<float>* weights,
+                            uint32_t* outputs, uint32_t* inputs) {
+    weights->clear();
+    *outputs = 0;
+    *inputs = 0;
+    bool hasChannels = options.Has("channels") && !options.Get("channels").IsUndefined();
+    bool hasMatrix = options.Has("channelMatrix") && !options.Get("channelMatrix").IsUndefined();
+    if (hasChannels && hasMatrix) {
+        Napi::TypeError::New(env, "Use either channels or channelMatrix, not both").ThrowAsJavaScriptException();
+        return false;
+    }
+
+    if (hasChannels) {
+        if (!options.Get("channels").IsArray()) {
+            Napi::TypeError::New(env, "channels must be an array of channel indexes").ThrowAsJavaScriptException();
+            return false;
+        }
+        Napi::Array channels = options.Get("channels").As<Napi::Array>();
+        uint32_t count = channels.Length();
+        if (count == 0 || count > AUDIO_CHANNEL_MATRIX_MAX) {
+            Napi::RangeError::New(env, "channels must list between 1 and 64 channels").ThrowAsJavaScriptException();
+            return false;
+        }
+        std::vector<uint32_t> picks(count);
+        for (uint32_t i = 0; i < count; i++) {
+            Napi::Value value = channels.Get(i);
+            double index = value.IsNumber() ? value.As<Napi::Number>().DoubleValue() : -1;
+            if (!(index >= 0 && index < AUDIO_CHANNEL_MATRIX_MAX) || index != static_cast<uint32_t>(index)) {
+                Napi::RangeError::New(env, "channels must hold integer indexes between 0 and 63")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+            picks[i] = static_cast<uint32_t>(index);
+            *inputs = std::max(*inputs, picks[i] + 1);
+        }
+        weights->assign(static_cast<size_t>(count) * *inputs, 0.0f);
+        for (uint32_t i = 0; i < count; i++) {
+            (*weights)[static_cast<size_t>(i) * *inputs + picks[i]] = 1.0f;
+        }
+        *outputs = count;
+        return true;
+    }
+
+    if (hasMatrix) {
+        Napi::Value value = options.Get("channelMatrix");
+        Napi::Array rows = value.IsArray() ? value.As<Napi::Array>() : Napi::Array::New(env);
+        uint32_t count = rows.Length();
+        if (count == 0 || count > AUDIO_CHANNEL_MATRIX_MAX) {
+            Napi::RangeError::New(env, "channelMatrix must have between 1 and 64 rows").ThrowAsJavaScriptException();
+            return false;
+        }
+        for (uint32_t o = 0; o < count; o++) {
+            Napi::Value row = rows.Get(o);
+            uint32_t width = row.IsArray() ? row.As<Napi::Array>().Length() : 0;
+            if (width == 0 || width > AUDIO_CHANNEL_MATRIX_MAX) {
+                Napi::RangeError::New(env, "channelMatrix rows must hold between 1 and 64 weights")
+                    .ThrowAsJavaScriptException();
+                return false;
+            }
+            *inputs = std::max(*inputs, width);
+        }
+        // Short rows are padded with zeros
+        weights->assign(static_cast<size_t>(count) * *inputs, 0.0f);
+        for (uint32_t o = 0; o < count; o++) {
+            Napi::Array row = rows.Get(o).As<Napi::Array>();
+            for (uint32_t i = 0; i < row.Length(); i++) {
+                Napi::Value weight = row.Get(i);
+                double w = weight.IsNumber() ? weight.As<Napi::Number>().DoubleValue() : NAN;
+                if (!std::isfinite(w)) {
+                    Napi::TypeError::New(env, "channelMatrix weights must be finite numbers").ThrowAsJavaScriptException();
+                    return false;
+                }
+                (*weights)[static_cast<size_t>(o) * *inputs + i] = static_cast<float>(w);
+            }
+        }
+        *outputs = count;
+    }
+    return true;
+}
+
 class AudioRecorderWrapper : public Napi::ObjectWrap<AudioRecorderWrapper> {
 public:
     static Napi::Object Init(Napi::Env env, Napi::Object exports);
@@ -119,25 +461,167 @@ private:
     // Instance methods
     Napi::Value StartSystemAudio(const Napi::CallbackInfo& info);
     Napi::Value StartMicrophone(const Napi::CallbackInfo& info);
+    Napi::Value StartCombined(const Napi::CallbackInfo& info);
+    Napi::Value StartVirtual(const Napi::CallbackInfo& info);
+    Napi::Value Prepare(const Napi::CallbackInfo& info);
+    Napi::Value ReleasePrepared(const Napi::CallbackInfo& info);
     Napi::Value Stop(const Napi::CallbackInfo& info);
     Napi::Value IsRunning(const Napi::CallbackInfo& info);
     Napi::Value ProcessEvents(const Napi::CallbackInfo& info);
+    Napi::Value SetEventCallback(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
+    Napi::Value SetOption(const Napi::CallbackInfo& info);
+    Napi::Value SetFileSink(const Napi::CallbackInfo& info);
+    Napi::Value SetSharedRing(const Napi::CallbackInfo& info);
+    Napi::Value Pause(const Napi::CallbackInfo& info);
+    Napi::Value Resume(const Napi::CallbackInfo& info);
+    Napi::Value SetListening(const Napi::CallbackInfo& info);
+    Napi::Value Snapshot(const Napi::CallbackInfo& info);
 
     // Callbacks from Swift
     static void OnData(const uint8_t* data, int32_t length, void* context);
+    static void OnChunk(const uint8_t* data, int32_t length, const AudioChunkInfo* info, void* context);
+    static void OnLevels(const AudioLevels* levels, const AudioChunkInfo* info, void* context);
     static void OnEvent(int32_t eventType, const char* message, void* context);
     static void OnMetadata(double sampleRate, uint32_t channelsPerFrame,
                           uint32_t bitsPerChannel, bool isFloat,
                           const char* encoding, void* context);
 
+    // Callbacks from the file writer thread
+    static void OnFileProgress(uint64_t bytesWritten, uint64_t framesWritten, uint64_t droppedChunks,
+                               bool final, void* context);
+    static void OnFileError(const char* message, void* context);
+    void CloseFileSink();
+
+    // Shared ring: wake Atomics.wait() readers from the JS thread
+    void NotifySharedRing(Napi::Env env);
+    void CloseSharedRing();
+
+    // Lookback: answer pre-roll and snapshot requests on the capture thread
+    void FeedLookback(const uint8_t* data, size_t length, const AudioChunkInfo& info, bool delivered);
+    void QueueSnapshot(double ms);
+    void ReserveLookbackSlab();
+    void ReleaseLookbackSlab();
+
+    // Start*: refuse a running session before touching capture-thread state,
+    // then reset what the previous session left behind
+    bool CheckNotRunning(Napi::Env env);
+    void ResetSessionState(const Chunking& chunking, const std::vector<float>& channelMatrix,
+                           uint32_t matrixOutputs, uint32_t matrixInputs);
+
+    // Sub-chunk mode (see ParseChunking)
+    bool ParseChunking(Napi::Env env, const Napi::Object& options, Chunking* chunking);
+    void BatchSubChunks(std::vector<AudioEvent>& events) const;
+
     // Queue management
+    void QueueData(const uint8_t* data, size_t length, const AudioChunkInfo* info,
+                   const AudioLevels* levels = nullptr, bool fromLookback = false);
     void QueueEvent(AudioEvent event);
-    std::vector<AudioEvent> DrainEvents();
+    bool WaitForDrain(size_t length, uint64_t frames);
+    void WakeProducer();
+    bool QueueOverLimit(size_t length, uint64_t frames) const;
+    bool QueueBelowResumeMark() const;
+    void ReleaseQueued(const ChunkSlab* slab);
+    void DropQueued(const ChunkSlab* slab, std::atomic<uint64_t>& counter);
+    bool TakeDropReport(AudioEvent* event);
+    std::vector<AudioEvent> DrainEvents(size_t maxEvents = SIZE_MAX);
+    Napi::Array BuildEventArray(Napi::Env env, std::vector<AudioEvent>& events);
+    Napi::Object BuildEvent(Napi::Env env, AudioEvent& event);
+    Napi::Object BuildPackedData(Napi::Env env, std::vector<AudioEvent>& events, size_t begin, size_t end);
+
+    // Push delivery
+    friend void CallRecorderEventCallback(Napi::Env env, Napi::Function callback,
+                                          AudioRecorderWrapper* self, void* data);
+    void SchedulePush();
+    void ScheduleQueuedEvents();
+    void ReleaseEventCallback();
+
+    AudioRecorderHandle handle_ = nullptr;
+    std::atomic<bool> isDestroyed_{false};
+
+    // Data path: wait-free ring of pooled slabs (capture thread -> JS thread)
+    std::unique_ptr<SpscRing<ChunkSlab*>> dataRing_;
+    std::shared_ptr<ChunkPool> chunkPool_;
+    OverflowPolicy overflowPolicy_ = OverflowPolicy::DropOldest;
+    std::atomic<bool> unblockProducer_{false};
+
+    // OverflowPolicy::Block: the producer waits on drainCond_, which
+    // DrainEvents() signals when producerWaiting_ is set
+    std::mutex drainMutex_;
+    std::condition_variable drainCond_;
+    std::atomic<bool> producerWaiting_{false};
+    bool blockTimedOut_ = false;  // Producer only: drop without waiting until a chunk fits again
 
-    AudioRecorderHandle handle_;
+    // Control path: rare events, mutex is fine here
     std::mutex eventMutex_;
-    std::queue<AudioEvent> eventQueue_;
-    std::atomic<bool> isDestroyed_{false};
+    std::queue<ControlEvent> controlQueue_;
+
+    // Queue counters (written by the producer, read by getStats)
+    std::atomic<uint64_t> droppedOldest_{0};
+    std::atomic<uint64_t> droppedNewest_{0};
+    std::atomic<uint64_t> droppedFrames_{0};
+    std::atomic<uint64_t> blockedWrites_{0};
+    std::atomic<size_t> peakQueued_{0};
+
+    // Flow control: what the ring holds, bounded besides its chunk capacity.
+    // Only data chunks count toward frames; level reports carry none.
+    uint64_t maxQueuedBytes_ = 0;               // 0 = no limit
+    double maxQueuedMs_ = 0;                    // 0 = no limit
+    std::atomic<uint64_t> maxQueuedFrames_{0};  // maxQueuedMs_ at the stream's rate
+    std::atomic<uint64_t> queuedBytes_{0};
+    std::atomic<uint64_t> queuedFrames_{0};
+    bool overflowPaused_ = false;               // Producer only, for OverflowPolicy::Pause
+    uint64_t reportedOldest_ = 0;               // JS thread: drops already in a drop event
+    uint64_t reportedNewest_ = 0;
+    uint64_t reportedFrames_ = 0;
+
+    // pause(): chunks keep queueing (under the policy) but nothing is delivered
+    std::atomic<bool> deliveryPaused_{false};
+
+    // Queue-to-JS latency (CAPTURE_STAGE_DELIVERY); the native layer times the rest
+    CaptureStats* deliveryStats_ = nullptr;
+
+    // Direct-to-disk recording: chunks go to the writer instead of JS.
+    // Only replaced while no session is running.
+    std::unique_ptr<FileWriter> fileWriter_;
+
+    // Shared-memory export: chunks are written into a SharedArrayBuffer or a
+    // named segment instead of the JS queue. Only replaced while not running.
+    SharedRingWriter sharedRing_;
+    std::unique_ptr<SharedMemorySegment> sharedSegment_;
+    Napi::Reference<Napi::Int32Array> sharedRingArray_;  // Keeps the SharedArrayBuffer alive
+    Napi::FunctionReference atomicsNotify_;
+    std::atomic<bool> sharedRingNotify_{false};
+
+    // Lookback: the last lookbackMs_ of chunks, kept natively. While listening
+    // they go only there; a pre-roll (setListening(false, ms)) or snapshot
+    // request is answered from it at the next chunk, on the capture thread.
+    LookbackRing lookback_;               // Capture thread while running, JS thread otherwise
+    double lookbackMs_ = 0;               // 0 = off; only changed while not running
+    std::atomic<bool> listening_{false};
+    std::atomic<int64_t> preRollMs_{-1};  // Pending pre-roll, published before listening_ clears
+    std::atomic<int64_t> snapshotMs_{-1}; // Pending snapshot
+    // A slab the size of a whole Collect(), reserved by the JS thread before
+    // each request and taken by the capture thread to queue the answer;
+    // pooled slabs are only chunk-sized
+    std::atomic<ChunkSlab*> lookbackSlab_{nullptr};
+    size_t lookbackSlabBytes_ = 0;                 // Its capacity; JS thread only
+    std::atomic<size_t> lookbackCollectBytes_{0};  // lookback_.MaxCollectBytes(), kept by its user
+
+    // Sub-chunk mode: chunks of subChunkDurationMs_ are captured natively and
+    // up to batchSubChunks_ contiguous ones reach JS as one data event
+    double subChunkDurationMs_ = 0;           // 0 = off; JS thread only
+    std::atomic<uint32_t> batchSubChunks_{1};
+    std::atomic<uint32_t> unbatchedSubChunks_{0}; // Queued since the last push
+    std::atomic<uint32_t> unbatchedLevels_{0};
+
+    // Packed delivery: runs of data events reach JS as one Buffer plus an index
+    bool packData_ = false;
+
+    RecorderEventTsfn eventTsfn_;
+    std::atomic<bool> pushEnabled_{false};
+    std::atomic<bool> pushPending_{false};
+    bool coalesceEvents_ = true;
 };
 
 Napi::FunctionReference AudioRecorderWrapper::constructor;
@@ -148,9 +632,22 @@ Napi::Object AudioRecorderWrapper::Init(Napi::Env env, Napi::Object exports) {
     Napi::Function func = DefineClass(env, "AudioRecorderNative", {
         InstanceMethod("startSystemAudio", &AudioRecorderWrapper::StartSystemAudio),
         InstanceMethod("startMicrophone", &AudioRecorderWrapper::StartMicrophone),
+        InstanceMethod("startCombined", &AudioRecorderWrapper::StartCombined),
+        InstanceMethod("startVirtual", &AudioRecorderWrapper::StartVirtual),
+        InstanceMethod("prepare", &AudioRecorderWrapper::Prepare),
+        InstanceMethod("releasePrepared", &AudioRecorderWrapper::ReleasePrepared),
         InstanceMethod("stop", &AudioRecorderWrapper::Stop),
         InstanceMethod("isRunning", &AudioRecorderWrapper::IsRunning),
         InstanceMethod("processEvents", &AudioRecorderWrapper::ProcessEvents),
+        InstanceMethod("setEventCallback", &AudioRecorderWrapper::SetEventCallback),
+        InstanceMethod("getStats", &AudioRecorderWrapper::GetStats),
+        InstanceMethod("setOption", &AudioRecorderWrapper::SetOption),
+        InstanceMethod("setFileSink", &AudioRecorderWrapper::SetFileSink),
+        InstanceMethod("setSharedRing", &AudioRecorderWrapper::SetSharedRing),
+        InstanceMethod("pause", &AudioRecorderWrapper::Pause),
+        InstanceMethod("resume", &AudioRecorderWrapper::Resume),
+        InstanceMethod("setListening", &AudioRecorderWrapper::SetListening),
+        InstanceMethod("snapshot", &AudioRecorderWrapper::Snapshot),
     });
 
     constructor = Napi::Persistent(func);
@@ -160,10 +657,79 @@ Napi::Object AudioRecorderWrapper::Init(Napi::Env env, Napi::Object exports) {
     return exports;
 }
 
+// new AudioRecorderNative({ queueCapacity?, overflowPolicy?, maxQueuedBytes?, maxQueuedMs?, packData? })
 AudioRecorderWrapper::AudioRecorderWrapper(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<AudioRecorderWrapper>(info) {
     Napi::Env env = info.Env();
 
+    // Validate into locals first: a throw here leaves the members untouched
+    // and ObjectWrap deletes the half-built wrapper straight away
+    size_t queueCapacity = kDefaultQueueCapacity;
+    OverflowPolicy overflowPolicy = OverflowPolicy::DropOldest;
+    uint64_t maxQueuedBytes = 0;
+    double maxQueuedMs = 0;
+    bool packData = false;
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object options = info[0].As<Napi::Object>();
+
+        if (options.Has("queueCapacity") && options.Get("queueCapacity").IsNumber()) {
+            int64_t capacity = options.Get("queueCapacity").As<Napi::Number>().Int64Value();
+            if (capacity < 1) {
+                Napi::RangeError::New(env, "queueCapacity must be at least 1").ThrowAsJavaScriptException();
+                return;
+            }
+            queueCapacity = static_cast<size_t>(capacity);
+        }
+
+        if (options.Has("overflowPolicy") && options.Get("overflowPolicy").IsString()) {
+            std::string policy = options.Get("overflowPolicy").As<Napi::String>().Utf8Value();
+            if (policy == "drop-oldest") {
+                overflowPolicy = OverflowPolicy::DropOldest;
+            } else if (policy == "drop-newest") {
+                overflowPolicy = OverflowPolicy::DropNewest;
+            } else if (policy == "block") {
+                overflowPolicy = OverflowPolicy::Block;
+            } else if (policy == "pause") {
+                overflowPolicy = OverflowPolicy::Pause;
+            } else {
+                Napi::TypeError::New(env, "overflowPolicy must be 'drop-oldest', 'drop-newest', 'block' or 'pause'")
+                    .ThrowAsJavaScriptException();
+                return;
+            }
+        }
+
+        if (options.Has("maxQueuedBytes") && options.Get("maxQueuedBytes").IsNumber()) {
+            double bytes = options.Get("maxQueuedBytes").As<Napi::Number>().DoubleValue();
+            if (!(bytes >= 0)) {
+                Napi::RangeError::New(env, "maxQueuedBytes must not be negative").ThrowAsJavaScriptException();
+                return;
+            }
+            maxQueuedBytes = static_cast<uint64_t>(bytes);
+        }
+
+        if (options.Has("maxQueuedMs") && options.Get("maxQueuedMs").IsNumber()) {
+            maxQueuedMs = options.Get("maxQueuedMs").As<Napi::Number>().DoubleValue();
+            if (!(maxQueuedMs >= 0)) {
+                Napi::RangeError::New(env, "maxQueuedMs must not be negative").ThrowAsJavaScriptException();
+                return;
+            }
+        }
+
+        if (options.Has("packData") && options.Get("packData").IsBoolean()) {
+            packData = options.Get("packData").As<Napi::Boolean>().Value();
+        }
+    }
+
+    overflowPolicy_ = overflowPolicy;
+    maxQueuedBytes_ = maxQueuedBytes;
+    maxQueuedMs_ = maxQueuedMs;
+    packData_ = packData;
+
+    dataRing_.reset(new SpscRing<ChunkSlab*>(queueCapacity));
+    // Room for a full ring plus the chunks JS is still holding on to
+    chunkPool_ = ChunkPool::Create(queueCapacity + 16);
+    deliveryStats_ = capture_stats_create();
+
     handle_ = audio_create(
         &AudioRecorderWrapper::OnData,
         &AudioRecorderWrapper::OnEvent,
@@ -173,15 +739,90 @@ AudioRecorderWrapper::AudioRecorderWrapper(const Napi::CallbackInfo& info)
 
     if (!handle_) {
         Napi::Error::New(env, "Failed to create AudioRecorder session").ThrowAsJavaScriptException();
+        return;
     }
+
+    // Receive chunks with timing; OnData stays as the fallback path
+    audio_set_chunk_callback(handle_, &AudioRecorderWrapper::OnChunk);
+    // Only called while the "levels" option is on
+    audio_set_level_callback(handle_, &AudioRecorderWrapper::OnLevels);
 }
 
 AudioRecorderWrapper::~AudioRecorderWrapper() {
     isDestroyed_ = true;
+    WakeProducer();
     if (handle_) {
         audio_destroy(handle_);
         handle_ = nullptr;
     }
+    CloseFileSink();
+    CloseSharedRing();
+    ReleaseEventCallback();
+    ReleaseLookbackSlab();
+
+    // Return undelivered chunks to the pool
+    ChunkSlab* slab = nullptr;
+    while (dataRing_ && dataRing_->TryPop(slab)) {
+        ChunkSlabRecycler()(slab);
+    }
+    capture_stats_destroy(deliveryStats_);
+}
+
+// Read chunkDurationMs and subChunkDurationMs. With a sub-chunk duration the
+// native layer captures (gates, meters, encodes) sub-chunks of that size, and
+// chunkDurationMs only sets how many contiguous ones are batched into each
+// data event. Throws and returns false on invalid input.
+bool AudioRecorderWrapper::ParseChunking(Napi::Env env, const Napi::Object& options, Chunking* chunking) {
+    double chunkDurationMs = 200;
+    if (options.Has("chunkDurationMs") && options.Get("chunkDurationMs").IsNumber()) {
+        chunkDurationMs = options.Get("chunkDurationMs").As<Napi::Number>().DoubleValue();
+    }
+
+    double subChunkDurationMs = 0;
+    if (options.Has("subChunkDurationMs") && options.Get("subChunkDurationMs").IsNumber()) {
+        subChunkDurationMs = options.Get("subChunkDurationMs").As<Napi::Number>().DoubleValue();
+        if (!(subChunkDurationMs > 0)) {
+            Napi::RangeError::New(env, "subChunkDurationMs must be positive").ThrowAsJavaScriptException();
+            return false;
+        }
+    }
+
+    chunking->subChunkDurationMs = subChunkDurationMs;
+    if (subChunkDurationMs > 0) {
+        double subChunks = std::round(chunkDurationMs / subChunkDurationMs);
+        chunking->batchSubChunks = static_cast<uint32_t>(std::max(1.0, subChunks));
+        chunking->nativeChunkMs = subChunkDurationMs;
+    } else {
+        chunking->batchSubChunks = 1;
+        chunking->nativeChunkMs = chunkDurationMs;
+    }
+    return true;
+}
+
+// While recording, the capture thread owns the lookback ring, the producer
+// flags and the live config, so a start on a running session must not reach
+// ResetSessionState()
+bool AudioRecorderWrapper::CheckNotRunning(Napi::Env env) {
+    if (audio_is_running(handle_)) {
+        Napi::Error::New(env, "Already recording").ThrowAsJavaScriptException();
+        return false;
+    }
+    return true;
+}
+
+void AudioRecorderWrapper::ResetSessionState(const Chunking& chunking, const std::vector<float>& channelMatrix,
+                                             uint32_t matrixOutputs, uint32_t matrixInputs) {
+    subChunkDurationMs_ = chunking.subChunkDurationMs;
+    batchSubChunks_ = chunking.batchSubChunks;
+    unbatchedSubChunks_ = 0;
+    unbatchedLevels_ = 0;
+    unblockProducer_ = false;
+    overflowPaused_ = false;
+    lookback_.Clear();
+    preRollMs_ = -1;
+    snapshotMs_ = -1;
+    capture_stats_reset(deliveryStats_);
+    audio_set_channel_matrix(handle_, channelMatrix.empty() ? nullptr : channelMatrix.data(), matrixOutputs, matrixInputs);
 }
 
 Napi::Value AudioRecorderWrapper::StartSystemAudio(const Napi::CallbackInfo& info) {
@@ -192,6 +833,10 @@ Napi::Value AudioRecorderWrapper::StartSystemAudio(const Napi::CallbackInfo& inf
         return env.Null();
     }
 
+    if (!CheckNotRunning(env)) {
+        return env.Null();
+    }
+
     Napi::Object options = info[0].As<Napi::Object>();
 
     // Extract options with defaults
@@ -200,9 +845,9 @@ Napi::Value AudioRecorderWrapper::StartSystemAudio(const Napi::CallbackInfo& inf
         sampleRate = options.Get("sampleRate").As<Napi::Number>().DoubleValue();
     }
 
-    double chunkDurationMs = 200;
-    if (options.Has("chunkDurationMs") && options.Get("chunkDurationMs").IsNumber()) {
-        chunkDurationMs = options.Get("chunkDurationMs").As<Napi::Number>().DoubleValue();
+    Chunking chunking;
+    if (!ParseChunking(env, options, &chunking)) {
+        return env.Null();
     }
 
     bool mute = false;
@@ -221,38 +866,37 @@ Napi::Value AudioRecorderWrapper::StartSystemAudio(const Napi::CallbackInfo& inf
     }
 
     // Handle process arrays
-    std::vector<int32_t> includeProcesses;
-    std::vector<int32_t> excludeProcesses;
+    std::vector<int32_t> includeProcesses = ParseProcessList(options, "includeProcesses");
+    std::vector<int32_t> excludeProcesses = ParseProcessList(options, "excludeProcesses");
 
-    if (options.Has("includeProcesses") && options.Get("includeProcesses").IsArray()) {
-        Napi::Array arr = options.Get("includeProcesses").As<Napi::Array>();
-        for (uint32_t i = 0; i < arr.Length(); i++) {
-            if (arr.Get(i).IsNumber()) {
-                includeProcesses.push_back(arr.Get(i).As<Napi::Number>().Int32Value());
-            }
-        }
+    int32_t outputFormat;
+    if (!ParseOutputFormat(env, options, &outputFormat)) {
+        return env.Null();
     }
 
-    if (options.Has("excludeProcesses") && options.Get("excludeProcesses").IsArray()) {
-        Napi::Array arr = options.Get("excludeProcesses").As<Napi::Array>();
-        for (uint32_t i = 0; i < arr.Length(); i++) {
-            if (arr.Get(i).IsNumber()) {
-                excludeProcesses.push_back(arr.Get(i).As<Napi::Number>().Int32Value());
-            }
-        }
+    std::vector<float> channelMatrix;
+    uint32_t matrixOutputs, matrixInputs;
+    if (!ParseChannelMap(env, options, &channelMatrix, &matrixOutputs, &matrixInputs)) {
+        return env.Null();
+    }
+    if (matrixOutputs > 0) {
+        isMono = false;  // The map sees every device channel
     }
 
+    ResetSessionState(chunking, channelMatrix, matrixOutputs, matrixInputs);
+
     int32_t result = audio_start_system_audio(
         handle_,
         sampleRate,
-        chunkDurationMs,
+        chunking.nativeChunkMs,
         mute,
         isMono,
         emitSilence,
         includeProcesses.empty() ? nullptr : includeProcesses.data(),
         static_cast<int32_t>(includeProcesses.size()),
         excludeProcesses.empty() ? nullptr : excludeProcesses.data(),
-        static_cast<int32_t>(excludeProcesses.size())
+        static_cast<int32_t>(excludeProcesses.size()),
+        outputFormat
     );
 
     if (result != 0) {
@@ -272,6 +916,10 @@ Napi::Value AudioRecorderWrapper::StartMicrophone(const Napi::CallbackInfo& info
         return env.Null();
     }
 
+    if (!CheckNotRunning(env)) {
+        return env.Null();
+    }
+
     Napi::Object options = info[0].As<Napi::Object>();
 
     // Extract options with defaults
@@ -280,9 +928,9 @@ Napi::Value AudioRecorderWrapper::StartMicrophone(const Napi::CallbackInfo& info
         sampleRate = options.Get("sampleRate").As<Napi::Number>().DoubleValue();
     }
 
-    double chunkDurationMs = 200;
-    if (options.Has("chunkDurationMs") && options.Get("chunkDurationMs").IsNumber()) {
-        chunkDurationMs = options.Get("chunkDurationMs").As<Napi::Number>().DoubleValue();
+    Chunking chunking;
+    if (!ParseChunking(env, options, &chunking)) {
+        return env.Null();
     }
 
     bool isMono = true;
@@ -307,14 +955,31 @@ Napi::Value AudioRecorderWrapper::StartMicrophone(const Napi::CallbackInfo& info
         gain = options.Get("gain").As<Napi::Number>().DoubleValue();
     }
 
+    int32_t outputFormat;
+    if (!ParseOutputFormat(env, options, &outputFormat)) {
+        return env.Null();
+    }
+
+    std::vector<float> channelMatrix;
+    uint32_t matrixOutputs, matrixInputs;
+    if (!ParseChannelMap(env, options, &channelMatrix, &matrixOutputs, &matrixInputs)) {
+        return env.Null();
+    }
+    if (matrixOutputs > 0) {
+        isMono = false;  // The map sees every device channel
+    }
+
+    ResetSessionState(chunking, channelMatrix, matrixOutputs, matrixInputs);
+
     int32_t result = audio_start_microphone(
         handle_,
         sampleRate,
-        chunkDurationMs,
+        chunking.nativeChunkMs,
         isMono,
         emitSilence,
         deviceUID,
-        gain
+        gain,
+        outputFormat
     );
 
     if (result != 0) {
@@ -326,75 +991,1087 @@ Napi::Value AudioRecorderWrapper::StartMicrophone(const Napi::CallbackInfo& info
     return env.Undefined();
 }
 
-Napi::Value AudioRecorderWrapper::Stop(const Napi::CallbackInfo& info) {
+Napi::Value AudioRecorderWrapper::StartCombined(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
-    int32_t result = audio_stop(handle_);
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!CheckNotRunning(env)) {
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    // Extract options with defaults
+    double sampleRate = 0;
+    if (options.Has("sampleRate") && options.Get("sampleRate").IsNumber()) {
+        sampleRate = options.Get("sampleRate").As<Napi::Number>().DoubleValue();
+    }
+
+    Chunking chunking;
+    if (!ParseChunking(env, options, &chunking)) {
+        return env.Null();
+    }
+
+    bool mute = false;
+    if (options.Has("mute") && options.Get("mute").IsBoolean()) {
+        mute = options.Get("mute").As<Napi::Boolean>().Value();
+    }
+
+    std::vector<int32_t> includeProcesses = ParseProcessList(options, "includeProcesses");
+    std::vector<int32_t> excludeProcesses = ParseProcessList(options, "excludeProcesses");
+
+    const char* deviceUID = nullptr;
+    std::string deviceUIDStr;
+    if (options.Has("deviceId") && options.Get("deviceId").IsString()) {
+        deviceUIDStr = options.Get("deviceId").As<Napi::String>().Utf8Value();
+        deviceUID = deviceUIDStr.c_str();
+    }
+
+    double gain = 1.0;
+    if (options.Has("gain") && options.Get("gain").IsNumber()) {
+        gain = options.Get("gain").As<Napi::Number>().DoubleValue();
+    }
+
+    int32_t outputFormat;
+    if (!ParseOutputFormat(env, options, &outputFormat)) {
+        return env.Null();
+    }
+
+    std::vector<float> channelMatrix;
+    uint32_t matrixOutputs, matrixInputs;
+    if (!ParseChannelMap(env, options, &channelMatrix, &matrixOutputs, &matrixInputs)) {
+        return env.Null();
+    }
+
+    ResetSessionState(chunking, channelMatrix, matrixOutputs, matrixInputs);
+
+    int32_t result = audio_start_combined(
+        handle_,
+        sampleRate,
+        chunking.nativeChunkMs,
+        mute,
+        includeProcesses.empty() ? nullptr : includeProcesses.data(),
+        static_cast<int32_t>(includeProcesses.size()),
+        excludeProcesses.empty() ? nullptr : excludeProcesses.data(),
+        static_cast<int32_t>(excludeProcesses.size()),
+        deviceUID,
+        gain,
+        outputFormat
+    );
+
     if (result != 0) {
-        Napi::Error::New(env, "Failed to stop recording").ThrowAsJavaScriptException();
+        std::string errorMsg = "Failed to start combined recording: error code " + std::to_string(result);
+        Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+        return env.Null();
     }
 
     return env.Undefined();
 }
 
-Napi::Value AudioRecorderWrapper::IsRunning(const Napi::CallbackInfo& info) {
-    return Napi::Boolean::New(info.Env(), audio_is_running(handle_));
+// startVirtual({ sampleRate?, chunkDurationMs?, subChunkDurationMs?, stereo?, channels?, channelMatrix?,
+//                outputFormat?, source? })
+Napi::Value AudioRecorderWrapper::StartVirtual(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsObject()) {
+        Napi::TypeError::New(env, "Options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (!CheckNotRunning(env)) {
+        return env.Null();
+    }
+
+    Napi::Object options = info[0].As<Napi::Object>();
+
+    double sampleRate = 0;
+    if (options.Has("sampleRate") && options.Get("sampleRate").IsNumber()) {
+        sampleRate = options.Get("sampleRate").As<Napi::Number>().DoubleValue();
+    }
+
+    Chunking chunking;
+    if (!ParseChunking(env, options, &chunking)) {
+        return env.Null();
+    }
+
+    bool isMono = true;
+    if (options.Has("stereo") && options.Get("stereo").IsBoolean()) {
+        isMono = !options.Get("stereo").As<Napi::Boolean>().Value();
+    }
+
+    int32_t outputFormat;
+    if (!ParseOutputFormat(env, options, &outputFormat)) {
+        return env.Null();
+    }
+
+    VirtualSourceConfig source;
+    if (!ParseVirtualSource(env, options, &source)) {
+        return env.Null();
+    }
+
+    std::vector<float> channelMatrix;
+    uint32_t matrixOutputs, matrixInputs;
+    if (!ParseChannelMap(env, options, &channelMatrix, &matrixOutputs, &matrixInputs)) {
+        return env.Null();
+    }
+    if (matrixOutputs > 0) {
+        isMono = false;  // The map sees every source channel
+    }
+
+    ResetSessionState(chunking, channelMatrix, matrixOutputs, matrixInputs);
+
+    int32_t result = audio_start_virtual(handle_, sampleRate, chunking.nativeChunkMs, isMono, &source, outputFormat);
+
+    if (result != 0) {
+        std::string errorMsg = "Failed to start virtual recording: error code " + std::to_string(result);
+        Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Undefined();
 }
 
-Napi::Value AudioRecorderWrapper::ProcessEvents(const Napi::CallbackInfo& info) {
+// prepare('system' | 'microphone' | 'combined', options)
+// Options are those of the matching start call; only the ones that pick the
+// device or tap (processes, mute, stereo, deviceId) matter here.
+Napi::Value AudioRecorderWrapper::Prepare(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
-    std::vector<AudioEvent> events = DrainEvents();
-    Napi::Array result = Napi::Array::New(env, events.size());
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject()) {
+        Napi::TypeError::New(env, "Source name and options object expected").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string source = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object options = info[1].As<Napi::Object>();
+
+    bool mute = false;
+    if (options.Has("mute") && options.Get("mute").IsBoolean()) {
+        mute = options.Get("mute").As<Napi::Boolean>().Value();
+    }
+
+    bool isMono = true;
+    if (options.Has("stereo") && options.Get("stereo").IsBoolean()) {
+        isMono = !options.Get("stereo").As<Napi::Boolean>().Value();
+    }
+    // A start with a channel map taps every channel, as stereo does
+    if ((options.Has("channels") && !options.Get("channels").IsUndefined()) ||
+        (options.Has("channelMatrix") && !options.Get("channelMatrix").IsUndefined())) {
+        isMono = false;
+    }
+
+    std::vector<int32_t> includeProcesses = ParseProcessList(options, "includeProcesses");
+    std::vector<int32_t> excludeProcesses = ParseProcessList(options, "excludeProcesses");
+
+    const char* deviceUID = nullptr;
+    std::string deviceUIDStr;
+    if (options.Has("deviceId") && options.Get("deviceId").IsString()) {
+        deviceUIDStr = options.Get("deviceId").As<Napi::String>().Utf8Value();
+        deviceUID = deviceUIDStr.c_str();
+    }
+
+    const int32_t* include = includeProcesses.empty() ? nullptr : includeProcesses.data();
+    const int32_t* exclude = excludeProcesses.empty() ? nullptr : excludeProcesses.data();
+    int32_t includeCount = static_cast<int32_t>(includeProcesses.size());
+    int32_t excludeCount = static_cast<int32_t>(excludeProcesses.size());
+
+    int32_t result;
+    if (source == "system") {
+        result = audio_prepare_system_audio(handle_, mute, isMono, include, includeCount, exclude, excludeCount);
+    } else if (source == "microphone") {
+        result = audio_prepare_microphone(handle_, deviceUID);
+    } else if (source == "combined") {
+        result = audio_prepare_combined(handle_, mute, include, includeCount, exclude, excludeCount, deviceUID);
+    } else {
+        Napi::TypeError::New(env, "Unknown source: " + source).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    if (result == -2) {
+        Napi::Error::New(env, "Cannot prepare while recording").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+    if (result != 0) {
+        std::string errorMsg = "Failed to prepare " + source + " recording: error code " + std::to_string(result);
+        Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value AudioRecorderWrapper::ReleasePrepared(const Napi::CallbackInfo& info) {
+    audio_release_prepared(handle_);
+    return info.Env().Undefined();
+}
+
+Napi::Value AudioRecorderWrapper::Stop(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // A producer blocked on a full ring would otherwise delay the join below
+    unblockProducer_ = true;
+    WakeProducer();
+
+    int32_t result = audio_stop(handle_);
+
+    // Capture has stopped, so everything left in the writer's ring is final
+    CloseFileSink();
+    if (sharedRing_.Attached()) {
+        sharedRing_.SetState(shared_ring::kStopped);
+        sharedRingNotify_ = true;
+        NotifySharedRing(env);
+        CloseSharedRing();
+    }
+
+    if (result != 0) {
+        Napi::Error::New(env, "Failed to stop recording").ThrowAsJavaScriptException();
+    }
+
+    return env.Undefined();
+}
+
+// setFileSink(path | null, { raw?, bufferBytes?, blockBytes?, preallocateBytes?, progressIntervalMs? })
+// Record the next session straight to `path`: chunks are written by a native
+// writer thread and never reach JS, which sees file progress events instead.
+// The file is finished (header sizes, trimmed preallocation) by stop().
+Napi::Value AudioRecorderWrapper::SetFileSink(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (audio_is_running(handle_)) {
+        Napi::Error::New(env, "Cannot change the file sink while recording").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (listening_ && info.Length() > 0 && info[0].IsString()) {
+        Napi::Error::New(env, "Cannot set a file sink while listening").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        CloseFileSink();
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected (path: string | null, options?: object)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    FileWriter::Config config;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object options = info[1].As<Napi::Object>();
+
+        if (options.Has("raw") && options.Get("raw").IsBoolean()) {
+            config.raw = options.Get("raw").As<Napi::Boolean>().Value();
+        }
+
+        const char* sizeKeys[] = {"bufferBytes", "blockBytes", "preallocateBytes"};
+        for (const char* key : sizeKeys) {
+            if (!options.Has(key) || !options.Get(key).IsNumber()) continue;
+            double value = options.Get(key).As<Napi::Number>().DoubleValue();
+            if (!(value >= 0)) {
+                Napi::RangeError::New(env, std::string(key) + " must not be negative").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            if (std::strcmp(key, "bufferBytes") == 0) config.bufferBytes = static_cast<size_t>(value);
+            else if (std::strcmp(key, "blockBytes") == 0) config.blockBytes = static_cast<size_t>(value);
+            else config.preallocateBytes = static_cast<uint64_t>(value);
+        }
+
+        if (options.Has("progressIntervalMs") && options.Get("progressIntervalMs").IsNumber()) {
+            config.progressIntervalMs = options.Get("progressIntervalMs").As<Napi::Number>().DoubleValue();
+        }
+    }
+
+    CloseFileSink();
+
+    std::unique_ptr<FileWriter> writer(new FileWriter());
+    std::string error;
+    if (!writer->Open(info[0].As<Napi::String>().Utf8Value(), config, &AudioRecorderWrapper::OnFileProgress,
+                      &AudioRecorderWrapper::OnFileError, this, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    fileWriter_ = std::move(writer);
+
+    return env.Undefined();
+}
+
+// Flushes and finalizes the file; the writer queues its final progress event
+void AudioRecorderWrapper::CloseFileSink() {
+    if (fileWriter_) {
+        fileWriter_->Close();
+        fileWriter_.reset();
+    }
+}
+
+// setSharedRing(ring: Int32Array | string | null, { capacityBytes? })
+// Write the next session's chunks into a shared ring (layout in shared_ring.h)
+// instead of the JS queue, so worker_threads or other processes read them
+// without the main thread touching the data:
+//   - an Int32Array over a SharedArrayBuffer prepared by createSharedAudioRing()
+//   - a name: a shared-memory segment of capacityBytes (default 1 MiB) is created
+//     and removed again on stop; other processes map it with openSharedRing()
+// stop() marks the ring stopped and releases it.
+Napi::Value AudioRecorderWrapper::SetSharedRing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (audio_is_running(handle_)) {
+        Napi::Error::New(env, "Cannot change the shared ring while recording").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (listening_ && info.Length() > 0 && !info[0].IsNull() && !info[0].IsUndefined()) {
+        Napi::Error::New(env, "Cannot set a shared ring while listening").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    CloseSharedRing();
+
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        return env.Undefined();
+    }
+
+    if (info[0].IsTypedArray() && info[0].As<Napi::TypedArray>().TypedArrayType() == napi_int32_array) {
+        Napi::Int32Array array = info[0].As<Napi::Int32Array>();
+        if (!sharedRing_.Attach(reinterpret_cast<uint8_t*>(array.Data()), array.ByteLength(), false)) {
+            Napi::Error::New(env, "Not a shared audio ring (use createSharedAudioRing())").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        sharedRingArray_ = Napi::Persistent(array);
+        if (atomicsNotify_.IsEmpty()) {
+            Napi::Object atomics = env.Global().Get("Atomics").As<Napi::Object>();
+            atomicsNotify_ = Napi::Persistent(atomics.Get("notify").As<Napi::Function>());
+        }
+        return env.Undefined();
+    }
+
+    if (!info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected (ring: Int32Array | string | null, options?: object)")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    size_t capacity = 1 << 20;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("capacityBytes") && options.Get("capacityBytes").IsNumber()) {
+            double value = options.Get("capacityBytes").As<Napi::Number>().DoubleValue();
+            if (!(value > 0)) {
+                Napi::RangeError::New(env, "capacityBytes must be positive").ThrowAsJavaScriptException();
+                return env.Undefined();
+            }
+            capacity = static_cast<size_t>(value);
+        }
+    }
+    capacity = shared_ring::RoundUpCapacity(capacity);
+
+    std::unique_ptr<SharedMemorySegment> segment(new SharedMemorySegment());
+    std::string error;
+    if (!segment->Create(info[0].As<Napi::String>().Utf8Value(), shared_ring::kHeaderBytes + capacity, &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    sharedRing_.Attach(segment->Data(), segment->Size(), true);
+    sharedSegment_ = std::move(segment);
+
+    return env.Undefined();
+}
+
+void AudioRecorderWrapper::NotifySharedRing(Napi::Env env) {
+    if (!sharedRingNotify_.exchange(false) || sharedRingArray_.IsEmpty()) return;
+    atomicsNotify_.Call({sharedRingArray_.Value(), Napi::Number::New(env, shared_ring::kWrite)});
+}
+
+void AudioRecorderWrapper::CloseSharedRing() {
+    sharedRing_.Detach();
+    sharedRingArray_.Reset();
+    sharedSegment_.reset();
+}
+
+// setOption(key: string, value: number | boolean) -> boolean (false if ignored on this platform)
+Napi::Value AudioRecorderWrapper::SetOption(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !(info[1].IsNumber() || info[1].IsBoolean())) {
+        Napi::TypeError::New(env, "Expected (key: string, value: number | boolean)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    std::string key = info[0].As<Napi::String>().Utf8Value();
+    double value = info[1].IsBoolean()
+        ? (info[1].As<Napi::Boolean>().Value() ? 1.0 : 0.0)
+        : info[1].As<Napi::Number>().DoubleValue();
+
+    // In sub-chunk mode the chunk size is the batch size, which lives here
+    // and changes immediately, even while recording
+    if (key == "chunkDurationMs" && subChunkDurationMs_ > 0) {
+        if (!(value > 0)) {
+            Napi::Error::New(env, "Invalid value for option '" + key + "'").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        batchSubChunks_ = static_cast<uint32_t>(std::max(1.0, std::round(value / subChunkDurationMs_)));
+        return Napi::Boolean::New(env, true);
+    }
+
+    // The lookback ring lives here too; it is sized once the stream's format is known
+    if (key == "lookbackMs") {
+        if (audio_is_running(handle_)) {
+            Napi::Error::New(env, "Cannot change option '" + key + "' while recording").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        if (!(value >= 0)) {
+            Napi::Error::New(env, "Invalid value for option '" + key + "'").ThrowAsJavaScriptException();
+            return env.Null();
+        }
+        lookbackMs_ = value;
+        if (value == 0) {
+            lookback_.Release();
+            lookbackCollectBytes_ = 0;
+            ReleaseLookbackSlab();
+        }
+        return Napi::Boolean::New(env, true);
+    }
+
+    int32_t result = audio_set_option(handle_, key.c_str(), value);
+    if (result < 0) {
+        std::string errorMsg = result == -2
+            ? "Cannot change option '" + key + "' while recording"
+            : "Invalid value for option '" + key + "'";
+        Napi::Error::New(env, errorMsg).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    return Napi::Boolean::New(env, result == 0);
+}
+
+Napi::Value AudioRecorderWrapper::IsRunning(const Napi::CallbackInfo& info) {
+    return Napi::Boolean::New(info.Env(), audio_is_running(handle_));
+}
+
+Napi::Value AudioRecorderWrapper::ProcessEvents(const Napi::CallbackInfo& info) {
+    NotifySharedRing(info.Env());
+    if (deliveryPaused_) {
+        return Napi::Array::New(info.Env(), 0);
+    }
+    std::vector<AudioEvent> events = DrainEvents();
+    return BuildEventArray(info.Env(), events);
+}
+
+Napi::Value AudioRecorderWrapper::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+
+    uint64_t droppedOldest = droppedOldest_.load(std::memory_order_relaxed);
+    uint64_t droppedNewest = droppedNewest_.load(std::memory_order_relaxed);
+
+    stats.Set("queueCapacity", Napi::Number::New(env, static_cast<double>(dataRing_->Capacity())));
+    stats.Set("queuedChunks", Napi::Number::New(env, static_cast<double>(dataRing_->Size())));
+    stats.Set("peakQueuedChunks", Napi::Number::New(env, static_cast<double>(peakQueued_.load(std::memory_order_relaxed))));
+    stats.Set("droppedChunks", Napi::Number::New(env, static_cast<double>(droppedOldest + droppedNewest)));
+    stats.Set("droppedOldest", Napi::Number::New(env, static_cast<double>(droppedOldest)));
+    stats.Set("droppedNewest", Napi::Number::New(env, static_cast<double>(droppedNewest)));
+    stats.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(droppedFrames_.load(std::memory_order_relaxed))));
+    stats.Set("queuedBytes", Napi::Number::New(env, static_cast<double>(queuedBytes_.load(std::memory_order_relaxed))));
+    stats.Set("queuedFrames", Napi::Number::New(env, static_cast<double>(queuedFrames_.load(std::memory_order_relaxed))));
+    stats.Set("deliveryPaused", Napi::Boolean::New(env, deliveryPaused_));
+    stats.Set("blockedWrites", Napi::Number::New(env, static_cast<double>(blockedWrites_.load(std::memory_order_relaxed))));
+    stats.Set("pooledSlabs", Napi::Number::New(env, static_cast<double>(chunkPool_->AllocatedSlabs())));
+
+    // Capture side, since the last start
+    AudioCaptureStats capture;
+    if (!handle_ || audio_get_stats(handle_, &capture) != 0) {
+        capture = AudioCaptureStats{};
+    }
+    AudioCaptureStats delivery;
+    capture_stats_snapshot(deliveryStats_, &delivery);
+
+    stats.Set("packets", Napi::Number::New(env, static_cast<double>(capture.packets)));
+    stats.Set("framesCaptured", Napi::Number::New(env, static_cast<double>(capture.framesCaptured)));
+    stats.Set("chunksEmitted", Napi::Number::New(env, static_cast<double>(capture.chunksEmitted)));
+    stats.Set("framesEmitted", Napi::Number::New(env, static_cast<double>(capture.framesEmitted)));
+    stats.Set("discontinuities", Napi::Number::New(env, static_cast<double>(capture.discontinuities)));
+    stats.Set("timestampErrors", Napi::Number::New(env, static_cast<double>(capture.timestampErrors)));
+    stats.Set("deviceDroppedBytes", Napi::Number::New(env, static_cast<double>(capture.droppedBytes)));
+    stats.Set("bytesAllocated", Napi::Number::New(env,
+        static_cast<double>(capture.bytesAllocated + chunkPool_->AllocatedBytes())));
+
+    Napi::Object stages = Napi::Object::New(env);
+    stages.Set("convert", BuildStageStats(env, capture.stages[CAPTURE_STAGE_CONVERT]));
+    stages.Set("resample", BuildStageStats(env, capture.stages[CAPTURE_STAGE_RESAMPLE]));
+    stages.Set("chunk", BuildStageStats(env, capture.stages[CAPTURE_STAGE_CHUNK]));
+    stages.Set("delivery", BuildStageStats(env, delivery.stages[CAPTURE_STAGE_DELIVERY]));
+    stats.Set("stages", stages);
+
+    return stats;
+}
+
+// pause(): stop delivering events while capture goes on. Chunks queue up to
+// the limits and are then handled by the overflow policy; 'block' drops the
+// incoming chunk without waiting while paused.
+Napi::Value AudioRecorderWrapper::Pause(const Napi::CallbackInfo& info) {
+    deliveryPaused_ = true;
+    return info.Env().Undefined();
+}
+
+// resume(): deliver what queued up meanwhile, drops reported first
+Napi::Value AudioRecorderWrapper::Resume(const Napi::CallbackInfo& info) {
+    if (deliveryPaused_.exchange(false)) {
+        // Without coalescing each call drains one event, so schedule the backlog
+        ScheduleQueuedEvents();
+    }
+    return info.Env().Undefined();
+}
+
+// setListening(listening: boolean, preRollMs?: number)
+// While listening, chunks only go into the lookback ring and no data or level
+// events reach JS. Ending it with preRollMs delivers the last preRollMs held
+// back, as one data event, ahead of the next chunk. Can be called before a
+// start or while recording. A file sink or shared ring takes every chunk, so
+// neither can be combined with listening or a pre-roll.
+Napi::Value AudioRecorderWrapper::SetListening(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsBoolean()) {
+        Napi::TypeError::New(env, "Expected (listening: boolean, preRollMs?: number)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool listening = info[0].As<Napi::Boolean>().Value();
+    int64_t preRollMs = -1;
+    if (info.Length() > 1 && info[1].IsNumber()) {
+        double value = info[1].As<Napi::Number>().DoubleValue();
+        if (!(value >= 0)) {
+            Napi::RangeError::New(env, "preRollMs must not be negative").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        if (value > 0) {
+            preRollMs = static_cast<int64_t>(std::llround(value));
+        }
+    }
+
+    if ((listening || preRollMs >= 0) && (fileWriter_ || sharedRing_.Attached())) {
+        Napi::Error::New(env, "Listening and pre-roll can't be used with a file sink or shared ring")
+            .ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (!listening && preRollMs >= 0) {
+        ReserveLookbackSlab();
+    }
+
+    // The capture thread reads listening_ first, so a pre-roll is always seen with it
+    preRollMs_.store(listening ? -1 : preRollMs, std::memory_order_relaxed);
+    listening_.store(listening, std::memory_order_release);
+    return env.Undefined();
+}
+
+// snapshot(ms) -> snapshot event | null | undefined
+// Copy the last `ms` of the lookback ring (all of it for 0). While recording
+// the copy is made at the next chunk and arrives as a snapshot event
+// (undefined is returned); otherwise it is returned right away, or null if the
+// ring is empty.
+Napi::Value AudioRecorderWrapper::Snapshot(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber() || !(info[0].As<Napi::Number>().DoubleValue() >= 0)) {
+        Napi::TypeError::New(env, "Expected (ms: number >= 0)").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+    if (lookbackMs_ <= 0) {
+        Napi::Error::New(env, "Set the lookbackMs option to take snapshots").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    double ms = info[0].As<Napi::Number>().DoubleValue();
+    if (audio_is_running(handle_)) {
+        ReserveLookbackSlab();
+        snapshotMs_.store(static_cast<int64_t>(std::llround(ms)), std::memory_order_relaxed);
+        return env.Undefined();
+    }
+
+    // No capture thread: read the ring here
+    snapshotMs_ = -1;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    AudioChunkInfo chunk;
+    if (!lookback_.Collect(ms, false, &data, &length, &chunk)) {
+        return env.Null();
+    }
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("type", Napi::Number::New(env, 10));
+    obj.Set("data", Napi::Buffer<uint8_t>::Copy(env, data, length));
+    SetChunkFields(env, obj, chunk, chunk.frameCount);
+    return obj;
+}
+
+// Fold each run of contiguous data events (consecutive sequence numbers and
+// frame positions, no flags after the first) into its first event, up to
+// batchSubChunks_ per run. Level events inside a run move ahead of it, so each
+// report still precedes the data it describes.
+void AudioRecorderWrapper::BatchSubChunks(std::vector<AudioEvent>& events) const {
+    uint32_t maxSubChunks = batchSubChunks_.load(std::memory_order_relaxed);
+    std::vector<AudioEvent> batched;
+    batched.reserve(events.size());
+
+    for (size_t i = 0; i < events.size();) {
+        AudioEvent& head = events[i++];
+        if (head.type != 0 || !head.data) {
+            batched.push_back(std::move(head));
+            continue;
+        }
+
+        AudioChunkInfo last = head.data->info;
+        std::vector<AudioEvent> levels;
+        while (i < events.size() && head.batch.size() + 1 < maxSubChunks) {
+            AudioEvent& next = events[i];
+            if (next.type == 7) {
+                levels.push_back(std::move(next));
+                i++;
+                continue;
+            }
+            if (next.type != 0 || !next.data) break;
+
+            const AudioChunkInfo& info = next.data->info;
+            if (info.flags != 0 || info.sequence != last.sequence + 1 ||
+                info.framePosition != last.framePosition + last.frameCount) {
+                break;
+            }
+            last = info;
+            head.batch.push_back(std::move(next.data));
+            i++;
+        }
+
+        for (AudioEvent& level : levels) {
+            batched.push_back(std::move(level));
+        }
+        batched.push_back(std::move(head));
+    }
+
+    events.swap(batched);
+}
+
+Napi::Array AudioRecorderWrapper::BuildEventArray(Napi::Env env, std::vector<AudioEvent>& events) {
+    if (batchSubChunks_.load(std::memory_order_relaxed) > 1) {
+        BatchSubChunks(events);
+    }
+    Napi::Array result = Napi::Array::New(env);
+    uint32_t count = 0;
+
+    for (size_t i = 0; i < events.size(); i++) {
+        if (!packData_ || events[i].type != 0) {
+            result.Set(count++, BuildEvent(env, events[i]));
+            continue;
+        }
+
+        // Packed mode: the run of data events up to the next control event
+        // becomes one entry. Level events in it go ahead, each still before
+        // the data it describes.
+        size_t end = i;
+        while (end < events.size() && (events[end].type == 0 || events[end].type == 7)) {
+            if (events[end].type == 7) {
+                result.Set(count++, BuildEvent(env, events[end]));
+            }
+            end++;
+        }
+        result.Set(count++, BuildPackedData(env, events, i, end));
+        i = end - 1;
+    }
+
+    return result;
+}
+
+Napi::Object AudioRecorderWrapper::BuildEvent(Napi::Env env, AudioEvent& event) {
+    Napi::Object obj = Napi::Object::New(env);
+
+    obj.Set("type", Napi::Number::New(env, event.type));
+
+    switch (event.type) {
+        case 0: // data
+            if (event.data) {
+                const AudioChunkInfo chunk = event.data->info;
+                uint64_t frameCount = chunk.frameCount;
+                if (event.batch.empty()) {
+                    obj.Set("data", ChunkPool::ToBuffer(env, std::move(event.data)));
+                } else {
+                    // A batch can't be one slab, so its sub-chunks are copied together once
+                    size_t length = event.data->length;
+                    for (const ChunkSlabPtr& slab : event.batch) {
+                        length += slab->length;
+                    }
+                    Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, length);
+                    std::memcpy(buffer.Data(), event.data->data.get(), event.data->length);
+                    size_t offset = event.data->length;
+                    for (const ChunkSlabPtr& slab : event.batch) {
+                        std::memcpy(buffer.Data() + offset, slab->data.get(), slab->length);
+                        offset += slab->length;
+                        frameCount += slab->info.frameCount;
+                    }
+                    obj.Set("data", buffer);
+                    obj.Set("subChunks", Napi::Number::New(env, static_cast<double>(event.batch.size() + 1)));
+                    // Slabs go back to the pool when the event is destroyed
+                }
+                SetChunkFields(env, obj, chunk, frameCount);
+            }
+            break;
+
+        case 10: // snapshot, without data if the ring was empty
+            if (event.data) {
+                const AudioChunkInfo chunk = event.data->info;
+                obj.Set("data", ChunkPool::ToBuffer(env, std::move(event.data)));
+                SetChunkFields(env, obj, chunk, chunk.frameCount);
+            }
+            break;
+
+        case 1: // start
+        case 2: // stop
+        case 5: // speech start
+        case 6: // speech stop
+            // No additional data needed
+            break;
+
+        case 3: // error
+            obj.Set("message", Napi::String::New(env, event.message));
+            break;
+
+        case 4: // metadata
+            obj.Set("sampleRate", Napi::Number::New(env, event.sampleRate));
+            obj.Set("channelsPerFrame", Napi::Number::New(env, event.channelsPerFrame));
+            obj.Set("bitsPerChannel", Napi::Number::New(env, event.bitsPerChannel));
+            obj.Set("isFloat", Napi::Boolean::New(env, event.isFloat));
+            obj.Set("encoding", Napi::String::New(env, event.encoding));
+            break;
+
+        case 7: // level
+            if (event.data) {
+                const AudioChunkInfo& chunk = event.data->info;
+                const AudioLevels& levels = event.data->levels;
+                uint32_t channels = std::min<uint32_t>(levels.channels, AUDIO_LEVELS_MAX_CHANNELS);
+                Napi::Array peak = Napi::Array::New(env, channels);
+                Napi::Array rms = Napi::Array::New(env, channels);
+                Napi::Array clipped = Napi::Array::New(env, channels);
+                for (uint32_t c = 0; c < channels; c++) {
+                    peak.Set(c, Napi::Number::New(env, levels.peak[c]));
+                    rms.Set(c, Napi::Number::New(env, levels.rms[c]));
+                    clipped.Set(c, Napi::Number::New(env, levels.clipped[c]));
+                }
+                obj.Set("peak", peak);
+                obj.Set("rms", rms);
+                obj.Set("clipped", clipped);
+                obj.Set("sequence", Napi::Number::New(env, static_cast<double>(chunk.sequence)));
+                obj.Set("framePosition", Napi::Number::New(env, static_cast<double>(chunk.framePosition)));
+                obj.Set("frameCount", Napi::Number::New(env, chunk.frameCount));
+                obj.Set("hostTime", Napi::BigInt::New(env, chunk.hostTimeNs));
+            }
+            break;
+
+        case 8: // file progress
+            obj.Set("bytesWritten", Napi::Number::New(env, static_cast<double>(event.bytesWritten)));
+            obj.Set("framesWritten", Napi::Number::New(env, static_cast<double>(event.framesWritten)));
+            obj.Set("droppedChunks", Napi::Number::New(env, static_cast<double>(event.droppedChunks)));
+            obj.Set("final", Napi::Boolean::New(env, event.final));
+            break;
+
+        case 9: // drop
+            obj.Set("droppedChunks", Napi::Number::New(env, static_cast<double>(event.droppedChunks)));
+            obj.Set("droppedOldest", Napi::Number::New(env, static_cast<double>(event.droppedOldest)));
+            obj.Set("droppedNewest", Napi::Number::New(env, static_cast<double>(event.droppedNewest)));
+            obj.Set("droppedFrames", Napi::Number::New(env, static_cast<double>(event.droppedFrames)));
+            break;
+    }
+
+    return obj;
+}
+
+// Type 11: the data events in [begin, end) copied into one Buffer, so a burst
+// costs JS a fixed handful of objects however many chunks it holds. The index
+// is one ArrayBuffer viewed as
+//   index      Float64 x5 per chunk: byte offset, byte length, sequence, framePosition, frameCount
+//   flags      Uint32 x2 per chunk:  AUDIO_CHUNK_FLAG_*, sub-chunks
+//   hostTimes  BigUint64 per chunk
+// Level events in the range are skipped (the caller delivers them apart).
+Napi::Object AudioRecorderWrapper::BuildPackedData(Napi::Env env, std::vector<AudioEvent>& events,
+                                                   size_t begin, size_t end) {
+    size_t chunks = 0;
+    size_t bytes = 0;
+    for (size_t i = begin; i < end; i++) {
+        if (events[i].type != 0 || !events[i].data) continue;
+        chunks++;
+        bytes += events[i].data->length;
+        for (const ChunkSlabPtr& slab : events[i].batch) {
+            bytes += slab->length;
+        }
+    }
+
+    const size_t flagsOffset = chunks * 5 * sizeof(double);
+    const size_t hostTimeOffset = flagsOffset + chunks * 2 * sizeof(uint32_t);
+    Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, bytes);
+    Napi::ArrayBuffer indexBuffer = Napi::ArrayBuffer::New(env, hostTimeOffset + chunks * sizeof(uint64_t));
+    uint8_t* index = static_cast<uint8_t*>(indexBuffer.Data());
+    double* positions = reinterpret_cast<double*>(index);
+    uint32_t* flags = reinterpret_cast<uint32_t*>(index + flagsOffset);
+    uint64_t* hostTimes = reinterpret_cast<uint64_t*>(index + hostTimeOffset);
+
+    size_t offset = 0;
+    size_t n = 0;
+    for (size_t i = begin; i < end; i++) {
+        AudioEvent& event = events[i];
+        if (event.type != 0 || !event.data) continue;
+
+        const AudioChunkInfo& chunk = event.data->info;
+        const size_t start = offset;
+        uint64_t frameCount = chunk.frameCount;
+        std::memcpy(buffer.Data() + offset, event.data->data.get(), event.data->length);
+        offset += event.data->length;
+        for (const ChunkSlabPtr& slab : event.batch) {
+            std::memcpy(buffer.Data() + offset, slab->data.get(), slab->length);
+            offset += slab->length;
+            frameCount += slab->info.frameCount;
+        }
+
+        positions[n * 5] = static_cast<double>(start);
+        positions[n * 5 + 1] = static_cast<double>(offset - start);
+        positions[n * 5 + 2] = static_cast<double>(chunk.sequence);
+        positions[n * 5 + 3] = static_cast<double>(chunk.framePosition);
+        positions[n * 5 + 4] = static_cast<double>(frameCount);
+        flags[n * 2] = chunk.flags;
+        flags[n * 2 + 1] = static_cast<uint32_t>(event.batch.size() + 1);
+        hostTimes[n] = chunk.hostTimeNs;
+        n++;
+        // The slabs go back to the pool when `events` is destroyed
+    }
+
+    Napi::Object obj = Napi::Object::New(env);
+    obj.Set("type", Napi::Number::New(env, 11));
+    obj.Set("data", buffer);
+    obj.Set("index", Napi::Float64Array::New(env, chunks * 5, indexBuffer, 0));
+    obj.Set("flags", Napi::Uint32Array::New(env, chunks * 2, indexBuffer, flagsOffset));
+    obj.Set("hostTimes", Napi::BigUint64Array::New(env, chunks, indexBuffer, hostTimeOffset));
+    return obj;
+}
+
+// setEventCallback(callback | null, { coalesce?: boolean })
+// Switches the recorder to push delivery. The callback receives the same event
+// arrays processEvents() returns. With coalescing (default) at most one call is
+// pending at a time and it drains everything queued before it runs, so a burst
+// of chunks reaches JS as a single call.
+Napi::Value AudioRecorderWrapper::SetEventCallback(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    // The thread-safe function may only be swapped while no capture thread can
+    // be calling into it.
+    if (audio_is_running(handle_)) {
+        Napi::Error::New(env, "Cannot change the event callback while recording").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ReleaseEventCallback();
+
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        return env.Undefined();
+    }
+
+    if (!info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    coalesceEvents_ = true;
+    if (info.Length() > 1 && info[1].IsObject()) {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("coalesce") && options.Get("coalesce").IsBoolean()) {
+            coalesceEvents_ = options.Get("coalesce").As<Napi::Boolean>().Value();
+        }
+    }
+
+    eventTsfn_ = RecorderEventTsfn::New(
+        env,
+        info[0].As<Napi::Function>(),
+        "AudioRecorderEvents",
+        0,
+        1,
+        this,
+        [](Napi::Env, AudioRecorderWrapper* self) {
+            // Balances the Ref() below once the last queued call has run
+            self->Unref();
+        }
+    );
+
+    // Keep the JS object (and therefore this wrapper) alive while calls are queued
+    Ref();
+
+    pushPending_ = false;
+    pushEnabled_ = true;
+
+    // Deliver anything that was queued before the callback was installed
+    ScheduleQueuedEvents();
+
+    return env.Undefined();
+}
+
+// One call per queued event (a single one when coalescing), for events that
+// were queued while no call could be scheduled
+void AudioRecorderWrapper::ScheduleQueuedEvents() {
+    size_t queuedEvents = dataRing_->Size();
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        queuedEvents += controlQueue_.size();
+    }
+    if (coalesceEvents_) {
+        queuedEvents = std::min<size_t>(queuedEvents, 1);
+    }
+    for (size_t i = 0; i < queuedEvents; i++) {
+        SchedulePush();
+    }
+}
+
+void AudioRecorderWrapper::SchedulePush() {
+    if (!pushEnabled_ || deliveryPaused_) return;
+
+    // Coalescing: only the first event after a delivery schedules a call
+    if (coalesceEvents_ && pushPending_.exchange(true)) return;
+
+    eventTsfn_.NonBlockingCall();
+}
+
+void AudioRecorderWrapper::ReleaseEventCallback() {
+    if (pushEnabled_.exchange(false)) {
+        // Calls already queued still run; the finalizer drops our reference afterwards
+        eventTsfn_.Release();
+    }
+}
+
+static void CallRecorderEventCallback(Napi::Env env, Napi::Function callback,
+                                      AudioRecorderWrapper* self, void*) {
+    if (env == nullptr || self->isDestroyed_) return;
+
+    // Clear before draining so events queued from here on schedule a new call
+    self->pushPending_ = false;
+    self->unbatchedSubChunks_ = 0;
+    self->unbatchedLevels_ = 0;
+    self->NotifySharedRing(env);
+    if (self->deliveryPaused_) return;  // resume() schedules a call
+
+    std::vector<AudioEvent> events = self->DrainEvents(self->coalesceEvents_ ? SIZE_MAX : 1);
+    if (events.empty()) return;
+
+    callback.Call({self->BuildEventArray(env, events)});
+}
+
+void AudioRecorderWrapper::OnData(const uint8_t* data, int32_t length, void* context) {
+    AudioRecorderWrapper* self = static_cast<AudioRecorderWrapper*>(context);
+    if (self->isDestroyed_) return;
+
+    if (self->fileWriter_ || self->sharedRing_.Attached()) {
+        // Timing-less fallback path: route like OnChunk
+        OnChunk(data, length, nullptr, context);
+        return;
+    }
+    self->QueueData(data, static_cast<size_t>(length), nullptr);
+}
+
+void AudioRecorderWrapper::OnChunk(const uint8_t* data, int32_t length,
+                                   const AudioChunkInfo* info, void* context) {
+    AudioRecorderWrapper* self = static_cast<AudioRecorderWrapper*>(context);
+    if (self->isDestroyed_) return;
 
-    for (size_t i = 0; i < events.size(); i++) {
-        const AudioEvent& event = events[i];
-        Napi::Object obj = Napi::Object::New(env);
+    // Lock-free copies into the file writer and/or shared ring; both count their own drops
+    bool routed = false;
+    if (self->fileWriter_) {
+        self->fileWriter_->Write(data, static_cast<size_t>(length), info ? info->frameCount : 0);
+        routed = true;
+    }
+    if (self->sharedRing_.Attached()) {
+        // Wake the JS thread only for a parked reader, and once per notify:
+        // otherwise the ring's data path never touches it
+        if (self->sharedRing_.Write(data, static_cast<size_t>(length), info) &&
+            !self->sharedRingArray_.IsEmpty() && self->sharedRing_.ReaderWaiting() &&
+            !self->sharedRingNotify_.exchange(true)) {
+            self->SchedulePush();
+        }
+        routed = true;
+    }
 
-        obj.Set("type", Napi::Number::New(env, event.type));
+    bool listening = self->listening_.load(std::memory_order_acquire);
+    if (self->lookback_.Enabled() && info) {
+        self->FeedLookback(data, static_cast<size_t>(length), *info, !listening && !routed);
+    }
+    if (!routed && !listening) {
+        self->QueueData(data, static_cast<size_t>(length), info);
+    }
+}
 
-        switch (event.type) {
-            case 0: // data
-                {
-                    Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::Copy(
-                        env, event.data.data(), event.data.size()
-                    );
-                    obj.Set("data", buffer);
-                }
-                break;
+// Capture thread: keep the chunk, queueing a requested pre-roll ahead of it
+// (when it is about to be delivered) and a requested snapshot after it
+void AudioRecorderWrapper::FeedLookback(const uint8_t* data, size_t length, const AudioChunkInfo& info,
+                                        bool delivered) {
+    if (delivered) {
+        int64_t preRollMs = preRollMs_.exchange(-1, std::memory_order_relaxed);
+        const uint8_t* history = nullptr;
+        size_t historyLength = 0;
+        AudioChunkInfo historyInfo;
+        if (preRollMs >= 0 &&
+            lookback_.Collect(static_cast<double>(preRollMs), true, &history, &historyLength, &historyInfo)) {
+            QueueData(history, historyLength, &historyInfo, nullptr, true);
+        }
+    }
 
-            case 1: // start
-            case 2: // stop
-                // No additional data needed
-                break;
+    lookback_.Write(data, length, info);
+    lookbackCollectBytes_.store(lookback_.MaxCollectBytes(), std::memory_order_relaxed);  // Grows with an outsized chunk
+    if (delivered) {
+        lookback_.MarkDelivered();
+    }
 
-            case 3: // error
-                obj.Set("message", Napi::String::New(env, event.message));
-                break;
+    int64_t snapshotMs = snapshotMs_.exchange(-1, std::memory_order_relaxed);
+    if (snapshotMs >= 0) {
+        QueueSnapshot(static_cast<double>(snapshotMs));
+    }
+}
 
-            case 4: // metadata
-                obj.Set("sampleRate", Napi::Number::New(env, event.sampleRate));
-                obj.Set("channelsPerFrame", Napi::Number::New(env, event.channelsPerFrame));
-                obj.Set("bitsPerChannel", Napi::Number::New(env, event.bitsPerChannel));
-                obj.Set("isFloat", Napi::Boolean::New(env, event.isFloat));
-                obj.Set("encoding", Napi::String::New(env, event.encoding));
-                break;
-        }
+void AudioRecorderWrapper::QueueSnapshot(double ms) {
+    AudioEvent event;
+    event.type = 10;
+    const uint8_t* data = nullptr;
+    size_t length = 0;
+    AudioChunkInfo info;
+    if (lookback_.Collect(ms, false, &data, &length, &info)) {
+        event.data = chunkPool_->Acquire(data, length, lookbackSlab_.exchange(nullptr, std::memory_order_acquire));
+        event.data->info = info;
+    }
+    QueueEvent(std::move(event));
+}
 
-        result.Set(i, obj);
+// JS thread, before a pre-roll or snapshot request is published: make sure a
+// slab large enough for the answer is waiting. Only the capture thread takes
+// it, so one seen here stays until the request is served.
+void AudioRecorderWrapper::ReserveLookbackSlab() {
+    size_t bytes = lookbackCollectBytes_.load(std::memory_order_relaxed);
+    if (bytes == 0) return;
+
+    if (lookbackSlab_.load(std::memory_order_acquire) && lookbackSlabBytes_ >= bytes) return;
+    ChunkSlab* slab = lookbackSlab_.exchange(chunkPool_->Reserve(bytes).release(), std::memory_order_acq_rel);
+    lookbackSlabBytes_ = bytes;
+    if (slab) {
+        ChunkSlabRecycler()(slab);
     }
+}
 
-    return result;
+// JS thread: give the reserved slab back (lookback turned off, or destroyed)
+void AudioRecorderWrapper::ReleaseLookbackSlab() {
+    if (ChunkSlab* slab = lookbackSlab_.exchange(nullptr, std::memory_order_acq_rel)) {
+        ChunkSlabRecycler()(slab);
+    }
 }
 
-void AudioRecorderWrapper::OnData(const uint8_t* data, int32_t length, void* context) {
+// Level reports share the data ring (as empty slabs) so they stay lock-free
+// and ordered with the chunks they describe
+void AudioRecorderWrapper::OnLevels(const AudioLevels* levels, const AudioChunkInfo* info, void* context) {
     AudioRecorderWrapper* self = static_cast<AudioRecorderWrapper*>(context);
-    if (self->isDestroyed_) return;
+    if (self->isDestroyed_ || !levels || self->listening_.load(std::memory_order_relaxed)) return;
 
-    AudioEvent event;
-    event.type = 0;
-    event.data.assign(data, data + length);
-    self->QueueEvent(std::move(event));
+    self->QueueData(nullptr, 0, info, levels);
 }
 
 void AudioRecorderWrapper::OnEvent(int32_t eventType, const char* message, void* context) {
@@ -402,9 +2079,9 @@ void AudioRecorderWrapper::OnEvent(int32_t eventType, const char* message, void*
     if (self->isDestroyed_) return;
 
     AudioEvent event;
-    // eventType from Swift: 0=start, 1=stop, 2=error
-    // We remap: 1=start, 2=stop, 3=error (0 is reserved for data)
-    event.type = eventType + 1;
+    // eventType from native: 0=start, 1=stop, 2=error, 3=activity start, 4=activity stop
+    // We remap: 1=start, 2=stop, 3=error (0 is data, 4 is metadata), 5=speech start, 6=speech stop
+    event.type = eventType <= 2 ? eventType + 1 : eventType + 2;
     if (message) {
         event.message = message;
     }
@@ -424,21 +2101,292 @@ void AudioRecorderWrapper::OnMetadata(double sampleRate, uint32_t channelsPerFra
     event.bitsPerChannel = bitsPerChannel;
     event.isFloat = isFloat;
     event.encoding = encoding ? encoding : "";
+
+    // Chunks only follow the metadata, so the duration limit is in place first
+    self->maxQueuedFrames_ = self->maxQueuedMs_ > 0
+        ? std::max<uint64_t>(1, static_cast<uint64_t>(self->maxQueuedMs_ * sampleRate / 1000.0))
+        : 0;
+
+    if (self->lookbackMs_ > 0) {
+        self->lookback_.Configure(self->lookbackMs_, sampleRate, channelsPerFrame, bitsPerChannel, event.encoding);
+        self->lookbackCollectBytes_.store(self->lookback_.MaxCollectBytes(), std::memory_order_relaxed);
+    }
+
+    // The writer needs the format before the first chunk (e.g. for a WAV header)
+    if (self->fileWriter_) {
+        FileWriter::StreamFormat format;
+        format.encoding = event.encoding;
+        format.sampleRate = sampleRate;
+        format.channels = channelsPerFrame;
+        format.bitsPerSample = bitsPerChannel;
+        format.isFloat = isFloat;
+        self->fileWriter_->BeginStream(format);
+    }
+
+    self->QueueEvent(std::move(event));
+}
+
+void AudioRecorderWrapper::OnFileProgress(uint64_t bytesWritten, uint64_t framesWritten,
+                                          uint64_t droppedChunks, bool final, void* context) {
+    AudioRecorderWrapper* self = static_cast<AudioRecorderWrapper*>(context);
+    if (self->isDestroyed_) return;
+
+    AudioEvent event;
+    event.type = 8;
+    event.bytesWritten = bytesWritten;
+    event.framesWritten = framesWritten;
+    event.droppedChunks = droppedChunks;
+    event.final = final;
+    self->QueueEvent(std::move(event));
+}
+
+void AudioRecorderWrapper::OnFileError(const char* message, void* context) {
+    AudioRecorderWrapper* self = static_cast<AudioRecorderWrapper*>(context);
+    if (self->isDestroyed_) return;
+
+    AudioEvent event;
+    event.type = 3;
+    event.message = message ? message : "File sink error";
     self->QueueEvent(std::move(event));
 }
 
+// Would queueing this chunk exceed the ring or the byte/duration limits? One
+// chunk is always let in, however large, so a limit can't starve the stream.
+bool AudioRecorderWrapper::QueueOverLimit(size_t length, uint64_t frames) const {
+    if (dataRing_->Full()) return true;
+    if (dataRing_->Size() == 0) return false;
+    if (maxQueuedBytes_ > 0 && queuedBytes_.load(std::memory_order_relaxed) + length > maxQueuedBytes_) {
+        return true;
+    }
+    uint64_t maxFrames = maxQueuedFrames_.load(std::memory_order_relaxed);
+    return maxFrames > 0 && queuedFrames_.load(std::memory_order_relaxed) + frames > maxFrames;
+}
+
+// Where OverflowPolicy::Pause lets chunks in again: half of every limit
+bool AudioRecorderWrapper::QueueBelowResumeMark() const {
+    if (dataRing_->Size() > dataRing_->Capacity() / 2) return false;
+    if (maxQueuedBytes_ > 0 && queuedBytes_.load(std::memory_order_relaxed) > maxQueuedBytes_ / 2) {
+        return false;
+    }
+    uint64_t maxFrames = maxQueuedFrames_.load(std::memory_order_relaxed);
+    return maxFrames == 0 || queuedFrames_.load(std::memory_order_relaxed) <= maxFrames / 2;
+}
+
+// A slab left the ring (delivered or stolen)
+void AudioRecorderWrapper::ReleaseQueued(const ChunkSlab* slab) {
+    queuedBytes_.fetch_sub(slab->length, std::memory_order_relaxed);
+    if (!slab->isLevels) {
+        queuedFrames_.fetch_sub(slab->info.frameCount, std::memory_order_relaxed);
+    }
+}
+
+void AudioRecorderWrapper::DropQueued(const ChunkSlab* slab, std::atomic<uint64_t>& counter) {
+    counter.fetch_add(1, std::memory_order_relaxed);
+    if (!slab->isLevels) {
+        droppedFrames_.fetch_add(slab->info.frameCount, std::memory_order_relaxed);
+    }
+}
+
+// OverflowPolicy::Block: wait until the chunk fits, for at most kBlockBudgetMs.
+// Once a wait runs out, later chunks are dropped right away until one fits,
+// so a stalled consumer costs the capture thread one budget, not one per chunk.
+bool AudioRecorderWrapper::WaitForDrain(size_t length, uint64_t frames) {
+    if (blockTimedOut_ || deliveryPaused_ || unblockProducer_ || isDestroyed_) {
+        return false;
+    }
+    blockedWrites_.fetch_add(1, std::memory_order_relaxed);
+
+    std::unique_lock<std::mutex> lock(drainMutex_);
+    producerWaiting_ = true;
+    bool fits = drainCond_.wait_for(lock, std::chrono::milliseconds(kBlockBudgetMs), [&] {
+        return !QueueOverLimit(length, frames) || unblockProducer_ || isDestroyed_;
+    }) && !QueueOverLimit(length, frames);
+    producerWaiting_ = false;
+    blockTimedOut_ = !fits;
+    return fits;
+}
+
+// JS thread: wake a producer waiting in WaitForDrain()
+void AudioRecorderWrapper::WakeProducer() {
+    if (producerWaiting_) {
+        std::lock_guard<std::mutex> lock(drainMutex_);
+        drainCond_.notify_one();
+    }
+}
+
+// Runs on the capture thread: no locks, and no allocation once the pool is warm
+// (OverflowPolicy::Block aside)
+void AudioRecorderWrapper::QueueData(const uint8_t* data, size_t length, const AudioChunkInfo* info,
+                                     const AudioLevels* levels, bool fromLookback) {
+    ChunkSlab* reuse = nullptr;
+    const uint64_t frames = info && !levels ? info->frameCount : 0;
+
+    // Pause policy: keep dropping until JS has caught up
+    if (overflowPaused_) {
+        if (!QueueBelowResumeMark()) {
+            droppedNewest_.fetch_add(1, std::memory_order_relaxed);
+            droppedFrames_.fetch_add(frames, std::memory_order_relaxed);
+            return;
+        }
+        overflowPaused_ = false;
+    }
+
+    if (QueueOverLimit(length, frames)) {
+        switch (overflowPolicy_) {
+            case OverflowPolicy::DropOldest:
+                // Steal the oldest chunks until this one fits; if JS popped them
+                // first there is room now. Only the first is reused: the pool's
+                // idle ring is refilled from the JS thread alone.
+                for (ChunkSlab* oldest = nullptr;
+                     QueueOverLimit(length, frames) && dataRing_->TryPop(oldest);) {
+                    ReleaseQueued(oldest);
+                    DropQueued(oldest, droppedOldest_);
+                    if (reuse) {
+                        chunkPool_->Discard(reuse);
+                    }
+                    reuse = oldest;
+                }
+                break;
+
+            case OverflowPolicy::Block:
+                if (WaitForDrain(length, frames)) break;
+                // Out of budget, paused or stopping: drop instead
+                [[fallthrough]];
+
+            case OverflowPolicy::DropNewest:
+                droppedNewest_.fetch_add(1, std::memory_order_relaxed);
+                droppedFrames_.fetch_add(frames, std::memory_order_relaxed);
+                return;
+
+            case OverflowPolicy::Pause:
+                overflowPaused_ = true;
+                droppedNewest_.fetch_add(1, std::memory_order_relaxed);
+                droppedFrames_.fetch_add(frames, std::memory_order_relaxed);
+                return;
+        }
+    }
+
+    blockTimedOut_ = false;
+
+    // A pre-roll goes into the slab reserved for it (see ReserveLookbackSlab)
+    if (fromLookback) {
+        if (ChunkSlab* reserved = lookbackSlab_.exchange(nullptr, std::memory_order_acquire)) {
+            if (reuse) {
+                chunkPool_->Discard(reuse);
+            }
+            reuse = reserved;
+        }
+    }
+
+    ChunkSlabPtr slab = chunkPool_->Acquire(data, length, reuse);
+    if (info) {
+        slab->info = *info;
+    }
+    slab->isLevels = levels != nullptr;
+    if (levels) {
+        slab->levels = *levels;
+    }
+    slab->queuedNs = capture_stats_now_ns();
+    // Counted before the push so the consumer never subtracts what isn't there
+    queuedBytes_.fetch_add(length, std::memory_order_relaxed);
+    queuedFrames_.fetch_add(frames, std::memory_order_relaxed);
+    if (!dataRing_->TryPush(slab.get())) {
+        // Only the producer pushes and we made room above, so this cannot happen
+        ReleaseQueued(slab.get());
+        DropQueued(slab.get(), droppedNewest_);
+        return;
+    }
+    slab.release();
+
+    size_t queued = dataRing_->Size();
+    if (queued > peakQueued_.load(std::memory_order_relaxed)) {
+        peakQueued_.store(queued, std::memory_order_relaxed);
+    }
+
+    // Sub-chunk mode: wake JS once per full batch rather than per sub-chunk.
+    // Level reports are counted apart, so levels-only sessions batch too.
+    uint32_t batch = batchSubChunks_.load(std::memory_order_relaxed);
+    if (batch > 1) {
+        std::atomic<uint32_t>& unbatched = levels ? unbatchedLevels_ : unbatchedSubChunks_;
+        if (unbatched.fetch_add(1, std::memory_order_relaxed) + 1 < batch) return;
+    }
+
+    SchedulePush();
+}
+
 void AudioRecorderWrapper::QueueEvent(AudioEvent event) {
-    std::lock_guard<std::mutex> lock(eventMutex_);
-    eventQueue_.push(std::move(event));
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        controlQueue_.push(ControlEvent{dataRing_->WritePosition(), std::move(event)});
+    }
+    SchedulePush();
 }
 
-std::vector<AudioEvent> AudioRecorderWrapper::DrainEvents() {
-    std::lock_guard<std::mutex> lock(eventMutex_);
+// JS thread: a drop event for chunks dropped since the last one, if any
+bool AudioRecorderWrapper::TakeDropReport(AudioEvent* event) {
+    uint64_t oldest = droppedOldest_.load(std::memory_order_relaxed);
+    uint64_t newest = droppedNewest_.load(std::memory_order_relaxed);
+    uint64_t frames = droppedFrames_.load(std::memory_order_relaxed);
+    if (oldest == reportedOldest_ && newest == reportedNewest_) return false;
+
+    event->type = 9;
+    event->droppedOldest = oldest - reportedOldest_;
+    event->droppedNewest = newest - reportedNewest_;
+    event->droppedChunks = event->droppedOldest + event->droppedNewest;
+    event->droppedFrames = frames - reportedFrames_;
+    reportedOldest_ = oldest;
+    reportedNewest_ = newest;
+    reportedFrames_ = frames;
+    return true;
+}
+
+std::vector<AudioEvent> AudioRecorderWrapper::DrainEvents(size_t maxEvents) {
     std::vector<AudioEvent> events;
-    while (!eventQueue_.empty()) {
-        events.push_back(std::move(eventQueue_.front()));
-        eventQueue_.pop();
+
+    // Drops are reported ahead of the chunks that survived them, on top of maxEvents
+    AudioEvent drop;
+    if (TakeDropReport(&drop)) {
+        events.push_back(std::move(drop));
+        if (maxEvents != SIZE_MAX) maxEvents++;
+    }
+
+    while (events.size() < maxEvents) {
+        // Snapshot the write position before looking at the control queue: any
+        // control event queued after this check is ordered after these chunks.
+        uint64_t limit = dataRing_->WritePosition();
+        bool hasControl = false;
+        {
+            std::lock_guard<std::mutex> lock(eventMutex_);
+            if (!controlQueue_.empty()) {
+                hasControl = true;
+                limit = controlQueue_.front().position;
+            }
+        }
+
+        ChunkSlab* slab = nullptr;
+        uint64_t now = capture_stats_now_ns();
+        while (events.size() < maxEvents && dataRing_->TryPop(slab, limit)) {
+            ReleaseQueued(slab);
+            capture_stats_add_time(deliveryStats_, CAPTURE_STAGE_DELIVERY,
+                                   now > slab->queuedNs ? now - slab->queuedNs : 0);
+            AudioEvent event;
+            event.type = slab->isLevels ? 7 : 0;
+            event.data = ChunkSlabPtr(slab);
+            events.push_back(std::move(event));
+        }
+
+        if (!hasControl || events.size() >= maxEvents) {
+            break;
+        }
+
+        // Every chunk queued before the control event has been taken (or dropped)
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        events.push_back(std::move(controlQueue_.front().event));
+        controlQueue_.pop();
     }
+
+    // Room was made for a producer waiting under OverflowPolicy::Block
+    WakeProducer();
     return events;
 }
 
@@ -452,6 +2400,7 @@ struct MicActivityEvent {
     std::string deviceId;
     std::string deviceName;
     std::string message;
+    uint64_t queuedNs = 0;  // capture_stats_now_ns() when the callback queued it
 };
 
 class MicActivityMonitorWrapper : public Napi::ObjectWrap<MicActivityMonitorWrapper> {
@@ -469,6 +2418,8 @@ private:
     Napi::Value GetActiveDeviceIds(const Napi::CallbackInfo& info);
     Napi::Value GetActiveProcesses(const Napi::CallbackInfo& info);
     Napi::Value ProcessEvents(const Napi::CallbackInfo& info);
+    Napi::Value SetEventCallback(const Napi::CallbackInfo& info);
+    Napi::Value GetStats(const Napi::CallbackInfo& info);
 
     static void OnChange(bool isActive, void* context);
     static void OnDeviceChange(const char* deviceId, const char* deviceName, bool isActive, void* context);
@@ -476,11 +2427,28 @@ private:
 
     void QueueEvent(MicActivityEvent event);
     std::vector<MicActivityEvent> DrainEvents();
+    Napi::Array BuildEventArray(Napi::Env env, const std::vector<MicActivityEvent>& events);
+
+    friend void CallMicActivityEventCallback(Napi::Env env, Napi::Function callback,
+                                             MicActivityMonitorWrapper* self, void* data);
+    void SchedulePush();
+    void ReleaseEventCallback();
 
     MicActivityMonitorHandle handle_;
     std::mutex eventMutex_;
     std::queue<MicActivityEvent> eventQueue_;
     std::atomic<bool> isDestroyed_{false};
+
+    // Event counters by type, under eventMutex_; deliveryStats_ times queue-to-JS
+    uint64_t eventsQueued_[3] = {};
+    uint64_t eventsDelivered_ = 0;
+    size_t peakQueued_ = 0;
+    CaptureStats* deliveryStats_ = nullptr;
+
+    MicActivityEventTsfn eventTsfn_;
+    std::atomic<bool> pushEnabled_{false};
+    std::atomic<bool> pushPending_{false};
+    bool isMonitoring_ = false;
 };
 
 Napi::FunctionReference MicActivityMonitorWrapper::constructor;
@@ -495,6 +2463,8 @@ Napi::Object MicActivityMonitorWrapper::Init(Napi::Env env, Napi::Object exports
         InstanceMethod("getActiveDeviceIds", &MicActivityMonitorWrapper::GetActiveDeviceIds),
         InstanceMethod("getActiveProcesses", &MicActivityMonitorWrapper::GetActiveProcesses),
         InstanceMethod("processEvents", &MicActivityMonitorWrapper::ProcessEvents),
+        InstanceMethod("setEventCallback", &MicActivityMonitorWrapper::SetEventCallback),
+        InstanceMethod("getStats", &MicActivityMonitorWrapper::GetStats),
     });
 
     constructor = Napi::Persistent(func);
@@ -509,6 +2479,8 @@ MicActivityMonitorWrapper::MicActivityMonitorWrapper(const Napi::CallbackInfo& i
     DebugLog("MicActivityMonitorWrapper: Constructor starting");
     Napi::Env env = info.Env();
 
+    deliveryStats_ = capture_stats_create();
+
     DebugLog("MicActivityMonitorWrapper: Calling mic_activity_create");
     handle_ = mic_activity_create(
         &MicActivityMonitorWrapper::OnChange,
@@ -531,6 +2503,8 @@ MicActivityMonitorWrapper::~MicActivityMonitorWrapper() {
         mic_activity_destroy(handle_);
         handle_ = nullptr;
     }
+    ReleaseEventCallback();
+    capture_stats_destroy(deliveryStats_);
 }
 
 Napi::Value MicActivityMonitorWrapper::Start(const Napi::CallbackInfo& info) {
@@ -544,8 +2518,10 @@ Napi::Value MicActivityMonitorWrapper::Start(const Napi::CallbackInfo& info) {
     int32_t result = mic_activity_start(handle_, scope.c_str());
     if (result != 0) {
         Napi::Error::New(env, "Failed to start mic activity monitor").ThrowAsJavaScriptException();
+        return env.Undefined();
     }
 
+    isMonitoring_ = true;
     return env.Undefined();
 }
 
@@ -555,8 +2531,10 @@ Napi::Value MicActivityMonitorWrapper::Stop(const Napi::CallbackInfo& info) {
     int32_t result = mic_activity_stop(handle_);
     if (result != 0) {
         Napi::Error::New(env, "Failed to stop mic activity monitor").ThrowAsJavaScriptException();
+        return env.Undefined();
     }
 
+    isMonitoring_ = false;
     return env.Undefined();
 }
 
@@ -613,9 +2591,11 @@ Napi::Value MicActivityMonitorWrapper::GetActiveProcesses(const Napi::CallbackIn
 }
 
 Napi::Value MicActivityMonitorWrapper::ProcessEvents(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-
     std::vector<MicActivityEvent> events = DrainEvents();
+    return BuildEventArray(info.Env(), events);
+}
+
+Napi::Array MicActivityMonitorWrapper::BuildEventArray(Napi::Env env, const std::vector<MicActivityEvent>& events) {
     Napi::Array result = Napi::Array::New(env, events.size());
 
     for (size_t i = 0; i < events.size(); i++) {
@@ -646,6 +2626,97 @@ Napi::Value MicActivityMonitorWrapper::ProcessEvents(const Napi::CallbackInfo& i
     return result;
 }
 
+// setEventCallback(callback | null) - see AudioRecorderWrapper::SetEventCallback
+Napi::Value MicActivityMonitorWrapper::SetEventCallback(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (isMonitoring_) {
+        Napi::Error::New(env, "Cannot change the event callback while monitoring").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ReleaseEventCallback();
+
+    if (info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined()) {
+        return env.Undefined();
+    }
+
+    if (!info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    eventTsfn_ = MicActivityEventTsfn::New(
+        env,
+        info[0].As<Napi::Function>(),
+        "MicActivityMonitorEvents",
+        0,
+        1,
+        this,
+        [](Napi::Env, MicActivityMonitorWrapper* self) {
+            self->Unref();
+        }
+    );
+    Ref();
+
+    pushPending_ = false;
+    pushEnabled_ = true;
+
+    bool hasQueuedEvents;
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        hasQueuedEvents = !eventQueue_.empty();
+    }
+    if (hasQueuedEvents) {
+        SchedulePush();
+    }
+
+    return env.Undefined();
+}
+
+// getStats(): event counts since construction and the queue-to-JS latency
+Napi::Value MicActivityMonitorWrapper::GetStats(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+    Napi::Object stats = Napi::Object::New(env);
+
+    AudioCaptureStats delivery;
+    capture_stats_snapshot(deliveryStats_, &delivery);
+
+    std::lock_guard<std::mutex> lock(eventMutex_);
+    stats.Set("activityChanges", Napi::Number::New(env, static_cast<double>(eventsQueued_[0])));
+    stats.Set("deviceChanges", Napi::Number::New(env, static_cast<double>(eventsQueued_[1])));
+    stats.Set("errors", Napi::Number::New(env, static_cast<double>(eventsQueued_[2])));
+    stats.Set("eventsDelivered", Napi::Number::New(env, static_cast<double>(eventsDelivered_)));
+    stats.Set("queuedEvents", Napi::Number::New(env, static_cast<double>(eventQueue_.size())));
+    stats.Set("peakQueuedEvents", Napi::Number::New(env, static_cast<double>(peakQueued_)));
+    stats.Set("delivery", BuildStageStats(env, delivery.stages[CAPTURE_STAGE_DELIVERY]));
+    return stats;
+}
+
+void MicActivityMonitorWrapper::SchedulePush() {
+    if (!pushEnabled_) return;
+    if (pushPending_.exchange(true)) return;
+    eventTsfn_.NonBlockingCall();
+}
+
+void MicActivityMonitorWrapper::ReleaseEventCallback() {
+    if (pushEnabled_.exchange(false)) {
+        eventTsfn_.Release();
+    }
+}
+
+static void CallMicActivityEventCallback(Napi::Env env, Napi::Function callback,
+                                         MicActivityMonitorWrapper* self, void*) {
+    if (env == nullptr || self->isDestroyed_) return;
+
+    self->pushPending_ = false;
+
+    std::vector<MicActivityEvent> events = self->DrainEvents();
+    if (events.empty()) return;
+
+    callback.Call({self->BuildEventArray(env, events)});
+}
+
 void MicActivityMonitorWrapper::OnChange(bool isActive, void* context) {
     MicActivityMonitorWrapper* self = static_cast<MicActivityMonitorWrapper*>(context);
     if (self->isDestroyed_) return;
@@ -679,17 +2750,28 @@ void MicActivityMonitorWrapper::OnError(const char* message, void* context) {
 }
 
 void MicActivityMonitorWrapper::QueueEvent(MicActivityEvent event) {
-    std::lock_guard<std::mutex> lock(eventMutex_);
-    eventQueue_.push(std::move(event));
+    event.queuedNs = capture_stats_now_ns();
+    {
+        std::lock_guard<std::mutex> lock(eventMutex_);
+        eventsQueued_[event.type]++;
+        eventQueue_.push(std::move(event));
+        peakQueued_ = std::max(peakQueued_, eventQueue_.size());
+    }
+    SchedulePush();
 }
 
 std::vector<MicActivityEvent> MicActivityMonitorWrapper::DrainEvents() {
     std::lock_guard<std::mutex> lock(eventMutex_);
     std::vector<MicActivityEvent> events;
+    uint64_t now = capture_stats_now_ns();
     while (!eventQueue_.empty()) {
-        events.push_back(std::move(eventQueue_.front()));
+        MicActivityEvent& event = eventQueue_.front();
+        capture_stats_add_time(deliveryStats_, CAPTURE_STAGE_DELIVERY,
+                               now > event.queuedNs ? now - event.queuedNs : 0);
+        events.push_back(std::move(event));
         eventQueue_.pop();
     }
+    eventsDelivered_ += events.size();
     return events;
 }
 
@@ -697,17 +2779,7 @@ std::vector<MicActivityEvent> MicActivityMonitorWrapper::DrainEvents() {
 // Device Enumeration
 // ============================================================================
 
-Napi::Value ListDevices(const Napi::CallbackInfo& info) {
-    Napi::Env env = info.Env();
-
-    int32_t count = 0;
-
-    AudioDeviceInfo* deviceList = nullptr;
-    int32_t result = audio_list_devices(&deviceList, &count);
-    if (result != 0 || deviceList == nullptr || count == 0) {
-        return Napi::Array::New(env, 0);
-    }
-
+static Napi::Array BuildDeviceArray(Napi::Env env, const AudioDeviceInfo* deviceList, int32_t count) {
     Napi::Array arr = Napi::Array::New(env, count);
     for (int32_t i = 0; i < count; i++) {
         const AudioDeviceInfo& device = deviceList[i];
@@ -723,11 +2795,130 @@ Napi::Value ListDevices(const Napi::CallbackInfo& info) {
         obj.Set("channelCount", Napi::Number::New(env, device.channelCount));
         arr.Set(i, obj);
     }
+    return arr;
+}
+
+Napi::Value ListDevices(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    int32_t count = 0;
+
+    AudioDeviceInfo* deviceList = nullptr;
+    int32_t result = audio_list_devices(&deviceList, &count);
+    if (result != 0 || deviceList == nullptr || count == 0) {
+        return Napi::Array::New(env, 0);
+    }
 
+    Napi::Array arr = BuildDeviceArray(env, deviceList, count);
     audio_free_device_list(deviceList, count);
     return arr;
 }
 
+// Enumerates on a libuv worker thread; only a cache miss after a device
+// change is slow, but that one shouldn't block the JS thread either
+class ListDevicesWorker : public Napi::AsyncWorker {
+public:
+    explicit ListDevicesWorker(Napi::Env env)
+        : Napi::AsyncWorker(env, "ListAudioDevices"), deferred_(Napi::Promise::Deferred::New(env)) {}
+
+    ~ListDevicesWorker() override {
+        if (deviceList_) {
+            audio_free_device_list(deviceList_, count_);
+        }
+    }
+
+    Napi::Promise Promise() const { return deferred_.Promise(); }
+
+protected:
+    void Execute() override {
+        if (audio_list_devices(&deviceList_, &count_) != 0 || deviceList_ == nullptr) {
+            count_ = 0;
+        }
+    }
+
+    void OnOK() override {
+        deferred_.Resolve(BuildDeviceArray(Env(), deviceList_, count_));
+    }
+
+    void OnError(const Napi::Error& error) override {
+        deferred_.Reject(error.Value());
+    }
+
+private:
+    Napi::Promise::Deferred deferred_;
+    AudioDeviceInfo* deviceList_ = nullptr;
+    int32_t count_ = 0;
+};
+
+Napi::Value ListDevicesAsync(const Napi::CallbackInfo& info) {
+    auto* worker = new ListDevicesWorker(info.Env());
+    Napi::Promise promise = worker->Promise();
+    worker->Queue();
+    return promise;
+}
+
+// Device change notifications: one process-wide callback, called without
+// arguments. Notifications that arrive while a call is already queued are
+// folded into it, since the listener re-reads the whole list anyway.
+static Napi::ThreadSafeFunction g_deviceChangeTsfn;
+static bool g_deviceChangeEnabled = false;
+static std::atomic<bool> g_deviceChangePending{false};
+
+static void OnDeviceChange(void*) {
+    if (g_deviceChangePending.exchange(true)) return;
+
+    napi_status status = g_deviceChangeTsfn.NonBlockingCall([](Napi::Env env, Napi::Function callback) {
+        g_deviceChangePending = false;
+        if (env != nullptr) {
+            callback.Call({});
+        }
+    });
+    if (status != napi_ok) {
+        g_deviceChangePending = false;
+    }
+}
+
+// setDeviceChangeCallback(callback | null)
+Napi::Value SetDeviceChangeCallback(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    bool clearing = info.Length() < 1 || info[0].IsNull() || info[0].IsUndefined();
+    if (!clearing && !info[0].IsFunction()) {
+        Napi::TypeError::New(env, "Callback function expected").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    // No native call is in progress once this returns, so the old function can go
+    audio_set_device_change_callback(nullptr, nullptr);
+    if (g_deviceChangeEnabled) {
+        g_deviceChangeTsfn.Release();
+        g_deviceChangeEnabled = false;
+    }
+
+    if (clearing) {
+        return env.Undefined();
+    }
+
+    g_deviceChangeTsfn = Napi::ThreadSafeFunction::New(
+        env,
+        info[0].As<Napi::Function>(),
+        "AudioDeviceChange",
+        0,
+        1
+    );
+    // Watching devices alone shouldn't keep the process alive
+    g_deviceChangeTsfn.Unref(env);
+    g_deviceChangeEnabled = true;
+    g_deviceChangePending = false;
+
+    if (audio_set_device_change_callback(OnDeviceChange, nullptr) != 0) {
+        g_deviceChangeTsfn.Release();
+        g_deviceChangeEnabled = false;
+        Napi::Error::New(env, "Device change notifications are not available").ThrowAsJavaScriptException();
+    }
+    return env.Undefined();
+}
+
 Napi::Value GetDefaultInputDevice(const Napi::CallbackInfo& info) {
     Napi::Env env = info.Env();
 
@@ -875,6 +3066,61 @@ Napi::Value RequestMicPermission(const Napi::CallbackInfo& info) {
     return env.Undefined();
 }
 
+// ============================================================================
+// Shared ring (reader side)
+// ============================================================================
+
+// openSharedRing(name) -> ArrayBuffer over a named segment created by a
+// recorder's setSharedRing(name) in this or another process. The mapping
+// lives as long as the ArrayBuffer. Runtimes without external buffers
+// (Electron's V8 sandbox) can't map it; copying would defeat the point, so
+// that throws and callers use a SharedArrayBuffer ring instead.
+Napi::Value OpenSharedRing(const Napi::CallbackInfo& info) {
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString()) {
+        Napi::TypeError::New(env, "Expected (name: string)").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    SharedMemorySegment segment;
+    std::string error;
+    if (!segment.Open(info[0].As<Napi::String>().Utf8Value(), &error)) {
+        Napi::Error::New(env, error).ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    uint8_t* data = segment.Data();
+    size_t size = segment.Size();
+    segment.Release();  // Ownership of the mapping moves to the ArrayBuffer
+
+    // The C API, so napi_no_external_buffers_allowed can be told apart
+    size_t* mappedSize = new size_t(size);
+    napi_value buffer = nullptr;
+    napi_status status = napi_create_external_arraybuffer(
+        env, data, size,
+        [](napi_env, void* mapped, void* hint) {
+            size_t* finalizedSize = static_cast<size_t*>(hint);
+            SharedMemorySegment::Unmap(static_cast<uint8_t*>(mapped), *finalizedSize);
+            delete finalizedSize;
+        },
+        mappedSize, &buffer);
+    if (status != napi_ok) {
+        // The finalizer only runs for a created buffer
+        SharedMemorySegment::Unmap(data, size);
+        delete mappedSize;
+        if (status == napi_no_external_buffers_allowed) {
+            Napi::Error::New(env, "Named shared rings are unavailable under Electron; pass a SharedArrayBuffer")
+                .ThrowAsJavaScriptException();
+        } else {
+            Napi::Error::New(env).ThrowAsJavaScriptException();  // From the last N-API error
+        }
+        return env.Null();
+    }
+
+    return Napi::Value(env, buffer);
+}
+
 // ============================================================================
 // Module initialization
 // ============================================================================
@@ -890,6 +3136,8 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
 
     // Device enumeration
     exports.Set("listDevices", Napi::Function::New(env, ListDevices));
+    exports.Set("listDevicesAsync", Napi::Function::New(env, ListDevicesAsync));
+    exports.Set("setDeviceChangeCallback", Napi::Function::New(env, SetDeviceChangeCallback));
     exports.Set("getDefaultInputDevice", Napi::Function::New(env, GetDefaultInputDevice));
     exports.Set("getDefaultOutputDevice", Napi::Function::New(env, GetDefaultOutputDevice));
 
@@ -903,6 +3151,9 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     exports.Set("getMicPermissionStatus", Napi::Function::New(env, GetMicPermissionStatus));
     exports.Set("requestMicPermission", Napi::Function::New(env, RequestMicPermission));
 
+    // Shared ring reader for other processes
+    exports.Set("openSharedRing", Napi::Function::New(env, OpenSharedRing));
+
     DebugLog("Init: Module initialization complete");
     return exports;
 }
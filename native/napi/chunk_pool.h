@@ -0,0 +1,171 @@
+#pragma once
+
+#include <napi.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+#include "audio_chunk.h"
+#include "spsc_ring.h"
+
+/**
+ * Chunk Pool - Recycled slabs for audio chunks handed to JavaScript.
+ *
+ * A chunk is written into a slab once on the capture thread and the slab is
+ * then exposed to JS as an external Buffer. The Buffer's finalizer returns the
+ * slab to the pool, so steady-state capture allocates nothing: the same handful
+ * of slabs cycle between the capture thread, the event queue and JS.
+ *
+ * Lifetime: every slab that is out of the pool holds a shared_ptr to it, so the
+ * pool outlives the recorder if JS still references Buffers after the recorder
+ * is garbage collected.
+ *
+ * Threading: idle slabs live in an SPSC ring. Acquire() is the consumer (the
+ * capture thread) and Recycle() the producer (the JS thread, via finalizers),
+ * so neither side ever blocks the other.
+ */
+
+class ChunkPool;
+
+struct ChunkSlab {
+    std::unique_ptr<uint8_t[]> data;
+    size_t capacity = 0;
+    size_t length = 0;
+    AudioChunkInfo info{};  // Timing reported by the capture side
+    AudioLevels levels{};   // Set on level reports, which carry no data
+    bool isLevels = false;
+    bool reserved = false;  // From Reserve(): freed on return instead of pooled
+    uint64_t queuedNs = 0;  // capture_stats_now_ns() when it was queued for JS
+
+    // Set while the slab is checked out of the pool
+    std::shared_ptr<ChunkPool> pool;
+};
+
+// Returns a slab to its pool when an owning pointer goes out of scope without
+// the slab having been handed to JS (e.g. events dropped on destroy).
+struct ChunkSlabRecycler {
+    void operator()(ChunkSlab* slab) const;
+};
+
+using ChunkSlabPtr = std::unique_ptr<ChunkSlab, ChunkSlabRecycler>;
+
+class ChunkPool : public std::enable_shared_from_this<ChunkPool> {
+public:
+    // maxPooled bounds how many idle slabs are kept; extra slabs are freed.
+    static std::shared_ptr<ChunkPool> Create(size_t maxPooled = 64) {
+        return std::shared_ptr<ChunkPool>(new ChunkPool(maxPooled));
+    }
+
+    ~ChunkPool() {
+        ChunkSlab* slab = nullptr;
+        while (free_.TryPop(slab)) {
+            Free(slab);
+        }
+    }
+
+    // Check out a slab with room for `length` bytes and copy `data` into it.
+    // `reuse` lets the caller recycle a slab it already owns (e.g. one dropped
+    // from a full queue) without a round trip through the pool.
+    // Only allocates when no idle slab is large enough.
+    ChunkSlabPtr Acquire(const uint8_t* data, size_t length, ChunkSlab* reuse = nullptr) {
+        ChunkSlab* slab = reuse;
+        if (slab == nullptr) {
+            free_.TryPop(slab);  // Leaves slab null when no idle slab is left
+        }
+
+        if (slab == nullptr) {
+            slab = new ChunkSlab();
+            allocatedSlabs_++;
+        }
+
+        if (slab->capacity < length) {
+            slab->data.reset(new uint8_t[length]);
+            allocatedBytes_ += length - slab->capacity;
+            slab->capacity = length;
+        }
+
+        if (length > 0) {
+            std::memcpy(slab->data.get(), data, length);
+        }
+        slab->length = length;
+        slab->pool = shared_from_this();
+        return ChunkSlabPtr(slab);
+    }
+
+    // Check out an empty slab of `capacity` bytes ahead of time, for a caller
+    // that later passes it to Acquire() as `reuse` to copy a large block on the
+    // capture thread without allocating there. It is freed when it comes back,
+    // so the idle slabs stay chunk-sized.
+    ChunkSlabPtr Reserve(size_t capacity) {
+        ChunkSlab* slab = new ChunkSlab();
+        allocatedSlabs_++;
+        slab->data.reset(new uint8_t[capacity]);
+        allocatedBytes_ += capacity;
+        slab->capacity = capacity;
+        slab->reserved = true;
+        slab->pool = shared_from_this();
+        return ChunkSlabPtr(slab);
+    }
+
+    // Give a slab back. Called from the Buffer finalizer or ChunkSlabRecycler.
+    void Recycle(ChunkSlab* slab) {
+        slab->length = 0;
+        slab->info = AudioChunkInfo{};
+        slab->isLevels = false;
+        if (slab->reserved || !free_.TryPush(slab)) {
+            Free(slab);
+        }
+    }
+
+    // Free a slab outright. For the capture thread, which can't Recycle() since
+    // only the JS thread pushes slabs back into the idle ring.
+    void Discard(ChunkSlab* slab) {
+        std::shared_ptr<ChunkPool> self = std::move(slab->pool);
+        Free(slab);
+    }
+
+    // Transfer the slab to JS as an external Buffer. When the runtime does not
+    // allow external buffers (Electron's V8 sandbox) the data is copied and the
+    // finalizer runs immediately, so the slab is recycled either way.
+    static Napi::Buffer<uint8_t> ToBuffer(Napi::Env env, ChunkSlabPtr slab) {
+        ChunkSlab* raw = slab.release();
+        return Napi::Buffer<uint8_t>::NewOrCopy(
+            env, raw->data.get(), raw->length,
+            [](Napi::Env, uint8_t*, ChunkSlab* finalized) {
+                ChunkSlabRecycler()(finalized);
+            },
+            raw
+        );
+    }
+
+    // Number of slabs currently owned by the pool (idle or checked out)
+    size_t AllocatedSlabs() const { return allocatedSlabs_; }
+
+    // Bytes of chunk data those slabs hold
+    size_t AllocatedBytes() const { return allocatedBytes_; }
+
+private:
+    explicit ChunkPool(size_t maxPooled) : free_(maxPooled) {}
+
+    void Free(ChunkSlab* slab) {
+        allocatedBytes_ -= slab->capacity;
+        allocatedSlabs_--;
+        delete slab;
+    }
+
+    SpscRing<ChunkSlab*> free_;
+    std::atomic<size_t> allocatedSlabs_{0};
+    std::atomic<size_t> allocatedBytes_{0};
+};
+
+inline void ChunkSlabRecycler::operator()(ChunkSlab* slab) const {
+    // Move the pool reference out first: if it is the last one, the pool is
+    // destroyed after Recycle() returns and frees the slab with it.
+    std::shared_ptr<ChunkPool> pool = std::move(slab->pool);
+    if (pool) {
+        pool->Recycle(slab);
+    } else {
+        delete slab;
+    }
+}
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "audio_chunk.h"
+#include "audio_encoder.h"
+
+/**
+ * Lookback Ring - The last few seconds of chunks, kept natively so a recorder
+ * can listen without delivering anything to JS and still hand over what was
+ * captured just before it was asked to record.
+ *
+ * Chunks are kept as the pipeline emitted them, so outputFormat decides how
+ * compact the history is (s16 PCM, FLAC or Opus rather than f32). Records sit
+ * back to back in one buffer, allocated when the stream format is known, and
+ * the oldest are overwritten: history is bounded by duration (to the chunk)
+ * and by the buffer. WAV and FLAC only have a header in a stream's first
+ * chunk, so it is kept aside and put in front of history that has lost it.
+ *
+ * Record layout: u32 payload bytes (kWrapMarker = skip to the start of the
+ * buffer), u32 record flags, AudioChunkInfo, payload padded to 8 bytes.
+ * Positions are monotonic byte counts, as in the shared ring.
+ *
+ * Threading: none of its own. The recorder only uses it from the capture
+ * thread while a session runs and from the JS thread while none does.
+ */
+class LookbackRing {
+public:
+    // Size the ring for `ms` of the stream the metadata describes. History is
+    // kept when the format is unchanged (a new device mid-session), else it
+    // starts empty. The buffer holds `ms` of samples at bitsPerChannel plus
+    // headroom, which also bounds the compressed encodings.
+    void Configure(double ms, double sampleRate, uint32_t channels, uint32_t bitsPerChannel,
+                   const std::string& encoding) {
+        const uint64_t maxFrames = std::max<uint64_t>(1, static_cast<uint64_t>(ms * sampleRate / 1000.0));
+        const size_t rawBytes = static_cast<size_t>(maxFrames) * std::max<uint32_t>(1, channels) *
+                                (std::max<uint32_t>(bitsPerChannel, 16) / 8);
+        const size_t capacity = Align8(rawBytes + rawBytes / 4 + kHeadroomBytes);
+
+        if (capacity_ > 0 && sampleRate == sampleRate_ && channels == channels_ &&
+            bitsPerChannel == bitsPerChannel_ && encoding == encoding_) {
+            maxFrames_ = maxFrames;
+            if (capacity > capacity_) Grow(capacity);
+            return;
+        }
+
+        sampleRate_ = sampleRate;
+        channels_ = channels;
+        bitsPerChannel_ = bitsPerChannel;
+        encoding_ = encoding;
+        headerBytes_ = encoding == "wav" ? AUDIO_WAV_HEADER_BYTES
+                     : encoding == "flac" ? AUDIO_FLAC_HEADER_BYTES
+                     : 0;
+        maxFrames_ = maxFrames;
+        Allocate(capacity);
+        Clear();
+    }
+
+    // Free the buffer (lookback turned off)
+    void Release() {
+        data_.reset();
+        capacity_ = 0;
+        scratch_ = std::vector<uint8_t>();
+        Clear();
+    }
+
+    // Drop the history; the next chunk starts a new stream (and carries its header)
+    void Clear() {
+        head_ = tail_;
+        deliveredEnd_ = tail_;
+        count_ = 0;
+        bufferedFrames_ = 0;
+        haveHeader_ = false;
+    }
+
+    bool Enabled() const { return capacity_ > 0; }
+    bool Empty() const { return count_ == 0; }
+    double SampleRate() const { return sampleRate_; }
+
+    // Upper bound on one Collect(): the whole buffer plus the stream header
+    size_t MaxCollectBytes() const { return capacity_ > 0 ? capacity_ + headerBytes_ : 0; }
+
+    // Append a chunk, overwriting the oldest ones. Never allocates unless a chunk
+    // is too large for the buffer, which is then grown once.
+    void Write(const uint8_t* data, size_t length, const AudioChunkInfo& info) {
+        if (capacity_ == 0) return;
+
+        uint32_t recordFlags = 0;
+        if (headerBytes_ > 0 && !haveHeader_ && count_ == 0 && length >= headerBytes_) {
+            header_.assign(data, data + headerBytes_);
+            haveHeader_ = true;
+            recordFlags |= kStartsStream;
+        }
+
+        const size_t recordBytes = RecordBytes(length);
+        if (recordBytes * 2 > capacity_) {
+            Grow(capacity_ + recordBytes * 2);
+        }
+
+        size_t offset = static_cast<size_t>(tail_ % capacity_);
+        size_t tailRoom = capacity_ - offset;
+        size_t needed = recordBytes <= tailRoom ? recordBytes : tailRoom + recordBytes;
+        while (count_ > 0 && tail_ - head_ + needed > capacity_) {
+            EvictOldest();
+        }
+        if (count_ == 0 && recordBytes > tailRoom) {
+            // Nothing left to keep: start over at the beginning of the buffer
+            tail_ += tailRoom;
+            head_ = tail_;
+            offset = 0;
+            tailRoom = capacity_;
+            needed = recordBytes;
+        }
+
+        uint8_t* record = data_.get() + offset;
+        if (recordBytes > tailRoom) {
+            PutU32(record, kWrapMarker);
+            record = data_.get();
+        }
+        PutU32(record, static_cast<uint32_t>(length));
+        PutU32(record + 4, recordFlags);
+        std::memcpy(record + 8, &info, sizeof(AudioChunkInfo));
+        if (length > 0) std::memcpy(record + kRecordHeaderBytes, data, length);
+
+        tail_ += needed;
+        count_++;
+        bufferedFrames_ += info.frameCount;
+
+        // Keep just enough whole chunks to cover maxFrames_
+        while (count_ > 1 && bufferedFrames_ - OldestFrames() >= maxFrames_) {
+            EvictOldest();
+        }
+    }
+
+    // Everything held so far has reached JS; Collect(undeliveredOnly) skips it
+    void MarkDelivered() { deliveredEnd_ = tail_; }
+
+    // Join the newest chunks covering `ms` (all of them if ms <= 0) into one,
+    // oldest first, with the stream header in front if they don't start with
+    // it. `info` gets the first chunk's position and the frames of them all;
+    // DISCONTINUITY is set if any chunk follows a gap. *data stays valid until
+    // the next call. Returns false if there is nothing to collect.
+    bool Collect(double ms, bool undeliveredOnly, const uint8_t** data, size_t* length, AudioChunkInfo* info) {
+        uint64_t start = undeliveredOnly ? std::max(head_, deliveredEnd_) : head_;
+        if (capacity_ == 0 || start >= tail_) return false;
+
+        // Frames on offer, then skip the oldest chunks that aren't needed to cover ms
+        uint64_t available = 0;
+        size_t bytes = 0;
+        for (uint64_t position = start; position < tail_;) {
+            RecordView record = ReadRecord(position);
+            available += record.info.frameCount;
+            bytes += record.length;
+        }
+        const uint64_t wanted = ms > 0 ? static_cast<uint64_t>(ms * sampleRate_ / 1000.0) : available;
+        while (available > wanted) {
+            uint64_t position = start;
+            RecordView record = ReadRecord(position);
+            if (available - record.info.frameCount < wanted) break;
+            available -= record.info.frameCount;
+            bytes -= record.length;
+            start = position;
+        }
+
+        uint64_t position = start;
+        RecordView first = ReadRecord(position);
+        const bool addHeader = haveHeader_ && (first.flags & kStartsStream) == 0;
+        scratch_.resize((addHeader ? header_.size() : 0) + bytes);
+        uint8_t* out = scratch_.data();
+        if (addHeader) {
+            std::memcpy(out, header_.data(), header_.size());
+            out += header_.size();
+        }
+
+        AudioChunkInfo merged = first.info;
+        merged.frameCount = 0;
+        uint64_t nextFrame = first.info.framePosition;
+        bool silent = true;
+        RecordView record = first;
+        for (;;) {
+            if (record.info.framePosition != nextFrame) {
+                merged.flags |= AUDIO_CHUNK_FLAG_DISCONTINUITY;
+            }
+            merged.flags |= record.info.flags & AUDIO_CHUNK_FLAG_DISCONTINUITY;
+            silent = silent && (record.info.flags & AUDIO_CHUNK_FLAG_SILENT) != 0;
+            merged.frameCount += record.info.frameCount;
+            nextFrame = record.info.framePosition + record.info.frameCount;
+            if (record.length > 0) std::memcpy(out, record.payload, record.length);
+            out += record.length;
+            if (position >= tail_) break;
+            record = ReadRecord(position);
+        }
+        merged.flags = (merged.flags & ~AUDIO_CHUNK_FLAG_SILENT) | (silent ? AUDIO_CHUNK_FLAG_SILENT : 0);
+
+        *data = scratch_.data();
+        *length = scratch_.size();
+        *info = merged;
+        return true;
+    }
+
+private:
+    static constexpr uint32_t kWrapMarker = 0xFFFFFFFFu;
+    static constexpr uint32_t kStartsStream = 0x1;  // Record flag: begins with the stream header
+    static constexpr size_t kRecordHeaderBytes = (8 + sizeof(AudioChunkInfo) + 7) & ~size_t(7);
+    static constexpr size_t kHeadroomBytes = 64 * 1024;  // Record headers, container overhead
+
+    struct RecordView {
+        uint32_t length;
+        uint32_t flags;
+        AudioChunkInfo info;
+        const uint8_t* payload;
+    };
+
+    static size_t Align8(size_t bytes) { return (bytes + 7) & ~size_t(7); }
+    static size_t RecordBytes(size_t length) { return kRecordHeaderBytes + Align8(length); }
+
+    static void PutU32(uint8_t* out, uint32_t value) { std::memcpy(out, &value, 4); }
+    static uint32_t GetU32(const uint8_t* in) {
+        uint32_t value;
+        std::memcpy(&value, in, 4);
+        return value;
+    }
+
+    // Read the record at `position` (following a wrap marker) and advance past it
+    RecordView ReadRecord(uint64_t& position) const {
+        size_t offset = static_cast<size_t>(position % capacity_);
+        if (GetU32(data_.get() + offset) == kWrapMarker) {
+            position += capacity_ - offset;
+            offset = 0;
+        }
+        const uint8_t* record = data_.get() + offset;
+        RecordView view;
+        view.length = GetU32(record);
+        view.flags = GetU32(record + 4);
+        std::memcpy(&view.info, record + 8, sizeof(AudioChunkInfo));
+        view.payload = record + kRecordHeaderBytes;
+        position += RecordBytes(view.length);
+        return view;
+    }
+
+    uint32_t OldestFrames() const {
+        uint64_t position = head_;
+        return ReadRecord(position).info.frameCount;
+    }
+
+    void EvictOldest() {
+        RecordView record = ReadRecord(head_);
+        bufferedFrames_ -= record.info.frameCount;
+        count_--;
+    }
+
+    // Move the records into a larger buffer, oldest at its start, so the
+    // history and what has been delivered of it survive
+    void Grow(size_t capacity) {
+        std::unique_ptr<uint8_t[]> data(new uint8_t[capacity]);
+        size_t out = 0;
+        uint64_t deliveredEnd = 0;
+        bool deliveredFound = false;
+        for (uint64_t position = head_; position < tail_;) {
+            if (!deliveredFound && position >= deliveredEnd_) {
+                deliveredEnd = out;
+                deliveredFound = true;
+            }
+            RecordView record = ReadRecord(position);
+            const size_t bytes = RecordBytes(record.length);
+            std::memcpy(data.get() + out, record.payload - kRecordHeaderBytes, bytes);
+            out += bytes;
+        }
+
+        data_ = std::move(data);
+        capacity_ = capacity;
+        scratch_.reserve(capacity + headerBytes_);
+        head_ = 0;
+        tail_ = out;
+        deliveredEnd_ = deliveredFound ? deliveredEnd : out;
+    }
+
+    // Replace the buffer, dropping the records
+    void Allocate(size_t capacity) {
+        data_.reset(new uint8_t[capacity]);
+        capacity_ = capacity;
+        scratch_.reserve(capacity + headerBytes_);
+        head_ = tail_ = deliveredEnd_ = 0;
+        count_ = 0;
+        bufferedFrames_ = 0;
+    }
+
+    std::unique_ptr<uint8_t[]> data_;
+    size_t capacity_ = 0;
+    uint64_t head_ = 0;          // Oldest record
+    uint64_t tail_ = 0;          // Where the next record goes
+    uint64_t deliveredEnd_ = 0;  // Records before this have reached JS
+    size_t count_ = 0;
+    uint64_t bufferedFrames_ = 0;
+    uint64_t maxFrames_ = 0;
+
+    double sampleRate_ = 0;
+    uint32_t channels_ = 0;
+    uint32_t bitsPerChannel_ = 0;
+    std::string encoding_;
+    size_t headerBytes_ = 0;           // AUDIO_*_HEADER_BYTES of the encoding, 0 for none
+    std::vector<uint8_t> header_;      // The stream's header, once its first chunk was seen
+    bool haveHeader_ = false;
+    std::vector<uint8_t> scratch_;     // Collect() output, reserved up front
+};
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "audio_chunk.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * Shared Ring - Chunk records written straight into memory that another
+ * thread or process reads, so the JS main thread drops out of the data path.
+ *
+ * The memory is either a SharedArrayBuffer (readable from worker_threads) or a
+ * named OS shared-memory segment (readable from other processes). Layout, all
+ * little-endian, mirrored by src/shared-ring.ts:
+ *
+ *   Header (64 bytes, Int32 slots so JS can use Atomics on them):
+ *     [0] write position   bytes ever written, wraps at 2^32
+ *     [1] read position    advanced by the reader
+ *     [2] capacity         bytes in the data area, a power of two
+ *     [3] dropped chunks   records that didn't fit
+ *     [4] state            0 idle, 1 running, 2 stopped
+ *     [5] version          kVersion
+ *     [6] waiters          readers parked in Atomics.wait() on slot 0
+ *   Data area: records, each 8-byte aligned and never split across the end
+ *     u32 payload bytes (kWrapMarker = skip to the start of the data area)
+ *     u32 frame count, u32 sequence, u32 flags (AUDIO_CHUNK_FLAG_*)
+ *     f64 frame position, u64 host time (ns)
+ *     payload, padded to 8 bytes
+ *
+ * The capture thread is the only writer: a record is copied in, then the write
+ * position is published with a release store. A chunk that doesn't fit is
+ * dropped and counted instead of waiting for the reader. Native stores don't
+ * wake Atomics.wait() by themselves, so a reader about to wait bumps slot 6
+ * first; only then does a write ask the recorder's JS thread for an
+ * Atomics.notify() on slot 0, at most one outstanding. Readers also wait with
+ * a timeout, since that JS thread may be busy (and named segments can't be
+ * waited on at all).
+ */
+
+namespace shared_ring {
+
+constexpr size_t kHeaderBytes = 64;
+constexpr size_t kRecordHeaderBytes = 32;
+constexpr uint32_t kWrapMarker = 0xFFFFFFFFu;
+constexpr int32_t kVersion = 2;
+
+enum Slot { kWrite = 0, kRead = 1, kCapacity = 2, kDropped = 3, kState = 4, kVersionSlot = 5, kWaiters = 6 };
+enum State { kIdle = 0, kRunning = 1, kStopped = 2 };
+
+inline size_t RoundUpCapacity(size_t bytes) {
+    size_t capacity = 4096;
+    while (capacity < bytes && capacity < (size_t(1) << 30)) capacity <<= 1;
+    return capacity;
+}
+
+} // namespace shared_ring
+
+class SharedRingWriter {
+public:
+    static_assert(std::atomic<int32_t>::is_always_lock_free, "shared ring slots must be lock-free");
+
+    // Use `bytes` of `memory` laid out as above. With `initialize` the header is
+    // written from scratch (capacity = the largest power of two that fits);
+    // otherwise it must have been prepared by the JS side. Returns false if it
+    // doesn't describe a usable ring.
+    bool Attach(uint8_t* memory, size_t bytes, bool initialize) {
+        Detach();
+        if (!memory || bytes < shared_ring::kHeaderBytes + 4096) return false;
+
+        header_ = reinterpret_cast<std::atomic<int32_t>*>(memory);
+        if (initialize) {
+            uint32_t capacity = 4096;
+            while (size_t(capacity) * 2 <= bytes - shared_ring::kHeaderBytes && capacity < (1u << 30)) {
+                capacity <<= 1;
+            }
+            for (size_t i = 0; i < shared_ring::kHeaderBytes / 4; i++) {
+                header_[i].store(0, std::memory_order_relaxed);
+            }
+            header_[shared_ring::kCapacity].store(static_cast<int32_t>(capacity), std::memory_order_relaxed);
+            header_[shared_ring::kVersionSlot].store(shared_ring::kVersion, std::memory_order_relaxed);
+        }
+
+        const uint32_t capacity = Load(shared_ring::kCapacity);
+        if (header_[shared_ring::kVersionSlot].load(std::memory_order_relaxed) != shared_ring::kVersion ||
+            capacity < 4096 || (capacity & (capacity - 1)) != 0 ||
+            shared_ring::kHeaderBytes + capacity > bytes) {
+            header_ = nullptr;
+            return false;
+        }
+
+        data_ = memory + shared_ring::kHeaderBytes;
+        capacity_ = capacity;
+        SetState(shared_ring::kRunning);
+        return true;
+    }
+
+    void Detach() {
+        header_ = nullptr;
+        data_ = nullptr;
+        capacity_ = 0;
+    }
+
+    bool Attached() const { return header_ != nullptr; }
+
+    void SetState(int32_t state) {
+        if (header_) header_[shared_ring::kState].store(state, std::memory_order_release);
+    }
+
+    // Capture thread. Returns false (and counts a drop) if the record doesn't fit.
+    bool Write(const uint8_t* data, size_t length, const AudioChunkInfo* info) {
+        if (!header_) return false;
+
+        const size_t recordBytes = shared_ring::kRecordHeaderBytes + ((length + 7) & ~size_t(7));
+        const uint32_t write = Load(shared_ring::kWrite);
+        const uint32_t read = static_cast<uint32_t>(header_[shared_ring::kRead].load(std::memory_order_acquire));
+        const size_t used = static_cast<uint32_t>(write - read);
+        const size_t offset = write & (capacity_ - 1);
+        const size_t tailRoom = capacity_ - offset;
+        // A record that doesn't fit before the end skips the rest of the data area
+        const size_t needed = recordBytes <= tailRoom ? recordBytes : tailRoom + recordBytes;
+
+        if (recordBytes > capacity_ || used + needed > capacity_) {
+            header_[shared_ring::kDropped].fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        uint8_t* record = data_ + offset;
+        if (recordBytes > tailRoom) {
+            PutU32(record, shared_ring::kWrapMarker);
+            record = data_;
+        }
+
+        const AudioChunkInfo chunk = info ? *info : AudioChunkInfo{};
+        const double framePosition = static_cast<double>(chunk.framePosition);
+        PutU32(record, static_cast<uint32_t>(length));
+        PutU32(record + 4, chunk.frameCount);
+        PutU32(record + 8, static_cast<uint32_t>(chunk.sequence));
+        PutU32(record + 12, chunk.flags);
+        std::memcpy(record + 16, &framePosition, 8);
+        std::memcpy(record + 24, &chunk.hostTimeNs, 8);
+        if (length > 0) std::memcpy(record + shared_ring::kRecordHeaderBytes, data, length);
+
+        header_[shared_ring::kWrite].store(static_cast<int32_t>(write + static_cast<uint32_t>(needed)),
+                                           std::memory_order_release);
+        return true;
+    }
+
+    // Capture thread, after a Write(): whether a reader is parked and needs a
+    // notify. The fence orders the write position's store before this load,
+    // pairing with the reader bumping the count before it loads that position.
+    bool ReaderWaiting() const {
+        if (!header_) return false;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return header_[shared_ring::kWaiters].load(std::memory_order_relaxed) > 0;
+    }
+
+private:
+    uint32_t Load(int slot) const {
+        return static_cast<uint32_t>(header_[slot].load(std::memory_order_relaxed));
+    }
+
+    static void PutU32(uint8_t* out, uint32_t value) {
+        std::memcpy(out, &value, 4);  // Both supported platforms are little-endian
+    }
+
+    std::atomic<int32_t>* header_ = nullptr;
+    uint8_t* data_ = nullptr;
+    size_t capacity_ = 0;
+};
+
+/**
+ * Named shared-memory segment holding a shared ring ("Local\name" file
+ * mapping on Windows, shm_open("/name") elsewhere). The creator owns the name
+ * and removes it on Close(); processes that opened it keep their mapping.
+ */
+class SharedMemorySegment {
+public:
+    ~SharedMemorySegment() { Close(); }
+
+    bool Create(const std::string& name, size_t bytes, std::string* error) {
+        return Map(name, bytes, true, error);
+    }
+
+    bool Open(const std::string& name, std::string* error) {
+        return Map(name, 0, false, error);
+    }
+
+    uint8_t* Data() const { return data_; }
+    size_t Size() const { return size_; }
+
+    // Hand the mapping to someone else (e.g. an external ArrayBuffer's finalizer)
+    static void Unmap(uint8_t* data, size_t size) {
+        if (!data) return;
+#ifdef _WIN32
+        (void)size;
+        UnmapViewOfFile(data);
+#else
+        munmap(data, size);
+#endif
+    }
+
+    void Release() {
+        data_ = nullptr;
+        size_ = 0;
+        Close();
+    }
+
+    void Close() {
+        Unmap(data_, size_);
+        data_ = nullptr;
+        size_ = 0;
+#ifdef _WIN32
+        if (mapping_) {
+            CloseHandle(mapping_);
+            mapping_ = nullptr;
+        }
+#else
+        if (owner_ && !name_.empty()) shm_unlink(name_.c_str());
+#endif
+        owner_ = false;
+        name_.clear();
+    }
+
+private:
+    bool Map(const std::string& name, size_t bytes, bool create, std::string* error) {
+        Close();
+        if (name.empty() || name.find_first_of("/\\") != std::string::npos) {
+            if (error) *error = "Shared memory name must be non-empty and contain no slashes";
+            return false;
+        }
+
+#ifdef _WIN32
+        std::string fullName = "Local\\" + name;
+        int length = MultiByteToWideChar(CP_UTF8, 0, fullName.c_str(), -1, nullptr, 0);
+        std::wstring wideName(static_cast<size_t>(length > 0 ? length : 1), L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, fullName.c_str(), -1, &wideName[0], length);
+
+        if (create) {
+            const uint64_t size = bytes;
+            mapping_ = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                          static_cast<DWORD>(size >> 32), static_cast<DWORD>(size), wideName.c_str());
+            if (mapping_ && GetLastError() == ERROR_ALREADY_EXISTS) {
+                CloseHandle(mapping_);
+                mapping_ = nullptr;
+                if (error) *error = "Shared memory segment '" + name + "' already exists";
+                return false;
+            }
+        } else {
+            mapping_ = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, wideName.c_str());
+        }
+        if (!mapping_) {
+            if (error) *error = "Cannot " + std::string(create ? "create" : "open") + " shared memory segment '" + name + "'";
+            return false;
+        }
+
+        void* view = MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, bytes);
+        if (!view) {
+            Close();
+            if (error) *error = "Cannot map shared memory segment '" + name + "'";
+            return false;
+        }
+        MEMORY_BASIC_INFORMATION region{};
+        VirtualQuery(view, &region, sizeof(region));
+        data_ = static_cast<uint8_t*>(view);
+        size_ = create ? bytes : region.RegionSize;
+#else
+        name_ = "/" + name;
+        int fd = create ? shm_open(name_.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600)
+                        : shm_open(name_.c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            name_.clear();
+            if (error) *error = "Cannot " + std::string(create ? "create" : "open") + " shared memory segment '" + name + "'";
+            return false;
+        }
+        owner_ = create;
+
+        if (create && ftruncate(fd, static_cast<off_t>(bytes)) != 0) {
+            ::close(fd);
+            Close();
+            if (error) *error = "Cannot size shared memory segment '" + name + "'";
+            return false;
+        }
+        if (!create) {
+            struct stat info {};
+            fstat(fd, &info);
+            bytes = static_cast<size_t>(info.st_size);
+        }
+
+        void* view = bytes > 0 ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            Close();
+            if (error) *error = "Cannot map shared memory segment '" + name + "'";
+            return false;
+        }
+        data_ = static_cast<uint8_t*>(view);
+        size_ = bytes;
+#endif
+        if (!create) name_.clear();  // Only the creator removes the name
+        return true;
+    }
+
+    uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+    std::string name_;
+    bool owner_ = false;
+#ifdef _WIN32
+    HANDLE mapping_ = nullptr;
+#endif
+};
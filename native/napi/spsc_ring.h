@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * SPSC Ring - Bounded single-producer/single-consumer queue of pointer-sized slots.
+ *
+ * The producer (capture thread) never takes a lock or allocates: a push is one
+ * slot store plus a release store of the write position. Positions are
+ * monotonic 64-bit counters, so a position doubles as a sequence number that
+ * other queues can use to order their entries relative to this one.
+ *
+ * The read position is advanced with a CAS so the producer may also pop the
+ * oldest entry (drop-oldest overflow). The consumer only owns an entry once its
+ * CAS succeeds; until then it must not touch what the slot points to.
+ */
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1),
+          slots_(new std::atomic<T>[capacity_]) {
+        for (size_t i = 0; i < capacity_; i++) {
+            slots_[i].store(T{}, std::memory_order_relaxed);
+        }
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer only. Returns false if the ring is full.
+    bool TryPush(T value) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) >= capacity_) {
+            return false;
+        }
+        slots_[tail % capacity_].store(value, std::memory_order_relaxed);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer, or the producer stealing the oldest entry. Only pops entries
+    // whose position is below `limit`.
+    bool TryPop(T& out, uint64_t limit = UINT64_MAX) {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        for (;;) {
+            if (head >= limit || head == tail_.load(std::memory_order_acquire)) {
+                return false;
+            }
+            T value = slots_[head % capacity_].load(std::memory_order_relaxed);
+            if (head_.compare_exchange_weak(head, head + 1,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                out = value;
+                return true;
+            }
+        }
+    }
+
+    bool Full() const {
+        return WritePosition() - head_.load(std::memory_order_acquire) >= capacity_;
+    }
+
+    size_t Size() const {
+        uint64_t tail = tail_.load(std::memory_order_acquire);
+        uint64_t head = head_.load(std::memory_order_acquire);
+        return tail > head ? static_cast<size_t>(tail - head) : 0;
+    }
+
+    size_t Capacity() const { return capacity_; }
+
+    // Position the next pushed entry will get
+    uint64_t WritePosition() const { return tail_.load(std::memory_order_acquire); }
+
+private:
+    const size_t capacity_;
+    std::unique_ptr<std::atomic<T>[]> slots_;
+
+    // Kept on separate cache lines so producer and consumer don't false-share
+    alignas(64) std::atomic<uint64_t> head_{0};
+    alignas(64) std::atomic<uint64_t> tail_{0};
+};
@@ -0,0 +1,135 @@
+#include "capture_scheduler.h"
+#include <combaseapi.h>
+#include <avrt.h>
+#include <algorithm>
+
+#pragma comment(lib, "avrt.lib")
+
+CaptureScheduler& CaptureScheduler::Instance() {
+    static CaptureScheduler* instance = new CaptureScheduler();
+    return *instance;
+}
+
+CaptureScheduler::CaptureScheduler() {
+    unsigned cores = std::thread::hardware_concurrency();
+    maxWorkers_ = (std::min)(4u, (std::max)(1u, cores / 2));
+}
+
+bool CaptureScheduler::Add(ScheduledCapture* capture) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // Least loaded worker; a new one while below the pool size and all are busy
+    Worker* target = nullptr;
+    size_t targetLoad = SIZE_MAX;
+    for (auto& worker : workers_) {
+        std::lock_guard<std::mutex> workerLock(worker->mutex);
+        if (worker->streams.size() < targetLoad) {
+            target = worker.get();
+            targetLoad = worker->streams.size();
+        }
+    }
+
+    if (workers_.size() < maxWorkers_ && (target == nullptr || targetLoad > 0)) {
+        std::unique_ptr<Worker> worker(new Worker());
+        worker->wakeEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+        if (worker->wakeEvent) {
+            target = worker.get();
+            targetLoad = 0;
+            worker->thread = std::thread(&CaptureScheduler::Run, this, target);
+            workers_.push_back(std::move(worker));
+        }
+    }
+
+    if (target == nullptr || targetLoad >= kMaxStreamsPerWorker) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> workerLock(target->mutex);
+        target->streams.push_back(capture);
+        target->generation++;
+    }
+    SetEvent(target->wakeEvent);
+    return true;
+}
+
+void CaptureScheduler::Remove(ScheduledCapture* capture) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (auto& worker : workers_) {
+        std::unique_lock<std::mutex> workerLock(worker->mutex);
+        auto it = std::find(worker->streams.begin(), worker->streams.end(), capture);
+        if (it == worker->streams.end()) continue;
+
+        worker->streams.erase(it);
+        uint64_t generation = ++worker->generation;
+        SetEvent(worker->wakeEvent);
+
+        // The worker picks up the new set between servicing passes, so once it
+        // has, it can no longer be inside ServiceCapture for this stream
+        if (worker->thread.get_id() != std::this_thread::get_id()) {
+            worker->changed.wait(workerLock, [&] { return worker->appliedGeneration >= generation; });
+        }
+        return;
+    }
+}
+
+void CaptureScheduler::Run(Worker* worker) {
+    // Same setup as a dedicated capture thread, once for all its streams.
+    // Workers live as long as the process, so neither is ever undone.
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+
+    DWORD taskIndex = 0;
+    AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+
+    std::vector<ScheduledCapture*> active;
+    std::vector<HANDLE> handles;
+    DWORD timeout = INFINITE;
+
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mutex);
+            if (worker->appliedGeneration != worker->generation) {
+                active = worker->streams;
+                worker->appliedGeneration = worker->generation;
+                worker->changed.notify_all();
+
+                handles.assign(1, worker->wakeEvent);
+                timeout = INFINITE;
+                for (ScheduledCapture* capture : active) {
+                    if (HANDLE event = capture->CaptureWaitHandle()) {
+                        handles.push_back(event);
+                    }
+                    timeout = (std::min)(timeout, capture->CaptureWaitTimeoutMs());
+                }
+            }
+        }
+
+        DWORD waitResult = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, timeout);
+        if (waitResult == WAIT_FAILED) {
+            // Only a closed handle gets here; back off until the set changes
+            WaitForSingleObject(worker->wakeEvent, 10);
+            continue;
+        }
+        if (waitResult == WAIT_OBJECT_0) {
+            continue;  // Membership changed
+        }
+
+        // Service everyone: auto-reset events of streams drained here without
+        // being the one that woke us just cause one extra, empty pass
+        for (ScheduledCapture* capture : active) {
+            if (!capture->ServiceCapture()) {
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                auto it = std::find(worker->streams.begin(), worker->streams.end(), capture);
+                if (it != worker->streams.end()) {
+                    worker->streams.erase(it);
+                    worker->generation++;
+                }
+            } else if (capture->TakeWaitChanged()) {
+                // Same set, new handle or timeout: re-collect on the next pass
+                std::lock_guard<std::mutex> lock(worker->mutex);
+                worker->generation++;
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <windows.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Capture Scheduler - Services many WASAPI capture streams from a small pool
+ * of threads instead of one thread (and MMCSS registration) per stream.
+ *
+ * Each worker thread waits on the buffer events of all its streams with one
+ * WaitForMultipleObjects call and then services every stream in turn, so a
+ * signal from any of them drains all that have data. Streams without an event
+ * (timer-polled endpoints) are serviced on the shortest poll interval any of
+ * the worker's streams asks for. Workers are started lazily, up to one per two
+ * cores (at most 4), and new streams go to the least loaded one.
+ *
+ * This is what makes per-process loopback scale: each process needs its own
+ * audio client, but eight of them no longer mean eight capture threads.
+ */
+class ScheduledCapture {
+public:
+    virtual ~ScheduledCapture() = default;
+
+    // Event WASAPI signals when a packet is ready, or nullptr if polled
+    virtual HANDLE CaptureWaitHandle() const = 0;
+
+    // Longest the stream may go unserviced (timer polling, silence generation)
+    virtual DWORD CaptureWaitTimeoutMs() const = 0;
+
+    // True once after the last ServiceCapture() changed what the two above
+    // return (a device switch between event and timer mode), so the worker
+    // collects them again
+    virtual bool TakeWaitChanged() = 0;
+
+    // Drain available packets. Returning false detaches the stream (it has
+    // already reported the error); it is not serviced again.
+    virtual bool ServiceCapture() = 0;
+};
+
+class CaptureScheduler {
+public:
+    static CaptureScheduler& Instance();
+
+    // Start servicing `capture`. Returns false if no worker could take it.
+    bool Add(ScheduledCapture* capture);
+
+    // Stop servicing `capture`; returns once no worker is inside ServiceCapture for it
+    void Remove(ScheduledCapture* capture);
+
+private:
+    // One WaitForMultipleObjects call covers the wake event plus 63 streams
+    static const size_t kMaxStreamsPerWorker = MAXIMUM_WAIT_OBJECTS - 1;
+
+    struct Worker {
+        std::thread thread;
+        HANDLE wakeEvent = nullptr;
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<ScheduledCapture*> streams;   // Guarded by mutex
+        uint64_t generation = 0;                  // Bumped on every membership or wait change
+        uint64_t appliedGeneration = 0;           // Last generation the thread picked up
+    };
+
+    // Never destroyed: joining threads while the DLL unloads would deadlock
+    // on the loader lock, and idle workers cost nothing but a blocked wait
+    CaptureScheduler();
+
+    CaptureScheduler(const CaptureScheduler&) = delete;
+    CaptureScheduler& operator=(const CaptureScheduler&) = delete;
+
+    void Run(Worker* worker);
+
+    std::mutex mutex_;                            // Guards workers_
+    std::vector<std::unique_ptr<Worker>> workers_;
+    size_t maxWorkers_;
+};
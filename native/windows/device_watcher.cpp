@@ -0,0 +1,156 @@
+#include "device_watcher.h"
+#include "wasapi_capture.h"
+#include <combaseapi.h>
+#include <algorithm>
+#include <cstring>
+
+static bool SameKey(const PROPERTYKEY& a, const PROPERTYKEY& b) {
+    return a.pid == b.pid && IsEqualGUID(a.fmtid, b.fmtid);
+}
+
+static char* CopyString(const char* str) {
+    return str ? _strdup(str) : nullptr;
+}
+
+DeviceWatcher& DeviceWatcher::Instance() {
+    static DeviceWatcher* instance = new DeviceWatcher();
+    return *instance;
+}
+
+std::vector<AudioDeviceInfo> DeviceWatcher::Snapshot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    bool registered = EnsureRegistered();
+    uint64_t generation = generation_.load();
+    if (!registered || cachedGeneration_ != generation) {
+        // A notification during enumeration bumps generation_ again, so the
+        // next snapshot enumerates once more instead of keeping a stale list
+        std::vector<AudioDeviceInfo> devices = AudioDeviceEnumerator::ListAllDevices();
+        FreeDevices(devices_);
+        devices_ = std::move(devices);
+        cachedGeneration_ = registered ? generation : 0;
+    }
+
+    std::vector<AudioDeviceInfo> copy(devices_);
+    for (AudioDeviceInfo& device : copy) {
+        device.uid = CopyString(device.uid);
+        device.name = CopyString(device.name);
+        device.manufacturer = CopyString(device.manufacturer);
+    }
+    return copy;
+}
+
+void DeviceWatcher::SetChangeCallback(AudioDeviceChangeCallback callback, void* context) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        EnsureRegistered();
+    }
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    callback_ = callback;
+    callbackContext_ = context;
+}
+
+bool DeviceWatcher::AddDefaultListener(DefaultDeviceCallback callback, void* context) {
+    if (!callback) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!EnsureRegistered()) return false;
+    }
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    defaultListeners_.push_back({ callback, context });
+    return true;
+}
+
+void DeviceWatcher::RemoveDefaultListener(void* context) {
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    defaultListeners_.erase(
+        std::remove_if(defaultListeners_.begin(), defaultListeners_.end(),
+                       [context](const DefaultListener& listener) { return listener.context == context; }),
+        defaultListeners_.end());
+}
+
+bool DeviceWatcher::EnsureRegistered() {
+    if (enumerator_) return true;
+
+    IMMDeviceEnumerator* enumerator = nullptr;
+    HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                  __uuidof(IMMDeviceEnumerator), (void**)&enumerator);
+    if (FAILED(hr)) return false;
+
+    hr = enumerator->RegisterEndpointNotificationCallback(this);
+    if (FAILED(hr)) {
+        enumerator->Release();
+        return false;
+    }
+
+    // Kept for the process lifetime; releasing it would end the notifications
+    enumerator_ = enumerator;
+    return true;
+}
+
+void DeviceWatcher::Invalidate() {
+    generation_++;
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    if (callback_) {
+        callback_(callbackContext_);
+    }
+}
+
+void DeviceWatcher::FreeDevices(std::vector<AudioDeviceInfo>& devices) {
+    for (AudioDeviceInfo& device : devices) {
+        free(device.uid);
+        free(device.name);
+        free(device.manufacturer);
+    }
+    devices.clear();
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::QueryInterface(REFIID riid, void** ppvObject) {
+    if (!ppvObject) return E_POINTER;
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+        *ppvObject = static_cast<IMMNotificationClient*>(this);
+        return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::OnDeviceStateChanged(LPCWSTR, DWORD) {
+    Invalidate();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::OnDeviceAdded(LPCWSTR) {
+    Invalidate();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::OnDeviceRemoved(LPCWSTR) {
+    Invalidate();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR) {
+    // Sent once per role; the list and capture use the console default only
+    if (role != eConsole) return S_OK;
+    Invalidate();
+
+    std::lock_guard<std::mutex> lock(callbackMutex_);
+    for (const DefaultListener& listener : defaultListeners_) {
+        listener.callback(flow, listener.context);
+    }
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE DeviceWatcher::OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY key) {
+    // Endpoints change many properties nobody lists (jack info, levels);
+    // only the ones behind AudioDeviceInfo invalidate the cache
+    if (SameKey(key, PKEY_Device_FriendlyName) || SameKey(key, PKEY_Device_DeviceDesc) ||
+        SameKey(key, PKEY_AudioEngine_DeviceFormat)) {
+        Invalidate();
+    }
+    return S_OK;
+}
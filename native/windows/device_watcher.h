@@ -0,0 +1,89 @@
+#pragma once
+
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include "audio_bridge.h"
+
+/**
+ * Device Watcher - Process-wide cache of the endpoint list, kept current by
+ * an IMMNotificationClient.
+ *
+ * Enumerating opens every endpoint's property store and activates a client
+ * for its mix format, which takes tens of milliseconds with a few devices.
+ * The watcher registers for endpoint notifications on first use and only
+ * enumerates again after one of them reports a change (a device added,
+ * removed, enabled or disabled, renamed or reformatted, or a new console
+ * default), so repeated listing is a copy of the last result.
+ *
+ * Notifications arrive on a system thread; the change callback is invoked
+ * there, after the cache has been marked stale. Capture sessions following
+ * the default device register their own default-device listeners.
+ */
+
+// Called on the notification thread when the console default for `flow` changes.
+// Must return quickly: no COM calls, no waiting on the capture thread.
+typedef void (*DefaultDeviceCallback)(EDataFlow flow, void* context);
+
+class DeviceWatcher : public IMMNotificationClient {
+public:
+    static DeviceWatcher& Instance();
+
+    // Copy of the current device list; strings are allocated with _strdup
+    // and freed by audio_free_device_list()
+    std::vector<AudioDeviceInfo> Snapshot();
+
+    // Replace the change callback (nullptr clears it). Returns once no call
+    // to the previous callback is in progress.
+    void SetChangeCallback(AudioDeviceChangeCallback callback, void* context);
+
+    // Add a default-device listener; false if notifications are unavailable
+    bool AddDefaultListener(DefaultDeviceCallback callback, void* context);
+
+    // Remove the listeners registered with context. Returns once no call to
+    // them is in progress.
+    void RemoveDefaultListener(void* context);
+
+    // IUnknown - the instance is static, so reference counting is a no-op
+    ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+    ULONG STDMETHODCALLTYPE Release() override { return 1; }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+
+    // IMMNotificationClient
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR deviceId, DWORD newState) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR deviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR deviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR defaultDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR deviceId, const PROPERTYKEY key) override;
+
+private:
+    // Never destroyed: unregistering during DLL unload would call into
+    // MMDevAPI under the loader lock
+    DeviceWatcher() = default;
+
+    DeviceWatcher(const DeviceWatcher&) = delete;
+    DeviceWatcher& operator=(const DeviceWatcher&) = delete;
+
+    // Register for notifications once; false keeps every Snapshot() enumerating
+    bool EnsureRegistered();
+    void Invalidate();
+    static void FreeDevices(std::vector<AudioDeviceInfo>& devices);
+
+    std::mutex mutex_;                       // Guards devices_, cachedGeneration_, enumerator_
+    std::vector<AudioDeviceInfo> devices_;
+    uint64_t cachedGeneration_ = 0;
+    std::atomic<uint64_t> generation_{1};    // Bumped by every notification
+    IMMDeviceEnumerator* enumerator_ = nullptr;
+
+    std::mutex callbackMutex_;               // Held while any callback runs
+    AudioDeviceChangeCallback callback_ = nullptr;
+    void* callbackContext_ = nullptr;
+
+    struct DefaultListener {
+        DefaultDeviceCallback callback;
+        void* context;
+    };
+    std::vector<DefaultListener> defaultListeners_;  // Under callbackMutex_
+};
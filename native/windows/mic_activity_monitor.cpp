@@ -0,0 +1,685 @@
+#include "mic_activity_monitor.h"
+#include <combaseapi.h>
+#include <functiondiscoverykeys_devpkey.h>
+#include <Psapi.h>
+#include <algorithm>
+#include <atomic>
+
+#pragma comment(lib, "Psapi.lib")
+
+static std::string WideToUtf8(const std::wstring& wstr) {
+    if (wstr.empty()) return "";
+    int len = WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, nullptr, 0, nullptr, nullptr);
+    if (len <= 0) return "";
+    std::string result(len - 1, 0);
+    WideCharToMultiByte(CP_UTF8, 0, wstr.c_str(), -1, &result[0], len, nullptr, nullptr);
+    return result;
+}
+
+static std::string GetProcessNameFromPid(DWORD pid) {
+    std::wstring name;
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, FALSE, pid);
+    if (hProcess) {
+        WCHAR buffer[MAX_PATH];
+        if (GetModuleBaseNameW(hProcess, NULL, buffer, MAX_PATH) > 0) {
+            name = buffer;
+            // Remove .exe extension if present
+            size_t extPos = name.rfind(L".exe");
+            if (extPos != std::wstring::npos && extPos == name.length() - 4) {
+                name = name.substr(0, extPos);
+            }
+        }
+        CloseHandle(hProcess);
+    }
+    return name.empty() ? "Unknown" : WideToUtf8(name);
+}
+
+static std::string GetDeviceName(IMMDevice* device) {
+    std::string name;
+    IPropertyStore* props = nullptr;
+    if (SUCCEEDED(device->OpenPropertyStore(STGM_READ, &props))) {
+        PROPVARIANT value;
+        PropVariantInit(&value);
+        if (SUCCEEDED(props->GetValue(PKEY_Device_FriendlyName, &value)) &&
+            value.vt == VT_LPWSTR && value.pwszVal) {
+            name = WideToUtf8(value.pwszVal);
+        }
+        PropVariantClear(&value);
+        props->Release();
+    }
+    return name;
+}
+
+// Counts a notification callback into its monitor's callbacksInFlight_
+struct CallbackScope {
+    explicit CallbackScope(std::atomic<int>& count) : count_(count) { count_++; }
+    ~CallbackScope() { count_--; }
+
+    std::atomic<int>& count_;
+};
+
+// ============================================================================
+// Session callbacks
+// ============================================================================
+
+// Events of one session. The fields below the interface are guarded by the
+// monitor's mutex.
+class MicActivityMonitor::SessionEvents : public IAudioSessionEvents {
+public:
+    SessionEvents(MicActivityMonitor* monitor, IAudioSessionControl* control)
+        : monitor_(monitor), control(control) {
+        control->AddRef();
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&refs_); }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG refs = InterlockedDecrement(&refs_);
+        if (refs == 0) delete this;
+        return refs;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+        if (!ppvObject) return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionEvents)) {
+            AddRef();
+            *ppvObject = static_cast<IAudioSessionEvents*>(this);
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnDisplayNameChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnIconPathChanged(LPCWSTR, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnSimpleVolumeChanged(float, BOOL, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnChannelVolumeChanged(DWORD, float[], DWORD, LPCGUID) override { return S_OK; }
+    HRESULT STDMETHODCALLTYPE OnGroupingParamChanged(LPCGUID, LPCGUID) override { return S_OK; }
+
+    HRESULT STDMETHODCALLTYPE OnStateChanged(AudioSessionState state) override {
+        CallbackScope scope(monitor_->callbacksInFlight_);
+        monitor_->OnSessionStateChanged(this, state);
+        return S_OK;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSessionDisconnected(AudioSessionDisconnectReason) override {
+        // The device went away, changed format or the audio service stopped;
+        // the session is gone for good either way
+        CallbackScope scope(monitor_->callbacksInFlight_);
+        monitor_->OnSessionStateChanged(this, AudioSessionStateExpired);
+        return S_OK;
+    }
+
+    MicActivityMonitor* monitor_;
+    IAudioSessionControl* control;
+    std::wstring endpointId;
+    std::wstring instanceId;
+    DWORD pid = 0;                 // 0 for sessions shared by several processes
+    std::string processName;
+    bool systemSounds = false;     // Not counted as microphone use
+    bool active = false;
+    bool expired = false;          // Dropped by the next SyncEndpoints()
+    uint32_t stateChanges = 0;
+
+private:
+    ~SessionEvents() { control->Release(); }
+
+    LONG refs_ = 1;
+};
+
+// New sessions on one endpoint
+class MicActivityMonitor::SessionNotifier : public IAudioSessionNotification {
+public:
+    SessionNotifier(MicActivityMonitor* monitor, const std::wstring& endpointId)
+        : monitor_(monitor), endpointId_(endpointId) {}
+
+    ULONG STDMETHODCALLTYPE AddRef() override { return InterlockedIncrement(&refs_); }
+
+    ULONG STDMETHODCALLTYPE Release() override {
+        ULONG refs = InterlockedDecrement(&refs_);
+        if (refs == 0) delete this;
+        return refs;
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override {
+        if (!ppvObject) return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(IAudioSessionNotification)) {
+            AddRef();
+            *ppvObject = static_cast<IAudioSessionNotification*>(this);
+            return S_OK;
+        }
+        *ppvObject = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    HRESULT STDMETHODCALLTYPE OnSessionCreated(IAudioSessionControl* newSession) override {
+        CallbackScope scope(monitor_->callbacksInFlight_);
+        if (newSession) {
+            monitor_->OnSessionCreated(endpointId_, newSession);
+        }
+        return S_OK;
+    }
+
+private:
+    ~SessionNotifier() = default;
+
+    MicActivityMonitor* monitor_;
+    std::wstring endpointId_;
+    LONG refs_ = 1;
+};
+
+// ============================================================================
+// MicActivityMonitor
+// ============================================================================
+
+MicActivityMonitor::MicActivityMonitor(MicActivityChangeCallback changeCallback,
+                                       MicActivityDeviceCallback deviceCallback,
+                                       MicActivityErrorCallback errorCallback,
+                                       void* context)
+    : changeCallback_(changeCallback),
+      deviceCallback_(deviceCallback),
+      errorCallback_(errorCallback),
+      context_(context) {}
+
+MicActivityMonitor::~MicActivityMonitor() {
+    Stop();
+    if (syncWork_) {
+        CloseThreadpoolWork(syncWork_);
+    }
+}
+
+int32_t MicActivityMonitor::Start(bool allDevices) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) return 0;
+    }
+
+    if (!syncWork_) {
+        syncWork_ = CreateThreadpoolWork(&MicActivityMonitor::SyncWork, this, nullptr);
+        if (!syncWork_) return -1;
+    }
+
+    HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                  __uuidof(IMMDeviceEnumerator), (void**)&enumerator_);
+    if (FAILED(hr)) {
+        enumerator_ = nullptr;
+        return -1;
+    }
+
+    allDevices_ = allDevices;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        running_ = true;
+        stopping_ = false;
+    }
+
+    if (FAILED(enumerator_->RegisterEndpointNotificationCallback(this))) {
+        EmitError("Failed to register for device notifications; devices added later are not monitored");
+    }
+
+    SyncEndpoints();
+    return 0;
+}
+
+int32_t MicActivityMonitor::Stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!running_) return 0;
+        stopping_ = true;
+    }
+
+    enumerator_->UnregisterEndpointNotificationCallback(this);
+    // Nothing is submitted once stopping_ is set, so this covers every sync
+    WaitForThreadpoolWorkCallbacks(syncWork_, TRUE);
+
+    std::vector<std::unique_ptr<Endpoint>> endpoints;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        endpoints.swap(endpoints_);
+        running_ = false;
+        aggregateActive_ = false;
+    }
+    for (auto& endpoint : endpoints) {
+        ReleaseEndpoint(std::move(endpoint));
+    }
+
+    while (callbacksInFlight_.load() > 0) {
+        Sleep(1);
+    }
+
+    enumerator_->Release();
+    enumerator_ = nullptr;
+    return 0;
+}
+
+bool MicActivityMonitor::IsActive() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return aggregateActive_;
+}
+
+std::vector<std::string> MicActivityMonitor::ActiveDeviceIds() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<std::string> ids;
+    for (const auto& endpoint : endpoints_) {
+        if (endpoint->activeSessions > 0) {
+            ids.push_back(endpoint->uid);
+        }
+    }
+    return ids;
+}
+
+std::vector<MicActivityMonitor::Process> MicActivityMonitor::ActiveProcesses() {
+    std::vector<Process> processes;
+    auto add = [&processes](DWORD pid, const std::string& name) {
+        for (const Process& process : processes) {
+            if (process.pid == pid) return;
+        }
+        processes.push_back({pid, name});
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (running_) {
+            for (const auto& endpoint : endpoints_) {
+                for (const SessionEvents* session : endpoint->sessions) {
+                    if (session->active && !session->systemSounds && session->pid != 0) {
+                        add(session->pid, session->processName);
+                    }
+                }
+            }
+            return processes;
+        }
+    }
+
+    // Not monitoring: one pass over the default endpoint's sessions
+    IMMDeviceEnumerator* enumerator = nullptr;
+    IMMDevice* device = nullptr;
+    IAudioSessionManager2* manager = nullptr;
+    IAudioSessionEnumerator* sessions = nullptr;
+
+    HRESULT hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                  __uuidof(IMMDeviceEnumerator), (void**)&enumerator);
+    if (SUCCEEDED(hr)) hr = enumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &device);
+    if (SUCCEEDED(hr)) hr = device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr, (void**)&manager);
+    if (SUCCEEDED(hr)) hr = manager->GetSessionEnumerator(&sessions);
+
+    int count = 0;
+    if (SUCCEEDED(hr)) sessions->GetCount(&count);
+
+    for (int i = 0; i < count; i++) {
+        IAudioSessionControl* control = nullptr;
+        if (FAILED(sessions->GetSession(i, &control))) continue;
+
+        AudioSessionState state;
+        IAudioSessionControl2* control2 = nullptr;
+        if (SUCCEEDED(control->GetState(&state)) && state == AudioSessionStateActive &&
+            SUCCEEDED(control->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2))) {
+            DWORD pid = 0;
+            if (control2->IsSystemSoundsSession() != S_OK && control2->GetProcessId(&pid) == S_OK && pid != 0) {
+                add(pid, GetProcessNameFromPid(pid));
+            }
+            control2->Release();
+        }
+        control->Release();
+    }
+
+    if (sessions) sessions->Release();
+    if (manager) manager->Release();
+    if (device) device->Release();
+    if (enumerator) enumerator->Release();
+    return processes;
+}
+
+void CALLBACK MicActivityMonitor::SyncWork(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK) {
+    static_cast<MicActivityMonitor*>(context)->SyncEndpoints();
+}
+
+void MicActivityMonitor::ScheduleSync() {
+    // With mutex_ held, so Stop() can't miss a submission
+    if (running_ && !stopping_) {
+        SubmitThreadpoolWork(syncWork_);
+    }
+}
+
+void MicActivityMonitor::SyncEndpoints() {
+    // Work items may run concurrently; only one of them changes registrations
+    static std::mutex syncMutex;
+    std::lock_guard<std::mutex> syncLock(syncMutex);
+
+    std::vector<IMMDevice*> devices;
+    if (allDevices_) {
+        IMMDeviceCollection* collection = nullptr;
+        if (SUCCEEDED(enumerator_->EnumAudioEndpoints(eCapture, DEVICE_STATE_ACTIVE, &collection))) {
+            UINT count = 0;
+            collection->GetCount(&count);
+            for (UINT i = 0; i < count; i++) {
+                IMMDevice* device = nullptr;
+                if (SUCCEEDED(collection->Item(i, &device))) {
+                    devices.push_back(device);
+                }
+            }
+            collection->Release();
+        }
+    } else {
+        IMMDevice* device = nullptr;
+        if (SUCCEEDED(enumerator_->GetDefaultAudioEndpoint(eCapture, eConsole, &device))) {
+            devices.push_back(device);
+        } else {
+            EmitError("No default input device found");
+        }
+    }
+
+    std::vector<std::wstring> ids;
+    for (IMMDevice* device : devices) {
+        LPWSTR id = nullptr;
+        if (SUCCEEDED(device->GetId(&id))) {
+            ids.push_back(id);
+            CoTaskMemFree(id);
+        } else {
+            ids.push_back(L"");
+        }
+    }
+
+    std::vector<std::unique_ptr<Endpoint>> removed;
+    std::vector<SessionEvents*> expired;
+    std::vector<bool> known(devices.size(), false);
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        std::vector<Notice> notices;
+
+        if (!stopping_) {
+            for (auto it = endpoints_.begin(); it != endpoints_.end();) {
+                auto match = std::find(ids.begin(), ids.end(), (*it)->id);
+                if (match == ids.end()) {
+                    if ((*it)->activeSessions > 0) {
+                        notices.push_back({false, (*it)->uid, (*it)->name, false});
+                    }
+                    removed.push_back(std::move(*it));
+                    it = endpoints_.erase(it);
+                    continue;
+                }
+                known[match - ids.begin()] = true;
+
+                auto& sessions = (*it)->sessions;
+                auto keep = std::stable_partition(sessions.begin(), sessions.end(),
+                                                  [](SessionEvents* s) { return !s->expired; });
+                expired.insert(expired.end(), keep, sessions.end());
+                sessions.erase(keep, sessions.end());
+                ++it;
+            }
+            if (!notices.empty()) {
+                UpdateAggregate(notices);
+            }
+        }
+
+        Fire(lock, notices);
+    }
+
+    for (auto& endpoint : removed) {
+        ReleaseEndpoint(std::move(endpoint));
+    }
+    for (SessionEvents* session : expired) {
+        ReleaseSession(session);
+    }
+
+    for (size_t i = 0; i < devices.size(); i++) {
+        if (!known[i] && !ids[i].empty()) {
+            AddEndpoint(devices[i]);
+        }
+        devices[i]->Release();
+    }
+}
+
+void MicActivityMonitor::AddEndpoint(IMMDevice* device) {
+    LPWSTR rawId = nullptr;
+    if (FAILED(device->GetId(&rawId))) return;
+
+    auto endpoint = std::make_unique<Endpoint>();
+    endpoint->id = rawId;
+    endpoint->uid = WideToUtf8(rawId);
+    endpoint->name = GetDeviceName(device);
+    CoTaskMemFree(rawId);
+
+    if (FAILED(device->Activate(__uuidof(IAudioSessionManager2), CLSCTX_ALL, nullptr,
+                                (void**)&endpoint->manager))) {
+        endpoint->manager = nullptr;
+        EmitError(("Failed to open audio sessions of " + endpoint->name).c_str());
+        return;
+    }
+    endpoint->notifier = new SessionNotifier(this, endpoint->id);
+
+    // Listed before registering, so sessions reported right away find their endpoint.
+    // Only SyncEndpoints() and Stop() (after waiting for it) remove endpoints,
+    // which keeps the raw pointer valid here.
+    Endpoint* added = endpoint.get();
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (stopping_) {
+            lock.unlock();
+            endpoint->notifier->Release();
+            endpoint->notifier = nullptr;
+            ReleaseEndpoint(std::move(endpoint));
+            return;
+        }
+        endpoints_.push_back(std::move(endpoint));
+    }
+
+    if (FAILED(added->manager->RegisterSessionNotification(added->notifier))) {
+        EmitError(("Failed to watch audio sessions of " + added->name).c_str());
+    }
+
+    // Enumerating is also what starts session notifications
+    IAudioSessionEnumerator* sessions = nullptr;
+    if (SUCCEEDED(added->manager->GetSessionEnumerator(&sessions))) {
+        int count = 0;
+        sessions->GetCount(&count);
+        for (int i = 0; i < count; i++) {
+            IAudioSessionControl* control = nullptr;
+            if (SUCCEEDED(sessions->GetSession(i, &control))) {
+                AddSession(added->id, control);
+                control->Release();
+            }
+        }
+        sessions->Release();
+    }
+}
+
+void MicActivityMonitor::AddSession(const std::wstring& endpointId, IAudioSessionControl* control) {
+    IAudioSessionControl2* control2 = nullptr;
+    if (FAILED(control->QueryInterface(__uuidof(IAudioSessionControl2), (void**)&control2))) return;
+
+    auto* session = new SessionEvents(this, control);
+    session->endpointId = endpointId;
+
+    LPWSTR instanceId = nullptr;
+    if (SUCCEEDED(control2->GetSessionInstanceIdentifier(&instanceId))) {
+        session->instanceId = instanceId;
+        CoTaskMemFree(instanceId);
+    }
+    session->systemSounds = control2->IsSystemSoundsSession() == S_OK;
+    // AUDCLNT_S_NO_SINGLE_PROCESS (a success code) leaves shared sessions without a PID
+    DWORD pid = 0;
+    if (control2->GetProcessId(&pid) == S_OK && pid != 0) {
+        session->pid = pid;
+        session->processName = GetProcessNameFromPid(pid);
+    }
+    control2->Release();
+
+    if (FAILED(control->RegisterAudioSessionNotification(session))) {
+        session->Release();
+        return;
+    }
+
+    // Listed before reading the state, so no transition is missed; a change
+    // reported in between wins over the state read here
+    uint32_t stateChanges = 0;
+    bool listed = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Endpoint* endpoint = stopping_ ? nullptr : FindEndpoint(endpointId);
+        // Sessions created while the endpoint was being enumerated are reported twice
+        bool duplicate = endpoint && !session->instanceId.empty() &&
+            std::any_of(endpoint->sessions.begin(), endpoint->sessions.end(), [session](SessionEvents* s) {
+                return !s->expired && s->instanceId == session->instanceId;
+            });
+        if (endpoint && !duplicate) {
+            session->AddRef();  // The list's reference; ours lasts until the end
+            endpoint->sessions.push_back(session);
+            stateChanges = session->stateChanges;
+            listed = true;
+        }
+    }
+    if (!listed) {
+        ReleaseSession(session);
+        return;
+    }
+
+    AudioSessionState state;
+    if (SUCCEEDED(control->GetState(&state))) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        Endpoint* endpoint = FindEndpoint(endpointId);
+        std::vector<Notice> notices;
+        if (endpoint && session->stateChanges == stateChanges && !session->expired &&
+            std::find(endpoint->sessions.begin(), endpoint->sessions.end(), session) != endpoint->sessions.end()) {
+            SetSessionActive(*endpoint, session, state == AudioSessionStateActive, notices);
+        }
+        Fire(lock, notices);
+    }
+    session->Release();
+}
+
+void MicActivityMonitor::ReleaseEndpoint(std::unique_ptr<Endpoint> endpoint) {
+    if (endpoint->notifier) {
+        endpoint->manager->UnregisterSessionNotification(endpoint->notifier);
+        endpoint->notifier->Release();
+    }
+    for (SessionEvents* session : endpoint->sessions) {
+        ReleaseSession(session);
+    }
+    if (endpoint->manager) {
+        endpoint->manager->Release();
+    }
+}
+
+void MicActivityMonitor::ReleaseSession(SessionEvents* session) {
+    session->control->UnregisterAudioSessionNotification(session);
+    session->Release();
+}
+
+void MicActivityMonitor::OnSessionCreated(const std::wstring& endpointId, IAudioSessionControl* control) {
+    AddSession(endpointId, control);
+}
+
+void MicActivityMonitor::OnSessionStateChanged(SessionEvents* session, AudioSessionState state) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    Endpoint* endpoint = FindEndpoint(session->endpointId);
+    if (!endpoint || std::find(endpoint->sessions.begin(), endpoint->sessions.end(), session) == endpoint->sessions.end()) {
+        return;
+    }
+
+    std::vector<Notice> notices;
+    session->stateChanges++;
+    SetSessionActive(*endpoint, session, state == AudioSessionStateActive, notices);
+
+    if (state == AudioSessionStateExpired && !session->expired) {
+        // Registrations can't change inside the callback
+        session->expired = true;
+        ScheduleSync();
+    }
+
+    Fire(lock, notices);
+}
+
+MicActivityMonitor::Endpoint* MicActivityMonitor::FindEndpoint(const std::wstring& id) {
+    for (auto& endpoint : endpoints_) {
+        if (endpoint->id == id) return endpoint.get();
+    }
+    return nullptr;
+}
+
+void MicActivityMonitor::SetSessionActive(Endpoint& endpoint, SessionEvents* session, bool active,
+                                          std::vector<Notice>& notices) {
+    if (session->active == active) return;
+    session->active = active;
+    if (session->systemSounds) return;
+
+    bool wasActive = endpoint.activeSessions > 0;
+    endpoint.activeSessions = active ? endpoint.activeSessions + 1 : endpoint.activeSessions - 1;
+    bool isActive = endpoint.activeSessions > 0;
+
+    if (wasActive != isActive) {
+        notices.push_back({false, endpoint.uid, endpoint.name, isActive});
+        UpdateAggregate(notices);
+    }
+}
+
+void MicActivityMonitor::UpdateAggregate(std::vector<Notice>& notices) {
+    bool active = std::any_of(endpoints_.begin(), endpoints_.end(),
+                              [](const std::unique_ptr<Endpoint>& e) { return e->activeSessions > 0; });
+    if (active != aggregateActive_) {
+        aggregateActive_ = active;
+        notices.push_back({true, std::string(), std::string(), active});
+    }
+}
+
+void MicActivityMonitor::Fire(std::unique_lock<std::mutex>& lock, const std::vector<Notice>& notices) {
+    if (notices.empty()) {
+        lock.unlock();
+        return;
+    }
+
+    std::lock_guard<std::mutex> callbackLock(callbackMutex_);
+    lock.unlock();
+    for (const Notice& notice : notices) {
+        if (notice.aggregate) {
+            if (changeCallback_) changeCallback_(notice.isActive, context_);
+        } else if (deviceCallback_) {
+            deviceCallback_(notice.uid.c_str(), notice.name.c_str(), notice.isActive, context_);
+        }
+    }
+}
+
+void MicActivityMonitor::EmitError(const char* message) {
+    std::lock_guard<std::mutex> callbackLock(callbackMutex_);
+    if (errorCallback_) {
+        errorCallback_(message, context_);
+    }
+}
+
+HRESULT STDMETHODCALLTYPE MicActivityMonitor::QueryInterface(REFIID riid, void** ppvObject) {
+    if (!ppvObject) return E_POINTER;
+    if (riid == __uuidof(IUnknown) || riid == __uuidof(IMMNotificationClient)) {
+        *ppvObject = static_cast<IMMNotificationClient*>(this);
+        return S_OK;
+    }
+    *ppvObject = nullptr;
+    return E_NOINTERFACE;
+}
+
+HRESULT STDMETHODCALLTYPE MicActivityMonitor::OnDeviceStateChanged(LPCWSTR, DWORD) {
+    CallbackScope scope(callbacksInFlight_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (allDevices_) ScheduleSync();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MicActivityMonitor::OnDeviceAdded(LPCWSTR) {
+    CallbackScope scope(callbacksInFlight_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (allDevices_) ScheduleSync();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MicActivityMonitor::OnDeviceRemoved(LPCWSTR) {
+    CallbackScope scope(callbacksInFlight_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (allDevices_) ScheduleSync();
+    return S_OK;
+}
+
+HRESULT STDMETHODCALLTYPE MicActivityMonitor::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR) {
+    CallbackScope scope(callbacksInFlight_);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!allDevices_ && flow == eCapture && role == eConsole) ScheduleSync();
+    return S_OK;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <windows.h>
+#include <mmdeviceapi.h>
+#include <audiopolicy.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "audio_bridge.h"
+
+/**
+ * Mic Activity Monitor - Reports when applications capture from microphones,
+ * driven entirely by WASAPI notifications.
+ *
+ * Each watched capture endpoint gets an IAudioSessionNotification on its
+ * IAudioSessionManager2, and each of its sessions an IAudioSessionEvents.
+ * A session turning active or inactive updates the endpoint and aggregate
+ * state and fires the callbacks, in order, from the notifying thread. The
+ * owning process of a session is resolved once when the session is first
+ * seen, so ActiveProcesses() is a lookup rather than a session walk.
+ *
+ * Endpoint changes (devices added, removed or disabled, and a new default
+ * for scope "default") arrive through an IMMNotificationClient. WASAPI
+ * doesn't allow registrations to change inside its callbacks, so those and
+ * the cleanup of expired sessions run as a thread pool work item. There is
+ * no polling thread: an idle monitor only holds its registrations.
+ */
+class MicActivityMonitor : public IMMNotificationClient {
+public:
+    struct Process {
+        DWORD pid;
+        std::string name;
+    };
+
+    MicActivityMonitor(MicActivityChangeCallback changeCallback,
+                       MicActivityDeviceCallback deviceCallback,
+                       MicActivityErrorCallback errorCallback,
+                       void* context);
+    ~MicActivityMonitor();
+
+    // allDevices: every active capture endpoint, else the default one
+    int32_t Start(bool allDevices);
+    int32_t Stop();
+
+    bool IsActive();
+    std::vector<std::string> ActiveDeviceIds();
+
+    // Processes with an active capture session; scans the default endpoint
+    // once when the monitor isn't running
+    std::vector<Process> ActiveProcesses();
+
+    // IUnknown - owned by mic_activity_create/destroy, so Release never deletes
+    ULONG STDMETHODCALLTYPE AddRef() override { return 1; }
+    ULONG STDMETHODCALLTYPE Release() override { return 1; }
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+
+    // IMMNotificationClient
+    HRESULT STDMETHODCALLTYPE OnDeviceStateChanged(LPCWSTR deviceId, DWORD newState) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceAdded(LPCWSTR deviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDeviceRemoved(LPCWSTR deviceId) override;
+    HRESULT STDMETHODCALLTYPE OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR defaultDeviceId) override;
+    HRESULT STDMETHODCALLTYPE OnPropertyValueChanged(LPCWSTR, const PROPERTYKEY) override { return S_OK; }
+
+private:
+    class SessionEvents;
+    class SessionNotifier;
+
+    struct Endpoint {
+        std::wstring id;
+        std::string uid;              // UTF-8 id, as listed by audio_list_devices
+        std::string name;
+        IAudioSessionManager2* manager = nullptr;
+        SessionNotifier* notifier = nullptr;
+        std::vector<SessionEvents*> sessions;
+        size_t activeSessions = 0;
+    };
+
+    // Callback queued while mutex_ is held and fired after it is released
+    struct Notice {
+        bool aggregate;
+        std::string uid;
+        std::string name;
+        bool isActive;
+    };
+
+    MicActivityMonitor(const MicActivityMonitor&) = delete;
+    MicActivityMonitor& operator=(const MicActivityMonitor&) = delete;
+
+    static void CALLBACK SyncWork(PTP_CALLBACK_INSTANCE, PVOID context, PTP_WORK);
+    void ScheduleSync();
+
+    // Bring endpoints_ in line with the devices to watch and drop expired sessions
+    void SyncEndpoints();
+    void AddEndpoint(IMMDevice* device);
+    void AddSession(const std::wstring& endpointId, IAudioSessionControl* control);
+    void ReleaseEndpoint(std::unique_ptr<Endpoint> endpoint);
+    static void ReleaseSession(SessionEvents* session);
+
+    // Called by SessionNotifier / SessionEvents
+    void OnSessionCreated(const std::wstring& endpointId, IAudioSessionControl* control);
+    void OnSessionStateChanged(SessionEvents* session, AudioSessionState state);
+
+    // With mutex_ held
+    Endpoint* FindEndpoint(const std::wstring& id);
+    void SetSessionActive(Endpoint& endpoint, SessionEvents* session, bool active, std::vector<Notice>& notices);
+    void UpdateAggregate(std::vector<Notice>& notices);
+
+    // Releases `lock` and fires the notices in order
+    void Fire(std::unique_lock<std::mutex>& lock, const std::vector<Notice>& notices);
+    void EmitError(const char* message);
+
+    MicActivityChangeCallback changeCallback_;
+    MicActivityDeviceCallback deviceCallback_;
+    MicActivityErrorCallback errorCallback_;
+    void* context_;
+
+    IMMDeviceEnumerator* enumerator_ = nullptr;
+    PTP_WORK syncWork_ = nullptr;
+    bool allDevices_ = true;
+
+    std::mutex mutex_;                // Endpoint, session and aggregate state
+    std::mutex callbackMutex_;        // Taken before mutex_ is released, keeps notices in order
+    std::vector<std::unique_ptr<Endpoint>> endpoints_;
+    bool running_ = false;
+    bool stopping_ = false;
+    bool aggregateActive_ = false;
+
+    // Notification callbacks of this monitor still running; Stop() waits for
+    // them to drain once everything is unregistered
+    std::atomic<int> callbacksInFlight_{0};
+};
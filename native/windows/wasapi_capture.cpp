@@ -1,8 +1,10 @@
 #include "wasapi_capture.h"
+#include "device_watcher.h"
 #include <combaseapi.h>
 #include <avrt.h>
 #include <cmath>
 #include <algorithm>
+#include <cstring>
 
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "avrt.lib")
@@ -27,6 +29,17 @@ static std::string WideToUtf8(const std::wstring& wstr) {
     return result;
 }
 
+// Current QueryPerformanceCounter time in nanoseconds (the clock of GetBuffer's qpcPosition)
+static uint64_t QpcNowNs() {
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    uint64_t ticks = static_cast<uint64_t>(counter.QuadPart);
+    uint64_t hz = static_cast<uint64_t>(frequency.QuadPart);
+    // Split to avoid overflowing ticks * 1e9
+    return (ticks / hz) * 1000000000ULL + (ticks % hz) * 1000000000ULL / hz;
+}
+
 // ============================================================================
 // ActivationCompletionHandler Implementation
 // ============================================================================
@@ -85,6 +98,9 @@ HRESULT ActivationCompletionHandler::Wait(DWORD timeout) {
 // WasapiCapture Implementation
 // ============================================================================
 
+// Headroom the pipeline allocates so chunkDurationMs can grow while running
+static const double kMaxLiveChunkMs = 1000;
+
 WasapiCapture::WasapiCapture(
     AudioDataCallback dataCallback,
     AudioEventCallback eventCallback,
@@ -92,22 +108,53 @@ WasapiCapture::WasapiCapture(
     void* userContext
 ) : dataCallback_(dataCallback),
     eventCallback_(eventCallback),
+    chunkCallback_(nullptr),
+    levelCallback_(nullptr),
     metadataCallback_(metadataCallback),
     userContext_(userContext),
     audioClient_(nullptr),
     captureClient_(nullptr),
     mixFormat_(nullptr),
+    keepPrepared_(false),
     running_(false),
     stopEvent_(nullptr),
+    bufferEvent_(nullptr),
+    eventDriven_(false),
+    scheduled_(false),
+    waitChanged_(false),
+    useEventCallback_(true),
+    bufferDurationMs_(1000),
+    resampleQuality_(PolyphaseResampler::Quality::Medium),
+    gateEnabled_(false),
+    gateThresholdDb_(-50),
+    gateHangoverMs_(500),
+    levelsMode_(0),
+    bitrate_(0),
+    sharedCaptureThread_(false),
+    mixProcesses_(true),
+    followDefaultDevice_(false),
+    channelMatrixInputs_(0),
     targetSampleRate_(0),
     chunkDurationMs_(200),
     isMono_(true),
     gain_(1.0),
     emitSilence_(true),
-    samplesPerChunk_(0),
-    resampleRatio_(1.0) {
+    outputFormat_(AUDIO_FORMAT_DEFAULT),
+    following_(false),
+    followFlow_(eRender),
+    defaultChanged_(false),
+    followEvent_(nullptr),
+    switching_(false),
+    switchFailed_(false),
+    hasDevicePosition_(false),
+    expectedDevicePosition_(0),
+    sourceChannels_(1),
+    stats_(capture_stats_create()),
+    virtualSource_(nullptr) {
 
     stopEvent_ = CreateEvent(nullptr, TRUE, FALSE, nullptr);
+    bufferEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    followEvent_ = CreateEvent(nullptr, FALSE, FALSE, nullptr);
 }
 
 WasapiCapture::~WasapiCapture() {
@@ -116,15 +163,92 @@ WasapiCapture::~WasapiCapture() {
     if (stopEvent_) {
         CloseHandle(stopEvent_);
     }
-    if (mixFormat_) {
-        CoTaskMemFree(mixFormat_);
+    if (bufferEvent_) {
+        CloseHandle(bufferEvent_);
+    }
+    if (followEvent_) {
+        CloseHandle(followEvent_);
+    }
+    ReleaseClient();
+    capture_stats_destroy(stats_);
+}
+
+std::wstring WasapiCapture::ClientKey(const std::wstring& endpoint) const {
+    // Initialize() fixes the buffer duration and event mode for the client's lifetime
+    return endpoint + L"|" + std::to_wstring(bufferDurationMs_) + (useEventCallback_ ? L"|event" : L"|timer");
+}
+
+bool WasapiCapture::ReuseClient(const std::wstring& key) {
+    if (audioClient_ && captureClient_ && key == clientKey_) {
+        // Stopped since its last session; drop what it buffered meanwhile
+        audioClient_->Reset();
+        return true;
     }
+    ReleaseClient();
+    return false;
+}
+
+void WasapiCapture::ReleaseClient() {
     if (captureClient_) {
         captureClient_->Release();
+        captureClient_ = nullptr;
     }
     if (audioClient_) {
         audioClient_->Release();
+        audioClient_ = nullptr;
     }
+    if (mixFormat_) {
+        CoTaskMemFree(mixFormat_);
+        mixFormat_ = nullptr;
+    }
+    clientKey_.clear();
+    eventDriven_ = false;
+}
+
+HRESULT WasapiCapture::OpenSystemClient(const int32_t* includeProcesses, int32_t includeCount,
+                                        const int32_t* excludeProcesses, int32_t excludeCount) {
+    std::wstring endpoint;
+    DWORD pid = 0;
+    PROCESS_LOOPBACK_MODE mode = PROCESS_LOOPBACK_MODE_INCLUDE_TARGET_PROCESS_TREE;
+    if (includeCount > 0 && includeProcesses != nullptr) {
+        // Include mode: capture only from specified process
+        pid = static_cast<DWORD>(includeProcesses[0]);
+        endpoint = L"include:" + std::to_wstring(pid);
+    } else if (excludeCount > 0 && excludeProcesses != nullptr) {
+        // Exclude mode: capture everything except specified process. A client
+        // excludes a single process tree, and excluding more can't be built
+        // from several clients the way including can.
+        pid = static_cast<DWORD>(excludeProcesses[0]);
+        mode = PROCESS_LOOPBACK_MODE_EXCLUDE_TARGET_PROCESS_TREE;
+        endpoint = L"exclude:" + std::to_wstring(pid);
+    } else {
+        // System-wide loopback
+        endpoint = L"system";
+    }
+
+    std::wstring key = ClientKey(endpoint);
+    if (ReuseClient(key)) return S_OK;
+
+    HRESULT hr = pid != 0 ? InitializeProcessLoopback(pid, mode) : InitializeSystemLoopback();
+    if (FAILED(hr)) {
+        ReleaseClient();
+        return hr;
+    }
+    clientKey_ = key;
+    return S_OK;
+}
+
+HRESULT WasapiCapture::OpenMicrophoneClient(const std::wstring& deviceId) {
+    std::wstring key = ClientKey(L"mic:" + deviceId);
+    if (ReuseClient(key)) return S_OK;
+
+    HRESULT hr = InitializeMicrophone(deviceId.empty() ? nullptr : deviceId.c_str());
+    if (FAILED(hr)) {
+        ReleaseClient();
+        return hr;
+    }
+    clientKey_ = key;
+    return S_OK;
 }
 
 HRESULT WasapiCapture::InitializeSystemLoopback() {
@@ -151,20 +275,7 @@ HRESULT WasapiCapture::InitializeSystemLoopback() {
     if (FAILED(hr)) return hr;
 
     // Initialize with loopback flag
-    hr = audioClient_->Initialize(
-        AUDCLNT_SHAREMODE_SHARED,
-        AUDCLNT_STREAMFLAGS_LOOPBACK,
-        10000000,  // 1 second buffer (100ns units)
-        0,
-        mixFormat_,
-        nullptr
-    );
-    if (FAILED(hr)) return hr;
-
-    // Get capture client
-    hr = audioClient_->GetService(__uuidof(IAudioCaptureClient), (void**)&captureClient_);
-
-    return hr;
+    return InitializeAudioClient(AUDCLNT_STREAMFLAGS_LOOPBACK, false);
 }
 
 HRESULT WasapiCapture::InitializeProcessLoopback(DWORD targetPid, PROCESS_LOOPBACK_MODE mode) {
@@ -231,21 +342,8 @@ HRESULT WasapiCapture::InitializeProcessLoopback(DWORD targetPid, PROCESS_LOOPBA
     hr = audioClient_->GetMixFormat(&mixFormat_);
     if (FAILED(hr)) return hr;
 
-    // Initialize the audio client
-    hr = audioClient_->Initialize(
-        AUDCLNT_SHAREMODE_SHARED,
-        0,  // No additional flags needed for process loopback
-        10000000,  // 1 second buffer
-        0,
-        mixFormat_,
-        nullptr
-    );
-    if (FAILED(hr)) return hr;
-
-    // Get capture client
-    hr = audioClient_->GetService(__uuidof(IAudioCaptureClient), (void**)&captureClient_);
-
-    return hr;
+    // Initialize the audio client (no additional flags needed for process loopback)
+    return InitializeAudioClient(0, false);
 }
 
 HRESULT WasapiCapture::InitializeMicrophone(const wchar_t* deviceId) {
@@ -277,45 +375,170 @@ HRESULT WasapiCapture::InitializeMicrophone(const wchar_t* deviceId) {
     if (FAILED(hr)) return hr;
 
     // Initialize for capture
-    hr = audioClient_->Initialize(
-        AUDCLNT_SHAREMODE_SHARED,
-        0,
-        10000000,  // 1 second buffer
-        0,
-        mixFormat_,
-        nullptr
-    );
-    if (FAILED(hr)) return hr;
+    return InitializeAudioClient(0, true);
+}
+
+HRESULT WasapiCapture::InitializeAudioClient(DWORD streamFlags, bool allowLowLatency) {
+    HRESULT hr = E_FAIL;
+    eventDriven_ = false;
+
+    // Buffer duration in 100ns units
+    REFERENCE_TIME bufferDuration = static_cast<REFERENCE_TIME>(bufferDurationMs_ * 10000.0);
+
+    if (useEventCallback_) {
+        // Sub-10ms periods need IAudioClient3 (Windows 10+); the legacy
+        // Initialize() always runs at the engine's default period.
+        if (allowLowLatency && bufferDurationMs_ < 10.0) {
+            IAudioClient3* audioClient3 = nullptr;
+            if (SUCCEEDED(audioClient_->QueryInterface(__uuidof(IAudioClient3), (void**)&audioClient3))) {
+                UINT32 defaultPeriod = 0, fundamentalPeriod = 0, minPeriod = 0, maxPeriod = 0;
+                hr = audioClient3->GetSharedModeEnginePeriod(
+                    mixFormat_, &defaultPeriod, &fundamentalPeriod, &minPeriod, &maxPeriod);
+
+                if (SUCCEEDED(hr) && fundamentalPeriod > 0) {
+                    UINT32 requested = static_cast<UINT32>(bufferDurationMs_ * mixFormat_->nSamplesPerSec / 1000.0);
+                    // Periods must be a multiple of the fundamental period within [min, max]
+                    UINT32 period = ((requested + fundamentalPeriod - 1) / fundamentalPeriod) * fundamentalPeriod;
+                    period = (std::max)(minPeriod, (std::min)(period, maxPeriod));
+
+                    hr = audioClient3->InitializeSharedAudioStream(
+                        streamFlags | AUDCLNT_STREAMFLAGS_EVENTCALLBACK, period, mixFormat_, nullptr);
+                    eventDriven_ = SUCCEEDED(hr);
+                }
+                audioClient3->Release();
+            }
+        }
+
+        if (!eventDriven_) {
+            hr = audioClient_->Initialize(
+                AUDCLNT_SHAREMODE_SHARED,
+                streamFlags | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+                bufferDuration,
+                0,
+                mixFormat_,
+                nullptr
+            );
+            eventDriven_ = SUCCEEDED(hr);
+        }
+
+        if (eventDriven_) {
+            hr = audioClient_->SetEventHandle(bufferEvent_);
+            if (FAILED(hr)) return hr;
+        }
+    }
+
+    // Timer fallback: endpoints that reject event callbacks, or when disabled
+    if (!eventDriven_) {
+        hr = audioClient_->Initialize(
+            AUDCLNT_SHAREMODE_SHARED,
+            streamFlags,
+            bufferDuration,
+            0,
+            mixFormat_,
+            nullptr
+        );
+        if (FAILED(hr)) return hr;
+    }
 
     // Get capture client
-    hr = audioClient_->GetService(__uuidof(IAudioCaptureClient), (void**)&captureClient_);
+    return audioClient_->GetService(__uuidof(IAudioCaptureClient), (void**)&captureClient_);
+}
+
+CapturePipeline::Config WasapiCapture::DevicePipelineConfig() const {
+    // Determine output sample rate
+    double outputSampleRate = targetSampleRate_ > 0 ? targetSampleRate_ : mixFormat_->nSamplesPerSec;
+
+    // Size every pipeline buffer now so the capture thread never allocates.
+    // A packet can't exceed the endpoint buffer, so that bounds the scratch.
+    UINT32 bufferFrames = 0;
+    if (FAILED(audioClient_->GetBufferSize(&bufferFrames)) || bufferFrames == 0) {
+        bufferFrames = mixFormat_->nSamplesPerSec;  // 1 second
+    }
 
-    return hr;
+    CapturePipeline::Config config;
+    config.inputSampleRate = mixFormat_->nSamplesPerSec;
+    config.inputChannels = mixFormat_->nChannels;
+    config.outputSampleRate = outputSampleRate;
+    config.mono = isMono_;
+    config.gain = static_cast<float>(gain_);
+    config.chunkDurationMs = chunkDurationMs_;
+    config.maxChunkDurationMs = (std::max)(chunkDurationMs_, kMaxLiveChunkMs);
+    config.maxFramesPerPacket = bufferFrames;
+    config.resampleQuality = resampleQuality_;
+    return config;
 }
 
 HRESULT WasapiCapture::FinalizeInitialization() {
     if (!mixFormat_) return E_FAIL;
 
-    // Determine output sample rate
-    double outputSampleRate = targetSampleRate_ > 0 ? targetSampleRate_ : mixFormat_->nSamplesPerSec;
-    resampleRatio_ = outputSampleRate / mixFormat_->nSamplesPerSec;
+    if (!ConfigurePipeline(DevicePipelineConfig())) return AUDCLNT_E_UNSUPPORTED_FORMAT;
 
-    // Calculate samples per chunk based on output sample rate
-    samplesPerChunk_ = static_cast<size_t>((chunkDurationMs_ / 1000.0) * outputSampleRate);
+    hasDevicePosition_ = false;
+    expectedDevicePosition_ = 0;
+
+    return S_OK;
+}
+
+bool WasapiCapture::ConfigurePipeline(CapturePipeline::Config config) {
+    // AUDIO_FORMAT_DEFAULT keeps the historical 32-bit float output; encoded
+    // streams have no history and default to 16-bit
+    int32_t sampleFormat = outputFormat_ & AUDIO_FORMAT_SAMPLE_MASK;
+    config.encoding = (outputFormat_ & AUDIO_ENCODING_MASK) >> AUDIO_ENCODING_SHIFT;
+    if (sampleFormat == AUDIO_FORMAT_DEFAULT) {
+        sampleFormat = config.encoding != AUDIO_ENCODER_PCM ? AUDIO_FORMAT_S16 : AUDIO_FORMAT_F32;
+    }
+    config.sampleFormat = sampleFormat;
+    config.planar = (outputFormat_ & AUDIO_FORMAT_PLANAR) != 0;
+    config.bitrate = bitrate_;
+    config.gate = gateEnabled_;
+    config.gateThresholdDb = gateThresholdDb_;
+    config.gateHangoverMs = gateHangoverMs_;
+    config.levels = levelsMode_ != 0 && levelCallback_ != nullptr;
+    config.levelsOnly = levelsMode_ == 2;
+
+    if (!FitChannelMatrix(config)) return false;
+
+    if (!pipeline_.Configure(config, &WasapiCapture::EmitChunk, this)) {
+        pipelineError_ = "Unsupported output encoding";
+        return false;
+    }
+    pipeline_.SetActivitySink(&WasapiCapture::EmitActivity);
+    pipeline_.SetLevelSink(&WasapiCapture::EmitLevels);
+
+    // Every session's counters start from zero
+    capture_stats_reset(stats_);
+    capture_stats_set_allocated(stats_, pipeline_.AllocatedBytes());
+    pipeline_.SetStats(stats_);
 
     // Report metadata
     if (metadataCallback_) {
+        std::string encoding = pipeline_.EncodingName();
         metadataCallback_(
-            outputSampleRate,
-            isMono_ ? 1 : mixFormat_->nChannels,
-            32,  // Always output 32-bit float
-            true,
-            "pcm_f32le",
+            pipeline_.OutputSampleRate(),
+            pipeline_.OutputChannels(),
+            pipeline_.BitsPerSample(),
+            pipeline_.IsFloat(),
+            encoding.c_str(),
             userContext_
         );
     }
+    return true;
+}
 
-    return S_OK;
+bool WasapiCapture::FitChannelMatrix(CapturePipeline::Config& config) {
+    // Fit the channel matrix to what this stream actually has
+    config.channelMatrix.clear();
+    if (channelMatrix_.empty()) return true;
+
+    const uint32_t outputs = static_cast<uint32_t>(channelMatrix_.size() / channelMatrixInputs_);
+    config.channelMatrix.resize(static_cast<size_t>(outputs) * config.inputChannels);
+    if (!dsp_channel_matrix_fit(channelMatrix_.data(), outputs, channelMatrixInputs_,
+                                config.inputChannels, config.channelMatrix.data())) {
+        pipelineError_ = "Channel map uses a channel the source doesn't have (it has " +
+                         std::to_string(config.inputChannels) + ")";
+        return false;
+    }
+    return true;
 }
 
 int32_t WasapiCapture::StartSystemAudio(
@@ -327,7 +550,8 @@ int32_t WasapiCapture::StartSystemAudio(
     const int32_t* includeProcesses,
     int32_t includeCount,
     const int32_t* excludeProcesses,
-    int32_t excludeCount
+    int32_t excludeCount,
+    int32_t outputFormat
 ) {
     if (running_) return -2;
 
@@ -335,28 +559,14 @@ int32_t WasapiCapture::StartSystemAudio(
     chunkDurationMs_ = chunkDurationMs > 0 ? chunkDurationMs : 200;
     isMono_ = isMono;
     emitSilence_ = emitSilence;
+    outputFormat_ = outputFormat;
 
-    HRESULT hr;
-
-    // Determine capture mode
-    if (includeCount > 0 && includeProcesses != nullptr) {
-        // Include mode: capture only from specified process
-        // Note: WASAPI only supports one process at a time
-        hr = InitializeProcessLoopback(
-            static_cast<DWORD>(includeProcesses[0]),
-            PROCESS_LOOPBACK_MODE_INCLUDE_TARGET_PROCESS_TREE
-        );
-    } else if (excludeCount > 0 && excludeProcesses != nullptr) {
-        // Exclude mode: capture everything except specified process
-        hr = InitializeProcessLoopback(
-            static_cast<DWORD>(excludeProcesses[0]),
-            PROCESS_LOOPBACK_MODE_EXCLUDE_TARGET_PROCESS_TREE
-        );
-    } else {
-        // System-wide loopback
-        hr = InitializeSystemLoopback();
+    if (includeCount > 1 && includeProcesses != nullptr) {
+        return StartProcessMix(sampleRate, isMono, includeProcesses, includeCount);
     }
 
+    ResizeSources(0);
+    HRESULT hr = OpenSystemClient(includeProcesses, includeCount, excludeProcesses, excludeCount);
     if (FAILED(hr)) {
         if (eventCallback_) {
             eventCallback_(2, "Failed to initialize audio capture", userContext_);
@@ -367,7 +577,9 @@ int32_t WasapiCapture::StartSystemAudio(
     hr = FinalizeInitialization();
     if (FAILED(hr)) {
         if (eventCallback_) {
-            eventCallback_(2, "Failed to finalize audio initialization", userContext_);
+            eventCallback_(2, hr == AUDCLNT_E_UNSUPPORTED_FORMAT
+                ? pipelineError_.c_str()
+                : "Failed to finalize audio initialization", userContext_);
         }
         return -4;
     }
@@ -375,6 +587,7 @@ int32_t WasapiCapture::StartSystemAudio(
     // Start the audio client
     hr = audioClient_->Start();
     if (FAILED(hr)) {
+        ReleaseClient();
         if (eventCallback_) {
             eventCallback_(2, "Failed to start audio client", userContext_);
         }
@@ -389,8 +602,15 @@ int32_t WasapiCapture::StartSystemAudio(
         eventCallback_(0, nullptr, userContext_);
     }
 
-    // Start capture thread
-    captureThread_ = std::thread(&WasapiCapture::CaptureThread, this);
+    // Process loopback isn't tied to an endpoint; system-wide loopback is
+    bool systemWide = !(includeCount > 0 && includeProcesses) && !(excludeCount > 0 && excludeProcesses);
+    if (followDefaultDevice_ && systemWide) {
+        followFlow_ = eRender;
+        defaultChanged_ = false;
+        following_ = DeviceWatcher::Instance().AddDefaultListener(&WasapiCapture::OnDefaultDeviceChanged, this);
+    }
+
+    StartCaptureThread();
 
     return 0;
 }
@@ -401,7 +621,8 @@ int32_t WasapiCapture::StartMicrophone(
     bool isMono,
     bool emitSilence,
     const char* deviceId,
-    double gain
+    double gain,
+    int32_t outputFormat
 ) {
     if (running_) return -2;
 
@@ -410,11 +631,12 @@ int32_t WasapiCapture::StartMicrophone(
     isMono_ = isMono;
     emitSilence_ = emitSilence;
     gain_ = gain;
+    outputFormat_ = outputFormat;
 
     std::wstring wideDeviceId = deviceId ? Utf8ToWide(deviceId) : L"";
 
-    HRESULT hr = InitializeMicrophone(wideDeviceId.empty() ? nullptr : wideDeviceId.c_str());
-
+    ResizeSources(0);
+    HRESULT hr = OpenMicrophoneClient(wideDeviceId);
     if (FAILED(hr)) {
         if (eventCallback_) {
             eventCallback_(2, "Failed to initialize microphone capture", userContext_);
@@ -425,7 +647,9 @@ int32_t WasapiCapture::StartMicrophone(
     hr = FinalizeInitialization();
     if (FAILED(hr)) {
         if (eventCallback_) {
-            eventCallback_(2, "Failed to finalize audio initialization", userContext_);
+            eventCallback_(2, hr == AUDCLNT_E_UNSUPPORTED_FORMAT
+                ? pipelineError_.c_str()
+                : "Failed to finalize audio initialization", userContext_);
         }
         return -4;
     }
@@ -433,6 +657,7 @@ int32_t WasapiCapture::StartMicrophone(
     // Start the audio client
     hr = audioClient_->Start();
     if (FAILED(hr)) {
+        ReleaseClient();
         if (eventCallback_) {
             eventCallback_(2, "Failed to start audio client", userContext_);
         }
@@ -447,25 +672,542 @@ int32_t WasapiCapture::StartMicrophone(
         eventCallback_(0, nullptr, userContext_);
     }
 
-    // Start capture thread
-    captureThread_ = std::thread(&WasapiCapture::CaptureThread, this);
+    // An explicitly chosen device is kept
+    if (followDefaultDevice_ && wideDeviceId.empty()) {
+        followFlow_ = eCapture;
+        defaultChanged_ = false;
+        following_ = DeviceWatcher::Instance().AddDefaultListener(&WasapiCapture::OnDefaultDeviceChanged, this);
+    }
+
+    StartCaptureThread();
+
+    return 0;
+}
+
+int32_t WasapiCapture::StartVirtual(
+    double sampleRate,
+    double chunkDurationMs,
+    bool isMono,
+    const VirtualSourceConfig* source,
+    int32_t outputFormat
+) {
+    if (running_) return -2;
+
+    targetSampleRate_ = sampleRate;
+    chunkDurationMs_ = chunkDurationMs > 0 ? chunkDurationMs : 200;
+    isMono_ = isMono;
+    emitSilence_ = false;
+    gain_ = 1.0;
+    outputFormat_ = outputFormat;
+
+    ResizeSources(0);
+    virtualSource_ = virtual_source_create(source);
+    if (!virtualSource_) {
+        if (eventCallback_) {
+            eventCallback_(2, "Invalid virtual source", userContext_);
+        }
+        return -3;
+    }
+
+    CapturePipeline::Config config;
+    config.inputSampleRate = source->sampleRate;
+    config.inputChannels = source->channels;
+    config.outputSampleRate = targetSampleRate_ > 0 ? targetSampleRate_ : source->sampleRate;
+    config.mono = isMono_;
+    config.chunkDurationMs = chunkDurationMs_;
+    config.maxChunkDurationMs = (std::max)(chunkDurationMs_, kMaxLiveChunkMs);
+    config.maxFramesPerPacket = source->framesPerPacket;
+    config.resampleQuality = resampleQuality_;
+    if (!ConfigurePipeline(config)) {
+        virtual_source_destroy(virtualSource_);
+        virtualSource_ = nullptr;
+        if (eventCallback_) {
+            eventCallback_(2, pipelineError_.c_str(), userContext_);
+        }
+        return -4;
+    }
+
+    running_ = true;
+    if (eventCallback_) {
+        eventCallback_(0, nullptr, userContext_);
+    }
+
+    if (virtual_source_start(virtualSource_, &WasapiCapture::OnVirtualPacket, this) != 0) {
+        Stop();
+        return -5;
+    }
+    return 0;
+}
+
+void WasapiCapture::OnVirtualPacket(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                                    uint32_t flags, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    capture_stats_add_packet(self->stats_, frameCount, flags);
+    self->pipeline_.Process(frames, frameCount, hostTimeNs, flags);
+}
+
+// Sources deliver short chunks so every push carries a fresh device timestamp
+static const double kCombinedSourceChunkMs = 10;
+
+int32_t WasapiCapture::StartCombined(
+    double sampleRate,
+    double chunkDurationMs,
+    const int32_t* includeProcesses,
+    int32_t includeCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeCount,
+    const char* micDeviceId,
+    double micGain,
+    int32_t outputFormat
+) {
+    if (running_) return -2;
+
+    chunkDurationMs_ = chunkDurationMs > 0 ? chunkDurationMs : 200;
+    outputFormat_ = outputFormat;
+
+    ResizeSources(2);
+    sourceChannels_ = 1;
+
+    // Loopback always emits silence: an idle endpoint would otherwise leave a
+    // hole in the shared timeline until the aligner's latency bound pads it
+    WasapiCapture* system = CreateSource(0);
+    int32_t result = system->StartSystemAudio(
+        sampleRate, kCombinedSourceChunkMs, false, true, true,
+        includeProcesses, includeCount, excludeProcesses, excludeCount, AUDIO_FORMAT_F32
+    );
+    if (result != 0) {
+        StopSources();
+        return result;
+    }
+
+    // The microphone is resampled to whatever rate the system source settled on.
+    // Configure the output side first: frames the system source delivers before
+    // the aligner is ready are discarded.
+    double rate = system->pipeline_.OutputSampleRate();
+    size_t sourceFrames = system->pipeline_.FramesPerChunk();
+
+    CapturePipeline::Config config;
+    config.inputSampleRate = rate;
+    config.inputChannels = 2;
+    config.outputSampleRate = rate;
+    config.mono = false;
+    config.chunkDurationMs = chunkDurationMs_;
+    config.maxChunkDurationMs = (std::max)(chunkDurationMs_, kMaxLiveChunkMs);
+    config.maxFramesPerPacket = sourceFrames;
+    if (!ConfigurePipeline(config)) {
+        StopSources();
+        if (eventCallback_) {
+            eventCallback_(2, pipelineError_.c_str(), userContext_);
+        }
+        return -4;
+    }
+
+    SourceAligner::Config alignerConfig;
+    alignerConfig.sources = 2;
+    alignerConfig.sampleRate = rate;
+    alignerConfig.maxFramesPerPush = sourceFrames;
+    aligner_.Configure(alignerConfig, &WasapiCapture::OnAlignedFrames, this);
+
+    WasapiCapture* microphone = CreateSource(1);
+    result = microphone->StartMicrophone(
+        rate, kCombinedSourceChunkMs, true, true, micDeviceId, micGain, AUDIO_FORMAT_F32
+    );
+    if (result != 0) {
+        StopSources();
+        return result;
+    }
+
+    running_ = true;
+    ResetEvent(stopEvent_);
+
+    // Emit start event
+    if (eventCallback_) {
+        eventCallback_(0, nullptr, userContext_);
+    }
+
+    return 0;
+}
+
+int32_t WasapiCapture::StartProcessMix(double sampleRate, bool isMono, const int32_t* processes, int32_t count) {
+    ResizeSources(static_cast<size_t>(count));
+
+    // As in combined capture, every source emits silence so an idle process
+    // keeps its place on the timeline instead of stalling the others.
+    // Stacked output has one channel per process, so those sources are mono.
+    const bool sourceMono = isMono || !mixProcesses_;
+    const DWORD firstPid = static_cast<DWORD>(processes[0]);
+    WasapiCapture* first = CreateSource(0, firstPid);
+    int32_t result = first->StartSystemAudio(
+        sampleRate, kCombinedSourceChunkMs, false, sourceMono, true,
+        &processes[0], 1, nullptr, 0, AUDIO_FORMAT_F32
+    );
+    if (result != 0) {
+        StopSources();
+        return result;
+    }
+
+    // The other processes are resampled to the rate the first one settled on
+    double rate = first->pipeline_.OutputSampleRate();
+    size_t sourceFrames = first->pipeline_.FramesPerChunk();
+    sourceChannels_ = first->pipeline_.OutputChannels();
+    const uint32_t outputChannels = mixProcesses_ ? sourceChannels_ : static_cast<uint32_t>(count);
+
+    CapturePipeline::Config config;
+    config.inputSampleRate = rate;
+    config.inputChannels = outputChannels;
+    config.outputSampleRate = rate;
+    config.mono = mixProcesses_ && isMono;
+    config.chunkDurationMs = chunkDurationMs_;
+    config.maxChunkDurationMs = (std::max)(chunkDurationMs_, kMaxLiveChunkMs);
+    config.maxFramesPerPacket = sourceFrames;
+    if (!ConfigurePipeline(config)) {
+        StopSources();
+        if (eventCallback_) {
+            eventCallback_(2, pipelineError_.c_str(), userContext_);
+        }
+        return -4;
+    }
+
+    SourceAligner::Config alignerConfig;
+    alignerConfig.sources = static_cast<uint32_t>(count);
+    alignerConfig.channelsPerSource = sourceChannels_;
+    alignerConfig.mix = mixProcesses_;
+    alignerConfig.sampleRate = rate;
+    alignerConfig.maxFramesPerPush = sourceFrames;
+    aligner_.Configure(alignerConfig, &WasapiCapture::OnAlignedFrames, this);
+
+    for (int32_t i = 1; i < count; i++) {
+        WasapiCapture* source = CreateSource(static_cast<uint32_t>(i), static_cast<uint32_t>(processes[i]));
+        result = source->StartSystemAudio(
+            rate, kCombinedSourceChunkMs, false, sourceMono, true,
+            &processes[i], 1, nullptr, 0, AUDIO_FORMAT_F32
+        );
+        if (result == 0 && source->pipeline_.OutputChannels() != sourceChannels_) {
+            // Process loopback clients share the render mix format, so this
+            // only happens if the default endpoint changed mid-start
+            if (eventCallback_) {
+                eventCallback_(2, "Process loopback formats differ", userContext_);
+            }
+            result = -4;
+        }
+        if (result != 0) {
+            StopSources();
+            return result;
+        }
+    }
+
+    running_ = true;
+    ResetEvent(stopEvent_);
+
+    // Emit start event
+    if (eventCallback_) {
+        eventCallback_(0, nullptr, userContext_);
+    }
 
     return 0;
 }
 
+WasapiCapture* WasapiCapture::CreateSource(uint32_t index, uint32_t processId) {
+    // A prepared source is reused; its client is kept if the endpoint matches
+    sourceLinks_[index] = { this, index, processId };
+    if (!sources_[index]) {
+        sources_[index].reset(new WasapiCapture(nullptr, &WasapiCapture::OnSourceEvent, nullptr, &sourceLinks_[index]));
+    }
+
+    WasapiCapture* source = sources_[index].get();
+    source->keepPrepared_ = keepPrepared_;
+    source->useEventCallback_ = useEventCallback_;
+    source->bufferDurationMs_ = bufferDurationMs_;
+    source->resampleQuality_ = resampleQuality_;
+    source->sharedCaptureThread_ = sharedCaptureThread_;
+    source->followDefaultDevice_ = followDefaultDevice_;
+    source->chunkCallback_ = &WasapiCapture::OnSourceChunk;
+    return source;
+}
+
+void WasapiCapture::ResizeSources(size_t count) {
+    if (sources_.size() == count) return;
+
+    // Sources point into sourceLinks_, so they go before it reallocates
+    sources_.clear();
+    sourceLinks_.clear();
+    sources_.resize(count);
+    sourceLinks_.resize(count);
+}
+
+void WasapiCapture::StopSources() {
+    if (sources_.empty()) return;
+
+    for (auto& source : sources_) {
+        if (source) {
+            source->Stop();
+        }
+    }
+
+    // All producers are gone; emit what the slower source hadn't caught up on
+    aligner_.Flush();
+
+    // Prepared sources stay, stopped, for the next start
+    if (!keepPrepared_) {
+        sources_.clear();
+        sourceLinks_.clear();
+    }
+
+    // Detach, so the next session's first source can't feed a stale pipeline
+    // before that session configures the aligner
+    aligner_.Configure(SourceAligner::Config(), nullptr, nullptr);
+}
+
+void WasapiCapture::OnSourceChunk(const uint8_t* data, int32_t length, const AudioChunkInfo* info, void* context) {
+    auto* link = static_cast<SourceLink*>(context);
+    if (!data || length <= 0) return;
+
+    // Generated silence is a real span of the timeline; only loss is passed on
+    uint32_t flags = info ? (info->flags & AUDIO_CHUNK_FLAG_DISCONTINUITY) : 0;
+    link->owner->aligner_.Push(
+        link->index,
+        reinterpret_cast<const float*>(data),
+        static_cast<size_t>(length) / (sizeof(float) * link->owner->sourceChannels_),
+        info ? info->hostTimeNs : 0,
+        flags
+    );
+}
+
+void WasapiCapture::OnSourceEvent(int32_t eventType, const char* message, void* context) {
+    auto* link = static_cast<SourceLink*>(context);
+    WasapiCapture* owner = link->owner;
+
+    // Start and stop are reported once for the combined session
+    if (eventType != 2 || !owner->eventCallback_) return;
+
+    std::string text;
+    if (link->processId != 0) {
+        text = "Process " + std::to_string(link->processId) + ": ";
+    } else {
+        text = link->index == 0 ? "System audio: " : "Microphone: ";
+    }
+    text += message ? message : "capture error";
+    owner->eventCallback_(2, text.c_str(), owner->userContext_);
+}
+
+void WasapiCapture::OnAlignedFrames(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                                    uint32_t flags, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    self->pipeline_.Process(frames, frameCount, hostTimeNs, flags);
+}
+
+int32_t WasapiCapture::GetStats(AudioCaptureStats* stats) const {
+    if (!stats) return -1;
+    capture_stats_snapshot(stats_, stats);
+
+    // Combined and multi-process sessions read their devices through the
+    // sources; the pipeline, and so the stage timings, are this session's
+    for (const auto& source : sources_) {
+        if (!source) continue;
+        AudioCaptureStats sourceStats;
+        capture_stats_snapshot(source->stats_, &sourceStats);
+        stats->packets += sourceStats.packets;
+        stats->framesCaptured += sourceStats.framesCaptured;
+        stats->discontinuities += sourceStats.discontinuities;
+        stats->timestampErrors += sourceStats.timestampErrors;
+        stats->bytesAllocated += sourceStats.bytesAllocated;
+    }
+    return 0;
+}
+
+int32_t WasapiCapture::SetChannelMatrix(const float* weights, uint32_t outputs, uint32_t inputs) {
+    if (running_) return -2;
+    if (!weights || outputs == 0) {
+        channelMatrix_.clear();
+        channelMatrixInputs_ = 0;
+        return 0;
+    }
+    if (inputs == 0 || outputs > AUDIO_CHANNEL_MATRIX_MAX || inputs > AUDIO_CHANNEL_MATRIX_MAX) return -3;
+
+    channelMatrix_.assign(weights, weights + static_cast<size_t>(outputs) * inputs);
+    channelMatrixInputs_ = inputs;
+    return 0;
+}
+
+int32_t WasapiCapture::SetOption(const char* key, double value) {
+    if (!key) return -1;
+
+    // The one option applied live: the pipeline switches at the next chunk boundary
+    if (strcmp(key, "chunkDurationMs") == 0) {
+        if (value <= 0) return -3;
+        if (running_) return pipeline_.RequestChunkDuration(value) ? 0 : -3;
+        chunkDurationMs_ = value;
+        return 0;
+    }
+
+    if (running_) return -2;  // Other options only apply to the next start
+
+    if (strcmp(key, "bufferDurationMs") == 0) {
+        if (value <= 0) return -3;
+        bufferDurationMs_ = value;
+        return 0;
+    }
+
+    if (strcmp(key, "eventDriven") == 0) {
+        useEventCallback_ = value != 0;
+        return 0;
+    }
+
+    if (strcmp(key, "resampleQuality") == 0) {
+        if (value < 0 || value > 2) return -3;
+        resampleQuality_ = static_cast<PolyphaseResampler::Quality>(static_cast<int>(value));
+        return 0;
+    }
+
+    if (strcmp(key, "silenceGate") == 0) {
+        gateEnabled_ = value != 0;
+        return 0;
+    }
+
+    if (strcmp(key, "gateThresholdDb") == 0) {
+        if (value > 0) return -3;
+        gateThresholdDb_ = value;
+        return 0;
+    }
+
+    if (strcmp(key, "gateHangoverMs") == 0) {
+        if (value < 0) return -3;
+        gateHangoverMs_ = value;
+        return 0;
+    }
+
+    if (strcmp(key, "levels") == 0) {
+        if (value < 0 || value > 2) return -3;
+        levelsMode_ = static_cast<int32_t>(value);
+        return 0;
+    }
+
+    if (strcmp(key, "bitrate") == 0) {
+        if (value < 0) return -3;
+        bitrate_ = static_cast<int32_t>(value);
+        return 0;
+    }
+
+    if (strcmp(key, "sharedCaptureThread") == 0) {
+        sharedCaptureThread_ = value != 0;
+        return 0;
+    }
+
+    if (strcmp(key, "mixProcesses") == 0) {
+        mixProcesses_ = value != 0;
+        return 0;
+    }
+
+    if (strcmp(key, "followDefaultDevice") == 0) {
+        followDefaultDevice_ = value != 0;
+        return 0;
+    }
+
+    return 1;  // Not supported on Windows, ignored
+}
+
+int32_t WasapiCapture::PrepareSystemAudio(
+    const int32_t* includeProcesses,
+    int32_t includeCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeCount
+) {
+    if (running_) return -2;
+    keepPrepared_ = true;
+
+    if (includeCount > 1 && includeProcesses != nullptr) {
+        ResizeSources(static_cast<size_t>(includeCount));
+        for (int32_t i = 0; i < includeCount; i++) {
+            WasapiCapture* source = CreateSource(static_cast<uint32_t>(i), static_cast<uint32_t>(includeProcesses[i]));
+            int32_t result = source->PrepareSystemAudio(&includeProcesses[i], 1, nullptr, 0);
+            if (result != 0) return result;
+        }
+        return 0;
+    }
+
+    ResizeSources(0);
+    if (FAILED(OpenSystemClient(includeProcesses, includeCount, excludeProcesses, excludeCount))) {
+        if (eventCallback_) {
+            eventCallback_(2, "Failed to initialize audio capture", userContext_);
+        }
+        return -3;
+    }
+    return 0;
+}
+
+int32_t WasapiCapture::PrepareMicrophone(const char* deviceId) {
+    if (running_) return -2;
+    keepPrepared_ = true;
+
+    ResizeSources(0);
+    if (FAILED(OpenMicrophoneClient(deviceId ? Utf8ToWide(deviceId) : L""))) {
+        if (eventCallback_) {
+            eventCallback_(2, "Failed to initialize microphone capture", userContext_);
+        }
+        return -3;
+    }
+    return 0;
+}
+
+int32_t WasapiCapture::PrepareCombined(
+    const int32_t* includeProcesses,
+    int32_t includeCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeCount,
+    const char* micDeviceId
+) {
+    if (running_) return -2;
+    keepPrepared_ = true;
+
+    ResizeSources(2);
+    int32_t result = CreateSource(0)->PrepareSystemAudio(includeProcesses, includeCount, excludeProcesses, excludeCount);
+    if (result != 0) return result;
+    return CreateSource(1)->PrepareMicrophone(micDeviceId);
+}
+
+int32_t WasapiCapture::ReleasePrepared() {
+    keepPrepared_ = false;
+    for (auto& source : sources_) {
+        if (source) source->keepPrepared_ = false;
+    }
+
+    // A running session releases on stop instead
+    if (!running_) {
+        ResizeSources(0);
+        ReleaseClient();
+    }
+    return 0;
+}
+
 int32_t WasapiCapture::Stop() {
     if (!running_) return 0;
 
     running_ = false;
     SetEvent(stopEvent_);
 
-    if (captureThread_.joinable()) {
-        captureThread_.join();
+    // No notification may touch this session once it's stopped
+    if (following_) {
+        DeviceWatcher::Instance().RemoveDefaultListener(this);
+    }
+
+    StopCaptureThread();
+    following_ = false;
+
+    // Virtual session: joining the source thread ends its packets
+    if (virtualSource_) {
+        virtual_source_destroy(virtualSource_);
+        virtualSource_ = nullptr;
     }
 
     if (audioClient_) {
         audioClient_->Stop();
     }
+    if (!keepPrepared_) {
+        ReleaseClient();
+    }
+
+    // Combined or multi-process session: stop the sources and flush the aligner
+    StopSources();
 
     // Emit stop event
     if (eventCallback_) {
@@ -475,6 +1217,54 @@ int32_t WasapiCapture::Stop() {
     return 0;
 }
 
+void WasapiCapture::StartCaptureThread() {
+    // Initialize timing for silence generation
+    lastDataTime_ = std::chrono::steady_clock::now();
+
+    switching_ = false;
+    switchFailed_ = false;
+    if (following_) {
+        followThread_ = std::thread(&WasapiCapture::FollowThread, this);
+    }
+
+    scheduled_ = sharedCaptureThread_ && CaptureScheduler::Instance().Add(this);
+    if (!scheduled_) {
+        captureThread_ = std::thread(&WasapiCapture::CaptureThread, this);
+    }
+}
+
+void WasapiCapture::StopCaptureThread() {
+    if (scheduled_) {
+        CaptureScheduler::Instance().Remove(this);
+        scheduled_ = false;
+    }
+    if (captureThread_.joinable()) {
+        captureThread_.join();
+    }
+    // Woken by stopEvent_; a switch in progress finishes first
+    if (followThread_.joinable()) {
+        followThread_.join();
+    }
+}
+
+HANDLE WasapiCapture::CaptureWaitHandle() const {
+    return eventDriven_ ? bufferEvent_ : nullptr;
+}
+
+// Event-driven: sleep until WASAPI signals a packet. The timeout keeps
+// silence generation ticking and doubles as a poll for endpoints (some
+// loopback ones) that accept the event flag but never signal it.
+// Timer mode: poll at least twice per buffer, and no slower than 10ms.
+DWORD WasapiCapture::CaptureWaitTimeoutMs() const {
+    double pollMs = (std::min)(10.0, bufferDurationMs_ / 2.0);
+    double timeoutMs = eventDriven_ ? (std::min)(chunkDurationMs_, bufferDurationMs_ / 2.0) : pollMs;
+    return static_cast<DWORD>((std::max)(1.0, timeoutMs));
+}
+
+bool WasapiCapture::TakeWaitChanged() {
+    return waitChanged_.exchange(false);
+}
+
 void WasapiCapture::CaptureThread() {
     // Initialize COM for this worker thread (required for WASAPI)
     // Use MTA for worker threads as it's more suitable for background processing
@@ -487,76 +1277,22 @@ void WasapiCapture::CaptureThread() {
     DWORD taskIndex = 0;
     HANDLE taskHandle = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
 
-    UINT32 packetLength = 0;
-    BYTE* data = nullptr;
-    UINT32 numFramesAvailable = 0;
-    DWORD flags = 0;
-
-    // Initialize timing for silence generation
-    lastDataTime_ = std::chrono::steady_clock::now();
-    auto chunkDuration = std::chrono::milliseconds(static_cast<int64_t>(chunkDurationMs_));
+    HANDLE waitHandles[2] = { stopEvent_, bufferEvent_ };
 
     while (running_) {
-        // Wait for audio data or stop event
-        DWORD waitResult = WaitForSingleObject(stopEvent_, 10);
+        // Wait for audio data or stop event. Recomputed every pass: following
+        // the default device can switch between event and timer mode.
+        DWORD waitTimeout = CaptureWaitTimeoutMs();
+        DWORD waitResult = eventDriven_
+            ? WaitForMultipleObjects(2, waitHandles, FALSE, waitTimeout)
+            : WaitForSingleObject(stopEvent_, waitTimeout);
         if (waitResult == WAIT_OBJECT_0) {
             break;
         }
 
-        bool receivedAudio = false;
-
-        // Get available audio data
-        HRESULT hr = captureClient_->GetNextPacketSize(&packetLength);
-        if (FAILED(hr)) {
-            if (eventCallback_) {
-                eventCallback_(2, "Failed to get packet size", userContext_);
-            }
+        if (!ServiceCapture()) {
             break;
         }
-
-        while (packetLength > 0 && running_) {
-            hr = captureClient_->GetBuffer(&data, &numFramesAvailable, &flags, nullptr, nullptr);
-            if (FAILED(hr)) break;
-
-            if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT) && data != nullptr) {
-                ProcessAudioData(data, numFramesAvailable);
-                receivedAudio = true;
-            }
-
-            hr = captureClient_->ReleaseBuffer(numFramesAvailable);
-            if (FAILED(hr)) break;
-
-            hr = captureClient_->GetNextPacketSize(&packetLength);
-            if (FAILED(hr)) break;
-        }
-
-        // Update last data time if we received audio
-        if (receivedAudio) {
-            lastDataTime_ = std::chrono::steady_clock::now();
-        }
-
-        // Generate silence if enabled and no audio received for too long
-        if (emitSilence_ && !receivedAudio) {
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastDataTime_);
-            
-            if (elapsed >= chunkDuration) {
-                // Generate silent chunk
-                size_t numChannels = isMono_ ? 1 : (mixFormat_ ? mixFormat_->nChannels : 2);
-                size_t silentSamples = samplesPerChunk_ * numChannels;
-                
-                if (silentSamples > 0 && dataCallback_) {
-                    std::vector<float> silentBuffer(silentSamples, 0.0f);
-                    dataCallback_(
-                        reinterpret_cast<const uint8_t*>(silentBuffer.data()),
-                        static_cast<int32_t>(silentSamples * sizeof(float)),
-                        userContext_
-                    );
-                }
-                
-                lastDataTime_ = now;
-            }
-        }
     }
 
     if (taskHandle) {
@@ -569,100 +1305,236 @@ void WasapiCapture::CaptureThread() {
     }
 }
 
-void WasapiCapture::ProcessAudioData(const BYTE* data, UINT32 numFrames) {
-    if (!mixFormat_ || numFrames == 0) return;
+bool WasapiCapture::ServiceCapture() {
+    if (!running_) return true;
 
-    // Convert to float (assuming input is float - WASAPI typically provides float)
-    const float* floatData = reinterpret_cast<const float*>(data);
-    size_t numChannels = mixFormat_->nChannels;
-    size_t totalSamples = numFrames * numChannels;
+    UINT32 packetLength = 0;
+    BYTE* data = nullptr;
+    UINT32 numFramesAvailable = 0;
+    DWORD flags = 0;
+    bool receivedAudio = false;
 
-    std::vector<float> processedData;
+    // While followThread_ switches devices the client and pipeline are its
+    if (switching_.load(std::memory_order_acquire)) return true;
+    if (switchFailed_) return false;
 
-    // Apply gain if capturing microphone
-    if (gain_ != 1.0) {
-        processedData.resize(totalSamples);
-        for (size_t i = 0; i < totalSamples; i++) {
-            processedData[i] = floatData[i] * static_cast<float>(gain_);
+    // A new default endpoint is picked up between packets
+    if (following_ && defaultChanged_.exchange(false)) {
+        RequestDeviceSwitch();
+        return true;
+    }
+
+    // Get available audio data. Without a client (a follow that found no
+    // endpoint yet) nothing is read; the silence below keeps the timeline.
+    HRESULT hr = captureClient_ ? captureClient_->GetNextPacketSize(&packetLength) : S_OK;
+    if (hr == AUDCLNT_E_DEVICE_INVALIDATED && following_) {
+        RequestDeviceSwitch();
+        return true;
+    }
+    if (FAILED(hr)) {
+        if (eventCallback_) {
+            eventCallback_(2, "Failed to get packet size", userContext_);
         }
-        floatData = processedData.data();
+        return false;
     }
 
-    // Convert to mono if needed
-    std::vector<float> monoData;
-    if (isMono_ && numChannels > 1) {
-        ConvertToMono(floatData, numFrames, monoData);
-        floatData = monoData.data();
-        numChannels = 1;
-        totalSamples = numFrames;
+    while (packetLength > 0 && running_) {
+        UINT64 devicePosition = 0;
+        UINT64 qpcPosition = 0;
+        hr = captureClient_->GetBuffer(&data, &numFramesAvailable, &flags, &devicePosition, &qpcPosition);
+        if (FAILED(hr)) break;
+
+        // A jump in the device position means frames were lost even when
+        // the endpoint doesn't report AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY
+        uint32_t chunkFlags = 0;
+        if ((flags & AUDCLNT_BUFFERFLAGS_DATA_DISCONTINUITY) ||
+            (hasDevicePosition_ && devicePosition != expectedDevicePosition_)) {
+            chunkFlags |= AUDIO_CHUNK_FLAG_DISCONTINUITY;
+        }
+        hasDevicePosition_ = true;
+        expectedDevicePosition_ = devicePosition + numFramesAvailable;
+
+        // qpcPosition is in 100ns units; unusable when the engine flags it
+        uint64_t hostTimeNs = (flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) ? 0 : qpcPosition * 100;
+
+        capture_stats_add_packet(stats_, numFramesAvailable, chunkFlags);
+        if (flags & AUDCLNT_BUFFERFLAGS_TIMESTAMP_ERROR) {
+            capture_stats_add_timestamp_error(stats_);
+        }
+
+        if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT) && data != nullptr) {
+            ProcessAudioData(data, numFramesAvailable, hostTimeNs, chunkFlags);
+            receivedAudio = true;
+        }
+
+        hr = captureClient_->ReleaseBuffer(numFramesAvailable);
+        if (FAILED(hr)) break;
+
+        hr = captureClient_->GetNextPacketSize(&packetLength);
+        if (FAILED(hr)) break;
     }
 
-    // Resample if needed
-    std::vector<float> resampledData;
-    size_t outputFrames = numFrames;
-    if (resampleRatio_ != 1.0) {
-        ResampleAudio(floatData, numFrames * numChannels, resampledData);
-        floatData = resampledData.data();
-        outputFrames = resampledData.size() / numChannels;
-        totalSamples = resampledData.size();
+    // Update last data time if we received audio
+    if (receivedAudio) {
+        lastDataTime_ = std::chrono::steady_clock::now();
     }
 
-    // Add to chunk buffer
-    size_t outputSamples = outputFrames * numChannels;
-    for (size_t i = 0; i < outputSamples; i++) {
-        chunkBuffer_.push_back(floatData[i]);
+    // Generate silence if enabled and no audio received for too long. The
+    // gate needs the ticks too, or an idle loopback would never close it.
+    // Without a client it is generated regardless of emitSilence, so a follow
+    // that lost its endpoint keeps delivering chunks on the same timeline.
+    if ((emitSilence_ || gateEnabled_ || !captureClient_) && !receivedAudio) {
+        auto now = std::chrono::steady_clock::now();
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - lastDataTime_);
+        // The pipeline's size, which follows live chunkDurationMs changes
+        auto chunkDuration = std::chrono::milliseconds(static_cast<int64_t>(
+            pipeline_.FramesPerChunk() * 1000.0 / pipeline_.OutputSampleRate()));
+
+        if (elapsed >= chunkDuration) {
+            // Generate a silent chunk from the pipeline's preallocated buffer
+            pipeline_.EmitSilence(QpcNowNs());
+
+            lastDataTime_ = now;
+        }
     }
 
-    // Emit chunks when buffer is full
-    size_t samplesNeeded = samplesPerChunk_ * (isMono_ ? 1 : numChannels);
-    while (chunkBuffer_.size() >= samplesNeeded && dataCallback_) {
-        // Emit chunk
-        dataCallback_(
-            reinterpret_cast<const uint8_t*>(chunkBuffer_.data()),
-            static_cast<int32_t>(samplesNeeded * sizeof(float)),
-            userContext_
-        );
+    return true;
+}
 
-        // Remove emitted samples from buffer
-        chunkBuffer_.erase(chunkBuffer_.begin(), chunkBuffer_.begin() + samplesNeeded);
-    }
+void WasapiCapture::OnDefaultDeviceChanged(EDataFlow flow, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    if (flow != self->followFlow_) return;
+
+    // Wake the capture thread; it hands the switch to followThread_ between packets
+    self->defaultChanged_ = true;
+    SetEvent(self->bufferEvent_);
 }
 
-void WasapiCapture::ConvertToMono(const float* input, size_t frames, std::vector<float>& output) {
-    size_t channels = mixFormat_->nChannels;
-    output.resize(frames);
+// Capture thread: stop touching the client and pipeline, and let
+// followThread_ reopen the endpoint
+void WasapiCapture::RequestDeviceSwitch() {
+    switching_.store(true, std::memory_order_relaxed);
+    SetEvent(followEvent_);
+}
 
-    for (size_t i = 0; i < frames; i++) {
-        float sum = 0.0f;
-        for (size_t c = 0; c < channels; c++) {
-            sum += input[i * channels + c];
+void WasapiCapture::FollowThread() {
+    HRESULT comHr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    bool comInitializedByUs = (comHr == S_OK);
+
+    HANDLE waitHandles[2] = { stopEvent_, followEvent_ };
+    while (WaitForMultipleObjects(2, waitHandles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+        if (!SwitchToDefaultDevice()) {
+            switchFailed_ = true;
         }
-        output[i] = sum / channels;
+        // Publishes the new client and pipeline input to the capture thread
+        switching_.store(false, std::memory_order_release);
+        SetEvent(bufferEvent_);
+    }
+
+    if (comInitializedByUs) {
+        CoUninitialize();
     }
 }
 
-void WasapiCapture::ResampleAudio(const float* input, size_t inputSamples, std::vector<float>& output) {
-    size_t outputSamples = static_cast<size_t>(inputSamples * resampleRatio_);
-    output.resize(outputSamples);
+HRESULT WasapiCapture::ReopenDefaultDevice() {
+    if (audioClient_) {
+        audioClient_->Stop();
+    }
+    ReleaseClient();
+
+    HRESULT hr = followFlow_ == eRender ? InitializeSystemLoopback() : InitializeMicrophone(nullptr);
+    if (FAILED(hr)) {
+        ReleaseClient();
+        return hr;
+    }
 
-    // Simple linear interpolation resampling
-    for (size_t i = 0; i < outputSamples; i++) {
-        double srcIndex = i / resampleRatio_;
-        size_t srcIndexInt = static_cast<size_t>(srcIndex);
-        double frac = srcIndex - srcIndexInt;
+    // The output side stays; only the input is rebuilt for the new mix format
+    CapturePipeline::Config config = DevicePipelineConfig();
+    if (!FitChannelMatrix(config)) {
+        ReleaseClient();
+        return AUDCLNT_E_UNSUPPORTED_FORMAT;
+    }
+    if (!pipeline_.ChangeInput(config)) {
+        pipelineError_ = "Channel map doesn't fit the new default device";
+        ReleaseClient();
+        return AUDCLNT_E_UNSUPPORTED_FORMAT;
+    }
 
-        if (srcIndexInt + 1 < inputSamples) {
-            output[i] = static_cast<float>(
-                input[srcIndexInt] * (1.0 - frac) + input[srcIndexInt + 1] * frac
-            );
-        } else if (srcIndexInt < inputSamples) {
-            output[i] = input[srcIndexInt];
-        } else {
-            output[i] = 0.0f;
+    hr = audioClient_->Start();
+    if (FAILED(hr)) {
+        ReleaseClient();
+        return hr;
+    }
+    clientKey_ = ClientKey(followFlow_ == eRender ? L"system" : L"mic:");
+
+    // The new endpoint's device clock starts elsewhere
+    hasDevicePosition_ = false;
+    expectedDevicePosition_ = 0;
+    capture_stats_set_allocated(stats_, pipeline_.AllocatedBytes());
+    return S_OK;
+}
+
+bool WasapiCapture::SwitchToDefaultDevice() {
+    HRESULT hr = ReopenDefaultDevice();
+    // Success or not, eventDriven_ may differ now
+    waitChanged_ = true;
+    if (hr == AUDCLNT_E_UNSUPPORTED_FORMAT) {
+        if (eventCallback_) {
+            eventCallback_(2, pipelineError_.c_str(), userContext_);
         }
+        return false;
+    }
+
+    // Any other failure (no default endpoint right now) leaves no client:
+    // ServiceCapture() generates silence until the next default-device change
+    return true;
+}
+
+void WasapiCapture::ProcessAudioData(const BYTE* data, UINT32 numFrames, uint64_t hostTimeNs, uint32_t flags) {
+    if (!mixFormat_ || numFrames == 0) return;
+
+    // Input is float (assuming WASAPI shared-mode mix format, which is float)
+    pipeline_.Process(reinterpret_cast<const float*>(data), numFrames, hostTimeNs, flags);
+}
+
+void WasapiCapture::EmitChunk(const uint8_t* data, size_t byteCount, const AudioChunkInfo& info, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    if (byteCount == 0) return;
+
+    capture_stats_add_chunk(self->stats_, info.frameCount);
+    if (self->chunkCallback_) {
+        self->chunkCallback_(data, static_cast<int32_t>(byteCount), &info, self->userContext_);
+    } else if (self->dataCallback_) {
+        self->dataCallback_(data, static_cast<int32_t>(byteCount), self->userContext_);
+    }
+}
+
+void WasapiCapture::EmitActivity(bool active, const AudioChunkInfo& /*info*/, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    if (self->eventCallback_) {
+        self->eventCallback_(active ? 3 : 4, nullptr, self->userContext_);
     }
 }
 
+int32_t WasapiCapture::SetChunkCallback(AudioChunkCallback callback) {
+    if (running_) return -2;
+    chunkCallback_ = callback;
+    return 0;
+}
+
+void WasapiCapture::EmitLevels(const AudioLevels& levels, const AudioChunkInfo& info, void* context) {
+    auto* self = static_cast<WasapiCapture*>(context);
+    if (self->levelCallback_) {
+        self->levelCallback_(&levels, &info, self->userContext_);
+    }
+}
+
+int32_t WasapiCapture::SetLevelCallback(AudioLevelCallback callback) {
+    if (running_) return -2;
+    levelCallback_ = callback;
+    return 0;
+}
+
 // ============================================================================
 // AudioDeviceEnumerator Implementation
 // ============================================================================
@@ -12,6 +12,9 @@
 #include <mutex>
 #include <string>
 #include <chrono>
+#include <memory>
+
+#include "capture_scheduler.h"
 
 // ============================================================================
 // Windows 10 2004+ Process Loopback API Definitions
@@ -55,6 +58,8 @@ typedef struct _AUDIOCLIENT_ACTIVATION_PARAMS {
 #endif
 
 #include "audio_bridge.h"
+#include "capture_pipeline.h"
+#include "source_aligner.h"
 
 // Forward declarations
 class WasapiCapture;
@@ -83,8 +88,9 @@ private:
     IActivateAudioInterfaceAsyncOperation* operation_;
 };
 
-// Main WASAPI capture class
-class WasapiCapture {
+// Main WASAPI capture class. Capture runs on its own thread, or on a shared
+// CaptureScheduler worker with the "sharedCaptureThread" option.
+class WasapiCapture : private ScheduledCapture {
 public:
     WasapiCapture(
         AudioDataCallback dataCallback,
@@ -94,7 +100,9 @@ public:
     );
     ~WasapiCapture();
 
-    // System audio capture (loopback)
+    // System audio capture (loopback). Several include PIDs fan in one
+    // process-loopback client each (see StartProcessMix); exclude mode can
+    // only honor the first PID.
     int32_t StartSystemAudio(
         double sampleRate,
         double chunkDurationMs,
@@ -104,7 +112,8 @@ public:
         const int32_t* includeProcesses,
         int32_t includeCount,
         const int32_t* excludeProcesses,
-        int32_t excludeCount
+        int32_t excludeCount,
+        int32_t outputFormat  // AUDIO_FORMAT_*
     );
 
     // Microphone capture
@@ -114,12 +123,70 @@ public:
         bool isMono,
         bool emitSilence,  // Generate silent buffers when no audio is playing
         const char* deviceId,
-        double gain
+        double gain,
+        int32_t outputFormat  // AUDIO_FORMAT_*
+    );
+
+    // System audio and microphone on one clock: a two-channel stream with
+    // system audio (downmixed) on channel 0 and the microphone on channel 1
+    int32_t StartCombined(
+        double sampleRate,
+        double chunkDurationMs,
+        const int32_t* includeProcesses,
+        int32_t includeCount,
+        const int32_t* excludeProcesses,
+        int32_t excludeCount,
+        const char* micDeviceId,
+        double micGain,
+        int32_t outputFormat  // AUDIO_FORMAT_*
+    );
+
+    // Synthetic source instead of a device (see audio_start_virtual); its
+    // thread feeds pipeline_ directly, no audio client or capture thread
+    int32_t StartVirtual(
+        double sampleRate,
+        double chunkDurationMs,
+        bool isMono,
+        const VirtualSourceConfig* source,
+        int32_t outputFormat  // AUDIO_FORMAT_*
+    );
+
+    // Activate and initialize the audio clients a start for this source would
+    // use, and keep them (and any sources) across stops until ReleasePrepared()
+    int32_t PrepareSystemAudio(
+        const int32_t* includeProcesses,
+        int32_t includeCount,
+        const int32_t* excludeProcesses,
+        int32_t excludeCount
+    );
+    int32_t PrepareMicrophone(const char* deviceId);
+    int32_t PrepareCombined(
+        const int32_t* includeProcesses,
+        int32_t includeCount,
+        const int32_t* excludeProcesses,
+        int32_t excludeCount,
+        const char* micDeviceId
     );
+    int32_t ReleasePrepared();
 
     int32_t Stop();
     bool IsRunning() const { return running_; }
 
+    // Counters and stage timings since the last start (see audio_get_stats)
+    int32_t GetStats(AudioCaptureStats* stats) const;
+
+    // Tuning options, applied on the next start (see audio_set_option)
+    int32_t SetOption(const char* key, double value);
+
+    // Channel selection/mix for the next start (see audio_set_channel_matrix)
+    int32_t SetChannelMatrix(const float* weights, uint32_t outputs, uint32_t inputs);
+
+    // Deliver chunks with timing instead of through dataCallback_ (see audio_set_chunk_callback)
+    int32_t SetChunkCallback(AudioChunkCallback callback);
+
+    // Per-chunk levels while the "levels" option is on (see audio_set_level_callback)
+    int32_t SetLevelCallback(AudioLevelCallback callback);
+
 private:
     // Initialize system-wide loopback (fallback for older Windows or no process filter)
     HRESULT InitializeSystemLoopback();
@@ -130,24 +197,103 @@ private:
     // Initialize microphone capture
     HRESULT InitializeMicrophone(const wchar_t* deviceId);
 
+    // Initialize audioClient_ in shared mode and fetch the capture client.
+    // Tries event-driven capture first and falls back to timer polling when the
+    // endpoint rejects it. allowLowLatency enables IAudioClient3 periods < 10ms.
+    HRESULT InitializeAudioClient(DWORD streamFlags, bool allowLowLatency);
+
     // Common initialization after audio client is set up
     HRESULT FinalizeInitialization();
 
+    // Make audioClient_ a stopped, empty client for the endpoint, reusing the
+    // current one when it was initialized for the same endpoint and tuning.
+    // Process loopback activation alone can take 100s of ms.
+    HRESULT OpenSystemClient(const int32_t* includeProcesses, int32_t includeCount,
+                             const int32_t* excludeProcesses, int32_t excludeCount);
+    HRESULT OpenMicrophoneClient(const std::wstring& deviceId);
+    bool ReuseClient(const std::wstring& key);
+    std::wstring ClientKey(const std::wstring& endpoint) const;
+    void ReleaseClient();
+
+    // Include-mode loopback for several processes: WASAPI takes one target per
+    // client, so each PID runs as its own source and aligner_ either mixes them
+    // ("mixProcesses", default) or stacks them one channel per process
+    int32_t StartProcessMix(double sampleRate, bool isMono, const int32_t* processes, int32_t count);
+
+    // Apply outputFormat_, configure pipeline_ and report its metadata.
+    // Returns false if the requested encoding can't be created.
+    bool ConfigurePipeline(CapturePipeline::Config config);
+
+    // Pipeline input side for the current mixFormat_ and audioClient_
+    CapturePipeline::Config DevicePipelineConfig() const;
+
+    // Fit channelMatrix_ into config for its input channels. Returns false,
+    // with pipelineError_ set, if the matrix uses a channel the source lacks.
+    bool FitChannelMatrix(CapturePipeline::Config& config);
+
+    // "followDefaultDevice": when the default endpoint changes, or the current
+    // one goes away, the capture thread hands the switch to followThread_,
+    // which reopens the new default and splices it into pipeline_
+    // (ChangeInput) instead of ending the session. The COM calls and buffer
+    // allocations stay off the capture thread, which leaves the client and
+    // pipeline alone until switching_ clears.
+    static void OnDefaultDeviceChanged(EDataFlow flow, void* context);
+    void RequestDeviceSwitch();
+    void FollowThread();
+    HRESULT ReopenDefaultDevice();
+    bool SwitchToDefaultDevice();  // False after reporting a fatal error
+
+    // Service the stream from captureThread_ or the shared scheduler
+    void StartCaptureThread();
+    void StopCaptureThread();
+
     // Audio capture thread
     void CaptureThread();
 
+    // One servicing pass: drain packets, generate silence when due.
+    // Returns false after reporting a fatal error.
+    bool ServiceCapture() override;
+    HANDLE CaptureWaitHandle() const override;
+    DWORD CaptureWaitTimeoutMs() const override;
+    bool TakeWaitChanged() override;
+
     // Convert audio data to target format
-    void ProcessAudioData(const BYTE* data, UINT32 numFrames);
+    void ProcessAudioData(const BYTE* data, UINT32 numFrames, uint64_t hostTimeNs, uint32_t flags);
 
-    // Sample rate conversion (simple linear interpolation)
-    void ResampleAudio(const float* input, size_t inputFrames, std::vector<float>& output);
+    // Pipeline sink: forwards completed chunks to the chunk or data callback
+    static void EmitChunk(const uint8_t* data, size_t byteCount, const AudioChunkInfo& info, void* context);
 
-    // Convert stereo to mono
-    void ConvertToMono(const float* input, size_t frames, std::vector<float>& output);
+    // Pipeline activity sink: reports gate transitions as activity events
+    static void EmitActivity(bool active, const AudioChunkInfo& info, void* context);
+
+    // Pipeline level sink: forwards chunk levels to levelCallback_
+    static void EmitLevels(const AudioLevels& levels, const AudioChunkInfo& info, void* context);
+
+    // Combined and multi-process capture: each source runs as its own f32
+    // capture at the output rate and feeds aligner_, whose interleaved frames
+    // go through pipeline_
+    struct SourceLink {
+        WasapiCapture* owner;
+        uint32_t index;
+        uint32_t processId;   // Multi-process source, 0 for combined capture
+    };
+    static void OnSourceChunk(const uint8_t* data, int32_t length, const AudioChunkInfo* info, void* context);
+    static void OnSourceEvent(int32_t eventType, const char* message, void* context);
+    static void OnAlignedFrames(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                                uint32_t flags, void* context);
+    WasapiCapture* CreateSource(uint32_t index, uint32_t processId = 0);
+
+    // Virtual source thread: packets go straight into pipeline_
+    static void OnVirtualPacket(const float* frames, size_t frameCount, uint64_t hostTimeNs,
+                                uint32_t flags, void* context);
+    void ResizeSources(size_t count);
+    void StopSources();
 
     // Callbacks
     AudioDataCallback dataCallback_;
     AudioEventCallback eventCallback_;
+    AudioChunkCallback chunkCallback_;
+    AudioLevelCallback levelCallback_;
     AudioMetadataCallback metadataCallback_;
     void* userContext_;
 
@@ -155,11 +301,32 @@ private:
     IAudioClient* audioClient_;
     IAudioCaptureClient* captureClient_;
     WAVEFORMATEX* mixFormat_;
+    std::wstring clientKey_;  // Endpoint and tuning audioClient_ was initialized for
+    bool keepPrepared_;       // Keep clients and sources across stops (Prepare*)
 
     // Capture state
     std::thread captureThread_;
     std::atomic<bool> running_;
     HANDLE stopEvent_;
+    HANDLE bufferEvent_;      // Signaled by WASAPI when a packet is ready (event-driven mode)
+    std::atomic<bool> eventDriven_; // Whether the current stream actually uses bufferEvent_
+    bool scheduled_;          // Serviced by CaptureScheduler instead of captureThread_
+    std::atomic<bool> waitChanged_; // A device switch may have flipped eventDriven_
+
+    // Tuning options
+    bool useEventCallback_;   // Request AUDCLNT_STREAMFLAGS_EVENTCALLBACK
+    double bufferDurationMs_; // Shared-mode buffer duration (or period for low latency)
+    PolyphaseResampler::Quality resampleQuality_;
+    bool gateEnabled_;        // Hold back chunks without activity ("silenceGate")
+    double gateThresholdDb_;
+    double gateHangoverMs_;
+    int32_t levelsMode_;      // "levels": 0 = off, 1 = meter chunks, 2 = levels only
+    int32_t bitrate_;         // "bitrate" for Opus, 0 = encoder default
+    bool sharedCaptureThread_; // "sharedCaptureThread": service on a CaptureScheduler worker
+    bool mixProcesses_;       // "mixProcesses": sum include PIDs, or one channel per PID
+    bool followDefaultDevice_; // "followDefaultDevice": move to a new default endpoint while running
+    std::vector<float> channelMatrix_;  // audio_set_channel_matrix weights, empty = off
+    uint32_t channelMatrixInputs_;
 
     // Audio format settings
     double targetSampleRate_;
@@ -167,17 +334,45 @@ private:
     bool isMono_;
     double gain_;
     bool emitSilence_;
+    int32_t outputFormat_;    // AUDIO_FORMAT_* requested by the last start
+
+    // Set while a session follows the default endpoint of followFlow_;
+    // defaultChanged_ is raised by the watcher and taken by the capture thread
+    bool following_;
+    EDataFlow followFlow_;
+    std::atomic<bool> defaultChanged_;
+    std::thread followThread_;
+    HANDLE followEvent_;              // Capture thread -> followThread_: switch now
+    std::atomic<bool> switching_;     // followThread_ owns the client and pipeline input
+    std::atomic<bool> switchFailed_;  // The switch reported a fatal error
+
+    // Device clock tracking for discontinuity detection
+    bool hasDevicePosition_;
+    UINT64 expectedDevicePosition_;
     
     // Silence generation tracking
     std::chrono::steady_clock::time_point lastDataTime_;
 
-    // Buffer for accumulating audio chunks
-    std::vector<float> chunkBuffer_;
-    size_t samplesPerChunk_;
+    // Gain, downmix, resampling and chunking (allocation-free once configured)
+    CapturePipeline pipeline_;
+
+    // Source state: combined capture has sources_[0] = system audio and
+    // sources_[1] = microphone, multi-process capture one source per PID.
+    // sourceLinks_ is sized before the sources exist and never reallocated
+    // while they do, since each source holds a pointer into it (ResizeSources).
+    std::vector<std::unique_ptr<WasapiCapture>> sources_;
+    std::vector<SourceLink> sourceLinks_;
+    uint32_t sourceChannels_; // Samples per frame each source delivers
+    SourceAligner aligner_;
+
+    // Packet, chunk and stage timing counters, reset when the pipeline is configured
+    CaptureStats* stats_;
+
+    // Why the last ConfigurePipeline() failed, for the start's error event
+    std::string pipelineError_;
 
-    // Resampling state
-    double resampleRatio_;
-    std::vector<float> resampleBuffer_;
+    // Set while a StartVirtual() session runs
+    VirtualSource* virtualSource_;
 };
 
 // Device enumeration helper
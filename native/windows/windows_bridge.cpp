@@ -1,38 +1,17 @@
 #include "audio_bridge.h"
 #include "wasapi_capture.h"
+#include "device_watcher.h"
+#include "mic_activity_monitor.h"
 #include "mta_thread.h"
 #include <combaseapi.h>
 #include <cstring>
 #include <mmdeviceapi.h>
-#include <audiopolicy.h>
-#include <Psapi.h>
 #include <vector>
 
-#pragma comment(lib, "Psapi.lib")
-
 // Global MTA cookie - keeps COM MTA alive for the module's lifetime
 // Uses CoIncrementMTAUsage (Windows 8+) for cleaner MTA management
 CO_MTA_USAGE_COOKIE g_mtaCookie = nullptr;
 
-// Helper function to get process name from PID
-static std::wstring GetProcessNameFromPid(DWORD pid) {
-    std::wstring name;
-    HANDLE hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_VM_READ, FALSE, pid);
-    if (hProcess) {
-        WCHAR buffer[MAX_PATH];
-        if (GetModuleBaseNameW(hProcess, NULL, buffer, MAX_PATH) > 0) {
-            name = buffer;
-            // Remove .exe extension if present
-            size_t extPos = name.rfind(L".exe");
-            if (extPos != std::wstring::npos && extPos == name.length() - 4) {
-                name = name.substr(0, extPos);
-            }
-        }
-        CloseHandle(hProcess);
-    }
-    return name;
-}
-
 // Alias for InitializeMTAThread from mta_thread.h
 // Ensure the MTA is initialized before any COM operation
 static bool EnsureMTAInitialized() {
@@ -73,7 +52,8 @@ int32_t audio_start_system_audio(
     const int32_t* includeProcesses,
     int32_t includeProcessCount,
     const int32_t* excludeProcesses,
-    int32_t excludeProcessCount
+    int32_t excludeProcessCount,
+    int32_t outputFormat
 ) {
     if (!handle) return -1;
     
@@ -87,7 +67,8 @@ int32_t audio_start_system_audio(
         includeProcesses,
         includeProcessCount,
         excludeProcesses,
-        excludeProcessCount
+        excludeProcessCount,
+        outputFormat
     );
 }
 
@@ -98,7 +79,8 @@ int32_t audio_start_microphone(
     bool isMono,
     bool emitSilence,
     const char* deviceUID,
-    double gain
+    double gain,
+    int32_t outputFormat
 ) {
     if (!handle) return -1;
     
@@ -109,10 +91,138 @@ int32_t audio_start_microphone(
         isMono,
         emitSilence,
         deviceUID,
-        gain
+        gain,
+        outputFormat
+    );
+}
+
+int32_t audio_start_virtual(
+    AudioRecorderHandle handle,
+    double sampleRate,
+    double chunkDurationMs,
+    bool isMono,
+    const VirtualSourceConfig* source,
+    int32_t outputFormat
+) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->StartVirtual(sampleRate, chunkDurationMs, isMono, source, outputFormat);
+}
+
+int32_t audio_start_combined(
+    AudioRecorderHandle handle,
+    double sampleRate,
+    double chunkDurationMs,
+    bool mute,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount,
+    const char* micDeviceUID,
+    double micGain,
+    int32_t outputFormat
+) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->StartCombined(
+        sampleRate,
+        chunkDurationMs,
+        includeProcesses,  // mute is ignored on Windows
+        includeProcessCount,
+        excludeProcesses,
+        excludeProcessCount,
+        micDeviceUID,
+        micGain,
+        outputFormat
+    );
+}
+
+int32_t audio_prepare_system_audio(
+    AudioRecorderHandle handle,
+    bool mute,
+    bool isMono,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount
+) {
+    if (!handle) return -1;
+    
+    // mute is ignored on Windows, and isMono only shapes the pipeline start builds
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->PrepareSystemAudio(
+        includeProcesses,
+        includeProcessCount,
+        excludeProcesses,
+        excludeProcessCount
+    );
+}
+
+int32_t audio_prepare_microphone(AudioRecorderHandle handle, const char* deviceUID) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->PrepareMicrophone(deviceUID);
+}
+
+int32_t audio_prepare_combined(
+    AudioRecorderHandle handle,
+    bool mute,
+    const int32_t* includeProcesses,
+    int32_t includeProcessCount,
+    const int32_t* excludeProcesses,
+    int32_t excludeProcessCount,
+    const char* micDeviceUID
+) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->PrepareCombined(
+        includeProcesses,  // mute is ignored on Windows
+        includeProcessCount,
+        excludeProcesses,
+        excludeProcessCount,
+        micDeviceUID
     );
 }
 
+int32_t audio_release_prepared(AudioRecorderHandle handle) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->ReleasePrepared();
+}
+
+int32_t audio_set_chunk_callback(AudioRecorderHandle handle, AudioChunkCallback callback) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->SetChunkCallback(callback);
+}
+
+int32_t audio_set_level_callback(AudioRecorderHandle handle, AudioLevelCallback callback) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->SetLevelCallback(callback);
+}
+
+int32_t audio_set_option(AudioRecorderHandle handle, const char* key, double value) {
+    if (!handle) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->SetOption(key, value);
+}
+
+int32_t audio_set_channel_matrix(AudioRecorderHandle handle, const float* weights, uint32_t outputs, uint32_t inputs) {
+    if (!handle) return -1;
+
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->SetChannelMatrix(weights, outputs, inputs);
+}
+
 int32_t audio_stop(AudioRecorderHandle handle) {
     if (!handle) return -1;
     
@@ -135,6 +245,13 @@ bool audio_is_running(AudioRecorderHandle handle) {
     return capture->IsRunning();
 }
 
+int32_t audio_get_stats(AudioRecorderHandle handle, AudioCaptureStats* stats) {
+    if (!handle || !stats) return -1;
+    
+    auto* capture = static_cast<WasapiCapture*>(handle);
+    return capture->GetStats(stats);
+}
+
 // ============================================================================
 // Device Enumeration
 // ============================================================================
@@ -151,14 +268,14 @@ int32_t audio_list_devices(AudioDeviceInfo** devices, int32_t* count) {
     }
     
     try {
-        std::vector<AudioDeviceInfo> deviceList = AudioDeviceEnumerator::ListAllDevices();
+        std::vector<AudioDeviceInfo> deviceList = DeviceWatcher::Instance().Snapshot();
         
         if (!deviceList.empty()) {
             // Allocate array of AudioDeviceInfo
             *devices = new AudioDeviceInfo[deviceList.size()];
             *count = static_cast<int32_t>(deviceList.size());
             
-            // Copy device info (strings are already allocated by the enumerator)
+            // Copy device info (strings are already allocated by the snapshot)
             for (size_t i = 0; i < deviceList.size(); i++) {
                 (*devices)[i] = deviceList[i];
             }
@@ -185,6 +302,13 @@ void audio_free_device_list(AudioDeviceInfo* devices, int32_t count) {
     delete[] devices;
 }
 
+int32_t audio_set_device_change_callback(AudioDeviceChangeCallback callback, void* context) {
+    if (!EnsureMTAInitialized()) return -1;
+
+    DeviceWatcher::Instance().SetChangeCallback(callback, context);
+    return 0;
+}
+
 char* audio_get_default_input_device(void) {
     EnsureMTAInitialized();
     
@@ -246,17 +370,9 @@ void audio_mic_permission_request(PermissionCallback callback, void* context) {
 }
 
 // ============================================================================
-// Microphone Activity Monitor (stub - full implementation TODO)
+// Microphone Activity Monitor
 // ============================================================================
 
-struct MicActivityMonitorState {
-    MicActivityChangeCallback changeCallback;
-    MicActivityDeviceCallback deviceCallback;
-    MicActivityErrorCallback errorCallback;
-    void* userContext;
-    bool isRunning;
-};
-
 MicActivityMonitorHandle mic_activity_create(
     MicActivityChangeCallback changeCallback,
     MicActivityDeviceCallback deviceCallback,
@@ -265,54 +381,45 @@ MicActivityMonitorHandle mic_activity_create(
 ) {
     // Note: We don't initialize COM here to avoid conflicts with Electron's COM state
     // COM will be initialized lazily when needed by specific functions
-    
-    auto* state = new MicActivityMonitorState{
+
+    auto* monitor = new MicActivityMonitor(
         changeCallback,
         deviceCallback,
         errorCallback,
-        userContext,
-        false
-    };
-    
-    return static_cast<MicActivityMonitorHandle>(state);
+        userContext
+    );
+
+    return static_cast<MicActivityMonitorHandle>(monitor);
 }
 
 int32_t mic_activity_start(MicActivityMonitorHandle handle, const char* scope) {
     if (!handle) return -1;
-    
-    auto* state = static_cast<MicActivityMonitorState*>(handle);
-    state->isRunning = true;
-    
-    // TODO: Implement WASAPI session monitoring
-    // - Use IAudioSessionManager2::RegisterSessionNotification
-    // - Track capture endpoint sessions
-    // - Emit change events when sessions become active/inactive
-    
-    return 0;
+    if (!EnsureMTAInitialized()) return -1;
+
+    auto* monitor = static_cast<MicActivityMonitor*>(handle);
+    bool allDevices = !(scope && strcmp(scope, "default") == 0);
+    return monitor->Start(allDevices);
 }
 
 int32_t mic_activity_stop(MicActivityMonitorHandle handle) {
     if (!handle) return -1;
-    
-    auto* state = static_cast<MicActivityMonitorState*>(handle);
-    state->isRunning = false;
-    
-    return 0;
+
+    auto* monitor = static_cast<MicActivityMonitor*>(handle);
+    return monitor->Stop();
 }
 
 void mic_activity_destroy(MicActivityMonitorHandle handle) {
     if (!handle) return;
-    
-    auto* state = static_cast<MicActivityMonitorState*>(handle);
-    state->isRunning = false;
-    delete state;
+
+    auto* monitor = static_cast<MicActivityMonitor*>(handle);
+    delete monitor;
 }
 
 bool mic_activity_is_active(MicActivityMonitorHandle handle) {
     if (!handle) return false;
-    
-    // TODO: Query active capture sessions
-    return false;
+
+    auto* monitor = static_cast<MicActivityMonitor*>(handle);
+    return monitor->IsActive();
 }
 
 int32_t mic_activity_get_active_device_ids(
@@ -321,11 +428,21 @@ int32_t mic_activity_get_active_device_ids(
     int32_t* count
 ) {
     if (!handle || !deviceIds || !count) return -1;
-    
-    // TODO: Return list of devices with active capture sessions
+
     *deviceIds = nullptr;
     *count = 0;
-    
+
+    auto* monitor = static_cast<MicActivityMonitor*>(handle);
+    std::vector<std::string> ids = monitor->ActiveDeviceIds();
+    if (ids.empty()) return 0;
+
+    *deviceIds = static_cast<char**>(malloc(ids.size() * sizeof(char*)));
+    if (!*deviceIds) return 0;
+
+    for (size_t i = 0; i < ids.size(); i++) {
+        (*deviceIds)[i] = _strdup(ids[i].c_str());
+    }
+    *count = static_cast<int32_t>(ids.size());
     return 0;
 }
 
@@ -346,7 +463,7 @@ int32_t mic_activity_get_active_processes(
     char*** bundleIds,
     int32_t* count
 ) {
-    if (!pids || !names || !bundleIds || !count) {
+    if (!handle || !pids || !names || !bundleIds || !count) {
         return -1;
     }
 
@@ -362,149 +479,13 @@ int32_t mic_activity_get_active_processes(
     }
 
     try {
-        HRESULT hr = S_OK;
-        
-        // Get device enumerator
-        IMMDeviceEnumerator* pEnumerator = nullptr;
-        hr = CoCreateInstance(
-            __uuidof(MMDeviceEnumerator),
-            nullptr,
-            CLSCTX_ALL,
-            __uuidof(IMMDeviceEnumerator),
-            reinterpret_cast<void**>(&pEnumerator)
-        );
-        if (FAILED(hr) || !pEnumerator) {
-            return 0;  // Return empty instead of error for robustness
-        }
-
-        // Get default capture (microphone) device
-        IMMDevice* pDevice = nullptr;
-        hr = pEnumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &pDevice);
-        if (FAILED(hr) || !pDevice) {
-            pEnumerator->Release();
-            return 0;  // No mic device, return empty
-        }
-
-        // Activate session manager
-        IAudioSessionManager2* pSessionManager = nullptr;
-        hr = pDevice->Activate(
-            __uuidof(IAudioSessionManager2),
-            CLSCTX_ALL,
-            nullptr,
-            reinterpret_cast<void**>(&pSessionManager)
-        );
-        if (FAILED(hr) || !pSessionManager) {
-            pDevice->Release();
-            pEnumerator->Release();
-            return 0;
-        }
-
-        // Get session enumerator
-        IAudioSessionEnumerator* pSessionEnum = nullptr;
-        hr = pSessionManager->GetSessionEnumerator(&pSessionEnum);
-        if (FAILED(hr) || !pSessionEnum) {
-            pSessionManager->Release();
-            pDevice->Release();
-            pEnumerator->Release();
-            return 0;
-        }
-
-        // Get session count
-        int sessionCount = 0;
-        hr = pSessionEnum->GetCount(&sessionCount);
-        if (FAILED(hr) || sessionCount == 0) {
-            pSessionEnum->Release();
-            pSessionManager->Release();
-            pDevice->Release();
-            pEnumerator->Release();
+        auto* monitor = static_cast<MicActivityMonitor*>(handle);
+        std::vector<MicActivityMonitor::Process> processes = monitor->ActiveProcesses();
+        if (processes.empty()) {
             return 0;
         }
 
-        // Collect active sessions
-        std::vector<DWORD> activePids;
-        std::vector<std::wstring> activeNames;
-
-        for (int i = 0; i < sessionCount; i++) {
-            IAudioSessionControl* pSessionControl = nullptr;
-            hr = pSessionEnum->GetSession(i, &pSessionControl);
-            if (FAILED(hr) || !pSessionControl) continue;
-
-            // Check if session is active
-            AudioSessionState state;
-            hr = pSessionControl->GetState(&state);
-            if (FAILED(hr) || state != AudioSessionStateActive) {
-                pSessionControl->Release();
-                continue;
-            }
-
-            // Get IAudioSessionControl2 for process info
-            IAudioSessionControl2* pSessionControl2 = nullptr;
-            hr = pSessionControl->QueryInterface(
-                __uuidof(IAudioSessionControl2),
-                reinterpret_cast<void**>(&pSessionControl2)
-            );
-            if (FAILED(hr) || !pSessionControl2) {
-                pSessionControl->Release();
-                continue;
-            }
-
-            // Skip system sounds
-            hr = pSessionControl2->IsSystemSoundsSession();
-            if (hr == S_OK) {
-                pSessionControl2->Release();
-                pSessionControl->Release();
-                continue;
-            }
-
-            // Get process ID
-            DWORD pid = 0;
-            hr = pSessionControl2->GetProcessId(&pid);
-            if (FAILED(hr) || pid == 0) {
-                // AUDCLNT_S_NO_SINGLE_PROCESS means multi-process session - skip
-                pSessionControl2->Release();
-                pSessionControl->Release();
-                continue;
-            }
-
-            // Avoid duplicates
-            bool duplicate = false;
-            for (DWORD existingPid : activePids) {
-                if (existingPid == pid) {
-                    duplicate = true;
-                    break;
-                }
-            }
-            if (duplicate) {
-                pSessionControl2->Release();
-                pSessionControl->Release();
-                continue;
-            }
-
-            // Get process name
-            std::wstring procName = GetProcessNameFromPid(pid);
-            if (procName.empty()) {
-                procName = L"Unknown";
-            }
-
-            activePids.push_back(pid);
-            activeNames.push_back(procName);
-
-            pSessionControl2->Release();
-            pSessionControl->Release();
-        }
-
-        // Cleanup COM objects
-        pSessionEnum->Release();
-        pSessionManager->Release();
-        pDevice->Release();
-        pEnumerator->Release();
-
-        // Allocate output arrays
-        if (activePids.empty()) {
-            return 0;
-        }
-
-        size_t n = activePids.size();
+        size_t n = processes.size();
         *pids = static_cast<int32_t*>(malloc(n * sizeof(int32_t)));
         *names = static_cast<char**>(malloc(n * sizeof(char*)));
         *bundleIds = static_cast<char**>(malloc(n * sizeof(char*)));
@@ -520,15 +501,8 @@ int32_t mic_activity_get_active_processes(
         }
 
         for (size_t i = 0; i < n; i++) {
-            (*pids)[i] = static_cast<int32_t>(activePids[i]);
-
-            // Convert wide string to UTF-8
-            int utf8Len = WideCharToMultiByte(CP_UTF8, 0, activeNames[i].c_str(), -1, nullptr, 0, nullptr, nullptr);
-            (*names)[i] = static_cast<char*>(malloc(utf8Len));
-            if ((*names)[i]) {
-                WideCharToMultiByte(CP_UTF8, 0, activeNames[i].c_str(), -1, (*names)[i], utf8Len, nullptr, nullptr);
-            }
-
+            (*pids)[i] = static_cast<int32_t>(processes[i].pid);
+            (*names)[i] = _strdup(processes[i].name.c_str());
             // Windows doesn't have bundle IDs - use empty string
             (*bundleIds)[i] = _strdup("");
         }
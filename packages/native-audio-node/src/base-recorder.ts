@@ -1,10 +1,28 @@
 import { EventEmitter } from 'events'
 import { getAudioRecorderNative } from './binding.js'
-import type { AudioRecorderEvents, AudioChunk, AudioMetadata, AudioRecorderNativeClass } from './types.js'
+import { AudioChunkBatch } from './chunk-batch.js'
+import type {
+  AudioRecorderEvents,
+  AudioRecorderOptions,
+  AudioChunk,
+  AudioMetadata,
+  AudioRecorderNativeClass,
+  AudioRecorderStats,
+  NativeEvent,
+  ResampleQuality,
+  StartOptions,
+} from './types.js'
+
+const RESAMPLE_QUALITY_LEVELS: Record<ResampleQuality, number> = {
+  low: 0,
+  medium: 1,
+  high: 2,
+}
 
 /**
  * Abstract base class for audio recorders.
- * Provides shared EventEmitter functionality, polling, and lifecycle management.
+ * Provides shared EventEmitter functionality, event delivery (push or polling),
+ * and lifecycle management.
  */
 export abstract class BaseAudioRecorder {
   protected events = new EventEmitter()
@@ -12,8 +30,17 @@ export abstract class BaseAudioRecorder {
   protected running = false
   protected pollInterval: ReturnType<typeof setInterval> | null = null
   protected metadata: AudioMetadata | null = null
+  protected pushDelivery = false
+  protected listening = false
+  private listenOnStart = false
+  private snapshots: Array<{
+    ms: number
+    resolve: (chunk: AudioChunk | null) => void
+    reject: (error: unknown) => void
+  }> = []
+  private recorderOptions: AudioRecorderOptions
 
-  constructor() {
+  constructor(options: AudioRecorderOptions = {}) {
     // Check platform at construction time
     const supportedPlatforms = ['darwin', 'win32']
     if (!supportedPlatforms.includes(process.platform)) {
@@ -21,7 +48,14 @@ export abstract class BaseAudioRecorder {
     }
 
     const AudioRecorderNative = getAudioRecorderNative()
-    this.native = new AudioRecorderNative()
+    this.native = new AudioRecorderNative({
+      queueCapacity: options.queueCapacity,
+      overflowPolicy: options.overflowPolicy,
+      maxQueuedBytes: options.maxQueuedBytes,
+      maxQueuedMs: options.maxQueuedMs,
+      packData: options.packedData,
+    })
+    this.recorderOptions = options
   }
 
   on<K extends keyof AudioRecorderEvents>(event: K, listener: AudioRecorderEvents[K]): this {
@@ -49,14 +83,15 @@ export abstract class BaseAudioRecorder {
   }
 
   protected processNativeEvents(): void {
-    const events = this.native.processEvents()
+    this.handleNativeEvents(this.native.processEvents())
+  }
 
+  protected handleNativeEvents(events: NativeEvent[]): void {
     for (const event of events) {
       switch (event.type) {
         case 0: // data
           if (event.data) {
-            const chunk: AudioChunk = { data: event.data }
-            this.emit('data', chunk)
+            this.emit('data', this.toChunk(event, event.data))
           }
           break
 
@@ -79,10 +114,258 @@ export abstract class BaseAudioRecorder {
             bitsPerChannel: event.bitsPerChannel!,
             isFloat: event.isFloat!,
             encoding: event.encoding!,
+            planar: event.encoding!.endsWith('_planar'),
           }
           this.emit('metadata', this.metadata)
           break
+
+        case 5: // speech start
+          this.emit('speechStart')
+          break
+
+        case 6: // speech stop
+          this.emit('speechStop')
+          break
+
+        case 7: // level
+          this.emit('level', {
+            peak: event.peak ?? [],
+            rms: event.rms ?? [],
+            clipped: event.clipped ?? [],
+            sequence: event.sequence ?? 0,
+            framePosition: event.framePosition ?? 0,
+            frameCount: event.frameCount ?? 0,
+            hostTime: event.hostTime ?? 0n,
+          })
+          break
+
+        case 8: // file progress
+          this.emit('fileProgress', {
+            bytesWritten: event.bytesWritten ?? 0,
+            framesWritten: event.framesWritten ?? 0,
+            droppedChunks: event.droppedChunks ?? 0,
+            final: event.final ?? false,
+          })
+          break
+
+        case 9: // drop
+          this.emit('drop', {
+            chunks: event.droppedChunks ?? 0,
+            oldest: event.droppedOldest ?? 0,
+            newest: event.droppedNewest ?? 0,
+            frames: event.droppedFrames ?? 0,
+            durationMs: this.metadata ? ((event.droppedFrames ?? 0) / this.metadata.sampleRate) * 1000 : 0,
+          })
+          break
+
+        case 10: // snapshot
+          this.snapshots.shift()?.resolve(event.data ? this.toChunk(event, event.data) : null)
+          this.requestSnapshot()
+          break
+
+        case 11: // packed data
+          if (event.data && event.index && event.flags && event.hostTimes) {
+            const batch = new AudioChunkBatch(event.data, event.index, event.flags, event.hostTimes)
+            this.emit('dataBatch', batch)
+            // Per-chunk objects only for those who asked for them
+            if (this.events.listenerCount('data') > 0) {
+              for (let i = 0; i < batch.length; i++) {
+                this.emit('data', batch.chunk(i))
+              }
+            }
+          }
+          break
+      }
+    }
+  }
+
+  private toChunk(event: NativeEvent, data: Buffer): AudioChunk {
+    return {
+      data,
+      sequence: event.sequence ?? 0,
+      framePosition: event.framePosition ?? 0,
+      frameCount: event.frameCount ?? 0,
+      hostTime: event.hostTime ?? 0n,
+      discontinuity: event.discontinuity ?? false,
+      silent: event.silent ?? false,
+      subChunks: event.subChunks ?? 1,
+    }
+  }
+
+  /**
+   * Start the native capture and hook up event delivery.
+   * In push mode the callback must be installed before the native start so the
+   * start and metadata events are delivered too.
+   */
+  protected startCapture(startNative: () => void): void {
+    const wantsPush = (this.recorderOptions.delivery ?? 'push') === 'push'
+    this.pushDelivery = wantsPush && typeof this.native.setEventCallback === 'function'
+
+    this.applyNativeOptions()
+    this.native.setListening?.(this.listenOnStart)
+    this.openFileSink()
+    this.openSharedRing()
+
+    if (this.pushDelivery) {
+      this.native.setEventCallback!((events) => this.handleNativeEvents(events), {
+        coalesce: this.recorderOptions.coalesceEvents ?? true,
+      })
+    }
+
+    try {
+      startNative()
+    } catch (error) {
+      if (this.pushDelivery) {
+        this.native.setEventCallback!(null)
       }
+      if (this.recorderOptions.file !== undefined) {
+        this.native.setFileSink!(null)
+      }
+      if (this.recorderOptions.sharedRing !== undefined) {
+        this.native.setSharedRing!(null)
+      }
+      throw error
+    }
+
+    this.running = true
+    this.listening = this.listenOnStart
+    if (!this.pushDelivery) {
+      this.startPolling()
+    }
+  }
+
+  /**
+   * Leave `listen()` for streaming: deliver up to `preRollMs` of what was
+   * captured meanwhile, then every chunk as usual. Called by `start()`.
+   */
+  protected startFromLookback(options: StartOptions): void {
+    this.native.setListening!(false, options.preRollMs)
+    this.listening = false
+  }
+
+  /**
+   * Do the slow part of a start ahead of time (see `prepare()` on the recorders).
+   * Tuning options are applied first, since Windows audio clients are
+   * initialized with the buffer duration and event mode.
+   */
+  protected prepareCapture(
+    source: 'system' | 'microphone' | 'combined',
+    options: Parameters<NonNullable<AudioRecorderNativeClass['prepare']>>[1]
+  ): Promise<void> {
+    return new Promise((resolve, reject) => {
+      if (this.running) {
+        reject(new Error('Cannot prepare a recorder that is running'))
+        return
+      }
+      if (typeof this.native.prepare !== 'function') {
+        resolve()
+        return
+      }
+
+      try {
+        this.applyNativeOptions()
+        this.native.prepare(source, options)
+        resolve()
+      } catch (error) {
+        reject(error)
+      }
+    })
+  }
+
+  /**
+   * Release the devices kept ready by `prepare()`. A running recorder keeps
+   * them until it stops.
+   */
+  releasePrepared(): void {
+    this.native.releasePrepared?.()
+  }
+
+  /**
+   * Pass capture tuning options to the native layer before it starts.
+   */
+  private applyNativeOptions(): void {
+    if (typeof this.native.setOption !== 'function') return
+
+    const {
+      bufferDurationMs,
+      eventDriven,
+      sharedCaptureThread,
+      followDefaultDevice,
+      resampleQuality,
+      silenceGate,
+      levels,
+      outputFormat,
+      lookbackMs,
+    } = this.recorderOptions
+    if (bufferDurationMs !== undefined) {
+      this.native.setOption('bufferDurationMs', bufferDurationMs)
+    }
+    if (eventDriven !== undefined) {
+      this.native.setOption('eventDriven', eventDriven)
+    }
+    if (sharedCaptureThread !== undefined) {
+      this.native.setOption('sharedCaptureThread', sharedCaptureThread)
+    }
+    if (followDefaultDevice !== undefined) {
+      this.native.setOption('followDefaultDevice', followDefaultDevice)
+    }
+    if (resampleQuality !== undefined) {
+      const level = RESAMPLE_QUALITY_LEVELS[resampleQuality]
+      if (level === undefined) {
+        throw new Error(`Invalid resampleQuality: ${resampleQuality}`)
+      }
+      this.native.setOption('resampleQuality', level)
+    }
+    if (silenceGate !== undefined) {
+      this.native.setOption('silenceGate', silenceGate !== false)
+      if (typeof silenceGate === 'object') {
+        if (silenceGate.thresholdDb !== undefined) {
+          this.native.setOption('gateThresholdDb', silenceGate.thresholdDb)
+        }
+        if (silenceGate.hangoverMs !== undefined) {
+          this.native.setOption('gateHangoverMs', silenceGate.hangoverMs)
+        }
+      }
+    }
+    if (levels !== undefined) {
+      this.native.setOption('levels', levels === 'only' ? 2 : levels ? 1 : 0)
+    }
+    if (outputFormat?.bitrate !== undefined) {
+      this.native.setOption('bitrate', outputFormat.bitrate)
+    }
+    if (lookbackMs !== undefined) {
+      this.native.setOption('lookbackMs', lookbackMs)
+    }
+  }
+
+  /**
+   * Route chunks to the native file writer for this session.
+   */
+  private openFileSink(): void {
+    const { file } = this.recorderOptions
+    if (file === undefined) return
+    if (typeof this.native.setFileSink !== 'function') {
+      throw new Error('Recording to file is not supported by this native binary')
+    }
+
+    const { path, ...options } = typeof file === 'string' ? { path: file } : file
+    this.native.setFileSink(path, options)
+  }
+
+  /**
+   * Route chunks into the shared-memory ring for this session.
+   */
+  private openSharedRing(): void {
+    const { sharedRing } = this.recorderOptions
+    if (sharedRing === undefined) return
+    if (typeof this.native.setSharedRing !== 'function') {
+      throw new Error('Shared rings are not supported by this native binary')
+    }
+
+    if (sharedRing instanceof SharedArrayBuffer) {
+      this.native.setSharedRing(new Int32Array(sharedRing))
+    } else {
+      this.native.setSharedRing(sharedRing.name, { capacityBytes: sharedRing.capacityBytes })
     }
   }
 
@@ -104,9 +387,84 @@ export abstract class BaseAudioRecorder {
   }
 
   /**
-   * Start audio capture. Must be implemented by subclasses.
+   * Start audio capture. Must be implemented by subclasses; when listening
+   * they switch to streaming with `startFromLookback()` instead.
    */
-  abstract start(): Promise<void>
+  abstract start(options?: StartOptions): Promise<void>
+
+  /**
+   * Capture into the lookback ring (`lookbackMs`) without delivering `data`
+   * or `level` events, so an idle recorder costs JavaScript nothing. Starts
+   * capture if needed, or stops delivery of a running recording. Control
+   * events (`start`, `metadata`, `error`, `speechStart`...) still arrive.
+   * `start({ preRollMs })` goes back to streaming with the last `preRollMs`.
+   * Not available with the `file` or `sharedRing` options, which take every chunk.
+   */
+  listen(): Promise<void> {
+    if (typeof this.native.setListening !== 'function') {
+      return Promise.reject(new Error('listen() is not supported by this native binary'))
+    }
+    if (this.recorderOptions.file !== undefined || this.recorderOptions.sharedRing !== undefined) {
+      return Promise.reject(new Error('listen() cannot be combined with the file or sharedRing options'))
+    }
+    if (this.running) {
+      this.native.setListening(true)
+      this.listening = true
+      return Promise.resolve()
+    }
+
+    this.listenOnStart = true
+    return this.start().finally(() => {
+      this.listenOnStart = false
+    })
+  }
+
+  /**
+   * Copy the last `ms` of the lookback ring (all of it for 0) into one chunk,
+   * or null if it is empty. While recording the copy is made at the next chunk
+   * boundary and streaming or listening goes on unaffected; after a stop it
+   * returns what the session ended with.
+   */
+  snapshot(ms = 0): Promise<AudioChunk | null> {
+    return new Promise((resolve, reject) => {
+      if (typeof this.native.snapshot !== 'function') {
+        reject(new Error('snapshot() is not supported by this native binary'))
+        return
+      }
+      if (!(ms >= 0)) {
+        reject(new RangeError('ms must not be negative'))
+        return
+      }
+
+      this.snapshots.push({ ms, resolve, reject })
+      if (this.snapshots.length === 1) {
+        this.requestSnapshot()
+      }
+    })
+  }
+
+  // The native side takes one snapshot at a time: ask for the oldest pending one
+  private requestSnapshot(): void {
+    const next = this.snapshots[0]
+    if (!next) return
+
+    let result: NativeEvent | null | undefined
+    try {
+      result = this.native.snapshot!(next.ms)
+    } catch (error) {
+      this.snapshots.shift()
+      next.reject(error)
+      this.requestSnapshot()
+      return
+    }
+
+    // undefined: taken at the next chunk and delivered as a snapshot event
+    if (result !== undefined) {
+      this.snapshots.shift()
+      next.resolve(result?.data ? this.toChunk(result, result.data) : null)
+      this.requestSnapshot()
+    }
+  }
 
   /**
    * Stop audio capture.
@@ -118,6 +476,21 @@ export abstract class BaseAudioRecorder {
         return
       }
 
+      // Whatever pause() held back is delivered before the stop event
+      this.native.resume?.()
+
+      if (this.pushDelivery) {
+        // Stop the native addon, deliver what it flushed, then drop the callback
+        this.native.stop()
+        this.processNativeEvents()
+        this.native.setEventCallback!(null)
+        this.running = false
+        this.listening = false
+        this.requestSnapshot()
+        resolve()
+        return
+      }
+
       // Stop the polling interval
       this.stopPolling()
 
@@ -128,10 +501,55 @@ export abstract class BaseAudioRecorder {
       this.native.stop()
       this.running = false
 
+      this.listening = false
+
+      // The file sink reports its final progress while stopping, and a
+      // pending snapshot may have been taken from the last chunks
+      if (this.recorderOptions.file !== undefined || this.snapshots.length > 0) {
+        this.processNativeEvents()
+      }
+
+      // Snapshots the capture thread didn't get to are read from the ring now
+      this.requestSnapshot()
       resolve()
     })
   }
 
+  /**
+   * Change `chunkDurationMs`. While recording the native side switches at the
+   * next chunk boundary (or, with `subChunkDurationMs`, the next batch), with
+   * no gap in `framePosition`; otherwise it applies from the next start.
+   * @throws RangeError if the duration isn't positive, Error if it's larger than
+   * the native side can switch to while running
+   */
+  setChunkDuration(chunkDurationMs: number): void {
+    if (!(chunkDurationMs > 0)) {
+      throw new RangeError('chunkDurationMs must be positive')
+    }
+    if (this.running && typeof this.native.setOption === 'function') {
+      this.native.setOption('chunkDurationMs', chunkDurationMs)
+    }
+    this.recorderOptions.chunkDurationMs = chunkDurationMs
+  }
+
+  /**
+   * Hold back event delivery while capture continues. Chunks queue natively up
+   * to `queueCapacity` / `maxQueuedBytes` / `maxQueuedMs`, past which the
+   * `overflowPolicy` applies; with `'block'` that stalls the capture thread, so
+   * use a dropping policy with pause().
+   */
+  pause(): void {
+    this.native.pause?.()
+  }
+
+  /**
+   * Deliver what queued up during `pause()` (after a `drop` event if anything
+   * was discarded) and continue.
+   */
+  resume(): void {
+    this.native.resume?.()
+  }
+
   /**
    * Check if the recorder is currently active.
    */
@@ -146,4 +564,13 @@ export abstract class BaseAudioRecorder {
   getMetadata(): AudioMetadata | null {
     return this.metadata
   }
+
+  /**
+   * Get native queue and capture statistics (depth, drops, packet and chunk
+   * counts, per-stage timings and allocated bytes).
+   * Returns null if the native binary does not report statistics.
+   */
+  getStats(): AudioRecorderStats | null {
+    return this.native.getStats?.() ?? null
+  }
 }
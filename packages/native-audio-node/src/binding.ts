@@ -18,6 +18,8 @@ export interface NativeAddon {
 
   // Device management
   listDevices(): AudioDevice[]
+  listDevicesAsync?(): Promise<AudioDevice[]>
+  setDeviceChangeCallback?(callback: (() => void) | null): void
   getDefaultInputDevice(): string | null
   getDefaultOutputDevice(): string | null
 
@@ -32,6 +34,9 @@ export interface NativeAddon {
 
   // Shared
   openSystemSettings(): boolean
+
+  // Shared ring reader (named segments)
+  openSharedRing?(name: string): ArrayBuffer
 }
 
 let cachedBinding: NativeAddon | null = null
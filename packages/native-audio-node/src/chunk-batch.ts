@@ -0,0 +1,83 @@
+import type { AudioChunk } from './types.js'
+
+// Index layout shared with BuildPackedData in native/napi/audio_napi.cpp
+const INDEX_STRIDE = 5 // byte offset, byte length, sequence, framePosition, frameCount
+const FLAGS_STRIDE = 2 // AUDIO_CHUNK_FLAG_*, sub-chunks
+const FLAG_DISCONTINUITY = 1
+const FLAG_SILENT = 2
+
+/**
+ * Consecutive chunks delivered as one Buffer (with `packedData`), so a burst
+ * of chunks costs one Buffer and one index instead of objects per chunk.
+ * `data` holds every chunk's bytes back to back; `chunk(i)` describes one of
+ * them, with its `data` a view into the batch rather than a copy.
+ *
+ * @example
+ * ```typescript
+ * recorder.on('dataBatch', (batch) => {
+ *   socket.write(batch.data)  // all of it at once
+ * })
+ * ```
+ */
+export class AudioChunkBatch {
+  /** The chunks' bytes, back to back */
+  readonly data: Buffer
+  /** Number of chunks */
+  readonly length: number
+
+  private readonly index: Float64Array
+  private readonly flags: Uint32Array
+  private readonly hostTimes: BigUint64Array
+
+  constructor(data: Buffer, index: Float64Array, flags: Uint32Array, hostTimes: BigUint64Array) {
+    this.data = data
+    this.index = index
+    this.flags = flags
+    this.hostTimes = hostTimes
+    this.length = hostTimes.length
+  }
+
+  /** Index of the first chunk's first frame in the output stream */
+  get framePosition(): number {
+    return this.length > 0 ? this.index[3] : 0
+  }
+
+  /** Frames in all chunks */
+  get frameCount(): number {
+    let frames = 0
+    for (let i = 0; i < this.length; i++) {
+      frames += this.index[i * INDEX_STRIDE + 4]
+    }
+    return frames
+  }
+
+  /**
+   * Chunk `i`, built on demand; its `data` shares memory with the batch
+   * @throws RangeError if `i` is out of range
+   */
+  chunk(i: number): AudioChunk {
+    if (!(i >= 0 && i < this.length)) {
+      throw new RangeError(`Chunk index ${i} out of range (0-${this.length - 1})`)
+    }
+
+    const at = i * INDEX_STRIDE
+    const offset = this.index[at]
+    const flags = this.flags[i * FLAGS_STRIDE]
+    return {
+      data: this.data.subarray(offset, offset + this.index[at + 1]),
+      sequence: this.index[at + 2],
+      framePosition: this.index[at + 3],
+      frameCount: this.index[at + 4],
+      hostTime: this.hostTimes[i],
+      discontinuity: (flags & FLAG_DISCONTINUITY) !== 0,
+      silent: (flags & FLAG_SILENT) !== 0,
+      subChunks: this.flags[i * FLAGS_STRIDE + 1],
+    }
+  }
+
+  *[Symbol.iterator](): IterableIterator<AudioChunk> {
+    for (let i = 0; i < this.length; i++) {
+      yield this.chunk(i)
+    }
+  }
+}
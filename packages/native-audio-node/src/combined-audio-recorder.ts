@@ -0,0 +1,92 @@
+import { BaseAudioRecorder } from './base-recorder.js'
+import type { CombinedAudioRecorderOptions, StartOptions } from './types.js'
+
+/**
+ * Captures system audio and a microphone in one session on a shared clock.
+ * Each chunk has two channels: system audio on channel 0 and the microphone
+ * on channel 1, sample-aligned with drift compensation.
+ *
+ * On macOS both sources run in one aggregate device (the microphone drives
+ * the clock, the tap is drift compensated). On Windows both endpoints are
+ * captured separately and aligned by their device timestamps.
+ *
+ * @example
+ * ```typescript
+ * import { CombinedAudioRecorder } from 'native-audio-node'
+ *
+ * const recorder = new CombinedAudioRecorder({
+ *   sampleRate: 16000,
+ *   chunkDurationMs: 100,
+ *   outputFormat: { sampleFormat: 's16' },
+ * })
+ *
+ * recorder.on('data', (chunk) => {
+ *   // Interleaved frames: [system, mic, system, mic, ...]
+ * })
+ *
+ * await recorder.start()
+ * // ... record the meeting
+ * await recorder.stop()
+ * ```
+ */
+export class CombinedAudioRecorder extends BaseAudioRecorder {
+  private options: CombinedAudioRecorderOptions
+
+  constructor(options: CombinedAudioRecorderOptions = {}) {
+    super(options)
+    this.options = options
+  }
+
+  /**
+   * Create the tap and input aggregate device (macOS) or both audio clients
+   * (Windows) ahead of `start()`; see `SystemAudioRecorder.prepare()`.
+   */
+  prepare(): Promise<void> {
+    return this.prepareCapture('combined', {
+      mute: this.options.mute,
+      includeProcesses: this.options.includeProcesses,
+      excludeProcesses: this.options.excludeProcesses,
+      deviceId: this.options.deviceId,
+    })
+  }
+
+  /**
+   * Start capturing system audio and the microphone.
+   * After `listen()`, streams from here with `options.preRollMs` of history.
+   * @throws Error if already running or if either permission is denied
+   */
+  start(options: StartOptions = {}): Promise<void> {
+    return new Promise((resolve, reject) => {
+      if (this.listening) {
+        this.startFromLookback(options)
+        resolve()
+        return
+      }
+      if (this.running) {
+        reject(new Error('CombinedAudioRecorder is already running'))
+        return
+      }
+
+      try {
+        this.startCapture(() =>
+          this.native.startCombined({
+            sampleRate: this.options.sampleRate,
+            chunkDurationMs: this.options.chunkDurationMs,
+            subChunkDurationMs: this.options.subChunkDurationMs,
+            mute: this.options.mute,
+            includeProcesses: this.options.includeProcesses,
+            excludeProcesses: this.options.excludeProcesses,
+            deviceId: this.options.deviceId,
+            gain: this.options.gain,
+            channels: this.options.channels,
+            channelMatrix: this.options.channelMatrix,
+            outputFormat: this.options.outputFormat,
+          })
+        )
+        resolve()
+      } catch (error) {
+        reject(error)
+      }
+    })
+  }
+}
@@ -1,5 +1,6 @@
+import { EventEmitter } from 'events'
 import { loadBinding } from './binding.js'
-import type { AudioDevice } from './types.js'
+import type { AudioDevice, AudioDeviceEvents } from './types.js'
 
 /**
  * List all audio devices on the system.
@@ -18,6 +19,20 @@ export function listAudioDevices(): AudioDevice[] {
   return loadBinding().listDevices()
 }
 
+/**
+ * List all audio devices without blocking the event loop.
+ * The native layer caches the list and keeps it current with device
+ * notifications, so this only enumerates after something changed, and then
+ * on a worker thread.
+ */
+export function listAudioDevicesAsync(): Promise<AudioDevice[]> {
+  const binding = loadBinding()
+  if (typeof binding.listDevicesAsync !== 'function') {
+    return Promise.resolve().then(() => binding.listDevices())
+  }
+  return binding.listDevicesAsync()
+}
+
 /**
  * Get the UID of the default input device (microphone).
  * @returns Device UID string, or null if no default input device
@@ -33,3 +48,103 @@ export function getDefaultInputDevice(): string | null {
 export function getDefaultOutputDevice(): string | null {
   return loadBinding().getDefaultOutputDevice()
 }
+
+/**
+ * Emitter behind `audioDeviceEvents`. Native notifications are only
+ * subscribed to while a `devicechange` listener is registered.
+ */
+class AudioDeviceEventEmitter {
+  private events = new EventEmitter()
+  private watching = false
+  private refreshing = false
+  private refreshAgain = false
+
+  constructor() {
+    this.events.on('removeListener', () => this.updateWatch())
+  }
+
+  on<K extends keyof AudioDeviceEvents>(event: K, listener: AudioDeviceEvents[K]): this {
+    this.events.on(event, listener)
+    this.updateWatch()
+    return this
+  }
+
+  once<K extends keyof AudioDeviceEvents>(event: K, listener: AudioDeviceEvents[K]): this {
+    this.events.once(event, listener)
+    this.updateWatch()
+    return this
+  }
+
+  off<K extends keyof AudioDeviceEvents>(event: K, listener: AudioDeviceEvents[K]): this {
+    this.events.off(event, listener)
+    return this
+  }
+
+  removeAllListeners<K extends keyof AudioDeviceEvents>(event?: K): this {
+    this.events.removeAllListeners(event)
+    this.updateWatch()
+    return this
+  }
+
+  private updateWatch(): void {
+    const wanted = this.events.listenerCount('devicechange') > 0
+    if (wanted === this.watching) return
+
+    const binding = loadBinding()
+    if (typeof binding.setDeviceChangeCallback !== 'function') {
+      if (wanted) {
+        throw new Error('Device change notifications are not supported by this native binary')
+      }
+      return
+    }
+
+    binding.setDeviceChangeCallback(wanted ? () => this.refresh() : null)
+    this.watching = wanted
+  }
+
+  /**
+   * Read the new list and emit it. Notifications that arrive while a read is
+   * in flight are answered by one more read once it finishes.
+   */
+  private refresh(): void {
+    if (this.refreshing) {
+      this.refreshAgain = true
+      return
+    }
+    this.refreshing = true
+
+    listAudioDevicesAsync()
+      .then(
+        (devices) => {
+          this.events.emit('devicechange', devices)
+        },
+        (error: Error) => {
+          if (this.events.listenerCount('error') > 0) {
+            this.events.emit('error', error)
+          }
+        }
+      )
+      .finally(() => {
+        this.refreshing = false
+        if (this.refreshAgain) {
+          this.refreshAgain = false
+          this.refresh()
+        }
+      })
+  }
+}
+
+/**
+ * Device change notifications (IMMNotificationClient on Windows, Core Audio
+ * property listeners on macOS).
+ *
+ * @example
+ * ```typescript
+ * import { audioDeviceEvents } from 'native-audio-node'
+ *
+ * audioDeviceEvents.on('devicechange', (devices) => {
+ *   updatePicker(devices.filter(d => d.isInput))
+ * })
+ * ```
+ */
+export const audioDeviceEvents = new AudioDeviceEventEmitter()
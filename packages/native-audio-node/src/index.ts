@@ -1,25 +1,58 @@
 // Recorder classes
 export { SystemAudioRecorder } from './system-audio-recorder.js'
 export { MicrophoneRecorder } from './microphone-recorder.js'
+export { CombinedAudioRecorder } from './combined-audio-recorder.js'
+export { VirtualAudioRecorder } from './virtual-audio-recorder.js'
 
 // Microphone activity monitoring
 export { MicrophoneActivityMonitor } from './microphone-activity-monitor.js'
 
+// Shared-memory chunk rings
+export { createSharedAudioRing, SharedAudioRingReader } from './shared-ring.js'
+
+// Packed chunk delivery
+export { AudioChunkBatch } from './chunk-batch.js'
+
 // Device enumeration
-export { listAudioDevices, getDefaultInputDevice, getDefaultOutputDevice } from './devices.js'
+export {
+  listAudioDevices,
+  listAudioDevicesAsync,
+  getDefaultInputDevice,
+  getDefaultOutputDevice,
+  audioDeviceEvents,
+} from './devices.js'
 
 // Types
 export type {
   AudioRecorderOptions,
   SystemAudioRecorderOptions,
   MicrophoneRecorderOptions,
+  CombinedAudioRecorderOptions,
+  VirtualAudioRecorderOptions,
+  StartOptions,
+  VirtualSourceOptions,
   MicrophoneActivityMonitorOptions,
   MicrophoneActivityMonitorEvents,
+  MicActivityMonitorStats,
   AudioChunk,
+  AudioLevels,
+  AudioDropInfo,
   AudioMetadata,
+  OutputFormat,
+  OutputEncoding,
+  SampleFormat,
   AudioDevice,
+  AudioDeviceEvents,
   AudioProcess,
   AudioRecorderEvents,
+  AudioRecorderStats,
+  AudioStageStats,
+  FileSinkOptions,
+  FileSinkProgress,
+  SharedRingOptions,
+  OverflowPolicy,
+  ResampleQuality,
+  SilenceGateOptions,
 } from './types.js'
 
 // Permission API
@@ -6,6 +6,7 @@ import type {
   MicrophoneActivityMonitorOptions,
   MicActivityMonitorNativeClass,
   MicActivityNativeEvent,
+  MicActivityMonitorStats,
   AudioDevice,
   AudioProcess,
 } from './types.js'
@@ -42,6 +43,7 @@ export class MicrophoneActivityMonitor {
   private native: MicActivityMonitorNativeClass
   private running = false
   private pollInterval: ReturnType<typeof setInterval> | null = null
+  private pushDelivery = false
   private options: Required<MicrophoneActivityMonitorOptions>
   private deviceCache: Map<string, AudioDevice> = new Map()
 
@@ -54,6 +56,7 @@ export class MicrophoneActivityMonitor {
     this.options = {
       scope: options?.scope ?? 'all',
       fallbackPollInterval: options?.fallbackPollInterval ?? 2000,
+      delivery: options?.delivery ?? 'push',
     }
 
     const MicActivityMonitorNative = getMicActivityMonitorNative()
@@ -90,9 +93,29 @@ export class MicrophoneActivityMonitor {
     }
 
     this.refreshDeviceCache()
-    this.native.start(this.options.scope)
+
+    this.pushDelivery = this.options.delivery === 'push' && typeof this.native.setEventCallback === 'function'
+    if (this.pushDelivery) {
+      this.native.setEventCallback!((events) => {
+        for (const event of events) {
+          this.handleNativeEvent(event)
+        }
+      })
+    }
+
+    try {
+      this.native.start(this.options.scope)
+    } catch (error) {
+      if (this.pushDelivery) {
+        this.native.setEventCallback!(null)
+      }
+      throw error
+    }
+
     this.running = true
-    this.startPolling()
+    if (!this.pushDelivery) {
+      this.startPolling()
+    }
   }
 
   /**
@@ -103,6 +126,14 @@ export class MicrophoneActivityMonitor {
       return
     }
 
+    if (this.pushDelivery) {
+      this.native.stop()
+      this.processNativeEvents()
+      this.native.setEventCallback!(null)
+      this.running = false
+      return
+    }
+
     this.stopPolling()
     this.processNativeEvents()
     this.native.stop()
@@ -142,8 +173,10 @@ export class MicrophoneActivityMonitor {
    * to identify which applications are actively using microphone input.
    * Returns process name, PID, and bundle identifier.
    *
-   * **Windows:** Uses WASAPI IAudioSessionManager2 to enumerate active capture
-   * sessions on the default microphone device. Returns process name and PID.
+   * **Windows:** While monitoring, returns the owners of the active capture
+   * sessions on the monitored devices, as tracked from WASAPI session
+   * notifications (no session walk). Otherwise enumerates the sessions of the
+   * default microphone once. Returns process name and PID.
    * Bundle ID is always empty (Windows doesn't have bundle identifiers).
    *
    * @returns Array of processes currently using the microphone
@@ -167,6 +200,14 @@ export class MicrophoneActivityMonitor {
     return this.running
   }
 
+  /**
+   * Get event counts and the native-to-JS delivery latency.
+   * Returns null if the native binary does not report statistics.
+   */
+  getStats(): MicActivityMonitorStats | null {
+    return this.native.getStats?.() ?? null
+  }
+
   private refreshDeviceCache(): void {
     this.deviceCache.clear()
     const devices = listAudioDevices()
@@ -1,5 +1,5 @@
 import { BaseAudioRecorder } from './base-recorder.js'
-import type { MicrophoneRecorderOptions } from './types.js'
+import type { MicrophoneRecorderOptions, StartOptions } from './types.js'
 
 /**
  * Captures microphone audio on macOS using Core Audio.
@@ -33,33 +33,51 @@ export class MicrophoneRecorder extends BaseAudioRecorder {
   private options: MicrophoneRecorderOptions
 
   constructor(options: MicrophoneRecorderOptions = {}) {
-    super()
+    super(options)
     this.options = options
   }
 
+  /**
+   * Look up the input device and get it ready to stream, so that `start()`
+   * doesn't lose the first few hundred milliseconds to setup (push-to-talk).
+   * The device stays prepared across stops until `releasePrepared()`.
+   */
+  prepare(): Promise<void> {
+    return this.prepareCapture('microphone', { deviceId: this.options.deviceId })
+  }
+
   /**
    * Start capturing microphone audio.
+   * After `listen()`, streams from here with `options.preRollMs` of history.
    * @throws Error if already running or if permission is denied
    */
-  start(): Promise<void> {
+  start(options: StartOptions = {}): Promise<void> {
     return new Promise((resolve, reject) => {
+      if (this.listening) {
+        this.startFromLookback(options)
+        resolve()
+        return
+      }
       if (this.running) {
         reject(new Error('MicrophoneRecorder is already running'))
         return
       }
 
       try {
-        this.native.startMicrophone({
-          sampleRate: this.options.sampleRate,
-          chunkDurationMs: this.options.chunkDurationMs,
-          stereo: this.options.stereo,
-          emitSilence: this.options.emitSilence ?? true,
-          deviceId: this.options.deviceId,
-          gain: this.options.gain,
-        })
-
-        this.running = true
-        this.startPolling()
+        this.startCapture(() =>
+          this.native.startMicrophone({
+            sampleRate: this.options.sampleRate,
+            chunkDurationMs: this.options.chunkDurationMs,
+            subChunkDurationMs: this.options.subChunkDurationMs,
+            stereo: this.options.stereo,
+            emitSilence: this.options.emitSilence ?? true,
+            deviceId: this.options.deviceId,
+            gain: this.options.gain,
+            channels: this.options.channels,
+            channelMatrix: this.options.channelMatrix,
+            outputFormat: this.options.outputFormat,
+          })
+        )
         resolve()
       } catch (error) {
         reject(error)
@@ -0,0 +1,181 @@
+import { loadBinding } from './binding.js'
+import type { AudioChunk } from './types.js'
+
+// Layout shared with native/napi/shared_ring.h
+const HEADER_BYTES = 64
+const RECORD_HEADER_BYTES = 32
+const WRAP_MARKER = 0xffffffff
+const VERSION = 2
+
+const SLOT_WRITE = 0
+const SLOT_READ = 1
+const SLOT_CAPACITY = 2
+const SLOT_DROPPED = 3
+const SLOT_STATE = 4
+const SLOT_VERSION = 5
+const SLOT_WAITERS = 6
+
+const STATE_STOPPED = 2
+
+// Longest single Atomics.wait(): a write wakes a reader that announced itself
+// in SLOT_WAITERS through the recorder's JS thread, which may be busy, so
+// readers also re-check on their own
+const WAIT_SLICE_MS = 5
+
+/**
+ * Allocate a SharedArrayBuffer laid out as a shared audio ring. Pass it to a
+ * recorder as `sharedRing` and post it to the worker that reads it.
+ *
+ * @param capacityBytes - Room for queued chunks; rounded up to a power of two
+ *   (at least 4 KiB). Chunks that don't fit are dropped and counted.
+ *
+ * @example
+ * ```typescript
+ * const ring = createSharedAudioRing(1 << 20)
+ * const worker = new Worker('./dsp-worker.js', { workerData: ring })
+ * const recorder = new MicrophoneRecorder({ sampleRate: 16000, sharedRing: ring })
+ * await recorder.start()
+ * ```
+ */
+export function createSharedAudioRing(capacityBytes = 1 << 20): SharedArrayBuffer {
+  let capacity = 4096
+  while (capacity < capacityBytes && capacity < 1 << 30) {
+    capacity *= 2
+  }
+
+  const buffer = new SharedArrayBuffer(HEADER_BYTES + capacity)
+  const header = new Int32Array(buffer, 0, HEADER_BYTES / 4)
+  header[SLOT_CAPACITY] = capacity
+  header[SLOT_VERSION] = VERSION
+  return buffer
+}
+
+/**
+ * Reads chunks a recorder writes into a shared audio ring, from a worker
+ * thread or another process. Only one reader may consume a ring.
+ *
+ * @example
+ * ```typescript
+ * // dsp-worker.js
+ * const reader = new SharedAudioRingReader(workerData)
+ * for (;;) {
+ *   const chunk = reader.read(100)
+ *   if (chunk) process(chunk.data)
+ *   else if (reader.stopped) break
+ * }
+ * ```
+ */
+export class SharedAudioRingReader {
+  private readonly header: Int32Array
+  private readonly bytes: Uint8Array
+  private readonly view: DataView
+  private readonly capacity: number
+  private readonly canWait: boolean
+
+  /**
+   * @param buffer - A ring from `createSharedAudioRing()`, or the ArrayBuffer
+   *   returned by `openNamed()`
+   */
+  constructor(buffer: SharedArrayBuffer | ArrayBuffer) {
+    this.header = new Int32Array(buffer, 0, HEADER_BYTES / 4)
+    this.capacity = this.header[SLOT_CAPACITY]
+    if (this.header[SLOT_VERSION] !== VERSION || this.capacity < 4096 || HEADER_BYTES + this.capacity > buffer.byteLength) {
+      throw new Error('Not a shared audio ring')
+    }
+    this.bytes = new Uint8Array(buffer, HEADER_BYTES, this.capacity)
+    this.view = new DataView(buffer, HEADER_BYTES, this.capacity)
+    this.canWait = typeof SharedArrayBuffer !== 'undefined' && buffer instanceof SharedArrayBuffer
+  }
+
+  /**
+   * Map a named ring created by a recorder with `sharedRing: { name }`,
+   * possibly in another process. The recorder must already be started.
+   * Throws under Electron, whose V8 sandbox rejects external ArrayBuffers.
+   */
+  static openNamed(name: string): SharedAudioRingReader {
+    const openSharedRing = loadBinding().openSharedRing
+    if (typeof openSharedRing !== 'function') {
+      throw new Error('Shared rings are not supported by this native binary')
+    }
+    return new SharedAudioRingReader(openSharedRing(name))
+  }
+
+  /** Chunks the recorder dropped because the ring was full */
+  get droppedChunks(): number {
+    return Atomics.load(this.header, SLOT_DROPPED)
+  }
+
+  /** The recorder stopped; nothing more will be written */
+  get stopped(): boolean {
+    return Atomics.load(this.header, SLOT_STATE) === STATE_STOPPED
+  }
+
+  /** Bytes waiting to be read */
+  get available(): number {
+    return (Atomics.load(this.header, SLOT_WRITE) - Atomics.load(this.header, SLOT_READ)) >>> 0
+  }
+
+  /**
+   * Take the next chunk, waiting up to `timeoutMs` for one (0 = don't wait).
+   * Returns null on timeout or once the recorder has stopped and the ring is
+   * drained. Waiting blocks the calling thread, so only wait from a worker
+   * or a process dedicated to reading; on a segment from `openNamed()` the
+   * wait polls.
+   */
+  read(timeoutMs = 0): AudioChunk | null {
+    const deadline = timeoutMs > 0 ? Date.now() + timeoutMs : 0
+
+    for (;;) {
+      const chunk = this.tryRead()
+      if (chunk || timeoutMs <= 0 || this.stopped) return chunk
+
+      const remaining = deadline - Date.now()
+      if (remaining <= 0) return null
+      this.wait(Math.min(remaining, WAIT_SLICE_MS))
+    }
+  }
+
+  private tryRead(): AudioChunk | null {
+    let read = Atomics.load(this.header, SLOT_READ) >>> 0
+    const write = Atomics.load(this.header, SLOT_WRITE) >>> 0
+    if (read === write) return null
+
+    let offset = read & (this.capacity - 1)
+    let length = this.view.getUint32(offset, true)
+    if (length === WRAP_MARKER) {
+      read = (read + this.capacity - offset) >>> 0
+      offset = 0
+      length = this.view.getUint32(0, true)
+    }
+
+    const start = offset + RECORD_HEADER_BYTES
+    const chunk: AudioChunk = {
+      // Copied out: the slot is reused as soon as the read position moves on
+      data: Buffer.from(this.bytes.subarray(start, start + length)),
+      frameCount: this.view.getUint32(offset + 4, true),
+      sequence: this.view.getUint32(offset + 8, true),
+      discontinuity: (this.view.getUint32(offset + 12, true) & 1) !== 0,
+      silent: (this.view.getUint32(offset + 12, true) & 2) !== 0,
+      framePosition: this.view.getFloat64(offset + 16, true),
+      hostTime: this.view.getBigUint64(offset + 24, true),
+    }
+
+    const recordBytes = RECORD_HEADER_BYTES + ((length + 7) & ~7)
+    Atomics.store(this.header, SLOT_READ, (read + recordBytes) | 0)
+    return chunk
+  }
+
+  private wait(ms: number): void {
+    if (this.canWait) {
+      // Announce before loading the write position, so a write after the load
+      // sees the waiter and asks for a notify
+      Atomics.add(this.header, SLOT_WAITERS, 1)
+      const write = Atomics.load(this.header, SLOT_WRITE)
+      Atomics.wait(this.header, SLOT_WRITE, write, ms)
+      Atomics.sub(this.header, SLOT_WAITERS, 1)
+    } else {
+      // Segments mapped from another process can't be waited on; sleep instead
+      Atomics.wait(new Int32Array(new SharedArrayBuffer(4)), 0, 0, ms)
+    }
+  }
+}
@@ -1,5 +1,5 @@
 import { BaseAudioRecorder } from './base-recorder.js'
-import type { SystemAudioRecorderOptions } from './types.js'
+import type { SystemAudioRecorderOptions, StartOptions } from './types.js'
 
 /**
  * Captures system audio on macOS using Core Audio process taps.
@@ -28,34 +28,63 @@ export class SystemAudioRecorder extends BaseAudioRecorder {
   private options: SystemAudioRecorderOptions
 
   constructor(options: SystemAudioRecorderOptions = {}) {
-    super()
+    super(options)
     this.options = options
   }
 
+  /**
+   * Build the process tap (macOS) or activate the loopback audio clients
+   * (Windows) now, so `start()` only has to begin streaming. They are kept
+   * across stop/start cycles until `releasePrepared()` or a start with
+   * different processes.
+   */
+  prepare(): Promise<void> {
+    return this.prepareCapture('system', {
+      mute: this.options.mute,
+      stereo: this.options.stereo,
+      channels: this.options.channels,
+      channelMatrix: this.options.channelMatrix,
+      includeProcesses: this.options.includeProcesses,
+      excludeProcesses: this.options.excludeProcesses,
+    })
+  }
+
   /**
    * Start capturing system audio.
+   * After `listen()`, streams from here with `options.preRollMs` of history.
    * @throws Error if already running or if permission is denied
    */
-  start(): Promise<void> {
+  start(options: StartOptions = {}): Promise<void> {
     return new Promise((resolve, reject) => {
+      if (this.listening) {
+        this.startFromLookback(options)
+        resolve()
+        return
+      }
       if (this.running) {
         reject(new Error('SystemAudioRecorder is already running'))
         return
       }
 
       try {
-        this.native.startSystemAudio({
-          sampleRate: this.options.sampleRate,
-          chunkDurationMs: this.options.chunkDurationMs,
-          mute: this.options.mute,
-          stereo: this.options.stereo,
-          emitSilence: this.options.emitSilence ?? true,
-          includeProcesses: this.options.includeProcesses,
-          excludeProcesses: this.options.excludeProcesses,
-        })
-
-        this.running = true
-        this.startPolling()
+        if (this.options.mixProcesses !== undefined) {
+          this.native.setOption?.('mixProcesses', this.options.mixProcesses)
+        }
+        this.startCapture(() =>
+          this.native.startSystemAudio({
+            sampleRate: this.options.sampleRate,
+            chunkDurationMs: this.options.chunkDurationMs,
+            subChunkDurationMs: this.options.subChunkDurationMs,
+            mute: this.options.mute,
+            stereo: this.options.stereo,
+            emitSilence: this.options.emitSilence ?? true,
+            includeProcesses: this.options.includeProcesses,
+            excludeProcesses: this.options.excludeProcesses,
+            channels: this.options.channels,
+            channelMatrix: this.options.channelMatrix,
+            outputFormat: this.options.outputFormat,
+          })
+        )
         resolve()
       } catch (error) {
         reject(error)
@@ -1,6 +1,25 @@
+import type { AudioChunkBatch } from './chunk-batch.js'
+
 // Common audio chunk structure
 export interface AudioChunk {
   data: Buffer
+  /** Chunk counter since start; a gap means chunks were dropped before reaching JS */
+  sequence: number
+  /** Index of the chunk's first frame in the output stream since start */
+  framePosition: number
+  /** Frames in this chunk */
+  frameCount: number
+  /**
+   * Capture time of the first frame in nanoseconds on the host clock, comparable
+   * to `process.hrtime.bigint()`. `0n` if the device reported no timestamp.
+   */
+  hostTime: bigint
+  /** Audio was lost right before this chunk (device glitch or native overrun) */
+  discontinuity: boolean
+  /** Synthesized silence (Windows `emitSilence`), not captured audio */
+  silent: boolean
+  /** Native sub-chunks merged into this chunk (`subChunkDurationMs`), else 1 */
+  subChunks: number
 }
 
 // Audio metadata from native layer
@@ -9,14 +28,94 @@ export interface AudioMetadata {
   channelsPerFrame: number
   bitsPerChannel: number
   isFloat: boolean
+  /**
+   * e.g. `'pcm_s16le'`; planar output carries a `'_planar'` suffix. Encoded
+   * streams report `'wav'`, `'flac'` or `'opus'`, with `bitsPerChannel`
+   * describing the decoded samples.
+   */
   encoding: string
+  /** Each chunk holds one contiguous block per channel instead of interleaved frames */
+  planar: boolean
+}
+
+export type SampleFormat = 'f32' | 's16' | 's24'
+
+/**
+ * Stream encoding applied natively to every chunk (see `OutputFormat.encoding`).
+ */
+export type OutputEncoding = 'pcm' | 'wav' | 'flac' | 'opus'
+
+/**
+ * Sample format and channel layout of emitted chunks, converted natively.
+ */
+export interface OutputFormat {
+  /**
+   * `'f32'` 32-bit float, `'s16'` signed 16-bit (dithered) or `'s24'` packed
+   * signed 24-bit, all little-endian.
+   * @default 'f32'
+   */
+  sampleFormat?: SampleFormat
+  /**
+   * `'interleaved'` frames (L R L R ...) or `'planar'` (all of channel 0, then
+   * channel 1, ...). Mono output is the same either way.
+   * @default 'interleaved'
+   */
+  layout?: 'interleaved' | 'planar'
+  /**
+   * Encode chunks natively so only compressed bytes reach JavaScript.
+   * Concatenating a session's chunks gives a complete stream:
+   * - `'wav'`: the first chunk starts with a RIFF header (sizes left at
+   *   0xFFFFFFFF, as for any stream of unknown length)
+   * - `'flac'`: the first chunk starts with the stream header; every chunk
+   *   holds whole frames. 16-bit, or 24-bit with `sampleFormat: 's24'`.
+   * - `'opus'`: each chunk is a run of 20 ms packets, each prefixed with its
+   *   byte length as a little-endian uint16. Needs 8, 12, 16, 24 or 48 kHz
+   *   output, at most two channels, and a native build linked with libopus.
+   *
+   * Encoded output is always interleaved and defaults to 16-bit samples.
+   * Starting fails with an error event if the encoding isn't available.
+   * @default 'pcm'
+   */
+  encoding?: OutputEncoding
+  /**
+   * Opus target bitrate in bits per second.
+   * @default 32000
+   */
+  bitrate?: number
 }
 
 // Common options shared by all recorder types
 export interface AudioRecorderOptions {
   sampleRate?: number
   chunkDurationMs?: number
+  /**
+   * Capture natively in sub-chunks of this many milliseconds and batch them up
+   * to `chunkDurationMs` before handing them to JavaScript, so frame size
+   * (e.g. 20ms for Opus or a VAD) and delivery rate are tuned separately.
+   * Levels, the silence gate and encoding work per sub-chunk, with one `level`
+   * event each; a stop or speech event delivers a partial batch early.
+   * `setChunkDuration()` then only changes the batch size.
+   *
+   * Batching needs the coalesced event callback (the default) or polling;
+   * without it every sub-chunk is delivered on its own.
+   */
+  subChunkDurationMs?: number
   stereo?: boolean
+  /**
+   * Keep only these source channels, in this order (e.g. `[0, 3]` from a
+   * 16-channel interface gives two-channel chunks). Applied natively before
+   * conversion, resampling and encoding; replaces the `stereo` downmix.
+   * A combined session's sources are `[system, microphone]`. Starting fails
+   * with an error event if an index exceeds the source's channels.
+   */
+  channels?: number[]
+  /**
+   * Mix the source channels through a matrix instead: one row of input
+   * weights per output channel, e.g. `[[0.5, 0.5, 0, 0]]` for a mono mix of
+   * the first two of four channels. Short rows are padded with zeros.
+   * Can't be combined with `channels`.
+   */
+  channelMatrix?: number[][]
   /**
    * Emit silent audio chunks when no audio is playing.
    * 
@@ -27,6 +126,345 @@ export interface AudioRecorderOptions {
    * @default true
    */
   emitSilence?: boolean
+  /**
+   * Sample format and layout of emitted chunks, identical on every platform.
+   * When omitted each platform keeps its historical output: 32-bit float on
+   * Windows; on macOS signed 16-bit when `sampleRate` is set, else the device format.
+   */
+  outputFormat?: OutputFormat
+  /**
+   * How events travel from the native layer to JavaScript.
+   * - `'push'`: the native layer calls into JS as soon as events are queued
+   *   (no timer, no idle wakeups)
+   * - `'poll'`: a 10ms interval drains the native queue
+   * @default 'push'
+   */
+  delivery?: 'push' | 'poll'
+  /**
+   * In push mode, deliver every event queued since the last delivery in one
+   * call instead of one call per event.
+   * @default true
+   */
+  coalesceEvents?: boolean
+  /**
+   * Deliver each run of queued chunks as one Buffer plus a compact index
+   * (a `dataBatch` event with an `AudioChunkBatch`) instead of one object and
+   * Buffer per chunk, which keeps bursts (after a GC pause, with small chunks
+   * or many streams) cheap. `data` listeners still get every chunk, as views
+   * into the batch's Buffer; leave them out to skip the per-chunk objects.
+   * @default false
+   */
+  packedData?: boolean
+  /**
+   * Maximum number of audio chunks buffered natively while JavaScript is busy
+   * (e.g. during a GC pause). The buffer is pre-allocated and lock-free.
+   * @default 256
+   */
+  queueCapacity?: number
+  /**
+   * What the capture thread does when the chunk queue is full (by
+   * `queueCapacity`, `maxQueuedBytes` or `maxQueuedMs`):
+   * - `'drop-oldest'`: discard the oldest queued chunks (bounded latency)
+   * - `'drop-newest'`: discard the incoming chunk
+   * - `'block'`: wait up to about one device period (10ms) for JavaScript to
+   *   drain the queue, then discard the incoming chunk; after a wait runs out,
+   *   chunks are discarded without waiting until the queue has room again
+   * - `'pause'`: discard incoming chunks until JavaScript has drained half the
+   *   queue, so a stall leaves one gap instead of scattered ones
+   *
+   * Drops are reported by the `drop` event and counted in {@link AudioRecorderStats}.
+   * @default 'drop-oldest'
+   */
+  overflowPolicy?: OverflowPolicy
+  /**
+   * Most chunk bytes queued natively for JavaScript; 0 means only
+   * `queueCapacity` applies. A single chunk is always let in.
+   * @default 0
+   */
+  maxQueuedBytes?: number
+  /**
+   * Most audio, in milliseconds of output frames, queued natively for
+   * JavaScript; 0 means only `queueCapacity` applies.
+   * @default 0
+   */
+  maxQueuedMs?: number
+  /**
+   * WASAPI shared-mode buffer duration in milliseconds. Values below 10 request
+   * a low-latency engine period (IAudioClient3, microphone only).
+   * **Windows only** - This option has no effect on macOS.
+   * @default 1000
+   */
+  bufferDurationMs?: number
+  /**
+   * Wake the capture thread when WASAPI signals a buffer instead of polling
+   * every 10ms. Falls back to polling automatically when an endpoint does not
+   * support event-driven capture.
+   * **Windows only** - This option has no effect on macOS.
+   * @default true
+   */
+  eventDriven?: boolean
+  /**
+   * Service this recorder from a small pool of native capture threads shared
+   * by all recorders that set it, instead of giving it a thread of its own.
+   * Worth it when capturing many processes at once; a full pool falls back
+   * to a dedicated thread.
+   * **Windows only** - This option has no effect on macOS.
+   * @default false
+   */
+  sharedCaptureThread?: boolean
+  /**
+   * Keep recording when the default device changes (or the one in use goes
+   * away): the native side reopens the new default and splices it into the
+   * same stream, flagging the first chunk after the switch as a discontinuity
+   * instead of stopping. Applies to the default microphone and to
+   * system-wide system audio; explicit `deviceId`s, process captures and
+   * virtual sources are unaffected. Output rate, channels, format and
+   * encoder stay as they were, with no new `metadata` event, so an encoded
+   * stream keeps its single header.
+   * @default false
+   */
+  followDefaultDevice?: boolean
+  /**
+   * Quality of the sample rate conversion applied when `sampleRate` differs
+   * from the device rate. Higher settings reject more aliasing at the cost of
+   * CPU and a few milliseconds of filter latency.
+   * @default 'medium'
+   */
+  resampleQuality?: ResampleQuality
+  /**
+   * Hold back chunks without activity in the native layer, so silence never
+   * reaches JavaScript. `speechStart` and `speechStop` events mark where
+   * delivery resumes and pauses; `framePosition` and `hostTime` on the next
+   * chunk show how much audio was skipped. `true` uses the default settings.
+   * @default false
+   */
+  silenceGate?: boolean | SilenceGateOptions
+  /**
+   * Measure per-channel peak, RMS and clip counts of every chunk natively and
+   * emit them as `level` events, so meters never decode PCM in JavaScript.
+   * `'only'` emits levels without any `data` events: no PCM is encoded or
+   * copied, which makes a meter-only view nearly free.
+   * @default false
+   */
+  levels?: boolean | 'only'
+  /**
+   * Record straight to a file from the native layer instead of emitting
+   * `data` events. A native writer thread batches chunks into large writes,
+   * so long recordings cost JavaScript nothing but `fileProgress` events.
+   * PCM is written as WAV (RF64 past 4 GiB) unless `raw` is set; encoded
+   * output (`outputFormat.encoding`) is written as its stream, with WAV and
+   * FLAC headers finished when the recorder stops.
+   */
+  file?: string | FileSinkOptions
+  /**
+   * Write chunks into a shared-memory ring instead of emitting `data` events,
+   * so a worker thread or another process reads them without the main thread
+   * touching the audio. Pass a SharedArrayBuffer from `createSharedAudioRing()`
+   * (read it with `SharedAudioRingReader` in a worker), or a name to create an
+   * OS shared-memory segment that `SharedAudioRingReader.openNamed()` maps in
+   * another process. The ring is marked stopped (and a named segment removed)
+   * when the recorder stops.
+   */
+  sharedRing?: SharedArrayBuffer | SharedRingOptions
+  /**
+   * Keep the last `lookbackMs` of audio in a native ring, so `listen()` can
+   * capture without delivering anything to JavaScript and a later
+   * `start({ preRollMs })` or `snapshot()` still returns what came just
+   * before. Chunks are kept as delivered, so an `outputFormat` of `'s16'` or
+   * an encoding keeps the ring compact; WAV and FLAC history starts with the
+   * stream header. 0 turns the ring off.
+   * @default 0
+   */
+  lookbackMs?: number
+}
+
+/**
+ * Options for `start()` (see {@link AudioRecorderOptions.lookbackMs}).
+ */
+export interface StartOptions {
+  /**
+   * When the recorder is listening, first deliver up to this much of the
+   * audio captured while listening, as one `data` chunk ahead of the next
+   * one (whole chunks, so slightly more). Ignored if it isn't listening.
+   * @default 0
+   */
+  preRollMs?: number
+}
+
+/**
+ * A named shared-memory ring (see {@link AudioRecorderOptions.sharedRing}).
+ */
+export interface SharedRingOptions {
+  /** Segment name, without slashes; must not exist yet */
+  name: string
+  /**
+   * Room for queued chunks, rounded up to a power of two.
+   * @default 1048576
+   */
+  capacityBytes?: number
+}
+
+/**
+ * Settings of the native file writer (see {@link AudioRecorderOptions.file}).
+ */
+export interface FileSinkOptions {
+  /** Output file, created or truncated on start */
+  path: string
+  /**
+   * Write bare PCM samples without a WAV header.
+   * @default false
+   */
+  raw?: boolean
+  /**
+   * Bytes buffered between the capture and writer threads. Chunks that don't
+   * fit while the disk is slow are dropped and counted.
+   * @default 8388608
+   */
+  bufferBytes?: number
+  /**
+   * Size of each write, rounded up to 4 KiB.
+   * @default 262144
+   */
+  blockBytes?: number
+  /**
+   * Disk space reserved up front (e.g. the expected size of the recording),
+   * so the file grows without fragmenting. Unused space is released on stop.
+   * @default 0
+   */
+  preallocateBytes?: number
+  /**
+   * How often `fileProgress` is emitted and the WAV header is updated, so a
+   * crash still leaves a readable file.
+   * @default 1000
+   */
+  progressIntervalMs?: number
+}
+
+/**
+ * Progress of a recording to file, emitted as `fileProgress`.
+ */
+export interface FileSinkProgress {
+  /** Bytes on disk, including the container header */
+  bytesWritten: number
+  /** Frames of chunks that are completely on disk */
+  framesWritten: number
+  /** Chunks dropped because the writer fell behind */
+  droppedChunks: number
+  /** True for the last event, once the file has been finished on stop */
+  final: boolean
+}
+
+export type ResampleQuality = 'low' | 'medium' | 'high'
+
+/**
+ * Settings of the native silence gate. Activity is detected per chunk from
+ * its RMS level, so shorter chunks react faster.
+ */
+export interface SilenceGateOptions {
+  /**
+   * RMS level in dBFS above which a chunk counts as activity.
+   * @default -50
+   */
+  thresholdDb?: number
+  /**
+   * How long chunks keep flowing after the last active one, so pauses
+   * between words don't split the stream.
+   * @default 500
+   */
+  hangoverMs?: number
+}
+
+export type OverflowPolicy = 'drop-oldest' | 'drop-newest' | 'block' | 'pause'
+
+/**
+ * Timing of one processing stage, from a histogram with buckets at most 25% wide.
+ * Percentiles are bucket upper bounds, so they can overstate by up to a quarter.
+ */
+export interface AudioStageStats {
+  /** Calls timed */
+  count: number
+  meanUs: number
+  maxUs: number
+  p50Us: number
+  p90Us: number
+  p99Us: number
+}
+
+/**
+ * Native queue and capture statistics returned by `getStats()`.
+ * Capture counters and stage timings cover the session since the last start.
+ */
+export interface AudioRecorderStats {
+  /** Maximum number of chunks the native queue holds */
+  queueCapacity: number
+  /** Chunks currently waiting to be delivered to JavaScript */
+  queuedChunks: number
+  /** Highest number of chunks that were waiting at once */
+  peakQueuedChunks: number
+  /** Total chunks discarded because the queue was full */
+  droppedChunks: number
+  /** Chunks discarded by the `'drop-oldest'` policy */
+  droppedOldest: number
+  /** Chunks discarded by `'drop-newest'` or `'pause'` (or `'block'` while stopping) */
+  droppedNewest: number
+  /** Audio frames in the discarded chunks */
+  droppedFrames: number
+  /** Chunk bytes currently waiting */
+  queuedBytes: number
+  /** Audio frames currently waiting */
+  queuedFrames: number
+  /** Delivery is held by `pause()` */
+  deliveryPaused: boolean
+  /** Times the capture thread had to wait under the `'block'` policy */
+  blockedWrites: number
+  /** Chunk buffers currently allocated by the native pool */
+  pooledSlabs: number
+  /** Device buffers read */
+  packets: number
+  /** Device frames in them, at the device rate */
+  framesCaptured: number
+  /** Chunks the capture side produced (chunks held back by the silence gate excluded) */
+  chunksEmitted: number
+  /** Output frames in those chunks */
+  framesEmitted: number
+  /** Device buffers that followed lost data */
+  discontinuities: number
+  /** Device buffers without a usable capture timestamp */
+  timestampErrors: number
+  /** Device data lost before processing because the capture thread fell behind (macOS) */
+  deviceDroppedBytes: number
+  /** Buffers held by the capture path and the chunk pool */
+  bytesAllocated: number
+  /** Per-stage processing time */
+  stages: {
+    /** Gain, downmix and sample format conversion */
+    convert: AudioStageStats
+    /** Sample rate conversion (on macOS, the whole conversion when the rate changes) */
+    resample: AudioStageStats
+    /** Metering, gating, encoding and queueing each chunk */
+    chunk: AudioStageStats
+    /** From a chunk being queued until JavaScript receives it */
+    delivery: AudioStageStats
+  }
+}
+
+/**
+ * Statistics returned by `MicrophoneActivityMonitor.getStats()`, since construction.
+ */
+export interface MicActivityMonitorStats {
+  /** Changes of the overall active state */
+  activityChanges: number
+  /** Per-device changes */
+  deviceChanges: number
+  errors: number
+  /** Events handed to JavaScript */
+  eventsDelivered: number
+  /** Events waiting to be delivered */
+  queuedEvents: number
+  /** Highest number of events that were waiting at once */
+  peakQueuedEvents: number
+  /** From an event being queued until JavaScript receives it */
+  delivery: AudioStageStats
 }
 
 // System audio specific options
@@ -38,7 +476,8 @@ export interface SystemAudioRecorderOptions extends AudioRecorderOptions {
   mute?: boolean
   /**
    * Only capture audio from these process IDs.
-   * **Note:** On Windows, only the first process ID is used (OS limitation).
+   * On Windows each process gets its own loopback client; their streams are
+   * aligned natively and mixed (see `mixProcesses`).
    */
   includeProcesses?: number[]
   /**
@@ -46,6 +485,14 @@ export interface SystemAudioRecorderOptions extends AudioRecorderOptions {
    * **Note:** On Windows, only the first process ID is used (OS limitation).
    */
   excludeProcesses?: number[]
+  /**
+   * With several `includeProcesses` on Windows, sum them into one stream
+   * (`true`), or deliver one mono channel per process in the order given
+   * (`false`), sample-aligned in the same chunks.
+   * **Windows only** - macOS always captures the processes as one mix.
+   * @default true
+   */
+  mixProcesses?: boolean
 }
 
 // Microphone specific options
@@ -54,6 +501,58 @@ export interface MicrophoneRecorderOptions extends AudioRecorderOptions {
   gain?: number
 }
 
+/**
+ * Options for a combined system audio + microphone session. Output has two
+ * channels: system audio (downmixed) on channel 0 and the microphone on
+ * channel 1, aligned on the capture clock. `channels` or `channelMatrix`
+ * pick or mix these two.
+ */
+export interface CombinedAudioRecorderOptions
+  extends Omit<SystemAudioRecorderOptions, 'stereo' | 'emitSilence' | 'mixProcesses'> {
+  /** Microphone device ID (default input device if omitted) */
+  deviceId?: string
+  /** Microphone gain (1.0 = unity) */
+  gain?: number
+}
+
+/**
+ * Synthetic signal fed to a `VirtualAudioRecorder` in place of a device.
+ * The same options and seed always produce the same samples.
+ */
+export interface VirtualSourceOptions {
+  /** @default 48000 */
+  sampleRate?: number
+  /** @default 2 */
+  channels?: number
+  /** Frames per packet, i.e. the simulated device buffer size. @default 480 */
+  packetFrames?: number
+  /** @default 'sine' */
+  signal?: 'sine' | 'noise' | 'silence'
+  /** Sine frequency in Hz. @default 440 */
+  frequency?: number
+  /** Peak level, 0 to 1. @default 0.5 */
+  amplitude?: number
+  /** Noise seed; 0 picks a fixed default. @default 0 */
+  seed?: number
+  /**
+   * Pace packets at the source rate like a device. `false` generates them
+   * back to back, for measuring throughput.
+   * @default true
+   */
+  realtime?: boolean
+  /** Stop generating after this much audio (the recorder runs on until `stop()`); 0 = no limit. @default 0 */
+  durationMs?: number
+}
+
+/**
+ * Options for a recorder fed by a synthetic source instead of a device. The
+ * audio goes through the same native pipeline, queue and delivery as device
+ * capture, so it works without hardware or permissions.
+ */
+export interface VirtualAudioRecorderOptions extends AudioRecorderOptions {
+  source?: VirtualSourceOptions
+}
+
 // Audio device information
 export interface AudioDevice {
   id: string
@@ -66,6 +565,22 @@ export interface AudioDevice {
   channelCount: number
 }
 
+/**
+ * Events emitted by `audioDeviceEvents`.
+ */
+export interface AudioDeviceEvents {
+  /**
+   * Emitted after a device is added or removed, changes its name or format,
+   * or becomes the default. `devices` is the updated list.
+   */
+  devicechange: (devices: AudioDevice[]) => void
+
+  /**
+   * Emitted when the updated list could not be read.
+   */
+  error: (error: Error) => void
+}
+
 // Events shared by all recorder types
 export interface AudioRecorderEvents {
   data: (chunk: AudioChunk) => void
@@ -73,18 +588,88 @@ export interface AudioRecorderEvents {
   start: () => void
   stop: () => void
   error: (error: Error) => void
+  /** The silence gate opened; the next chunk is the first with activity */
+  speechStart: () => void
+  /** The silence gate closed; chunks stop until activity resumes */
+  speechStop: () => void
+  /** Levels of one chunk (requires the `levels` option) */
+  level: (levels: AudioLevels) => void
+  /** Progress of a recording to file (requires the `file` option) */
+  fileProgress: (progress: FileSinkProgress) => void
+  /** Chunks were discarded by the overflow policy; emitted before the chunks that follow the gap */
+  drop: (drop: AudioDropInfo) => void
+  /** Consecutive chunks in one Buffer (requires the `packedData` option); emitted before their `data` events */
+  dataBatch: (batch: AudioChunkBatch) => void
+}
+
+/**
+ * Chunks discarded since the previous `drop` event.
+ */
+export interface AudioDropInfo {
+  /** Chunks discarded (level reports included) */
+  chunks: number
+  /** Of those, queued chunks discarded by `'drop-oldest'` */
+  oldest: number
+  /** Of those, incoming chunks discarded by `'drop-newest'`, `'pause'` or `'block'` */
+  newest: number
+  /** Audio frames lost */
+  frames: number
+  /** Audio lost in milliseconds, 0 before the metadata event */
+  durationMs: number
+}
+
+/**
+ * Per-channel levels of one chunk, measured natively before encoding.
+ * Linear values: 1.0 is full scale, `20 * Math.log10(value)` gives dBFS.
+ * Chunks held back by the silence gate are metered too.
+ */
+export interface AudioLevels {
+  /** Largest absolute sample per channel */
+  peak: number[]
+  /** Root mean square per channel */
+  rms: number[]
+  /** Samples at or beyond full scale per channel */
+  clipped: number[]
+  /** Sequence number of the chunk (the next one for a held-back chunk) */
+  sequence: number
+  /** First frame of the chunk in the output stream */
+  framePosition: number
+  /** Frames in the chunk */
+  frameCount: number
+  /** Capture time of the first frame (ns, process.hrtime.bigint() clock) */
+  hostTime: bigint
 }
 
 // Native addon event interface (internal)
 export interface NativeEvent {
-  type: number // 0=data, 1=start, 2=stop, 3=error, 4=metadata
+  type: number // 0=data, 1=start, 2=stop, 3=error, 4=metadata, 5=speechStart, 6=speechStop, 7=level, 8=fileProgress, 9=drop, 10=snapshot, 11=packed data
   data?: Buffer
+  index?: Float64Array
+  flags?: Uint32Array
+  hostTimes?: BigUint64Array
+  sequence?: number
+  framePosition?: number
+  frameCount?: number
+  hostTime?: bigint
+  discontinuity?: boolean
+  silent?: boolean
+  subChunks?: number
+  peak?: number[]
+  rms?: number[]
+  clipped?: number[]
   message?: string
   sampleRate?: number
   channelsPerFrame?: number
   bitsPerChannel?: number
   isFloat?: boolean
   encoding?: string
+  bytesWritten?: number
+  framesWritten?: number
+  droppedChunks?: number
+  droppedOldest?: number
+  droppedNewest?: number
+  droppedFrames?: number
+  final?: boolean
 }
 
 // ============================================================================
@@ -118,6 +703,13 @@ export interface MicrophoneActivityMonitorOptions {
    */
   scope?: 'all' | 'default'
 
+  /**
+   * How events travel from the native layer to JavaScript.
+   * See {@link AudioRecorderOptions.delivery}.
+   * @default 'push'
+   */
+  delivery?: 'push' | 'poll'
+
   /**
    * Polling fallback interval in milliseconds.
    * Used when native event listeners are unavailable.
@@ -174,6 +766,8 @@ export interface MicActivityMonitorNativeClass {
   getActiveDeviceIds(): string[]
   getActiveProcesses(): Array<{ pid: number; name: string; bundleId: string }>
   processEvents(): MicActivityNativeEvent[]
+  setEventCallback?(callback: ((events: MicActivityNativeEvent[]) => void) | null): void
+  getStats?(): MicActivityMonitorStats
 }
 
 /**
@@ -189,25 +783,88 @@ export interface AudioRecorderNativeClass {
   startSystemAudio(options: {
     sampleRate?: number
     chunkDurationMs?: number
+    subChunkDurationMs?: number
     mute?: boolean
     stereo?: boolean
     emitSilence?: boolean
     includeProcesses?: number[]
     excludeProcesses?: number[]
+    channels?: number[]
+    channelMatrix?: number[][]
+    outputFormat?: OutputFormat
   }): void
   startMicrophone(options: {
     sampleRate?: number
     chunkDurationMs?: number
+    subChunkDurationMs?: number
     stereo?: boolean
     emitSilence?: boolean
     deviceId?: string
     gain?: number
+    channels?: number[]
+    channelMatrix?: number[][]
+    outputFormat?: OutputFormat
+  }): void
+  startCombined(options: {
+    sampleRate?: number
+    chunkDurationMs?: number
+    subChunkDurationMs?: number
+    mute?: boolean
+    includeProcesses?: number[]
+    excludeProcesses?: number[]
+    deviceId?: string
+    gain?: number
+    channels?: number[]
+    channelMatrix?: number[][]
+    outputFormat?: OutputFormat
+  }): void
+  startVirtual?(options: {
+    sampleRate?: number
+    chunkDurationMs?: number
+    subChunkDurationMs?: number
+    stereo?: boolean
+    channels?: number[]
+    channelMatrix?: number[][]
+    outputFormat?: OutputFormat
+    source?: VirtualSourceOptions
   }): void
+  prepare?(
+    source: 'system' | 'microphone' | 'combined',
+    options: {
+      mute?: boolean
+      stereo?: boolean
+      channels?: number[]
+      channelMatrix?: number[][]
+      includeProcesses?: number[]
+      excludeProcesses?: number[]
+      deviceId?: string
+    }
+  ): void
+  releasePrepared?(): void
   stop(): void
   isRunning(): boolean
   processEvents(): NativeEvent[]
+  setEventCallback?(
+    callback: ((events: NativeEvent[]) => void) | null,
+    options?: { coalesce?: boolean }
+  ): void
+  getStats?(): AudioRecorderStats
+  pause?(): void
+  resume?(): void
+  setOption?(key: string, value: number | boolean): boolean
+  setFileSink?(path: string | null, options?: Omit<FileSinkOptions, 'path'>): void
+  setSharedRing?(ring: Int32Array | string | null, options?: { capacityBytes?: number }): void
+  setListening?(listening: boolean, preRollMs?: number): void
+  /** undefined while recording: the result arrives as a snapshot event */
+  snapshot?(ms: number): NativeEvent | null | undefined
 }
 
 export interface AudioRecorderNativeConstructor {
-  new (): AudioRecorderNativeClass
+  new (options?: {
+    queueCapacity?: number
+    overflowPolicy?: OverflowPolicy
+    maxQueuedBytes?: number
+    maxQueuedMs?: number
+    packData?: boolean
+  }): AudioRecorderNativeClass
 }
@@ -0,0 +1,75 @@
+import { BaseAudioRecorder } from './base-recorder.js'
+import type { VirtualAudioRecorderOptions, StartOptions } from './types.js'
+
+/**
+ * Records a synthetic signal instead of a device. Chunks go through the same
+ * native resampling, conversion, encoding, queue and delivery as the other
+ * recorders, so it suits benchmarks, load tests and CI machines without
+ * audio hardware or permissions.
+ *
+ * @example
+ * ```typescript
+ * import { VirtualAudioRecorder } from 'native-audio-node'
+ *
+ * const recorder = new VirtualAudioRecorder({
+ *   sampleRate: 16000,
+ *   chunkDurationMs: 100,
+ *   source: { sampleRate: 48000, channels: 2, signal: 'noise', durationMs: 5000 },
+ * })
+ *
+ * recorder.on('data', (chunk) => {
+ *   console.log(`Received ${chunk.data.length} bytes`)
+ * })
+ *
+ * await recorder.start()
+ * ```
+ */
+export class VirtualAudioRecorder extends BaseAudioRecorder {
+  private options: VirtualAudioRecorderOptions
+
+  constructor(options: VirtualAudioRecorderOptions = {}) {
+    super(options)
+    this.options = options
+  }
+
+  /**
+   * Start generating and capturing the synthetic signal.
+   * After `listen()`, streams from here with `options.preRollMs` of history.
+   * @throws Error if already running or the source options are invalid
+   */
+  start(options: StartOptions = {}): Promise<void> {
+    return new Promise((resolve, reject) => {
+      if (this.listening) {
+        this.startFromLookback(options)
+        resolve()
+        return
+      }
+      if (this.running) {
+        reject(new Error('VirtualAudioRecorder is already running'))
+        return
+      }
+      if (typeof this.native.startVirtual !== 'function') {
+        reject(new Error('VirtualAudioRecorder is not supported by this native build'))
+        return
+      }
+
+      try {
+        this.startCapture(() =>
+          this.native.startVirtual!({
+            sampleRate: this.options.sampleRate,
+            chunkDurationMs: this.options.chunkDurationMs,
+            subChunkDurationMs: this.options.subChunkDurationMs,
+            stereo: this.options.stereo,
+            channels: this.options.channels,
+            channelMatrix: this.options.channelMatrix,
+            outputFormat: this.options.outputFormat,
+            source: this.options.source,
+          })
+        )
+        resolve()
+      } catch (error) {
+        reject(error)
+      }
+    })
+  }
+}
@@ -0,0 +1,182 @@
+#!/usr/bin/env node
+
+/**
+ * Load-test the capture path end to end with synthetic sources.
+ *
+ * Runs N VirtualAudioRecorders at once, each pacing a generated signal like a
+ * device, through the native pipeline, queue and delivery into JavaScript,
+ * and reports how many such streams one core sustains, the per-chunk latency
+ * of each stage and the memory the session holds.
+ *
+ * Build first (`pnpm run build`), then:
+ *   node scripts/bench.js                        # 8 streams, 10 s, 48k stereo -> 16k mono s16
+ *   node scripts/bench.js --streams 64 --seconds 30
+ *   node scripts/bench.js --encoding flac --json
+ *   node scripts/bench.js --no-realtime          # generate as fast as possible (throughput)
+ *
+ * For the pipeline alone, without Node, see native/bench/capture_bench.cpp.
+ */
+
+import { cpus } from 'os'
+import { parseArgs } from 'util'
+import { VirtualAudioRecorder } from '../packages/native-audio-node/dist/index.js'
+
+const { values } = parseArgs({
+  options: {
+    streams: { type: 'string', short: 'n', default: '8' },
+    seconds: { type: 'string', short: 'd', default: '10' },
+    'source-rate': { type: 'string', default: '48000' },
+    channels: { type: 'string', default: '2' },
+    'sample-rate': { type: 'string', short: 's', default: '16000' },
+    chunk: { type: 'string', short: 'c', default: '100' },
+    format: { type: 'string', short: 'f', default: 's16' },
+    encoding: { type: 'string', short: 'e', default: 'pcm' },
+    stereo: { type: 'boolean', default: false },
+    'no-realtime': { type: 'boolean', default: false },
+    json: { type: 'boolean', default: false },
+    help: { type: 'boolean', short: 'h', default: false },
+  },
+})
+
+if (values.help) {
+  console.log(`
+Usage: node scripts/bench.js [options]
+
+Options:
+  -n, --streams <n>       Concurrent recorders (default: 8)
+  -d, --seconds <s>       Run time in seconds (default: 10)
+      --source-rate <hz>  Virtual source rate (default: 48000)
+      --channels <n>      Virtual source channels (default: 2)
+  -s, --sample-rate <hz>  Output rate (default: 16000)
+  -c, --chunk <ms>        Chunk duration (default: 100)
+  -f, --format <fmt>      f32 | s16 | s24 (default: s16)
+  -e, --encoding <enc>    pcm | wav | flac | opus (default: pcm)
+      --stereo            Keep the source channels instead of downmixing
+      --no-realtime       Generate packets back to back instead of at the source rate
+      --json              Print the result as JSON
+  -h, --help              Show this help
+`)
+  process.exit(0)
+}
+
+const streams = parseInt(values.streams, 10)
+const seconds = parseFloat(values.seconds)
+const realtime = !values['no-realtime']
+
+function mean(list) {
+  return list.length ? list.reduce((a, b) => a + b, 0) / list.length : 0
+}
+
+function max(list) {
+  return list.length ? Math.max(...list) : 0
+}
+
+async function main() {
+  const recorders = []
+  const received = []
+  for (let i = 0; i < streams; i++) {
+    const recorder = new VirtualAudioRecorder({
+      sampleRate: parseFloat(values['sample-rate']),
+      chunkDurationMs: parseFloat(values.chunk),
+      stereo: values.stereo,
+      outputFormat: { sampleFormat: values.format, encoding: values.encoding },
+      source: {
+        sampleRate: parseFloat(values['source-rate']),
+        channels: parseInt(values.channels, 10),
+        signal: 'noise',
+        seed: i + 1,
+        realtime,
+      },
+    })
+    const counts = { chunks: 0, bytes: 0, gaps: 0, lastSequence: -1 }
+    recorder.on('data', (chunk) => {
+      counts.chunks++
+      counts.bytes += chunk.data.length
+      if (counts.lastSequence >= 0 && chunk.sequence !== counts.lastSequence + 1) counts.gaps++
+      counts.lastSequence = chunk.sequence
+    })
+    recorder.on('error', (error) => {
+      console.error(`stream ${i}: ${error.message}`)
+    })
+    recorders.push(recorder)
+    received.push(counts)
+  }
+
+  const heapBefore = process.memoryUsage()
+  const cpuBefore = process.cpuUsage()
+  const wallBefore = process.hrtime.bigint()
+
+  await Promise.all(recorders.map((recorder) => recorder.start()))
+  await new Promise((resolve) => setTimeout(resolve, seconds * 1000))
+
+  // Read the stats while still running, so they cover the whole session
+  const stats = recorders.map((recorder) => recorder.getStats())
+  await Promise.all(recorders.map((recorder) => recorder.stop()))
+
+  const wallSeconds = Number(process.hrtime.bigint() - wallBefore) / 1e9
+  const cpu = process.cpuUsage(cpuBefore)
+  const cpuSeconds = (cpu.user + cpu.system) / 1e6
+  const heapAfter = process.memoryUsage()
+
+  const valid = stats.filter(Boolean)
+  const stage = (name) => {
+    const entries = valid.map((s) => s.stages[name]).filter((s) => s.count > 0)
+    return {
+      p50Us: mean(entries.map((s) => s.p50Us)),
+      p99Us: max(entries.map((s) => s.p99Us)),
+      maxUs: max(entries.map((s) => s.maxUs)),
+    }
+  }
+
+  // Total CPU (all native threads plus JS) per stream-second of wall time
+  const coresUsed = cpuSeconds / wallSeconds
+  const result = {
+    streams,
+    seconds: wallSeconds,
+    realtime,
+    cores: cpus().length,
+    cpuPercent: coresUsed * 100,
+    streamsPerCore: coresUsed > 0 ? streams / coresUsed : 0,
+    chunks: received.reduce((sum, r) => sum + r.chunks, 0),
+    bytes: received.reduce((sum, r) => sum + r.bytes, 0),
+    sequenceGaps: received.reduce((sum, r) => sum + r.gaps, 0),
+    droppedChunks: valid.reduce((sum, s) => sum + s.droppedChunks, 0),
+    peakQueuedChunks: max(valid.map((s) => s.peakQueuedChunks)),
+    stages: {
+      convert: stage('convert'),
+      resample: stage('resample'),
+      chunk: stage('chunk'),
+      delivery: stage('delivery'),
+    },
+    memory: {
+      nativeBytesAllocated: valid.reduce((sum, s) => sum + s.bytesAllocated, 0),
+      pooledSlabs: valid.reduce((sum, s) => sum + s.pooledSlabs, 0),
+      rssDelta: heapAfter.rss - heapBefore.rss,
+      heapUsedDelta: heapAfter.heapUsed - heapBefore.heapUsed,
+      externalDelta: heapAfter.external - heapBefore.external,
+    },
+  }
+
+  if (values.json) {
+    console.log(JSON.stringify(result, null, 2))
+    return
+  }
+
+  const us = (s) => `p50 ${s.p50Us.toFixed(1)}us  p99 ${s.p99Us.toFixed(1)}us  max ${s.maxUs.toFixed(1)}us`
+  const mb = (bytes) => `${(bytes / 1048576).toFixed(2)} MB`
+  console.log(`${streams} streams for ${wallSeconds.toFixed(1)}s (${realtime ? 'realtime' : 'as fast as possible'})`)
+  console.log(`  CPU          ${result.cpuPercent.toFixed(1)}% of one core (${result.cores} cores)`)
+  console.log(`  Throughput   ${result.streamsPerCore.toFixed(1)} streams per core`)
+  console.log(`  Chunks       ${result.chunks} (${mb(result.bytes)}), ${result.droppedChunks} dropped, ${result.sequenceGaps} gaps`)
+  console.log(`  Queue        peak ${result.peakQueuedChunks} chunks`)
+  for (const [name, s] of Object.entries(result.stages)) {
+    console.log(`  ${name.padEnd(12)} ${us(s)}`)
+  }
+  console.log(`  Native       ${mb(result.memory.nativeBytesAllocated)} in buffers, ${result.memory.pooledSlabs} pooled slabs`)
+  console.log(`  Process      RSS ${mb(result.memory.rssDelta)}, heap ${mb(result.memory.heapUsedDelta)}, external ${mb(result.memory.externalDelta)}`)
+}
+
+main().catch((error) => {
+  console.error(error)
+  process.exit(1)
+})